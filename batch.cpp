@@ -0,0 +1,465 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Batch mode of the CLI: runs many tool invocations in parallel */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "batch.h"
+#include "tools.h"
+#include "tool_exception.h"
+#include "tool_trace.h"
+#include "common/file_hash.h"
+#include "common/parallel.h"
+
+namespace {
+
+bool isPathDirectory(const std::string &path) {
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+bool pathExists(const std::string &path) {
+	struct stat st;
+	return stat(path.c_str(), &st) == 0;
+}
+
+/** Appends a '/' to a directory path, if it does not already end with one. */
+std::string directoryPath(const std::string &path) {
+	if (!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\')
+		return path + '/';
+	return path;
+}
+
+std::string absolutePath(const std::string &path) {
+	if (path.empty() || path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'))
+		return path;
+	char cwd[4096];
+#ifdef _WIN32
+	if (!_getcwd(cwd, sizeof(cwd)))
+#else
+	if (!getcwd(cwd, sizeof(cwd)))
+#endif
+		return path;
+	return directoryPath(cwd) + path;
+}
+
+/** Lists the entries of a directory, sorted by name, excluding "." and "..". */
+std::vector<std::string> listDirectory(const std::string &path) {
+	std::vector<std::string> entries;
+	DIR *dir = opendir(path.c_str());
+	if (!dir)
+		return entries;
+	while (struct dirent *entry = readdir(dir)) {
+		std::string name = entry->d_name;
+		if (name != "." && name != "..")
+			entries.push_back(name);
+	}
+	closedir(dir);
+	std::sort(entries.begin(), entries.end());
+	return entries;
+}
+
+/** Returns the size of a file, or the total size of the files in a directory tree. */
+uint64 pathSize(const std::string &path) {
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return 0;
+	if (!S_ISDIR(st.st_mode))
+		return st.st_size;
+
+	uint64 size = 0;
+	std::vector<std::string> entries = listDirectory(path);
+	for (std::vector<std::string>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+		size += pathSize(directoryPath(path) + *entry);
+	return size;
+}
+
+bool makeDirectory(const std::string &path) {
+#ifdef _WIN32
+	return _mkdir(path.c_str()) == 0 || isPathDirectory(path);
+#else
+	return mkdir(path.c_str(), 0755) == 0 || isPathDirectory(path);
+#endif
+}
+
+bool copyFile(const std::string &from, const std::string &to) {
+	std::ifstream input(from.c_str(), std::ios::binary);
+	std::ofstream output(to.c_str(), std::ios::binary);
+	if (!input || !output)
+		return false;
+	output << input.rdbuf();
+	return (bool)output;
+}
+
+/** Moves the files of a directory tree into another directory, replacing the files of the same name. */
+bool moveTree(const std::string &from, const std::string &to) {
+	if (!makeDirectory(to))
+		return false;
+
+	bool moved = true;
+	std::vector<std::string> entries = listDirectory(from);
+	for (std::vector<std::string>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry) {
+		std::string source = directoryPath(from) + *entry;
+		std::string target = directoryPath(to) + *entry;
+		if (isPathDirectory(source)) {
+			moved = moveTree(source, target) && moved;
+			continue;
+		}
+#ifdef _WIN32
+		remove(target.c_str());
+#endif
+		// Copy when the output directory is on another file system
+		if (rename(source.c_str(), target.c_str()) != 0)
+			moved = copyFile(source, target) && remove(source.c_str()) == 0 && moved;
+	}
+	rmdir(from.c_str());
+	return moved;
+}
+
+void removeTree(const std::string &path) {
+	if (isPathDirectory(path)) {
+		std::vector<std::string> entries = listDirectory(path);
+		for (std::vector<std::string>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+			removeTree(directoryPath(path) + *entry);
+		rmdir(path.c_str());
+	} else {
+		remove(path.c_str());
+	}
+}
+
+/** Quotes an argument for the command interpreter used by system(). */
+std::string quoteArgument(const std::string &arg) {
+#ifdef _WIN32
+	return '"' + arg + '"';
+#else
+	std::string quoted = "'";
+	for (std::string::const_iterator c = arg.begin(); c != arg.end(); ++c) {
+		if (*c == '\'')
+			quoted += "'\\''";
+		else
+			quoted += *c;
+	}
+	return quoted + "'";
+#endif
+}
+
+/** Splits a manifest line into arguments. Double quotes group words containing spaces. */
+std::deque<std::string> splitLine(const std::string &line) {
+	std::deque<std::string> args;
+	std::string arg;
+	bool inArg = false, inQuotes = false;
+	for (std::string::const_iterator c = line.begin(); c != line.end(); ++c) {
+		if (*c == '"') {
+			inQuotes = !inQuotes;
+			inArg = true;
+		} else if ((*c == ' ' || *c == '\t' || *c == '\r') && !inQuotes) {
+			if (inArg)
+				args.push_back(arg);
+			arg.clear();
+			inArg = false;
+		} else {
+			arg += *c;
+			inArg = true;
+		}
+	}
+	if (inArg)
+		args.push_back(arg);
+	return args;
+}
+
+/** Returns the last non-empty line of a text file. */
+std::string lastLine(const std::string &path) {
+	std::ifstream file(path.c_str());
+	std::string line, last;
+	while (std::getline(file, line)) {
+		line.erase(0, line.find_first_not_of(" \t\r"));
+		if (!line.empty())
+			last = line;
+	}
+	return last;
+}
+
+} // End of anonymous namespace
+
+BatchRunner::BatchRunner(const Tools &tools, const std::string &executable) :
+	_tools(tools), _executable(executable), _seconds(0) {
+	if (_executable.find('/') != std::string::npos || _executable.find('\\') != std::string::npos)
+		_executable = absolutePath(_executable);
+}
+
+void BatchRunner::addManifest(const std::string &manifest) {
+	std::ifstream file(manifest.c_str());
+	if (!file)
+		throw ToolException("Could not open manifest '" + manifest + "'.");
+
+	std::string line;
+	for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+		std::deque<std::string> args = splitLine(line);
+		if (args.empty() || args.front()[0] == '#')
+			continue;
+
+		std::string tool = args.front();
+		args.pop_front();
+		if (tool != "auto" && !_tools.getTool(tool)) {
+			std::ostringstream os;
+			os << "Unknown tool '" << tool << "' on line " << lineNumber << " of manifest '" << manifest << "'.";
+			throw ToolException(os.str());
+		}
+		addJob(tool, args);
+	}
+}
+
+void BatchRunner::addDirectory(const std::string &directory, const std::deque<std::string> &options) {
+	std::vector<std::string> inputs;
+	std::vector<std::string> entries = listDirectory(directory);
+	for (std::vector<std::string>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry) {
+		// The hash cache of the directory is not a game file
+		if (*entry == Common::kFileHashSidecarName)
+			continue;
+		std::string path = directoryPath(directory) + *entry;
+		if (!isPathDirectory(path)) {
+			inputs.push_back(path);
+			continue;
+		}
+
+		// A game install: the directory itself and the files it contains
+		inputs.push_back(directoryPath(path));
+		std::vector<std::string> files = listDirectory(path);
+		for (std::vector<std::string>::const_iterator file = files.begin(); file != files.end(); ++file)
+			if (*file != Common::kFileHashSidecarName && !isPathDirectory(directoryPath(path) + *file))
+				inputs.push_back(directoryPath(path) + *file);
+	}
+
+	// Some tools recognize their inputs by the MD5 of their first bytes: hash
+	// all the files at once beforehand, so that inspecting them hits the cache
+	Common::FileHashCache &hashes = Common::FileHashCache::instance();
+	parallelFor(inputs.size(), std::max(std::thread::hardware_concurrency(), 1U), [&](size_t i) {
+		uint8 digest[16];
+		if (!isPathDirectory(inputs[i]))
+			hashes.md5(inputs[i], Common::kDetectionHashSize, digest);
+	});
+	hashes.save();
+
+	for (std::vector<std::string>::const_iterator input = inputs.begin(); input != inputs.end(); ++input) {
+		Tools::ToolList choices = _tools.inspectInput(*input);
+		if (choices.size() != 1 || choices.front()->_inputPaths.size() != 1)
+			continue;
+		if (choices.front()->inspectInput(*input) != IMATCH_PERFECT)
+			continue;
+
+		std::deque<std::string> args = options;
+		args.push_back(*input);
+		addJob(choices.front()->getName(), args);
+	}
+}
+
+void BatchRunner::addJob(const std::string &tool, const std::deque<std::string> &arguments) {
+	BatchJob job;
+	job.tool = tool;
+
+	for (std::deque<std::string>::const_iterator arg = arguments.begin(); arg != arguments.end(); ++arg) {
+		if ((*arg == "-o" || *arg == "--output") && arg + 1 != arguments.end()) {
+			// The output option is added back when the jobs run
+			job.outputPath = directoryPath(absolutePath(*++arg));
+		} else if (*arg == "--trace" && arg + 1 != arguments.end()) {
+			// Jobs run in their own working directory, which is removed
+			job.arguments.push_back(*arg++);
+			job.arguments.push_back(absolutePath(*arg));
+		} else if (pathExists(*arg)) {
+			// Jobs run in their own working directory
+			job.arguments.push_back(absolutePath(*arg));
+			job.bytesIn += pathSize(*arg);
+		} else {
+			job.arguments.push_back(*arg);
+		}
+	}
+
+	if (tool == "auto") {
+		// As in the normal CLI mode, the input is the last argument that a tool accepts
+		job.tool.clear();
+		for (std::deque<std::string>::const_reverse_iterator arg = job.arguments.rbegin(); arg != job.arguments.rend(); ++arg) {
+			if (!pathExists(*arg))
+				continue;
+			Tools::ToolList choices = _tools.inspectInput(*arg);
+			if (choices.size() == 1)
+				job.tool = choices.front()->getName();
+			else
+				job.error = "Could not detect a single tool for input '" + *arg + "'.";
+			break;
+		}
+		if (job.tool.empty() && job.error.empty())
+			job.error = "No input found.";
+	}
+
+	_jobs.push_back(job);
+}
+
+int BatchRunner::run(const std::string &outputPath, unsigned int jobs) {
+	std::string root = directoryPath(absolutePath(outputPath.empty() ? std::string(".") : outputPath));
+	if (!makeDirectory(root))
+		throw ToolException("Could not create output directory '" + root + "'.");
+
+	for (size_t i = 0; i < _jobs.size(); i++) {
+		BatchJob &job = _jobs[i];
+		std::ostringstream name;
+		name << (job.tool.empty() ? "auto" : job.tool) << '-' << (i + 1);
+		job.tempPath = root + ".tmp-" + name.str() + '/';
+		if (job.outputPath.empty()) {
+			job.outputPath = root + name.str() + '/';
+			job.toolOutputPath = job.outputPath;
+		} else {
+			job.toolOutputPath = job.tempPath + "output/";
+		}
+
+		// The tool takes its own options first, so the output goes after them
+		const Tool *tool = job.tool.empty() ? NULL : _tools.getTool(job.tool);
+		if (tool)
+			insertBeforeInputs(job.arguments, tool->_inputPaths.size(), "-o", job.toolOutputPath);
+	}
+
+	if (jobs < 1)
+		jobs = 1;
+	if (jobs > _jobs.size())
+		jobs = _jobs.size();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < jobs; t++) {
+		workers.push_back(std::thread([&]() {
+			for (size_t i = next++; i < _jobs.size(); i = next++)
+				runJob(_jobs[i]);
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+	_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	int failed = 0;
+	for (std::vector<BatchJob>::const_iterator job = _jobs.begin(); job != _jobs.end(); ++job)
+		if (job->status != 0)
+			failed++;
+	return failed;
+}
+
+void BatchRunner::runJob(BatchJob &job) {
+	if (!job.error.empty())
+		return;
+	if (!makeDirectory(job.tempPath) || !makeDirectory(job.outputPath) || !makeDirectory(job.toolOutputPath)) {
+		job.error = "Could not create the directories of the job.";
+		return;
+	}
+
+	std::string log = job.tempPath + "output.log";
+	std::string command;
+#ifdef _WIN32
+	command = "cd /d " + quoteArgument(job.tempPath) + " && ";
+#else
+	command = "cd " + quoteArgument(job.tempPath) + " && ";
+#endif
+	command += quoteArgument(_executable) + " --tool " + quoteArgument(job.tool);
+	for (std::deque<std::string>::const_iterator arg = job.arguments.begin(); arg != job.arguments.end(); ++arg)
+		command += ' ' + quoteArgument(*arg);
+	command += " > " + quoteArgument(log) + " 2>&1";
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int ret = system(command.c_str());
+	job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+#ifdef _WIN32
+	job.status = ret;
+#else
+	job.status = (ret != -1 && WIFEXITED(ret)) ? WEXITSTATUS(ret) : -1;
+#endif
+	job.bytesOut = pathSize(job.toolOutputPath);
+
+	if (job.status == 0 && job.toolOutputPath != job.outputPath && !moveTree(job.toolOutputPath, job.outputPath)) {
+		job.status = -1;
+		job.error = "Could not move the output of the job to '" + job.outputPath + "'.";
+	} else if (job.status == 0) {
+		removeTree(job.tempPath);
+	} else {
+		job.error = lastLine(log);
+		if (job.error.empty())
+			job.error = "The tool failed without any output.";
+	}
+
+	std::cerr << "\t" << (job.status == 0 ? "Finished " : "FAILED ") << job.tool << " -> " << job.outputPath << std::endl;
+}
+
+void BatchRunner::writeSummary(std::ostream &output) const {
+	uint64 bytesIn = 0, bytesOut = 0;
+	int failed = 0;
+
+	output << "{\n\t\"jobs\": [";
+	for (std::vector<BatchJob>::const_iterator job = _jobs.begin(); job != _jobs.end(); ++job) {
+		output << (job == _jobs.begin() ? "\n" : ",\n");
+		output << "\t\t{\n";
+		output << "\t\t\t\"tool\": " << jsonString(job->tool) << ",\n";
+		output << "\t\t\t\"arguments\": [";
+		for (std::deque<std::string>::const_iterator arg = job->arguments.begin(); arg != job->arguments.end(); ++arg)
+			output << (arg == job->arguments.begin() ? "" : ", ") << jsonString(*arg);
+		output << "],\n";
+		output << "\t\t\t\"output\": " << jsonString(job->outputPath) << ",\n";
+		output << "\t\t\t\"status\": " << job->status << ",\n";
+		output << "\t\t\t\"seconds\": " << job->seconds << ",\n";
+		output << "\t\t\t\"bytes_in\": " << job->bytesIn << ",\n";
+		output << "\t\t\t\"bytes_out\": " << job->bytesOut;
+		if (job->status != 0)
+			output << ",\n\t\t\t\"error\": " << jsonString(job->error);
+		if (job->status != 0 && pathExists(job->tempPath + "output.log"))
+			output << ",\n\t\t\t\"log\": " << jsonString(job->tempPath + "output.log");
+		output << "\n\t\t}";
+
+		bytesIn += job->bytesIn;
+		bytesOut += job->bytesOut;
+		if (job->status != 0)
+			failed++;
+	}
+	output << "\n\t],\n";
+	output << "\t\"total\": {\n";
+	output << "\t\t\"jobs\": " << _jobs.size() << ",\n";
+	output << "\t\t\"failed\": " << failed << ",\n";
+	output << "\t\t\"seconds\": " << _seconds << ",\n";
+	output << "\t\t\"bytes_in\": " << bytesIn << ",\n";
+	output << "\t\t\"bytes_out\": " << bytesOut << "\n";
+	output << "\t}\n}" << std::endl;
+}
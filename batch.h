@@ -0,0 +1,150 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <algorithm>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "common/scummsys.h"
+
+class Tools;
+
+/**
+ * A single tool invocation of a batch.
+ */
+struct BatchJob {
+	BatchJob() : status(-1), seconds(0), bytesIn(0), bytesOut(0) {}
+
+	/** Name of the tool to run. */
+	std::string tool;
+	/** Options and inputs passed to the tool. Paths are absolute. */
+	std::deque<std::string> arguments;
+	/** Output directory of the job. */
+	std::string outputPath;
+	/**
+	 * Directory the tool writes to. It is the output directory, unless the job
+	 * gives its own, which other jobs may share: the files are then moved there
+	 * once the tool succeeds, so that the output of each job can be measured.
+	 */
+	std::string toolOutputPath;
+	/** Temporary working directory of the job. */
+	std::string tempPath;
+
+	/** Exit status of the tool, or -1 if it could not be run. */
+	int status;
+	/** Error message if the job failed. */
+	std::string error;
+	/** Wall clock time spent running the job. */
+	double seconds;
+	/** Total size of the inputs. */
+	uint64 bytesIn;
+	/** Total size of the files written by the job. */
+	uint64 bytesOut;
+};
+
+/**
+ * Inserts an option and its value among the arguments of a tool, just before
+ * its input paths, which are the last arguments. Tools take their standard
+ * options anywhere before the inputs, but their own options at the front.
+ *
+ * @param arguments Options and inputs of the tool.
+ * @param inputs    Number of input paths the tool expects.
+ * @param option    The option to insert.
+ * @param value     Value of the option.
+ */
+inline void insertBeforeInputs(std::deque<std::string> &arguments, size_t inputs, const std::string &option, const std::string &value) {
+	std::deque<std::string>::iterator position = arguments.end() - std::min(inputs, arguments.size());
+	position = arguments.insert(position, value);
+	arguments.insert(position, option);
+}
+
+/**
+ * Runs many tool invocations, on a bounded number of worker threads.
+ *
+ * Each job runs in a separate process whose working directory is a temporary
+ * directory of its own, since tools write their temporary files to the current
+ * directory. The temporary directory, which also holds the output of the tool
+ * in output.log, is removed if the job succeeds.
+ */
+class BatchRunner {
+public:
+	/**
+	 * @param tools      Tools used to detect the tool to run for an input.
+	 * @param executable Path to the CLI executable, used to start the jobs.
+	 */
+	BatchRunner(const Tools &tools, const std::string &executable);
+
+	/**
+	 * Adds the jobs listed in a manifest file.
+	 *
+	 * Each line holds a tool name (or "auto" to detect it from the inputs),
+	 * followed by the options and inputs of the tool, separated by spaces.
+	 * Arguments containing spaces can be enclosed in double quotes. Empty lines
+	 * and lines starting with '#' are ignored.
+	 *
+	 * @param manifest Path to the manifest.
+	 * @throws ToolException if the manifest can not be read or is invalid.
+	 */
+	void addManifest(const std::string &manifest);
+
+	/**
+	 * Adds a job for every input found in a directory of game installs that a
+	 * single tool accepts as a perfect match. Every subdirectory and the files
+	 * it contains are inspected, as well as the files in the directory itself.
+	 *
+	 * @param directory The directory to scan.
+	 * @param options   Options passed to all the tools.
+	 */
+	void addDirectory(const std::string &directory, const std::deque<std::string> &options);
+
+	/**
+	 * Runs all the jobs.
+	 *
+	 * @param outputPath Directory in which the output directory of each job is created,
+	 *                   unless the job gives its own output directory.
+	 * @param jobs       Maximum number of jobs to run at the same time.
+	 * @return The number of failed jobs.
+	 */
+	int run(const std::string &outputPath, unsigned int jobs);
+
+	/**
+	 * Writes a JSON summary of the jobs that have been run.
+	 *
+	 * @param output The stream to write to.
+	 */
+	void writeSummary(std::ostream &output) const;
+
+private:
+	void addJob(const std::string &tool, const std::deque<std::string> &arguments);
+	void runJob(BatchJob &job);
+
+	const Tools &_tools;
+	std::string _executable;
+	std::vector<BatchJob> _jobs;
+	double _seconds;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Throughput of the ADPCM decoders, read in chunks through their audio
+// stream as CompressionTool::encodeAudioStream() does. The figures are in
+// MB of encoded input per second.
+
+#include "bench/bench.h"
+#include "sound/adpcm.h"
+#include "sound/audiostream.h"
+
+#include <vector>
+
+volatile uint32 benchSink;
+
+static void benchDecoder(const char *name, const std::vector<byte> &data, Audio::typesADPCM type, int channels, uint32 blockAlign) {
+	runBenchmark(name, data.size(), [&]() {
+		const int kChunkSamples = 4096;
+		int16 samples[kChunkSamples];
+		uint32 sum = 0;
+
+		Audio::AudioStream *stream = Audio::makeADPCMStream(&data[0], data.size(), type, 22050, channels, blockAlign);
+		while (!stream->endOfData()) {
+			int count = stream->readBuffer(samples, kChunkSamples);
+			if (count <= 0)
+				break;
+			sum += samples[count - 1];
+		}
+		delete stream;
+		benchSink += sum;
+	});
+}
+
+int main() {
+	std::vector<byte> data(1024 * 1024);
+	fillRandom(&data[0], data.size());
+
+	benchDecoder("OKI", data, Audio::kADPCMOki, 1, 0);
+	benchDecoder("IMA", data, Audio::kADPCMIma, 1, 0);
+	benchDecoder("IMA stereo", data, Audio::kADPCMIma, 2, 0);
+	benchDecoder("MS IMA", data, Audio::kADPCMMSIma, 1, 1024);
+	benchDecoder("MS IMA stereo", data, Audio::kADPCMMSIma, 2, 2048);
+	benchDecoder("MS", data, Audio::kADPCMMS, 1, 1024);
+	benchDecoder("Tinsel 6-bit", data, Audio::kADPCMTinsel6, 1, 24);
+	return 0;
+}
@@ -0,0 +1,63 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include "bench/test_data.h"
+#include "common/scummsys.h"
+
+#include <chrono>
+#include <stdio.h>
+
+/**
+ * Runs a function repeatedly for at least half a second and prints its
+ * throughput.
+ *
+ * @param name  Name printed in front of the result.
+ * @param bytes Number of input bytes processed by one call of func.
+ * @param func  The function to measure.
+ */
+template<typename Func>
+void runBenchmark(const char *name, uint64 bytes, Func func) {
+	typedef std::chrono::steady_clock Clock;
+	const double kMinSeconds = 0.5;
+
+	// Warm up the caches and the branch predictors
+	func();
+
+	uint32 runs = 0;
+	double seconds = 0;
+	Clock::time_point start = Clock::now();
+	do {
+		func();
+		runs++;
+		seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	} while (seconds < kMinSeconds);
+
+	printf("%-32s %10.1f MB/s\n", name, (double)bytes * runs / seconds / (1024 * 1024));
+}
+
+/** Keeps the compiler from removing a computation whose result is unused. */
+extern volatile uint32 benchSink;
+
+#endif
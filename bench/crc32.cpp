@@ -0,0 +1,60 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Throughput of the CRC-32 code paths on a large buffer, in MB/s: the one
+// chosen for this CPU, slice-by-8, and the byte-wise loop which the ROM and
+// ISO extractors used before.
+
+#include "bench/bench.h"
+#include "common/crc32.h"
+
+#include <vector>
+
+volatile uint32 benchSink;
+
+static uint32 crc32Bytewise(const byte *data, uint32 length) {
+	static uint32 table[256];
+	if (!table[1]) {
+		for (uint32 i = 0; i < 256; i++) {
+			uint32 n = i;
+			for (int j = 0; j < 8; j++)
+				n = (n & 1) ? ((n >> 1) ^ 0xEDB88320) : (n >> 1);
+			table[i] = n;
+		}
+	}
+
+	uint32 crc = 0xFFFFFFFF;
+	for (uint32 i = 0; i < length; i++)
+		crc = (crc >> 8) ^ table[(crc ^ data[i]) & 0xFF];
+	return crc ^ 0xFFFFFFFF;
+}
+
+int main() {
+	std::vector<byte> data(16 * 1024 * 1024);
+	fillRandom(&data[0], data.size());
+
+	printf("carry-less multiplications: %s\n", Common::crc32_hasPCLMUL() ? "yes" : "no");
+	runBenchmark("crc32", data.size(), [&]() { benchSink += Common::crc32(&data[0], data.size()); });
+	runBenchmark("slice-by-8", data.size(), [&]() { benchSink += Common::crc32_update_slice8(0, &data[0], data.size()); });
+	runBenchmark("byte-wise", data.size(), [&]() { benchSink += crc32Bytewise(&data[0], data.size()); });
+	return 0;
+}
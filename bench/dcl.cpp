@@ -0,0 +1,133 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Throughput of the PKWARE DCL decompressor, in MB of unpacked output per
+// second, on a generated binary mode stream with a 4096 byte dictionary.
+
+#include "bench/bench.h"
+#include "common/dcl.h"
+#include "common/memstream.h"
+
+#include <vector>
+
+volatile uint32 benchSink;
+
+static TestRandom randomSource;
+
+/**
+ * Generates a stream of literals and copies of all sizes, using a few of
+ * the length and distance codes.
+ *
+ * @param unpackedSize Set to the size of the output.
+ */
+static std::vector<byte> generateStream(uint32 targetSize, uint32 &unpackedSize) {
+	const int kDictionaryType = 6;
+	DCLBitWriter writer;
+	uint32 written = 0;
+
+	writer.putBits(0, 8); // binary mode
+	writer.putBits(kDictionaryType, 8);
+
+	while (written < targetSize) {
+		uint32 token = randomSource.next(10);
+		if (written < 4096 || token < 4) {
+			writer.putBits(0, 1);
+			writer.putBits(randomSource.next(256), 8);
+			written++;
+			continue;
+		}
+
+		writer.putBits(1, 1);
+		uint32 length;
+		switch (token) {
+		case 4:
+			writer.putCode("101");     // length value 0
+			writer.putCode("11");      // distance value 0
+			writer.putBits(randomSource.next(4), 2);
+			written += 2;
+			continue;
+		case 5:
+		case 6:
+			writer.putCode("11");      // length value 1
+			length = 3;
+			break;
+		case 7:
+		case 8:
+			writer.putCode("0000001"); // length value 14
+			length = randomSource.next(128);
+			writer.putBits(length, 7);
+			length += 136;
+			break;
+		default:
+			writer.putCode("0000000"); // length value 15
+			length = randomSource.next(255);
+			writer.putBits(length, 8);
+			length += 264;
+			break;
+		}
+
+		switch (randomSource.next(3)) {
+		case 0:
+			writer.putCode("11");       // distance value 0
+			break;
+		case 1:
+			writer.putCode("1011");     // distance value 1
+			break;
+		default:
+			writer.putCode("00000000"); // distance value 63
+			break;
+		}
+		writer.putBits(randomSource.next(1 << kDictionaryType), kDictionaryType);
+		written += length;
+	}
+
+	// End of stream
+	writer.putBits(1, 1);
+	writer.putCode("0000000");
+	writer.putBits(255, 8);
+
+	unpackedSize = written;
+	return writer.data;
+}
+
+int main() {
+	uint32 unpackedSize;
+	std::vector<byte> packed = generateStream(4 * 1024 * 1024, unpackedSize);
+	std::vector<byte> unpacked(unpackedSize);
+
+	runBenchmark("fixed size", unpackedSize, [&]() {
+		Common::MemoryReadStream stream(&packed[0], packed.size());
+		if (!Common::decompressDCL(&stream, &unpacked[0], packed.size(), unpackedSize))
+			error("Could not decompress the generated stream");
+		benchSink += unpacked[unpackedSize - 1];
+	});
+
+	runBenchmark("dynamic size", unpackedSize, [&]() {
+		Common::MemoryReadStream stream(&packed[0], packed.size());
+		Common::SeekableReadStream *output = Common::decompressDCL(&stream);
+		if (!output || (uint32)output->size() != unpackedSize)
+			error("Could not decompress the generated stream");
+		benchSink += output->size();
+		delete output;
+	});
+	return 0;
+}
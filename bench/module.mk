@@ -0,0 +1,39 @@
+######################################################################
+# Benchmarks of the decoders and checksums shared by the tools.
+# Use the 'bench' target to build and run them. Each benchmark prints
+# the throughput of its variants, there is nothing to pass or fail.
+# Configure with --enable-release for figures of an optimized build.
+#
+######################################################################
+
+BENCHES      := \
+	bench/audio_decoders \
+	bench/crc32 \
+	bench/dcl \
+	bench/tinsel_adpcm
+
+BENCH_LIBS   := \
+	common/crc32.o \
+	common/dcl.o \
+	common/file.o \
+	common/str.o \
+	common/util.o \
+	common/memorypool.o \
+	common/hashmap.o \
+	common/stream.o \
+	sound/adpcm.o
+
+bench: $(BENCHES)
+	@for b in $(BENCHES); do echo "$$b:"; ./$$b || exit 1; done
+
+bench/%: bench/%.o $(BENCH_LIBS)
+	@echo '   ' LINK '   ' $@
+	$(QUIET)$(CXX) $(LDFLAGS) -o $@ $+ $(LIBS)
+
+.SECONDARY: $(addsuffix .o,$(BENCHES))
+
+clean: clean-bench
+clean-bench:
+	-$(RM) $(BENCHES) bench/*.o
+
+.PHONY: bench clean-bench
@@ -0,0 +1,89 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Generators of input data, shared by the benchmarks and the unit tests.
+
+#ifndef BENCH_TEST_DATA_H
+#define BENCH_TEST_DATA_H
+
+#include "common/scummsys.h"
+
+#include <vector>
+
+/**
+ * Reproducible pseudo-random numbers: the linear congruential generator of
+ * the C standard, so that the data is the same on every platform.
+ */
+class TestRandom {
+public:
+	TestRandom(uint32 seed = 1) : _seed(seed) {}
+
+	void setSeed(uint32 seed) { _seed = seed; }
+
+	/** Returns the next number, in [0, 65536). */
+	uint32 next() {
+		_seed = _seed * 1103515245 + 12345;
+		return _seed >> 16;
+	}
+
+	/** Returns the next number, in [0, range). */
+	uint32 next(uint32 range) {
+		return next() % range;
+	}
+
+private:
+	uint32 _seed;
+};
+
+/** Fills a buffer with reproducible pseudo-random bytes. */
+inline void fillRandom(byte *data, uint32 size, uint32 seed = 1) {
+	TestRandom random(seed);
+	for (uint32 i = 0; i < size; i++)
+		data[i] = (byte)random.next();
+}
+
+/** Writes a PKWARE DCL stream, least significant bit first. */
+class DCLBitWriter {
+public:
+	std::vector<byte> data;
+
+	DCLBitWriter() : _bits(0) {}
+
+	void putBits(uint32 value, int n) {
+		for (int i = 0; i < n; i++, _bits++) {
+			if ((_bits & 7) == 0)
+				data.push_back(0);
+			if ((value >> i) & 1)
+				data.back() |= 1 << (_bits & 7);
+		}
+	}
+
+	/** Writes a Huffman code, given as the bits of the path from the root. */
+	void putCode(const char *path) {
+		for (; *path; path++)
+			putBits(*path == '1', 1);
+	}
+
+private:
+	uint32 _bits;
+};
+
+#endif
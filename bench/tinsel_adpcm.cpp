@@ -0,0 +1,168 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+// Throughput of the Tinsel 6-bit ADPCM decoder, compared with the original
+// decoder of compress_tinsel and with a fixed-point filter. The fixed-point filter is
+// not used by the tools: its samples are not bit-exact, see
+// readBufferTinsel6(). It is kept here to show what that choice costs.
+
+#include "bench/bench.h"
+#include "common/util.h"
+#include "sound/adpcm.h"
+#include "sound/audiostream.h"
+
+#include <vector>
+
+volatile uint32 benchSink;
+
+static const double kFilterTable[4][2] = {
+	{0, 0 },
+	{0.9375, 0},
+	{1.796875, -0.8125},
+	{1.53125, -0.859375}
+};
+
+// The filter coefficients are multiples of 1/64
+static const int kFilterTable64[4][2] = {
+	{0, 0},
+	{60, 0},
+	{115, -52},
+	{98, -55}
+};
+
+static const double kScale = 1.032226562;
+static const uint32 kBlockAlign = 24;
+
+/** Generates blocks with all the filters and the positive scales. */
+static std::vector<byte> generateBlocks(int blocks) {
+	std::vector<byte> data(blocks * (kBlockAlign + 1));
+	fillRandom(&data[0], data.size());
+	for (int block = 0; block < blocks; block++)
+		data[block * (kBlockAlign + 1)] &= 0xC7;
+	return data;
+}
+
+/** The decoder as it was written in compress_tinsel, one sample per step through a switch. */
+static uint32 decodePerSample(const std::vector<byte> &data) {
+	double predictor = 0, k0 = 0, k1 = 0, d0 = 0, d1 = 0;
+	uint32 blockPos = kBlockAlign;
+	uint16 chunkData = 0;
+	int16 chunkWord = 0;
+	byte chunkPos = 0;
+	uint32 sum = 0;
+
+	for (size_t pos = 0; pos < data.size(); ) {
+		if (blockPos == kBlockAlign) {
+			byte headerByte = data[pos++];
+			predictor = 1.0 / (1 << (headerByte & 0x1F));
+			k0 = kFilterTable[headerByte >> 6][0];
+			k1 = kFilterTable[headerByte >> 6][1];
+			blockPos = 0;
+			chunkPos = 0;
+			continue;
+		}
+		switch (chunkPos) {
+		case 0:
+			chunkData = data[pos++];
+			chunkWord = (chunkData << 8) & 0xFC00;
+			break;
+		case 1:
+			chunkData = (chunkData << 8) | data[pos++];
+			blockPos++;
+			chunkWord = (chunkData << 6) & 0xFC00;
+			break;
+		case 2:
+			chunkData = (chunkData << 8) | data[pos++];
+			blockPos++;
+			chunkWord = (chunkData << 4) & 0xFC00;
+			break;
+		case 3:
+			chunkData = chunkData << 8;
+			blockPos++;
+			chunkWord = (chunkData << 2) & 0xFC00;
+			break;
+		}
+		double sample = chunkWord;
+		sample *= kScale * predictor;
+		sample += (d0 * k0) + (d1 * k1);
+		d1 = d0;
+		d0 = sample;
+		sum += (int16)CLIP<double>(sample, -32768.0, 32767.0);
+		chunkPos = (chunkPos + 1) % 4;
+	}
+	return sum;
+}
+
+/** The decoder used by the tools, through its audio stream. */
+static uint32 decodeStream(const std::vector<byte> &data) {
+	int16 samples[4096];
+	uint32 sum = 0;
+
+	Audio::AudioStream *stream = Audio::makeADPCMStream(&data[0], data.size(), Audio::kADPCMTinsel6, 22050, 1, kBlockAlign);
+	while (!stream->endOfData()) {
+		int count = stream->readBuffer(samples, ARRAYSIZE(samples));
+		if (count <= 0)
+			break;
+		for (int i = 0; i < count; i++)
+			sum += samples[i];
+	}
+	delete stream;
+	return sum;
+}
+
+/** Four samples per group of 3 bytes, with the filter in 16.16 fixed point. */
+static uint32 decodeFixedPoint(const std::vector<byte> &data) {
+	int64 d0 = 0, d1 = 0;
+	uint32 sum = 0;
+
+	for (size_t pos = 0; pos + kBlockAlign < data.size(); pos += kBlockAlign + 1) {
+		const byte headerByte = data[pos];
+		const int64 scale = (int64)(kScale * 65536.0) >> (headerByte & 0x1F);
+		const int k0 = kFilterTable64[headerByte >> 6][0];
+		const int k1 = kFilterTable64[headerByte >> 6][1];
+
+		for (const byte *p = &data[pos + 1]; p < &data[pos + 1 + kBlockAlign]; p += 3) {
+			const int16 words[4] = {
+				(int16)((p[0] << 8) & 0xFC00),
+				(int16)((((p[0] << 8) | p[1]) << 6) & 0xFC00),
+				(int16)((((p[1] << 8) | p[2]) << 4) & 0xFC00),
+				(int16)((p[2] << 10) & 0xFC00)
+			};
+			for (int i = 0; i < 4; i++) {
+				int64 sample = words[i] * scale + ((d0 * k0 + d1 * k1) >> 6);
+				d1 = d0;
+				d0 = sample;
+				sum += (int16)CLIP<int64>(sample >> 16, -32768, 32767);
+			}
+		}
+	}
+	return sum;
+}
+
+int main() {
+	std::vector<byte> data = generateBlocks(40000);
+
+	runBenchmark("per sample, double", data.size(), [&]() { benchSink += decodePerSample(data); });
+	runBenchmark("stream, double", data.size(), [&]() { benchSink += decodeStream(data); });
+	runBenchmark("groups, fixed point", data.size(), [&]() { benchSink += decodeFixedPoint(data); });
+	return 0;
+}
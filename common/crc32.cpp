@@ -0,0 +1,221 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common/crc32.h"
+#include "common/endian.h"
+#include "common/file.h"
+#include "common/util.h"
+
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32_PCLMUL
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace Common {
+
+/** Size of the blocks in which crc32_file reads files. */
+static const uint32 kFileBlockSize = 256 * 1024;
+
+/**
+ * Tables for slice-by-8: _table[k][b] is the CRC of byte b followed by k
+ * zero bytes.
+ */
+struct CRC32Tables {
+	uint32 _table[8][256];
+
+	CRC32Tables() {
+		const uint32 poly = 0xEDB88320;
+		for (uint32 i = 0; i < 256; i++) {
+			uint32 n = i;
+			for (int j = 0; j < 8; j++)
+				n = (n & 1) ? ((n >> 1) ^ poly) : (n >> 1);
+			_table[0][i] = n;
+		}
+		for (uint32 i = 0; i < 256; i++)
+			for (int k = 1; k < 8; k++)
+				_table[k][i] = (_table[k - 1][i] >> 8) ^ _table[0][_table[k - 1][i] & 0xFF];
+	}
+};
+
+static const CRC32Tables tables;
+
+/** Slice-by-8 over the inverted CRC. */
+static uint32 crc32_slice8(uint32 crc, const byte *data, uint32 length) {
+	const uint32 (*t)[256] = tables._table;
+
+	for (; length > 0 && ((size_t)data & 3) != 0; length--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+
+	for (; length >= 8; length -= 8, data += 8) {
+		uint32 lo = READ_LE_UINT32(data) ^ crc;
+		uint32 hi = READ_LE_UINT32(data + 4);
+		crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+		      t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+	}
+
+	for (; length > 0; length--)
+		crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+	return crc;
+}
+
+#ifdef CRC32_PCLMUL
+
+/**
+ * Folds 64 bytes at a time with carry-less multiplications, as described in
+ * "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+ * by Intel. length must be a multiple of 16, and at least 64.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32 crc32_pclmul(uint32 crc, const byte *data, uint32 length) {
+	// Constants of the bit-reflected domain, from the end of the paper
+	static const uint64 k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64 k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64 k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64 poly[2] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	x1 = _mm_loadu_si128((const __m128i *)(data + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *)(data + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *)(data + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *)(data + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	x0 = _mm_load_si128((const __m128i *)k1k2);
+	data += 64;
+	length -= 64;
+
+	// Fold four blocks of 16 bytes in parallel
+	while (length >= 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		y5 = _mm_loadu_si128((const __m128i *)(data + 0x00));
+		y6 = _mm_loadu_si128((const __m128i *)(data + 0x10));
+		y7 = _mm_loadu_si128((const __m128i *)(data + 0x20));
+		y8 = _mm_loadu_si128((const __m128i *)(data + 0x30));
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+		data += 64;
+		length -= 64;
+	}
+
+	// Fold the four blocks into one
+	x0 = _mm_load_si128((const __m128i *)k3k4);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// Fold the remaining blocks of 16 bytes
+	while (length >= 16) {
+		x2 = _mm_loadu_si128((const __m128i *)data);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		data += 16;
+		length -= 16;
+	}
+
+	// Fold 128 bits into 64
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+	x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x0 = _mm_load_si128((const __m128i *)poly);
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+	return _mm_extract_epi32(x1, 1);
+}
+
+static bool hasPCLMUL() {
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+	return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+}
+
+static const bool usePCLMUL = hasPCLMUL();
+
+#endif
+
+uint32 crc32_update(uint32 crc, const void *data, uint32 length) {
+	const byte *bytes = (const byte *)data;
+	crc = ~crc;
+#ifdef CRC32_PCLMUL
+	if (usePCLMUL && length >= 64) {
+		uint32 count = length & ~15;
+		crc = crc32_pclmul(crc, bytes, count);
+		bytes += count;
+		length -= count;
+	}
+#endif
+	return ~crc32_slice8(crc, bytes, length);
+}
+
+uint32 crc32_update_slice8(uint32 crc, const void *data, uint32 length) {
+	return ~crc32_slice8(~crc, (const byte *)data, length);
+}
+
+bool crc32_hasPCLMUL() {
+#ifdef CRC32_PCLMUL
+	return usePCLMUL;
+#else
+	return false;
+#endif
+}
+
+uint32 crc32_file(File &file, uint32 length) {
+	std::vector<byte> buffer(MIN(length, kFileBlockSize));
+	uint32 crc = 0;
+	while (length > 0) {
+		uint32 count = MIN(length, kFileBlockSize);
+		file.read_throwsOnError(&buffer[0], count);
+		crc = crc32_update(crc, &buffer[0], count);
+		length -= count;
+	}
+	return crc;
+}
+
+} // End of namespace Common
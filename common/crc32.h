@@ -0,0 +1,64 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COMMON_CRC32_H
+#define COMMON_CRC32_H
+
+#include "common/scummsys.h"
+
+namespace Common {
+
+class File;
+
+/**
+ * Updates the CRC-32 of some data with more data. This is the CRC used by
+ * zip, PNG and the ROM and disc dumping tools, and the initial value is 0.
+ *
+ * Large buffers are processed with carry-less multiplications on x86 CPUs
+ * which support them, and eight bytes at a time otherwise.
+ */
+uint32 crc32_update(uint32 crc, const void *data, uint32 length);
+
+/**
+ * Updates a CRC-32 like crc32_update(), but always eight bytes at a time,
+ * as on CPUs without carry-less multiplications. This lets the tests and the
+ * benchmark check and measure that code path on any CPU.
+ */
+uint32 crc32_update_slice8(uint32 crc, const void *data, uint32 length);
+
+/** Returns true if crc32_update() uses carry-less multiplications on this CPU. */
+bool crc32_hasPCLMUL();
+
+/** Computes the CRC-32 of a buffer. */
+inline uint32 crc32(const void *data, uint32 length) {
+	return crc32_update(0, data, length);
+}
+
+/**
+ * Computes the CRC-32 of the next bytes of a file, read in large blocks.
+ *
+ * @throws FileException if the file holds less than length more bytes.
+ */
+uint32 crc32_file(File &file, uint32 length);
+
+} // End of namespace Common
+
+#endif
@@ -22,72 +22,131 @@
 #include "common/dcl.h"
 #include "common/memstream.h"
 #include "common/stream.h"
+#include "common/endian.h"
+#include "common/util.h"
+
+#include <stdlib.h>
+#include <string.h>
 
 namespace Common {
 
+struct DCLHuffmanTable;
+
 class DecompressorDCL {
 public:
-	bool unpack(SeekableReadStream *sourceStream, WriteStream *targetStream, uint32 targetSize, bool targetFixedSize);
+	DecompressorDCL();
+	~DecompressorDCL();
+
+	/**
+	 * Decompress a buffer.
+	 * @param source			compressed data
+	 * @param sourceSize		size of the compressed data
+	 * @param target			buffer receiving the decompressed data, or 0 to
+	 *							let the decompressor allocate it (dynamic size only)
+	 * @param targetSize		size of the target buffer (if fixed)
+	 * @param targetFixedSize	if target is fixed size or dynamic size
+	 */
+	bool unpack(const byte *source, uint32 sourceSize, byte *target, uint32 targetSize, bool targetFixedSize);
+
+	/**
+	 * Take over the buffer allocated for a dynamic size target. It has to be
+	 * released with free().
+	 */
+	byte *releaseTarget();
+
+	/** Number of bytes written to the target. */
+	uint32 getBytesWritten() const { return _bytesWritten; }
+
+	/** Number of bytes of the source that have been used. */
+	uint32 getBytesRead() const;
 
 protected:
 	/**
-	 * Initialize decompressor.
-	 * @param sourceStream	source stream to read from
-	 * @param targetStream	target memory stream to write to
+	 * Fill the bit buffer with at least 56 bits, a whole word at a time
+	 * while 8 bytes are left in the source.
 	 */
-	void init(SeekableReadStream *sourceStream, WriteStream *targetStream, uint32 targetSize, bool targetFixedSize);
+	void fetchBitsLSB();
 
 	/**
-	 * Get a number of bits from _src stream, starting with the least
-	 * significant unread bit of the current four byte block.
-	 * @param n		number of bits to get
+	 * Get a number of bits from the source, starting with the least
+	 * significant unread bit.
+	 * @param n		number of bits to get, at most 32
 	 * @return n-bits number
 	 */
 	uint32 getBitsLSB(int n);
 
 	/**
-	 * Get one byte from _src stream.
+	 * Get one byte from the source.
 	 * @return byte
 	 */
 	byte getByteLSB();
 
-	void fetchBitsLSB();
+	/**
+	 * Make room for n more bytes in a dynamic size target.
+	 */
+	void reserve(uint32 n);
 
 	/**
-	 * Write one byte into _dest stream
+	 * Write one byte to the target
 	 * @param b byte to put
 	 */
 	void putByte(byte b);
 
-	int huffman_lookup(const int *tree);
+	int huffman_lookup(const int *tree, const DCLHuffmanTable &table);
 
-	uint32 _dwBits;			///< bits buffer
+	uint64 _dwBits;			///< bits buffer
 	byte _nBits;			///< number of unread bits in _dwBits
-	uint32 _sourceSize;		///< size of the source stream
-	uint32 _targetSize;		///< size of the target stream (if fixed)
-	bool _targetFixedSize;  ///< if target stream is fixed size or dynamic size
-	uint32 _bytesRead;		///< number of bytes read from _sourceStream
-	uint32 _bytesWritten;	///< number of bytes written to _targetStream
-	SeekableReadStream *_sourceStream;
-	WriteStream *_targetStream;
+	const byte *_source;	///< start of the source
+	const byte *_sourcePos;	///< next byte of the source to load into _dwBits
+	const byte *_sourceEnd;	///< end of the source
+	uint32 _sourcePadding;	///< number of zero bytes loaded past the end of the source
+	byte *_target;			///< target buffer
+	uint32 _targetSize;		///< size of the target buffer
+	bool _targetFixedSize;  ///< if target buffer is fixed size or grows as needed
+	bool _targetOwned;		///< if the target buffer was allocated by the decompressor
+	uint32 _bytesWritten;	///< number of bytes written to _target
 };
 
-void DecompressorDCL::init(SeekableReadStream *sourceStream, WriteStream *targetStream, uint32 targetSize, bool targetFixedSize) {
-	_sourceStream = sourceStream;
-	_targetStream = targetStream;
-	_sourceSize = sourceStream->size();
-	_targetSize = targetSize;
-	_targetFixedSize = targetFixedSize;
-	_nBits = 0;
-	_bytesRead = _bytesWritten = 0;
-	_dwBits = 0;
+DecompressorDCL::DecompressorDCL() : _target(nullptr), _targetOwned(false) {
+}
+
+DecompressorDCL::~DecompressorDCL() {
+	if (_targetOwned)
+		free(_target);
+}
+
+byte *DecompressorDCL::releaseTarget() {
+	byte *target = _target;
+	_target = nullptr;
+	_targetOwned = false;
+	return target;
+}
+
+uint32 DecompressorDCL::getBytesRead() const {
+	uint32 loaded = (_sourcePos - _source) + _sourcePadding;
+	uint32 read = loaded - _nBits / 8;
+	return MIN<uint32>(read, _sourceEnd - _source);
 }
 
 void DecompressorDCL::fetchBitsLSB() {
-	while (_nBits <= 24) {
-		_dwBits |= ((uint32)_sourceStream->readByte()) << _nBits;
+	if (_sourceEnd - _sourcePos >= 8) {
+		// Load a whole word; the bytes which do not fit are loaded again,
+		// at the same position, by the next call
+		uint64 word = READ_LE_UINT32(_sourcePos) | ((uint64)READ_LE_UINT32(_sourcePos + 4) << 32);
+		_dwBits |= word << _nBits;
+		_sourcePos += (63 - _nBits) >> 3;
+		_nBits |= 56;
+		return;
+	}
+
+	while (_nBits <= 56) {
+		uint64 b = 0;
+		if (_sourcePos < _sourceEnd)
+			b = *_sourcePos++;
+		else
+			_sourcePadding++;
+		_dwBits |= b << _nBits;
 		_nBits += 8;
-		_bytesRead++;
 	}
 }
 
@@ -95,7 +154,7 @@ uint32 DecompressorDCL::getBitsLSB(int n) {
 	// Fetching more data to buffer if needed
 	if (_nBits < n)
 		fetchBitsLSB();
-	uint32 ret = (_dwBits & ~(~0UL << n));
+	uint32 ret = (uint32)(_dwBits & ~(~(uint64)0 << n));
 	_dwBits >>= n;
 	_nBits -= n;
 	return ret;
@@ -105,9 +164,22 @@ byte DecompressorDCL::getByteLSB() {
 	return getBitsLSB(8);
 }
 
+void DecompressorDCL::reserve(uint32 n) {
+	if (_bytesWritten + n <= _targetSize)
+		return;
+
+	uint32 newSize = MAX<uint32>(MAX<uint32>(_targetSize * 2, _bytesWritten + n), 4096);
+	byte *newTarget = (byte *)realloc(_target, newSize);
+	if (!newTarget)
+		error("DCL-INFLATE: Out of memory");
+	_target = newTarget;
+	_targetSize = newSize;
+}
+
 void DecompressorDCL::putByte(byte b) {
-	_targetStream->writeByte(b);
-	_bytesWritten++;
+	if (!_targetFixedSize)
+		reserve(1);
+	_target[_bytesWritten++] = b;
 }
 
 #define HUFFMAN_LEAF 0x40000000
@@ -313,11 +385,61 @@ static const int ascii_tree[] = {
 	LN(509, 128)      LN(510, 26)
 };
 
-int DecompressorDCL::huffman_lookup(const int *tree) {
-	int pos = 0;
+/**
+ * Lookup table for the first bits of the codes of a Huffman tree, indexed
+ * by the next kBits bits of the source. An entry holds either the value and
+ * the length of a code no longer than kBits, flagged with HUFFMAN_LEAF, or the
+ * node of the tree reached after kBits bits.
+ */
+struct DCLHuffmanTable {
+	enum {
+		kBits = 8
+	};
+
+	int entries[1 << kBits];
+
+	explicit DCLHuffmanTable(const int *tree) {
+		for (int index = 0; index < (1 << kBits); index++) {
+			int pos = 0;
+			int length = 0;
+			while (!(tree[pos] & HUFFMAN_LEAF) && length < kBits) {
+				int bit = (index >> length) & 1;
+				pos = bit ? tree[pos] & 0xFFF : tree[pos] >> 12;
+				length++;
+			}
+			if (tree[pos] & HUFFMAN_LEAF)
+				entries[index] = (tree[pos] & 0xFFFF) | (length << 16) | HUFFMAN_LEAF;
+			else
+				entries[index] = pos;
+		}
+	}
+};
+
+static const DCLHuffmanTable length_table(length_tree);
+static const DCLHuffmanTable distance_table(distance_tree);
+static const DCLHuffmanTable ascii_table(ascii_tree);
+
+int DecompressorDCL::huffman_lookup(const int *tree, const DCLHuffmanTable &table) {
+	// The longest code has 13 bits
+	if (_nBits < 16)
+		fetchBitsLSB();
+
+	int entry = table.entries[_dwBits & ((1 << DCLHuffmanTable::kBits) - 1)];
+	if (entry & HUFFMAN_LEAF) {
+		int length = (entry >> 16) & 0xFF;
+		_dwBits >>= length;
+		_nBits -= length;
+		return entry & 0xFFFF;
+	}
 
+	// Walk the rest of the tree one bit at a time
+	_dwBits >>= DCLHuffmanTable::kBits;
+	_nBits -= DCLHuffmanTable::kBits;
+	int pos = entry;
 	while (!(tree[pos] & HUFFMAN_LEAF)) {
-		int bit = getBitsLSB(1);
+		int bit = _dwBits & 1;
+		_dwBits >>= 1;
+		_nBits--;
 		pos = bit ? tree[pos] & 0xFFF : tree[pos] >> 12;
 	}
 
@@ -327,18 +449,23 @@ int DecompressorDCL::huffman_lookup(const int *tree) {
 #define DCL_BINARY_MODE 0
 #define DCL_ASCII_MODE 1
 
-#define MIDI_SETUP_BUNDLE_FILE_MAXIMUM_DICTIONARY_SIZE 4096
-
-bool DecompressorDCL::unpack(SeekableReadStream *sourceStream, WriteStream *targetStream, uint32 targetSize, bool targetFixedSize) {
-	byte   dictionary[MIDI_SETUP_BUNDLE_FILE_MAXIMUM_DICTIONARY_SIZE];
-	uint16 dictionaryPos = 0;
-	uint16 dictionarySize = 0;
-	uint16 dictionaryMask = 0;
+bool DecompressorDCL::unpack(const byte *source, uint32 sourceSize, byte *target, uint32 targetSize, bool targetFixedSize) {
 	int value;
 	uint16 tokenOffset = 0;
 	uint16 tokenLength = 0;
 
-	init(sourceStream, targetStream, targetSize, targetFixedSize);
+	_source = _sourcePos = source;
+	_sourceEnd = source + sourceSize;
+	_sourcePadding = 0;
+	_dwBits = 0;
+	_nBits = 0;
+	if (_targetOwned)
+		free(_target);
+	_target = target;
+	_targetSize = target ? targetSize : 0;
+	_targetFixedSize = targetFixedSize;
+	_targetOwned = !target;
+	_bytesWritten = 0;
 
 	byte mode = getByteLSB();
 	byte dictionaryType = getByteLSB();
@@ -351,25 +478,27 @@ bool DecompressorDCL::unpack(SeekableReadStream *sourceStream, WriteStream *targ
 	// TODO: original code supported 3 as well???
 	// Was this an accident or on purpose? And the original code did just give out a warning
 	// and didn't error out at all
+	// The dictionary holds 1024, 2048 or 4096 bytes
 	switch (dictionaryType) {
 	case 4:
-		dictionarySize = 1024;
-		break;
 	case 5:
-		dictionarySize = 2048;
-		break;
 	case 6:
-		dictionarySize = 4096;
 		break;
 	default:
 		warning("DCL-INFLATE: Error: unsupported dictionary type %02x", dictionaryType);
 		return false;
 	}
-	dictionaryMask = dictionarySize - 1;
 
+	// The whole output is in memory, so tokens copy straight from the bytes
+	// already written; the largest offset is the size of the dictionary
 	while ((!targetFixedSize) || (_bytesWritten < _targetSize)) {
+		if (!targetFixedSize && _sourcePadding > 8) {
+			warning("DCL-INFLATE Error: Unexpected end of compressed data after %d bytes", _bytesWritten);
+			return false;
+		}
+
 		if (getBitsLSB(1)) { // (length,distance) pair
-			value = huffman_lookup(length_tree);
+			value = huffman_lookup(length_tree, length_table);
 
 			if (value < 8)
 				tokenLength = value + 2;
@@ -379,7 +508,7 @@ bool DecompressorDCL::unpack(SeekableReadStream *sourceStream, WriteStream *targ
 			if (tokenLength == 519)
 				break; // End of stream signal
 
-			value = huffman_lookup(distance_tree);
+			value = huffman_lookup(distance_tree, distance_table);
 
 			if (tokenLength == 2)
 				tokenOffset = (value << 2) | getBitsLSB(2);
@@ -393,6 +522,8 @@ bool DecompressorDCL::unpack(SeekableReadStream *sourceStream, WriteStream *targ
 							tokenLength, _targetSize, _bytesWritten, tokenLength);
 					return false;
 				}
+			} else {
+				reserve(tokenLength);
 			}
 
 			if (_bytesWritten < tokenOffset) {
@@ -401,37 +532,20 @@ bool DecompressorDCL::unpack(SeekableReadStream *sourceStream, WriteStream *targ
 				return false;
 			}
 
-			uint16 dictionaryBaseIndex = (dictionaryPos - tokenOffset) & dictionaryMask;
-			uint16 dictionaryIndex = dictionaryBaseIndex;
-			uint16 dictionaryNextIndex = dictionaryPos;
-
-			while (tokenLength) {
-				// Write byte from dictionary
-				putByte(dictionary[dictionaryIndex]);
-
-				dictionary[dictionaryNextIndex] = dictionary[dictionaryIndex];
-
-				dictionaryNextIndex = (dictionaryNextIndex + 1) & dictionaryMask;
-				dictionaryIndex = (dictionaryIndex + 1) & dictionaryMask;
-
-				if (dictionaryIndex == dictionaryPos)
-					dictionaryIndex = dictionaryBaseIndex;
-				if (dictionaryNextIndex == dictionarySize)
-					dictionaryNextIndex = 0;
-
-				tokenLength--;
+			byte *dest = _target + _bytesWritten;
+			const byte *src = dest - tokenOffset;
+			if (tokenOffset >= tokenLength) {
+				memcpy(dest, src, tokenLength);
+			} else {
+				// Overlapping copy, repeating the last tokenOffset bytes
+				for (uint16 i = 0; i < tokenLength; i++)
+					dest[i] = src[i];
 			}
-			dictionaryPos = dictionaryNextIndex;
+			_bytesWritten += tokenLength;
 
 		} else { // Copy byte verbatim
-			value = (mode == DCL_ASCII_MODE) ? huffman_lookup(ascii_tree) : getByteLSB();
+			value = (mode == DCL_ASCII_MODE) ? huffman_lookup(ascii_tree, ascii_table) : getByteLSB();
 			putByte(value);
-
-			// Also remember it inside dictionary
-			dictionary[dictionaryPos] = value;
-			dictionaryPos++;
-			if (dictionaryPos >= dictionarySize)
-				dictionaryPos = 0;
 		}
 	}
 
@@ -444,7 +558,6 @@ bool DecompressorDCL::unpack(SeekableReadStream *sourceStream, WriteStream *targ
 }
 
 bool decompressDCL(ReadStream *src, byte *dest, uint32 packedSize, uint32 unpackedSize) {
-	bool success = false;
 	DecompressorDCL dcl;
 
 	if (!src || !dest)
@@ -455,31 +568,29 @@ bool decompressDCL(ReadStream *src, byte *dest, uint32 packedSize, uint32 unpack
 		return false;
 
 	// Read source into memory
-	src->read(sourceBufferPtr, packedSize);
-
-	Common::MemoryReadStream  *sourceStream = new MemoryReadStream(sourceBufferPtr, packedSize, DisposeAfterUse::YES);
-	Common::MemoryWriteStream *targetStream = new MemoryWriteStream(dest, unpackedSize);
+	packedSize = src->read(sourceBufferPtr, packedSize);
 
-	success = dcl.unpack(sourceStream, targetStream, unpackedSize, true);
-	delete sourceStream;
-	delete targetStream;
+	bool success = dcl.unpack(sourceBufferPtr, packedSize, dest, unpackedSize, true);
+	free(sourceBufferPtr);
 	return success;
 }
 
 SeekableReadStream *decompressDCL(SeekableReadStream *sourceStream, uint32 packedSize, uint32 unpackedSize) {
-	bool success = false;
-	byte *targetPtr = nullptr;
-	Common::MemoryWriteStream *targetStream;
 	DecompressorDCL dcl;
 
-	targetPtr = (byte *)malloc(unpackedSize);
-	if (!targetPtr)
+	byte *sourcePtr = (byte *)malloc(packedSize);
+	if (!sourcePtr)
 		return nullptr;
+	packedSize = sourceStream->read(sourcePtr, packedSize);
 
-	targetStream = new MemoryWriteStream(targetPtr, unpackedSize);
+	byte *targetPtr = (byte *)malloc(unpackedSize);
+	if (!targetPtr) {
+		free(sourcePtr);
+		return nullptr;
+	}
 
-	success = dcl.unpack(sourceStream, targetStream, unpackedSize, true);
-	delete targetStream;
+	bool success = dcl.unpack(sourcePtr, packedSize, targetPtr, unpackedSize, true);
+	free(sourcePtr);
 
 	if (!success) {
 		free(targetPtr);
@@ -491,19 +602,25 @@ SeekableReadStream *decompressDCL(SeekableReadStream *sourceStream, uint32 packe
 // This one figures out the unpacked size by itself
 // Needed for at least Simon 2, because the unpacked size is not stored anywhere
 SeekableReadStream *decompressDCL(SeekableReadStream *sourceStream) {
-	Common::MemoryWriteStreamDynamic *targetStream;
 	DecompressorDCL dcl;
 
-	targetStream = new MemoryWriteStreamDynamic(DisposeAfterUse::NO);
+	int32 start = sourceStream->pos();
+	uint32 packedSize = sourceStream->size() - start;
+	byte *sourcePtr = (byte *)malloc(MAX<uint32>(packedSize, 1));
+	if (!sourcePtr)
+		return nullptr;
+	packedSize = sourceStream->read(sourcePtr, packedSize);
 
-	if (dcl.unpack(sourceStream, targetStream, 0, false)) {
-		byte *targetPtr = targetStream->getData();
-		uint32 unpackedSize = targetStream->size();
-		delete targetStream;
-		return new MemoryReadStream(targetPtr, unpackedSize, DisposeAfterUse::YES);
-	}
-	delete targetStream;
-	return nullptr;
+	bool success = dcl.unpack(sourcePtr, packedSize, nullptr, 0, false);
+	free(sourcePtr);
+
+	// Leave the source just after the compressed data
+	sourceStream->seek(start + dcl.getBytesRead());
+
+	if (!success)
+		return nullptr;
+	uint32 unpackedSize = dcl.getBytesWritten();
+	return new MemoryReadStream(dcl.releaseTarget(), unpackedSize, DisposeAfterUse::YES);
 }
 
 } // End of namespace Common
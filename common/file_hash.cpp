@@ -0,0 +1,164 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "common/file_hash.h"
+#include "common/md5.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace Common {
+
+FileHashCache &FileHashCache::instance() {
+	static FileHashCache cache;
+	return cache;
+}
+
+FileHashCache::FileHashCache() : _sidecarEnabled(false) {
+}
+
+FileHashCache::~FileHashCache() {
+	save();
+}
+
+void FileHashCache::setSidecarEnabled(bool enabled) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_sidecarEnabled = enabled;
+}
+
+FileHashCache::Directory &FileHashCache::getDirectory(const std::string &directory) {
+	Directory &dir = _directories[directory];
+	if (dir.loaded || !_sidecarEnabled)
+		return dir;
+	dir.loaded = true;
+
+	FILE *f = fopen((directory + kFileHashSidecarName).c_str(), "r");
+	if (!f)
+		return dir;
+
+	// One line per digest: md5 length size mtime name
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		char hex[33];
+		unsigned long length;
+		unsigned long long size;
+		long long mtime;
+		int nameStart;
+		if (sscanf(line, "%32s %lu %llu %lld %n", hex, &length, &size, &mtime, &nameStart) != 4 || strlen(hex) != 32)
+			continue;
+
+		std::string name(line + nameStart);
+		while (!name.empty() && (name[name.size() - 1] == '\n' || name[name.size() - 1] == '\r'))
+			name.erase(name.size() - 1);
+
+		Entry entry;
+		entry.size = size;
+		entry.mtime = mtime;
+		for (int i = 0; i < 16; i++) {
+			unsigned int b;
+			sscanf(hex + i * 2, "%2x", &b);
+			entry.digest[i] = (uint8)b;
+		}
+		dir.entries[std::make_pair(name, (uint32)length)] = entry;
+	}
+	fclose(f);
+	return dir;
+}
+
+bool FileHashCache::md5(const std::string &path, uint32 length, uint8 digest[16]) {
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0 || (st.st_mode & S_IFDIR))
+		return false;
+
+	std::string::size_type slash = path.find_last_of("/\\");
+	std::string directory = (slash == std::string::npos) ? std::string() : path.substr(0, slash + 1);
+	std::pair<std::string, uint32> key(path.substr(directory.size()), length);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		Directory &dir = getDirectory(directory);
+		std::map<std::pair<std::string, uint32>, Entry>::const_iterator it = dir.entries.find(key);
+		if (it != dir.entries.end() && it->second.size == (uint64)st.st_size && it->second.mtime == (int64)st.st_mtime) {
+			memcpy(digest, it->second.digest, 16);
+			return true;
+		}
+	}
+
+	// Hash without holding the lock, so that several files can be read at once
+	if (!md5_file(path.c_str(), digest, length))
+		return false;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	Directory &dir = getDirectory(directory);
+	Entry &entry = dir.entries[key];
+	entry.size = st.st_size;
+	entry.mtime = st.st_mtime;
+	memcpy(entry.digest, digest, 16);
+	dir.dirty = true;
+	return true;
+}
+
+void FileHashCache::save() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_sidecarEnabled)
+		return;
+
+	for (std::map<std::string, Directory>::iterator dir = _directories.begin(); dir != _directories.end(); ++dir) {
+		if (!dir->second.dirty)
+			continue;
+		dir->second.dirty = false;
+
+		// Write under a temporary name first, so that a tool running at the
+		// same time never reads a partial file
+		std::string path = dir->first + kFileHashSidecarName;
+		char suffix[32];
+		snprintf(suffix, sizeof(suffix), ".%d.tmp", (int)getpid());
+		std::string tempPath = path + suffix;
+
+		FILE *f = fopen(tempPath.c_str(), "w");
+		if (!f)
+			continue;
+
+		bool ok = true;
+		for (std::map<std::pair<std::string, uint32>, Entry>::const_iterator it = dir->second.entries.begin(); it != dir->second.entries.end(); ++it) {
+			char hex[33];
+			for (int i = 0; i < 16; i++)
+				snprintf(hex + i * 2, 3, "%02x", it->second.digest[i]);
+			ok = fprintf(f, "%s %lu %llu %lld %s\n", hex, (unsigned long)it->first.second,
+			             (unsigned long long)it->second.size, (long long)it->second.mtime, it->first.first.c_str()) > 0 && ok;
+		}
+		ok = (fclose(f) == 0) && ok;
+		if (!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+			remove(tempPath.c_str());
+	}
+}
+
+} // End of namespace Common
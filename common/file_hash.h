@@ -0,0 +1,100 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COMMON_FILE_HASH_H
+#define COMMON_FILE_HASH_H
+
+#include "common/scummsys.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace Common {
+
+/** Number of leading bytes of a file hashed to recognize game files. */
+static const uint32 kDetectionHashSize = 5000;
+
+/** Name of the sidecar file of FileHashCache, in the directory of the hashed files. */
+static const char *const kFileHashSidecarName = ".scummvm-tools-md5";
+
+/**
+ * MD5 digests of files, or of their first bytes, as used to recognize the
+ * files of a game.
+ *
+ * Digests are kept in memory, keyed by the name, size and modification time
+ * of the file. If enabled, they are also kept in a sidecar file in the
+ * directory of the hashed files, so that recognizing the files of an install
+ * a second time only needs a stat per file. The sidecar is disabled by
+ * default, and silently skipped if the directory is read-only.
+ *
+ * The cache may be used from several threads at once.
+ */
+class FileHashCache {
+public:
+	/** The cache shared by all tools of the process. */
+	static FileHashCache &instance();
+
+	FileHashCache();
+	~FileHashCache();
+
+	/**
+	 * Computes the MD5 of a file, or of its first bytes.
+	 *
+	 * @param path   Path of the file.
+	 * @param length Number of bytes to hash, 0 for the whole file.
+	 * @param digest Receives the digest.
+	 * @return false if the file could not be read.
+	 */
+	bool md5(const std::string &path, uint32 length, uint8 digest[16]);
+
+	/** Enables or disables reading and writing the sidecar files, disabled by default. */
+	void setSidecarEnabled(bool enabled);
+
+	/** Writes the sidecar files of the directories with new digests. */
+	void save();
+
+private:
+	struct Entry {
+		uint64 size;
+		int64 mtime;
+		uint8 digest[16];
+	};
+
+	/** Digests of the files of a directory, by file name and hashed length. */
+	struct Directory {
+		Directory() : loaded(false), dirty(false) {}
+
+		bool loaded;
+		bool dirty;
+		std::map<std::pair<std::string, uint32>, Entry> entries;
+	};
+
+	Directory &getDirectory(const std::string &directory);
+
+	std::map<std::string, Directory> _directories;
+	std::mutex _mutex;
+	bool _sidecarEnabled;
+};
+
+} // End of namespace Common
+
+#endif
@@ -242,17 +242,20 @@ bool md5_file(const char *name, uint8 digest[16], uint32 length) {
 
 	md5_context ctx;
 	uint32 i;
-	unsigned char buf[1000];
+	static const uint32 kBufferSize = 256 * 1024;
 	bool restricted = (length != 0);
-	int readlen;
+	uint32 readlen;
 
-	if (!restricted || sizeof(buf) <= length)
-		readlen = sizeof(buf);
+	if (!restricted || kBufferSize <= length)
+		readlen = kBufferSize;
 	else
 		readlen = length;
 
-	md5_starts(&ctx);
+	// Read in large blocks straight into our own buffer
+	unsigned char *buf = new unsigned char[readlen];
+	setvbuf(f, NULL, _IONBF, 0);
 
+	md5_starts(&ctx);
 
 	while ((i = (uint32)fread(buf, 1, readlen, f)) > 0) {
 		md5_update(&ctx, buf, i);
@@ -261,9 +264,10 @@ bool md5_file(const char *name, uint8 digest[16], uint32 length) {
 		if (restricted && length == 0)
 			break;
 
-		if (restricted && sizeof(buf) > length)
+		if (restricted && kBufferSize > length)
 			readlen = length;
 	}
+	delete[] buf;
 
 	md5_finish(&ctx, digest);
 	fclose(f);
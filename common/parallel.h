@@ -0,0 +1,75 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef COMMON_PARALLEL_H
+#define COMMON_PARALLEL_H
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+/**
+ * Runs func(i) for every i in [0, count) on up to jobs threads.
+ * Workers pull the next unprocessed index from a shared counter, so a thread
+ * finishing a small work item immediately picks up the next one.
+ * If any invocation throws, the first exception is rethrown after all workers have finished.
+ *
+ * @param count Number of work items.
+ * @param jobs  Maximum number of threads to use. With 1 (or a single work item), everything runs on the calling thread.
+ * @param func  Callable taking a size_t index.
+ */
+template<typename Func>
+void parallelFor(size_t count, unsigned int jobs, Func func) {
+	if (jobs <= 1 || count <= 1) {
+		for (size_t i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+
+	if (jobs > count)
+		jobs = count;
+
+	std::atomic<size_t> next(0);
+	std::atomic<bool> failed(false);
+	std::exception_ptr error;
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < jobs; t++) {
+		workers.push_back(std::thread([&]() {
+			for (size_t i = next++; i < count && !failed; i = next++) {
+				try {
+					func(i);
+				} catch (...) {
+					if (!failed.exchange(true))
+						error = std::current_exception();
+				}
+			}
+		}));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+#endif
@@ -143,6 +143,7 @@ bool GZipReadStream::seek(int32 offset, std::ios::seekdir whence) {
 		warning("Backward seeking in GZipReadStream detected");
 #endif
 		_pos = 0;
+		_wrapped->clear();
 		_wrapped->seekg(_start, std::ios_base::beg);
 		_zlibErr = inflateReset(&_stream);
 		if (_zlibErr != Z_OK)
@@ -249,4 +250,245 @@ uint32 GZipWriteStream::write(const void *dataPtr, uint32 dataSize) {
 	return dataSize - _stream.avail_in;
 }
 
+namespace Common {
+
+GZipSeekableReadStream::GZipSeekableReadStream(SeekableReadStream *wrapped, DisposeAfterUse::Flag disposeParent, uint32 checkpointInterval)
+	: _wrapped(wrapped), _disposeParent(disposeParent), _checkpointInterval(checkpointInterval), _stream(), _eos(false), _size(-1) {
+	assert(wrapped != 0);
+	_start = _wrapped->pos();
+
+	// The size of the data is only stored by the gzip format
+	uint16 header = _wrapped->readUint16BE();
+	if (header == 0x1F8B && _wrapped->size() >= _start + 18) {
+		_wrapped->seek(-4, SEEK_END);
+		_size = _wrapped->readUint32LE();
+	}
+
+	// Adding 32 to windowBits makes zlib detect whether gzip or zlib headers
+	// are used
+	_zlibErr = inflateInit2(&_stream, MAX_WBITS + 32);
+	restart(NULL);
+}
+
+GZipSeekableReadStream::~GZipSeekableReadStream() {
+	inflateEnd(&_stream);
+	if (_disposeParent == DisposeAfterUse::YES)
+		delete _wrapped;
+}
+
+bool GZipSeekableReadStream::err() const {
+	return (_zlibErr != Z_OK && _zlibErr != Z_STREAM_END) || _wrapped->err();
+}
+
+void GZipSeekableReadStream::clearErr() {
+	// only reset _eos; I/O errors are not recoverable
+	_eos = false;
+}
+
+bool GZipSeekableReadStream::eos() const {
+	return _eos;
+}
+
+int64 GZipSeekableReadStream::pos() const {
+	return _pos;
+}
+
+int64 GZipSeekableReadStream::size() const {
+	return _size;
+}
+
+bool GZipSeekableReadStream::restart(const Checkpoint *checkpoint) {
+	if (checkpoint) {
+		// Resume in the middle of the raw deflate data
+		_zlibErr = inflateReset2(&_stream, -MAX_WBITS);
+		_inPos = checkpoint->in;
+		if (_zlibErr == Z_OK && checkpoint->bits) {
+			_wrapped->seek(_inPos - 1);
+			byte b = _wrapped->readByte();
+			_zlibErr = inflatePrime(&_stream, checkpoint->bits, b >> (8 - checkpoint->bits));
+		}
+		if (_zlibErr == Z_OK)
+			_zlibErr = inflateSetDictionary(&_stream, &checkpoint->window[0], kWindowSize);
+		memcpy(_window, &checkpoint->window[0], kWindowSize);
+		_pos = checkpoint->out;
+	} else {
+		if (_zlibErr == Z_OK || _zlibErr == Z_STREAM_END)
+			_zlibErr = inflateReset2(&_stream, MAX_WBITS + 32);
+		_inPos = _start;
+		memset(_window, 0, kWindowSize);
+		_pos = 0;
+	}
+	_stream.next_in = _input;
+	_stream.avail_in = 0;
+	_windowPos = 0;
+	_pending = 0;
+	_eos = false;
+	return _zlibErr == Z_OK;
+}
+
+void GZipSeekableReadStream::addCheckpoint() {
+	Checkpoint checkpoint;
+	checkpoint.in = _inPos - _stream.avail_in;
+	checkpoint.out = _pos + _pending;
+	checkpoint.bits = _stream.data_type & 7;
+
+	// The window is a ring, whose oldest byte is the next to be written
+	checkpoint.window.resize(kWindowSize);
+	memcpy(&checkpoint.window[0], _window + _windowPos, kWindowSize - _windowPos);
+	memcpy(&checkpoint.window[kWindowSize - _windowPos], _window, _windowPos);
+	_checkpoints.push_back(checkpoint);
+}
+
+bool GZipSeekableReadStream::fill() {
+	assert(_pending == 0);
+	if (_zlibErr != Z_OK)
+		return false;
+
+	if (_stream.avail_in == 0) {
+		if (_wrapped->pos() != _inPos)
+			_wrapped->seek(_inPos);
+		uint32 count = _wrapped->read(_input, kInputSize);
+		if (count == 0) {
+			// The compressed data ends too early
+			_zlibErr = Z_BUF_ERROR;
+			return false;
+		}
+		_inPos += count;
+		_stream.next_in = _input;
+		_stream.avail_in = count;
+	}
+
+	if (_windowPos == kWindowSize)
+		_windowPos = 0;
+	_stream.next_out = _window + _windowPos;
+	_stream.avail_out = kWindowSize - _windowPos;
+
+	// Stop at the end of each block header, where checkpoints may be taken
+	_zlibErr = inflate(&_stream, Z_BLOCK);
+	if (_zlibErr == Z_NEED_DICT)
+		_zlibErr = Z_DATA_ERROR;
+
+	uint32 count = (kWindowSize - _windowPos) - _stream.avail_out;
+	_windowPos += count;
+	_pending += count;
+
+	if (_zlibErr == Z_STREAM_END) {
+		_size = _pos + _pending;
+	} else if (_zlibErr == Z_OK && _checkpointInterval > 0 && (_stream.data_type & 128) && !(_stream.data_type & 64)) {
+		int64 last = _checkpoints.empty() ? 0 : _checkpoints.back().out;
+		if (_pos + _pending >= last + _checkpointInterval)
+			addCheckpoint();
+	}
+	return true;
+}
+
+uint32 GZipSeekableReadStream::readInternal(byte *dataPtr, uint32 dataSize) {
+	uint32 done = 0;
+	while (done < dataSize) {
+		if (_pending == 0) {
+			if (!fill())
+				break;
+			continue;
+		}
+
+		// Decompressed data always follows each other in the window
+		uint32 count = MIN(_pending, dataSize - done);
+		if (dataPtr)
+			memcpy(dataPtr + done, _window + _windowPos - _pending, count);
+		_pending -= count;
+		_pos += count;
+		done += count;
+	}
+	return done;
+}
+
+uint32 GZipSeekableReadStream::read(void *dataPtr, uint32 dataSize) {
+	uint32 count = readInternal((byte *)dataPtr, dataSize);
+	if (count < dataSize)
+		_eos = true;
+	return count;
+}
+
+bool GZipSeekableReadStream::seek(int64 offset, int whence) {
+	switch (whence) {
+	case SEEK_END:
+		if (_size < 0) {
+			// Decompress everything to find the size
+			while (readInternal(NULL, 0x7FFFFFFF) == 0x7FFFFFFF)
+				;
+			if (_size < 0)
+				return false;
+		}
+		offset += _size;
+		break;
+	case SEEK_CUR:
+		offset += _pos;
+		break;
+	case SEEK_SET:
+	default:
+		break;
+	}
+
+	if (offset < 0)
+		return false;
+
+	// Resume from the last checkpoint before the target, unless the current
+	// position is already between them
+	const Checkpoint *checkpoint = NULL;
+	for (std::vector<Checkpoint>::const_iterator i = _checkpoints.begin(); i != _checkpoints.end() && i->out <= offset; ++i)
+		checkpoint = &*i;
+	if (offset < _pos || (checkpoint && checkpoint->out > _pos)) {
+		if (!restart(checkpoint))
+			return false;
+	}
+
+	while (_pos < offset) {
+		uint32 count = (uint32)MIN(offset - _pos, (int64)0x7FFFFFFF);
+		if (readInternal(NULL, count) < count)
+			return false;
+	}
+
+	// Reset end-of-stream flag on a successful seek
+	_eos = false;
+	return true;
+}
+
+bool inflateGZip(const byte *data, uint32 size, std::vector<byte> &output) {
+	output.clear();
+
+	// The gzip trailer holds the uncompressed size modulo 4 GB, which is
+	// used as a first guess of the size of the output. Deflate compresses
+	// by 1032:1 at most, which bounds the guess for corrupted data.
+	uint64 expected = 0;
+	if (size >= 18)
+		expected = READ_LE_UINT32(data + size - 4);
+	if (expected == 0 || expected > (uint64)size * 1032)
+		expected = 64 * 1024;
+	output.resize(expected);
+
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+		return false;
+
+	stream.next_in = const_cast<byte *>(data);
+	stream.avail_in = size;
+	int err = Z_OK;
+	uint32 done = 0;
+	while (err == Z_OK) {
+		if (done == output.size())
+			output.resize(output.size() * 2);
+		stream.next_out = &output[done];
+		stream.avail_out = output.size() - done;
+		err = inflate(&stream, Z_NO_FLUSH);
+		done = output.size() - stream.avail_out;
+	}
+	inflateEnd(&stream);
+
+	output.resize(done);
+	return err == Z_STREAM_END;
+}
+
+} // End of namespace Common
+
 #endif
@@ -38,6 +38,11 @@
   #error Version 1.2.0.4 or newer of zlib is required for this code
   #endif
 
+#include <vector>
+
+#include "common/stream.h"
+#include "common/types.h"
+
 /**
  * A simple wrapper class which can be used to wrap around an arbitrary
  * other std::ifstream and will then provide on-the-fly decompression support.
@@ -101,6 +106,99 @@ public:
 	uint32 write(const void *dataPtr, uint32 dataSize);
 };
 
+namespace Common {
+
+/**
+ * Provides seekable access to the gzip or zlib compressed data of a seekable
+ * stream.
+ *
+ * As the data is decompressed for the first time, a checkpoint is recorded at
+ * the first deflate block boundary after every checkpointInterval bytes of
+ * uncompressed data. A checkpoint holds the state needed to restart the
+ * decompression there, that is its position in the compressed data and the
+ * last 32 KB of uncompressed data. Seeking then resumes from the closest
+ * checkpoint before the target, and decompresses about checkpointInterval
+ * bytes at most, instead of everything before the target.
+ *
+ * A checkpointInterval of 0 disables the checkpoints, in which case seeking
+ * backward restarts from the beginning of the data, like GZipReadStream.
+ */
+class GZipSeekableReadStream : public SeekableReadStream {
+public:
+	enum {
+		kDefaultCheckpointInterval = 1024 * 1024
+	};
+
+	GZipSeekableReadStream(SeekableReadStream *wrapped, DisposeAfterUse::Flag disposeParent = DisposeAfterUse::YES,
+	                       uint32 checkpointInterval = kDefaultCheckpointInterval);
+	~GZipSeekableReadStream();
+
+	bool err() const;
+	void clearErr();
+
+	uint32 read(void *dataPtr, uint32 dataSize);
+
+	bool eos() const;
+	int64 pos() const;
+	int64 size() const;
+	bool seek(int64 offset, int whence = SEEK_SET);
+
+	/** Number of checkpoints recorded so far. */
+	uint32 getCheckpointCount() const { return _checkpoints.size(); }
+
+private:
+	enum {
+		kWindowSize = 32768,	// 1 << MAX_WBITS
+		kInputSize = 16384
+	};
+
+	struct Checkpoint {
+		int64 in;		///< Position of the next compressed byte.
+		int64 out;		///< Position in the uncompressed data.
+		int bits;		///< Number of bits of the previous compressed byte still to use.
+		std::vector<byte> window;
+	};
+
+	SeekableReadStream *_wrapped;
+	DisposeAfterUse::Flag _disposeParent;
+	int64 _start;
+	uint32 _checkpointInterval;
+	std::vector<Checkpoint> _checkpoints;
+
+	z_stream _stream;
+	int _zlibErr;
+	bool _eos;
+	byte _input[kInputSize];
+	int64 _inPos;		///< Position of the end of _input in the wrapped stream.
+	byte _window[kWindowSize];
+	uint32 _windowPos;	///< Where the decompression writes next in _window.
+	uint32 _pending;	///< Bytes decompressed to _window but not read yet.
+	int64 _pos;
+	int64 _size;		///< Size of the uncompressed data, -1 while unknown.
+
+	/** Decompresses more data into the window, and records checkpoints. */
+	bool fill();
+	void addCheckpoint();
+	bool restart(const Checkpoint *checkpoint);
+	uint32 readInternal(byte *dataPtr, uint32 dataSize);
+};
+
+/**
+ * Decompresses gzip data held in memory.
+ *
+ * The output is sized from the uncompressed size recorded in the gzip
+ * trailer, and grown as needed if that size turns out to be wrong, so there
+ * is no limit on the size of the data.
+ *
+ * @param data   The gzip data.
+ * @param size   Size of the gzip data.
+ * @param output Receives the uncompressed data.
+ * @return false if the data is not valid gzip data, or is truncated.
+ */
+bool inflateGZip(const byte *data, uint32 size, std::vector<byte> &output);
+
+} // End of namespace Common
+
 #endif
 
 #endif
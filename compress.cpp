@@ -19,11 +19,16 @@
  *
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
+#include <signal.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sstream>
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
@@ -31,6 +36,13 @@
 
 #include "compress.h"
 #include "common/endian.h"
+#include "common/ptr.h"
+#include "common/util.h"
+#include "sound/audiostream.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #ifdef USE_VORBIS
 #include <vorbis/vorbisenc.h>
@@ -66,18 +78,16 @@ struct flaccparams {
 	bool silent;
 };
 
-struct rawtype {
-	bool isLittleEndian, isStereo;
-	uint8 bitsPerSample;
-};
-
 lameparams lameparms = { -1, -1, 32, VBR, algqualDef, vbrqualDef, 0, "lame" };
 oggencparams oggparms = { -1, -1, -1, (float)oggqualDef, 0 };
 flaccparams flacparms = { flacCompressDef, flacBlocksizeDef, false, false };
-rawtype	rawAudioType = { false, false, 8 };
+RawAudioType rawAudioType = { false, false, 8 };
 
 const char *tempEncoded = TEMP_MP3;
 
+/** Number of temporary files made by encodeAudioBuffer(), which names them after it. */
+static std::atomic<unsigned int> tempEncodedCount(0);
+
 void CompressionTool::setRawAudioType(bool isLittleEndian, bool isStereo, uint8 bitsPerSample) {
 	rawAudioType.isLittleEndian = isLittleEndian;
 	rawAudioType.isStereo = isStereo;
@@ -118,24 +128,70 @@ static int map2MP3Frequency(int freq) {
     return 48000;
 }
 
-void CompressionTool::encodeAudio(const char *inname, bool rawInput, int rawSamplerate, const char *outname, AudioFormat compmode) {
-	bool err = false;
+/** Counts a file passed to an external encoder in the trace of the tool. */
+static void traceEncoderInput(Tool &tool, const char *inname) {
+	FILE *f = fopen(inname, "rb");
+	if (f) {
+		fseek(f, 0, SEEK_END);
+		tool.addProcessedBytes(ftell(f));
+		fclose(f);
+	}
+	tool.addProcessedItems();
+}
+
+/** Returns true if a format is encoded by an external program rather than a library. */
+static bool usesExternalEncoder(AudioFormat compmode) {
+	switch (compmode) {
+	case AUDIO_MP3:
+		return true;
+	case AUDIO_VORBIS:
+#ifdef USE_VORBIS
+		return false;
+#else
+		return true;
+#endif
+	case AUDIO_FLAC:
+#ifdef USE_FLAC
+		return false;
+#else
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+static void throwEncoderError(AudioFormat compmode, const std::string &command) {
+	const char *name = (compmode == AUDIO_MP3) ? "MP3" : (compmode == AUDIO_VORBIS) ? "Vorbis" : "FLAC";
+	char buf[4096];
+	snprintf(buf, sizeof(buf), "Error in %s encoder. (check parameters)\n%s Encoder Commandline:%s\n", name, name, command.c_str());
+	throw ToolException(buf, 1);
+}
+
+/**
+ * Builds the command line of the external encoder of a format.
+ *
+ * @param type   Layout of the samples if the input is raw, NULL if it is a WAV file.
+ * @param inname Input file, or "-" to read the samples from the standard input.
+ */
+static std::string buildEncoderCommand(const RawAudioType *type, int rawSamplerate, const char *inname, const char *outname, AudioFormat compmode) {
 	char fbuf[2048];
 	char *tmp = fbuf;
+	fbuf[0] = '\0';
 
 	if (compmode == AUDIO_MP3) {
 		tmp += sprintf(tmp, "%s -t ", lameparms.lamePath.c_str());
-		if (rawInput) {
+		if (type) {
 			tmp += sprintf(tmp, "-r ");
-			tmp += sprintf(tmp, "--bitwidth %d ", rawAudioType.bitsPerSample);
+			tmp += sprintf(tmp, "--bitwidth %d ", type->bitsPerSample);
 
-			if (rawAudioType.isLittleEndian) {
+			if (type->isLittleEndian) {
 				tmp += sprintf(tmp, "--little-endian ");
 			} else {
 				tmp += sprintf(tmp, "--big-endian ");
 			}
 
-			tmp += sprintf(tmp, (rawAudioType.isStereo ? "-m j " : "-m m "));
+			tmp += sprintf(tmp, (type->isStereo ? "-m j " : "-m m "));
 			tmp += sprintf(tmp, "-s %d ", rawSamplerate);
 		}
 
@@ -171,27 +227,14 @@ void CompressionTool::encodeAudio(const char *inname, bool rawInput, int rawSamp
 		tmp += sprintf(tmp, "-q %d ", lameparms.algqual);
 
 		tmp += sprintf(tmp, "\"%s\" \"%s\" ", inname, outname);
-
-		err = spawnSubprocess(fbuf) != 0;
-
-		if (err) {
-			char buf[2048];
-			sprintf(buf, "Error in MP3 encoder.(check parameters) \nMP3 Encoder Commandline:%s\n", fbuf);
-			throw ToolException(buf, err);
-		} else {
-			return;
-		}
-	}
-
-#ifndef USE_VORBIS
-	if (compmode == AUDIO_VORBIS) {
+	} else if (compmode == AUDIO_VORBIS) {
 		tmp += sprintf(tmp, "oggenc ");
-		if (rawInput) {
+		if (type) {
 			tmp += sprintf(tmp, "--raw ");
-			tmp += sprintf(tmp, "--raw-chan=%d ", (rawAudioType.isStereo ? 2 : 1));
-			tmp += sprintf(tmp, "--raw-bits=%d ", rawAudioType.bitsPerSample);
+			tmp += sprintf(tmp, "--raw-chan=%d ", (type->isStereo ? 2 : 1));
+			tmp += sprintf(tmp, "--raw-bits=%d ", type->bitsPerSample);
 			tmp += sprintf(tmp, "--raw-rate=%d ", rawSamplerate);
-			tmp += sprintf(tmp, "--raw-endianness=%d ", (rawAudioType.isLittleEndian ? 0 : 1));
+			tmp += sprintf(tmp, "--raw-endianness=%d ", (type->isLittleEndian ? 0 : 1));
 		}
 
 		if (oggparms.nominalBitr != -1) {
@@ -214,32 +257,18 @@ void CompressionTool::encodeAudio(const char *inname, bool rawInput, int rawSamp
 
 		tmp += sprintf(tmp, "--output=\"%s\" ", outname);
 		tmp += sprintf(tmp, "\"%s\" ", inname);
-
-		err = spawnSubprocess(fbuf) != 0;
-
-		if (err) {
-			char buf[2048];
-			sprintf(buf, "Error in Vorbis encoder. (check parameters)\nVorbis Encoder Commandline:%s\n", fbuf);
-			throw ToolException(buf, err);
-		} else {
-			return;
-		}
-	}
-#endif
-
-#ifndef USE_FLAC
-	if (compmode == AUDIO_FLAC) {
+	} else if (compmode == AUDIO_FLAC) {
 		/* --lax is needed to allow 11kHz, we dont need place for meta-tags, and no seektable */
 		/* -f is reqired to force override of unremoved temp file. See bug #1294648 */
 		tmp += sprintf(tmp, "flac -f --lax --no-padding --no-seektable --no-ogg ");
 
-		if (rawInput) {
+		if (type) {
 			tmp += sprintf(tmp, "--force-raw-format ");
-			tmp += sprintf(tmp, "--sign=%s ", ((rawAudioType.bitsPerSample == 8) ? "unsigned" : "signed"));
-			tmp += sprintf(tmp, "--channels=%d ", (rawAudioType.isStereo ? 2 : 1));
-			tmp += sprintf(tmp, "--bps=%d ", rawAudioType.bitsPerSample);
+			tmp += sprintf(tmp, "--sign=%s ", ((type->bitsPerSample == 8) ? "unsigned" : "signed"));
+			tmp += sprintf(tmp, "--channels=%d ", (type->isStereo ? 2 : 1));
+			tmp += sprintf(tmp, "--bps=%d ", type->bitsPerSample);
 			tmp += sprintf(tmp, "--sample-rate=%d ", rawSamplerate);
-			tmp += sprintf(tmp, "--endian=%s ", (rawAudioType.isLittleEndian ? "little" : "big"));
+			tmp += sprintf(tmp, "--endian=%s ", (type->isLittleEndian ? "little" : "big"));
 		}
 
 		if (flacparms.silent) {
@@ -254,69 +283,206 @@ void CompressionTool::encodeAudio(const char *inname, bool rawInput, int rawSamp
 		tmp += sprintf(tmp, "-b %d ", flacparms.blocksize);
 		tmp += sprintf(tmp, "-o \"%s\" ", outname);
 		tmp += sprintf(tmp, "\"%s\" ", inname);
+	}
 
-		err = spawnSubprocess(fbuf) != 0;
+	return fbuf;
+}
 
-		if (err) {
-			char buf[2048];
-			sprintf(buf, "Error in FLAC encoder. (check parameters)\nFLAC Encoder Commandline:%s\n", fbuf);
-			throw ToolException(buf, err);
-		} else {
+/**
+ * Encodes raw samples to a file. The samples are given in chunks of any size,
+ * so that the external encoders get them without a whole sample being held in
+ * memory.
+ */
+class AudioEncoder {
+public:
+	AudioEncoder(const RawAudioType &type) : _type(type), _frameSize((type.bitsPerSample / 8) * (type.isStereo ? 2 : 1)), _frames(0) {}
+	virtual ~AudioEncoder() {}
+
+	/** Encodes the next samples. A frame may be split between two calls. */
+	void write(const byte *data, uint32 size);
+
+	/** Encodes the end of the samples and completes the output file. */
+	virtual void finish() = 0;
+
+protected:
+	/** Encodes whole frames, each holding one sample per channel. */
+	virtual void encodeFrames(const byte *data, uint32 frames) = 0;
+
+	int getChannels() const { return _type.isStereo ? 2 : 1; }
+
+	RawAudioType _type;
+	uint32 _frameSize;
+	/** Number of frames passed to encodeFrames() so far. */
+	uint32 _frames;
+	/** Start of a frame split between two calls to write(). */
+	std::vector<byte> _partial;
+};
+
+void AudioEncoder::write(const byte *data, uint32 size) {
+	if (!_partial.empty()) {
+		uint32 missing = MIN<uint32>(_frameSize - _partial.size(), size);
+		_partial.insert(_partial.end(), data, data + missing);
+		data += missing;
+		size -= missing;
+		if (_partial.size() < _frameSize)
 			return;
+		encodeFrames(&_partial[0], 1);
+		_frames++;
+		_partial.clear();
+	}
+
+	uint32 frames = size / _frameSize;
+	if (frames) {
+		encodeFrames(data, frames);
+		_frames += frames;
+	}
+	_partial.assign(data + frames * _frameSize, data + size);
+}
+
+#ifndef _WIN32
+/**
+ * Blocks SIGPIPE in the current thread while it exists. An external encoder
+ * which fails early closes its pipe, the writes to it then fail and are
+ * reported instead of killing the process.
+ */
+class ScopedBlockSigpipe {
+public:
+	ScopedBlockSigpipe() {
+		sigset_t pending;
+		sigemptyset(&_set);
+		sigaddset(&_set, SIGPIPE);
+		sigpending(&pending);
+		_wasPending = sigismember(&pending, SIGPIPE);
+		pthread_sigmask(SIG_BLOCK, &_set, &_oldSet);
+	}
+
+	~ScopedBlockSigpipe() {
+		// Discard the SIGPIPE raised by the writes, it would be delivered when unblocked
+		sigset_t pending;
+		sigpending(&pending);
+		if (!_wasPending && sigismember(&pending, SIGPIPE)) {
+			int sig;
+			sigwait(&_set, &sig);
 		}
+		pthread_sigmask(SIG_SETMASK, &_oldSet, NULL);
 	}
-#endif
-	if (rawInput) {
-		long length;
-		char *rawData;
 
-		Common::File inputRaw(inname, "rb");
-		length = inputRaw.size();
-		rawData = (char *)malloc(length);
-		inputRaw.read_throwsOnError(rawData, length);
+private:
+	sigset_t _set;
+	sigset_t _oldSet;
+	bool _wasPending;
+};
 
-		encodeRaw(rawData, length, rawSamplerate, outname, compmode);
+/** Pipes the samples to the standard input of an external encoder. */
+class PipeEncoder : public AudioEncoder {
+public:
+	PipeEncoder(const RawAudioType &type, int samplerate, const char *outname, AudioFormat compmode);
+	~PipeEncoder();
 
-		free(rawData);
-	} else {
-		int fmtHeaderSize, length, numChannels, sampleRate, bitsPerSample;
-		char *wavData;
+	void finish();
 
-		Common::File inputWav(inname, "rb");
+protected:
+	void encodeFrames(const byte *data, uint32 frames);
 
-		/* Standard PCM fmt header is 16 bits, but at least Simon 1 and 2 use 18 bits */
-		inputWav.seek(16, SEEK_SET);
-		fmtHeaderSize = inputWav.readUint32LE();
+private:
+	AudioFormat _compmode;
+	std::string _command;
+	FILE *_pipe;
+};
 
-		inputWav.seek(22, SEEK_SET);
-		numChannels = inputWav.readUint16LE();
-		sampleRate = inputWav.readUint32LE();
+PipeEncoder::PipeEncoder(const RawAudioType &type, int samplerate, const char *outname, AudioFormat compmode) :
+	AudioEncoder(type), _compmode(compmode), _pipe(NULL) {
+	_command = buildEncoderCommand(&type, samplerate, "-", outname, compmode);
+	_pipe = popen(_command.c_str(), "w");
+	if (!_pipe)
+		throwEncoderError(_compmode, _command);
+}
 
-		inputWav.seek(34, SEEK_SET);
-		bitsPerSample = inputWav.readUint16LE();
+PipeEncoder::~PipeEncoder() {
+	if (_pipe) {
+		ScopedBlockSigpipe blockSigpipe;
+		pclose(_pipe);
+	}
+}
 
-		/* The size of the raw audio is after the RIFF chunk (12 bytes), fmt chunk (8 + fmtHeaderSize bytes), and data chunk id (4 bytes) */
-		inputWav.seek(24 + fmtHeaderSize, SEEK_SET);
-		length = inputWav.readUint32LE();
+void PipeEncoder::encodeFrames(const byte *data, uint32 frames) {
+	ScopedBlockSigpipe blockSigpipe;
+	if (fwrite(data, _frameSize, frames, _pipe) != frames)
+		throwEncoderError(_compmode, _command);
+}
 
-		wavData = (char *)malloc(length);
-		inputWav.read_throwsOnError(wavData, length);
+void PipeEncoder::finish() {
+	int status;
+	{
+		// Closing the pipe writes the samples still buffered
+		ScopedBlockSigpipe blockSigpipe;
+		status = pclose(_pipe);
+	}
+	_pipe = NULL;
+	if (status != 0)
+		throwEncoderError(_compmode, _command);
+}
+#endif
 
-		setRawAudioType(true, numChannels == 2, (uint8)bitsPerSample);
-		encodeRaw(wavData, length, sampleRate, outname, compmode);
+/**
+ * Writes the samples to a temporary file, then runs an external encoder on it
+ * with Tool::spawnSubprocess(). Used when the GUI spawns the subprocesses of
+ * the tool, and on Windows, where a pipe would open a console window.
+ */
+class SubprocessEncoder : public AudioEncoder {
+public:
+	SubprocessEncoder(Tool &tool, const RawAudioType &type, int samplerate, const char *outname, AudioFormat compmode);
+	~SubprocessEncoder();
+
+	void finish();
+
+protected:
+	void encodeFrames(const byte *data, uint32 frames);
+
+private:
+	Tool &_tool;
+	int _samplerate;
+	std::string _outname;
+	std::string _rawname;
+	AudioFormat _compmode;
+	Common::File _raw;
+};
 
-		free(wavData);
+SubprocessEncoder::SubprocessEncoder(Tool &tool, const RawAudioType &type, int samplerate, const char *outname, AudioFormat compmode) :
+	AudioEncoder(type), _tool(tool), _samplerate(samplerate), _outname(outname), _compmode(compmode) {
+	// Named after the output, so that encoders running at the same time do not share it
+	_rawname = _outname + ".raw";
+	_raw.open(_rawname, "wb");
+}
+
+SubprocessEncoder::~SubprocessEncoder() {
+	if (_raw.isOpen()) {
+		_raw.close();
+		Common::removeFile(_rawname.c_str());
 	}
 }
 
-void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate, const char *outname, AudioFormat compmode) {
-	print(" - len=%ld, ch=%d, rate=%d, %dbits", length, (rawAudioType.isStereo ? 2 : 1), samplerate, rawAudioType.bitsPerSample);
+void SubprocessEncoder::encodeFrames(const byte *data, uint32 frames) {
+	_raw.write(data, frames * _frameSize);
+}
+
+void SubprocessEncoder::finish() {
+	_raw.close();
+	std::string command = buildEncoderCommand(&_type, _samplerate, _rawname.c_str(), _outname.c_str(), _compmode);
+	int status = _tool.spawnSubprocess(command.c_str());
+	Common::removeFile(_rawname.c_str());
+	if (status != 0)
+		throwEncoderError(_compmode, command);
+}
 
+#if defined(USE_VORBIS) || defined(USE_FLAC)
+/** Encodes raw samples to Ogg Vorbis or FLAC with libvorbis or libFLAC. */
+static void encodeWithLibrary(Tool &tool, const RawAudioType &type, const char *rawData, int length, int samplerate, const char *outname, AudioFormat compmode) {
 #ifdef USE_VORBIS
 	if (compmode == AUDIO_VORBIS) {
 		char outputString[256] = "";
-		int numChannels = (rawAudioType.isStereo ? 2 : 1);
-		int totalSamples = length / ((rawAudioType.bitsPerSample / 8) * numChannels);
+		int numChannels = (type.isStereo ? 2 : 1);
+		int totalSamples = length / ((type.bitsPerSample / 8) * numChannels);
 		int samplesLeft = totalSamples;
 		int eos = 0;
 		int totalBytes = 0;
@@ -346,10 +512,10 @@ void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate,
 
 			if (result == OV_EFAULT) {
 				vorbis_info_clear(&vi);
-				error("Error: Internal Logic Fault");
+				tool.error("Error: Internal Logic Fault");
 			} else if ((result == OV_EINVAL) || (result == OV_EIMPL)) {
 				vorbis_info_clear(&vi);
-				error("Error: Invalid bitrate parameters");
+				tool.error("Error: Invalid bitrate parameters");
 			}
 
 			if (!oggparms.silent) {
@@ -375,10 +541,10 @@ void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate,
 
 			if (result == OV_EFAULT) {
 				vorbis_info_clear(&vi);
-				error("Internal Logic Fault");
+				tool.error("Internal Logic Fault");
 			} else if ((result == OV_EINVAL) || (result == OV_EIMPL)) {
 				vorbis_info_clear(&vi);
-				error("Invalid bitrate parameters");
+				tool.error("Invalid bitrate parameters");
 			}
 
 			if (!oggparms.silent) {
@@ -448,15 +614,15 @@ void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate,
 				vorbis_analysis_wrote(&vd, 0);
 			} else {
 				/* Adapted from oggenc 1.1.1 */
-				if (rawAudioType.bitsPerSample == 8) {
+				if (type.bitsPerSample == 8) {
 					const byte *rawDataUnsigned = (const byte *)rawData;
 					for (int i = 0; i < numSamples; i++) {
 						for (int j = 0; j < numChannels; j++) {
 							buffer[j][i] = ((int)(rawDataUnsigned[i * numChannels + j]) - 128) / 128.0f;
 						}
 					}
-				} else if (rawAudioType.bitsPerSample == 16) {
-					if (rawAudioType.isLittleEndian) {
+				} else if (type.bitsPerSample == 16) {
+					if (type.isLittleEndian) {
 						for (int i = 0; i < numSamples; i++) {
 							for (int j = 0; j < numChannels; j++) {
 								buffer[j][i] = ((rawData[(i * 2 * numChannels) + (2 * j) + 1] << 8) | (rawData[(i * 2 * numChannels) + (2 * j)] & 0xff)) / 32768.0f;
@@ -498,7 +664,7 @@ void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate,
 				}
 			}
 
-			rawData += 2048 * (rawAudioType.bitsPerSample / 8) * numChannels;
+			rawData += 2048 * (type.bitsPerSample / 8) * numChannels;
 			samplesLeft -= 2048;
 		}
 
@@ -508,9 +674,9 @@ void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate,
 		vorbis_info_clear(&vi);
 
 		if (!oggparms.silent) {
-			print("\nDone encoding file \"%s\"", outname);
-			print("\n\tFile length:  %dm %ds", (int)(totalSamples / samplerate / 60), (totalSamples / samplerate % 60));
-			print("\tAverage bitrate: %.1f kb/s\n", (8.0 * (double)totalBytes / 1000.0) / ((double)totalSamples / (double)samplerate));
+			tool.print("\nDone encoding file \"%s\"", outname);
+			tool.print("\n\tFile length:  %dm %ds", (int)(totalSamples / samplerate / 60), (totalSamples / samplerate % 60));
+			tool.print("\tAverage bitrate: %.1f kb/s\n", (8.0 * (double)totalBytes / 1000.0) / ((double)totalSamples / (double)samplerate));
 		}
 	}
 #endif
@@ -518,20 +684,20 @@ void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate,
 #ifdef USE_FLAC
 	if (compmode == AUDIO_FLAC) {
 		int i;
-		int numChannels = (rawAudioType.isStereo ? 2 : 1);
-		int samplesPerChannel = length / ((rawAudioType.bitsPerSample / 8) * numChannels);
+		int numChannels = (type.isStereo ? 2 : 1);
+		int samplesPerChannel = length / ((type.bitsPerSample / 8) * numChannels);
 		FLAC__StreamEncoder *encoder;
 		FLAC__StreamEncoderInitStatus initStatus;
 		FLAC__int32 *flacData;
 
 		flacData = (FLAC__int32 *)malloc(samplesPerChannel * numChannels * sizeof(FLAC__int32));
 
-		if (rawAudioType.bitsPerSample == 8) {
+		if (type.bitsPerSample == 8) {
 			for (i = 0; i < samplesPerChannel * numChannels; i++) {
 				flacData[i] = (FLAC__int32)(FLAC__uint8)rawData[i] - 0x80;
 			}
-		} else if (rawAudioType.bitsPerSample == 16) {
-			if (rawAudioType.isLittleEndian) {
+		} else if (type.bitsPerSample == 16) {
+			if (type.isLittleEndian) {
 				for (i = 0; i < samplesPerChannel * numChannels; i++) {
 					flacData[i] = (FLAC__int32)((FLAC__int16)(FLAC__int8)(FLAC__byte)rawData[2 * i + 1] << 8 |
 								                (FLAC__int16)(FLAC__byte)rawData[2 * i    ]);
@@ -545,12 +711,12 @@ void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate,
 		}
 
 		if (!flacparms.silent) {
-			print("Encoding to\n         \"%s\"\nat compression level %d using blocksize %d\n", outname, flacparms.compressionLevel, flacparms.blocksize);
+			tool.print("Encoding to\n         \"%s\"\nat compression level %d using blocksize %d\n", outname, flacparms.compressionLevel, flacparms.blocksize);
 		}
 
 		encoder = FLAC__stream_encoder_new();
 
-		FLAC__stream_encoder_set_bits_per_sample(encoder, rawAudioType.bitsPerSample);
+		FLAC__stream_encoder_set_bits_per_sample(encoder, type.bitsPerSample);
 		FLAC__stream_encoder_set_blocksize(encoder, flacparms.blocksize);
 		FLAC__stream_encoder_set_channels(encoder, numChannels);
 		FLAC__stream_encoder_set_compression_level(encoder, flacparms.compressionLevel);
@@ -576,13 +742,309 @@ void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate,
 		free(flacData);
 
 		if (!flacparms.silent) {
-			print("\nDone encoding file \"%s\"", outname);
-			print("\n\tFile length:  %dm %ds\n", (int)(samplesPerChannel / samplerate / 60), (samplesPerChannel / samplerate % 60));
+			tool.print("\nDone encoding file \"%s\"", outname);
+			tool.print("\n\tFile length:  %dm %ds\n", (int)(samplesPerChannel / samplerate / 60), (samplesPerChannel / samplerate % 60));
 		}
 	}
 #endif
 }
 
+/** Collects the samples, then encodes them in one go with libvorbis or libFLAC. */
+class LibraryEncoder : public AudioEncoder {
+public:
+	LibraryEncoder(Tool &tool, const RawAudioType &type, int samplerate, uint32 totalFrames, const char *outname, AudioFormat compmode);
+
+	void finish();
+
+protected:
+	void encodeFrames(const byte *data, uint32 frames);
+
+private:
+	Tool &_tool;
+	int _samplerate;
+	std::string _outname;
+	AudioFormat _compmode;
+	std::vector<byte> _data;
+};
+
+LibraryEncoder::LibraryEncoder(Tool &tool, const RawAudioType &type, int samplerate, uint32 totalFrames, const char *outname, AudioFormat compmode) :
+	AudioEncoder(type), _tool(tool), _samplerate(samplerate), _outname(outname), _compmode(compmode) {
+	_data.reserve(totalFrames * _frameSize);
+}
+
+void LibraryEncoder::encodeFrames(const byte *data, uint32 frames) {
+	_data.insert(_data.end(), data, data + frames * _frameSize);
+}
+
+void LibraryEncoder::finish() {
+	encodeWithLibrary(_tool, _type, _data.empty() ? NULL : (const char *)&_data[0], _data.size(), _samplerate, _outname.c_str(), _compmode);
+}
+#endif
+
+AudioEncoder *CompressionTool::createEncoder(const RawAudioType &type, int samplerate, uint32 totalFrames, const char *outname, AudioFormat compmode) {
+	if (usesExternalEncoder(compmode)) {
+#ifndef _WIN32
+		if (!hasSubprocessFunction())
+			return new PipeEncoder(type, samplerate, outname, compmode);
+#endif
+		return new SubprocessEncoder(*this, type, samplerate, outname, compmode);
+	}
+
+#if defined(USE_VORBIS) || defined(USE_FLAC)
+	if (compmode == AUDIO_VORBIS || compmode == AUDIO_FLAC)
+		return new LibraryEncoder(*this, type, samplerate, totalFrames, outname, compmode);
+#endif
+	throw ToolException("Unsupported audio format");
+}
+
+std::string CompressionTool::getEncoderSettings(const RawAudioType *type, int rawSamplerate, AudioFormat compmode) const {
+	std::ostringstream os;
+
+	os << "format=" << compmode;
+	if (type) {
+		os << " raw=" << rawSamplerate << "," << (type->isLittleEndian ? "le" : "be")
+		   << "," << (type->isStereo ? 2 : 1) << "," << (int)type->bitsPerSample;
+	}
+
+	switch (compmode) {
+	case AUDIO_MP3:
+		os << " mp3=" << lameparms.minBitr << "," << lameparms.maxBitr << "," << lameparms.targetBitr
+		   << "," << lameparms.type << "," << lameparms.algqual << "," << lameparms.vbrqual;
+		os << "," << lameparms.lamePath;
+		break;
+	case AUDIO_VORBIS:
+		os << " vorbis=" << oggparms.nominalBitr << "," << oggparms.minBitr << "," << oggparms.maxBitr
+		   << "," << oggparms.quality;
+#ifdef USE_VORBIS
+		os << ",builtin";
+#endif
+		break;
+	case AUDIO_FLAC:
+		os << " flac=" << flacparms.compressionLevel << "," << flacparms.blocksize;
+#ifdef USE_FLAC
+		os << ",builtin";
+#endif
+		break;
+	default:
+		break;
+	}
+
+	return os.str();
+}
+
+void CompressionTool::setSampleCacheDirectory(const std::string &directory) {
+	_sampleCache.setDirectory(directory);
+}
+
+bool CompressionTool::lookupEncodedSample(const std::string &key, uint64 inputBytes, std::string &encoded) {
+	if (!_sampleCache.lookup(key, encoded))
+		return false;
+
+	ToolPhase phase(*this, "cache");
+	print(" - same audio already encoded, reusing it");
+	addProcessedBytes(inputBytes);
+	addProcessedItems();
+	return true;
+}
+
+bool CompressionTool::reuseEncodedSample(const std::string &key, uint64 inputBytes, const char *outname) {
+	std::string encoded;
+	if (!lookupEncodedSample(key, inputBytes, encoded))
+		return false;
+
+	Common::File output(outname, "wb");
+	output.write(encoded.data(), encoded.size());
+	return true;
+}
+
+/** Reads a whole encoded file. */
+static void readEncodedFile(const char *name, std::string &encoded) {
+	Common::File input(name, "rb");
+	encoded.resize(input.size());
+	if (!encoded.empty())
+		input.read_throwsOnError(&encoded[0], encoded.size());
+}
+
+void CompressionTool::storeEncodedSample(const std::string &key, const char *outname) {
+	std::string encoded;
+	readEncodedFile(outname, encoded);
+	_sampleCache.store(key, encoded);
+}
+
+void CompressionTool::encodeAudio(const char *inname, bool rawInput, int rawSamplerate, const char *outname, AudioFormat compmode) {
+	std::string data;
+	{
+		Common::File input(inname, "rb");
+		data.resize(input.size());
+		if (!data.empty())
+			input.read_throwsOnError(&data[0], data.size());
+	}
+
+	if (!rawInput && data.size() >= 36) {
+		// WAV input sets the raw audio type, as encodeAudioFile() does
+		const byte *header = (const byte *)data.data();
+		setRawAudioType(true, READ_LE_UINT16(header + 22) == 2, (uint8)READ_LE_UINT16(header + 34));
+	}
+
+	std::string key = EncodedSampleCache::makeKey(data.data(), data.size(), getEncoderSettings(rawInput ? &rawAudioType : NULL, rawSamplerate, compmode));
+	if (reuseEncodedSample(key, data.size(), outname))
+		return;
+
+	encodeAudioFile(inname, rawInput, rawSamplerate, outname, compmode);
+	storeEncodedSample(key, outname);
+}
+
+/** Gives samples to an encoder in chunks, then completes the output file. */
+static void encodeChunks(AudioEncoder &encoder, const byte *data, uint32 size) {
+	const uint32 kChunkSize = 64 * 1024;
+
+	for (uint32 done = 0; done < size; done += kChunkSize)
+		encoder.write(data + done, MIN(kChunkSize, size - done));
+	encoder.finish();
+}
+
+void CompressionTool::encodeAudioStream(Audio::AudioStream &stream, const std::string &sourceKey, const char *outname, AudioFormat compmode) {
+	// The samples of the stream are native 16 bits, they are given to the encoder as little endian
+	RawAudioType type = { true, stream.isStereo(), 16 };
+	int rate = stream.getRate();
+
+	std::string key;
+	if (!sourceKey.empty()) {
+		key = EncodedSampleCache::makeKey(sourceKey.data(), sourceKey.size(), getEncoderSettings(&type, rate, compmode));
+		if (reuseEncodedSample(key, 0, outname))
+			return;
+	}
+
+	const int kChunkSamples = 4096;
+	int16 samples[kChunkSamples];
+	byte data[kChunkSamples * 2];
+
+	// Decoding and encoding are interleaved, both count in the encode phase
+	ToolPhase phase(*this, "encode");
+	Common::ScopedPtr<AudioEncoder> encoder(createEncoder(type, rate, 0, outname, compmode));
+	while (!stream.endOfData()) {
+		int count = stream.readBuffer(samples, kChunkSamples);
+		if (count <= 0)
+			break;
+		for (int i = 0; i < count; i++)
+			WRITE_LE_UINT16(data + 2 * i, samples[i]);
+		encoder->write(data, count * 2);
+		addProcessedBytes(count * 2);
+	}
+	encoder->finish();
+	addProcessedItems();
+
+	if (!key.empty())
+		storeEncodedSample(key, outname);
+}
+
+void CompressionTool::encodeAudioBuffer(const byte *data, uint32 size, const RawAudioType &type, int rate, const char *outname, AudioFormat compmode) {
+	std::string key = EncodedSampleCache::makeKey(data, size, getEncoderSettings(&type, rate, compmode));
+	if (reuseEncodedSample(key, size, outname))
+		return;
+
+	encodeBuffer(data, size, type, rate, outname, compmode);
+	storeEncodedSample(key, outname);
+}
+
+void CompressionTool::encodeAudioBuffer(const byte *data, uint32 size, const RawAudioType &type, int rate, std::string &encoded, AudioFormat compmode) {
+	std::string key = EncodedSampleCache::makeKey(data, size, getEncoderSettings(&type, rate, compmode));
+	if (lookupEncodedSample(key, size, encoded))
+		return;
+
+	// The encoders still write a file, each call gets one of its own
+	char tempName[32];
+	snprintf(tempName, sizeof(tempName), "tempfile%03u.enc", tempEncodedCount++);
+	encodeBuffer(data, size, type, rate, tempName, compmode);
+	readEncodedFile(tempName, encoded);
+	Common::removeFile(tempName);
+	_sampleCache.store(key, encoded);
+}
+
+void CompressionTool::encodeBuffer(const byte *data, uint32 size, const RawAudioType &type, int rate, const char *outname, AudioFormat compmode) {
+	ToolPhase phase(*this, "encode");
+	uint32 frameSize = (type.bitsPerSample / 8) * (type.isStereo ? 2 : 1);
+	Common::ScopedPtr<AudioEncoder> encoder(createEncoder(type, rate, size / frameSize, outname, compmode));
+	encodeChunks(*encoder, data, size);
+	addProcessedBytes(size);
+	addProcessedItems();
+}
+
+std::string CompressionTool::hashFileRegion(Common::File &file, uint32 size) {
+	std::string data(size, '\0');
+	int start = file.pos();
+	if (size)
+		file.read_throwsOnError(&data[0], size);
+	file.seek(start, SEEK_SET);
+	return EncodedSampleCache::hash(data.data(), size);
+}
+
+void CompressionTool::encodeAudioFile(const char *inname, bool rawInput, int rawSamplerate, const char *outname, AudioFormat compmode) {
+	ToolPhase phase(*this, "encode");
+
+	if (usesExternalEncoder(compmode)) {
+		std::string command = buildEncoderCommand(rawInput ? &rawAudioType : NULL, rawSamplerate, inname, outname, compmode);
+		traceEncoderInput(*this, inname);
+		if (spawnSubprocess(command.c_str()) != 0)
+			throwEncoderError(compmode, command);
+		return;
+	}
+
+	if (rawInput) {
+		long length;
+		char *rawData;
+
+		Common::File inputRaw(inname, "rb");
+		length = inputRaw.size();
+		rawData = (char *)malloc(length);
+		inputRaw.read_throwsOnError(rawData, length);
+
+		encodeRaw(rawData, length, rawSamplerate, outname, compmode);
+
+		free(rawData);
+	} else {
+		int fmtHeaderSize, length, numChannels, sampleRate, bitsPerSample;
+		char *wavData;
+
+		Common::File inputWav(inname, "rb");
+
+		/* Standard PCM fmt header is 16 bits, but at least Simon 1 and 2 use 18 bits */
+		inputWav.seek(16, SEEK_SET);
+		fmtHeaderSize = inputWav.readUint32LE();
+
+		inputWav.seek(22, SEEK_SET);
+		numChannels = inputWav.readUint16LE();
+		sampleRate = inputWav.readUint32LE();
+
+		inputWav.seek(34, SEEK_SET);
+		bitsPerSample = inputWav.readUint16LE();
+
+		/* The size of the raw audio is after the RIFF chunk (12 bytes), fmt chunk (8 + fmtHeaderSize bytes), and data chunk id (4 bytes) */
+		inputWav.seek(24 + fmtHeaderSize, SEEK_SET);
+		length = inputWav.readUint32LE();
+
+		wavData = (char *)malloc(length);
+		inputWav.read_throwsOnError(wavData, length);
+
+		setRawAudioType(true, numChannels == 2, (uint8)bitsPerSample);
+		encodeRaw(wavData, length, sampleRate, outname, compmode);
+
+		free(wavData);
+	}
+}
+
+void CompressionTool::encodeRaw(const char *rawData, int length, int samplerate, const char *outname, AudioFormat compmode) {
+	ToolPhase phase(*this, "encode");
+	addProcessedBytes(length);
+	addProcessedItems();
+
+	print(" - len=%ld, ch=%d, rate=%d, %dbits", length, (rawAudioType.isStereo ? 2 : 1), samplerate, rawAudioType.bitsPerSample);
+
+	uint32 frameSize = (rawAudioType.bitsPerSample / 8) * (rawAudioType.isStereo ? 2 : 1);
+	Common::ScopedPtr<AudioEncoder> encoder(createEncoder(rawAudioType, samplerate, length / frameSize, outname, compmode));
+	encodeChunks(*encoder, (const byte *)rawData, length);
+}
+
 void CompressionTool::extractAndEncodeWAV(const char *outName, Common::File &input, AudioFormat compMode) {
 	unsigned int length;
 	char fbuf[2048];
@@ -1089,12 +1551,15 @@ bool CompressionTool::processFlacParms(){
 CompressionTool::CompressionTool(const std::string &name, ToolType type) : Tool(name, type) {
 	_supportedFormats = AUDIO_ALL;
 	_format = AUDIO_MP3;
+	_jobs = std::max(std::thread::hardware_concurrency(), 1U);
 }
 
 void CompressionTool::parseAudioArguments() {
 	if (_supportedFormats == AUDIO_NONE)
 		return;
 
+	parseSampleCacheArguments();
+
 	_format = AUDIO_MP3;
 
 	if (_arguments.front() ==  "--mp3")
@@ -1126,6 +1591,29 @@ void CompressionTool::parseAudioArguments() {
 	default: // cannot occur but we check anyway to avoid compiler warnings
 		throw ToolException("Unknown audio format, should be impossible!");
 	}
+
+	parseSampleCacheArguments();
+}
+
+void CompressionTool::parseJobsArguments() {
+	std::string value;
+	while (takeOption("--jobs", "--jobs", value)) {
+		char *end;
+		long jobs = strtol(value.c_str(), &end, 10);
+		if (value.empty() || *end != '\0' || jobs < 1)
+			throw ToolException("Could not parse command line options, the number of jobs must be a positive integer, not '" + value + "'");
+		_jobs = (unsigned int)jobs;
+	}
+}
+
+void CompressionTool::parseSampleCacheArguments() {
+	while (!_arguments.empty() && _arguments.front() == "--sample-cache") {
+		_arguments.pop_front();
+		if (_arguments.empty())
+			throw ToolException("Could not parse command line options, expected directory after --sample-cache");
+		setSampleCacheDirectory(_arguments.front());
+		_arguments.pop_front();
+	}
 }
 
 void CompressionTool::setTempFileName() {
@@ -1162,6 +1650,7 @@ std::string CompressionTool::getHelp() const {
 	if (_supportedFormats & AUDIO_FLAC)
 		os << " --flac       encode to Flac format\n";
 	os << "(If one of these is specified, it must be the first parameter.)\n";
+	os << " --sample-cache <dir> keep the encoded samples in <dir>, to reuse them in later runs\n";
 
 	if (_supportedFormats & AUDIO_MP3) {
 		os << "\nMP3 mode params:\n";
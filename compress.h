@@ -23,6 +23,13 @@
 #define COMPRESS_H
 
 #include "tool.h"
+#include "sample_cache.h"
+
+namespace Audio {
+class AudioStream;
+}
+
+class AudioEncoder;
 
 
 enum {
@@ -65,6 +72,12 @@ enum CompressionType {
 	VBR
 };
 
+/** Layout of raw samples given to an encoder. */
+struct RawAudioType {
+	bool isLittleEndian, isStereo;
+	uint8 bitsPerSample;
+};
+
 const char *audio_extensions(AudioFormat format);
 int compression_format(AudioFormat format);
 
@@ -128,12 +141,107 @@ public:
 
 	void extractAndEncodeAIFF(const char *inName, const char *outName, AudioFormat compMode);
 
+	/**
+	 * Encodes an audio file, or takes the result from the sample cache if the
+	 * same audio has already been encoded with the same settings.
+	 */
 	void encodeAudio(const char *inname, bool rawInput, int rawSamplerate, const char *outname, AudioFormat compmode);
 	void setRawAudioType(bool isLittleEndian, bool isStereo, uint8 bitsPerSample);
 
+	/**
+	 * Encodes the samples of an audio stream. The samples are pulled from the
+	 * stream in fixed-size chunks and given straight to the encoder, so the
+	 * decoded audio is neither held in memory as a whole nor written to a file.
+	 * If the sample cache already holds the result, the stream is not read.
+	 *
+	 * @param stream    The stream to encode, read until its end.
+	 * @param sourceKey Identifies the decoded audio in the sample cache, e.g. the
+	 *                  decoder and a hash of its input. Empty to bypass the cache.
+	 * @param outname   Name of the encoded file.
+	 * @param compmode  Format to encode to.
+	 */
+	void encodeAudioStream(Audio::AudioStream &stream, const std::string &sourceKey, const char *outname, AudioFormat compmode);
+
+	/**
+	 * Encodes raw samples held in memory, or takes the result from the sample
+	 * cache. Unlike encodeAudio(), this does not use the raw audio type set with
+	 * setRawAudioType(), so several threads can encode at once, each to its own
+	 * output file.
+	 *
+	 * @param data     The samples.
+	 * @param size     Size of the samples, in bytes.
+	 * @param type     Layout of the samples.
+	 * @param rate     Sample rate.
+	 * @param outname  Name of the encoded file.
+	 * @param compmode Format to encode to.
+	 */
+	void encodeAudioBuffer(const byte *data, uint32 size, const RawAudioType &type, int rate, const char *outname, AudioFormat compmode);
+
+	/**
+	 * Encodes raw samples held in memory like the above, but gives the encoded
+	 * data instead of a file. On a sample cache hit, no file is written at all.
+	 *
+	 * @param encoded Receives the encoded data.
+	 */
+	void encodeAudioBuffer(const byte *data, uint32 size, const RawAudioType &type, int rate, std::string &encoded, AudioFormat compmode);
+
+	/** Sets the directory in which encoded samples are kept across runs. */
+	void setSampleCacheDirectory(const std::string &directory);
+
 protected:
+	/** Encodes an audio file, without using the sample cache. */
+	void encodeAudioFile(const char *inname, bool rawInput, int rawSamplerate, const char *outname, AudioFormat compmode);
+
+	/**
+	 * Returns everything besides the audio data which affects the output of the encoder.
+	 *
+	 * @param type Layout of the samples if the input is raw, NULL if it is a WAV file.
+	 */
+	std::string getEncoderSettings(const RawAudioType *type, int rawSamplerate, AudioFormat compmode) const;
+
+	/** Gets an encoded sample from the sample cache, returns false if there is none. */
+	bool lookupEncodedSample(const std::string &key, uint64 inputBytes, std::string &encoded);
+
+	/** Writes an encoded sample found in the sample cache to outname, returns false if there is none. */
+	bool reuseEncodedSample(const std::string &key, uint64 inputBytes, const char *outname);
+
+	/** Adds the encoded file outname to the sample cache. */
+	void storeEncodedSample(const std::string &key, const char *outname);
+
+	/**
+	 * Creates the encoder of a format: a pipe to the external encoder, the
+	 * external encoder run on a temporary file with spawnSubprocess() when the
+	 * GUI spawns the subprocesses or on Windows, or one of the built-in encoders.
+	 *
+	 * @param totalFrames Number of frames which will be encoded, 0 if not known.
+	 */
+	AudioEncoder *createEncoder(const RawAudioType &type, int samplerate, uint32 totalFrames, const char *outname, AudioFormat compmode);
+
+	/** Encodes raw samples held in memory to outname, without using the sample cache. */
+	void encodeBuffer(const byte *data, uint32 size, const RawAudioType &type, int rate, const char *outname, AudioFormat compmode);
+
+	/** Parses the options of the sample cache. */
+	void parseSampleCacheArguments();
+
+	/**
+	 * Parses --jobs, the number of threads a tool which encodes several samples
+	 * at once may use. Called from parseExtraArguments() by such tools.
+	 */
+	void parseJobsArguments();
+
+	/**
+	 * Hashes the next bytes of a file, and seeks back to where they start.
+	 * Used to find the entries of an input file that hold the same audio, so
+	 * that they can share their encoded data in the output file.
+	 */
+	std::string hashFileRegion(Common::File &file, uint32 size);
 
 	void encodeRaw(const char *rawData, int length, int samplerate, const char *outname, AudioFormat compmode);
+
+	EncodedSampleCache _sampleCache;
+
+	/** Maximum number of threads used to encode samples, set with --jobs. */
+	unsigned int _jobs;
 };
 
 /*
@@ -0,0 +1,41 @@
+/* This file is automatically generated by configure */
+/* DO NOT EDIT MANUALLY */
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+
+#define SCUMM_LITTLE_ENDIAN
+#undef SCUMM_BIG_ENDIAN
+#undef SCUMM_NEED_ALIGNMENT
+#undef USE_VORBIS
+#undef USE_TREMOR
+#undef USE_FLAC
+#undef USE_MAD
+#define USE_PNG
+#define USE_ZLIB
+#define USE_FREETYPE2
+#define USE_ICONV
+
+/* paths */
+#define APP_MEDIA_PATH "/usr/local/share"
+
+/* Data types */
+typedef unsigned char byte;
+typedef unsigned int uint;
+typedef unsigned char uint8;
+typedef unsigned short uint16;
+typedef unsigned int uint32;
+typedef unsigned long uint64;
+typedef signed char int8;
+typedef signed short int16;
+typedef signed int int32;
+typedef signed long int64;
+
+#if defined(__APPLE__) && !defined(__ppc__)
+#ifndef _UINT64
+#define _UINT64
+#endif
+#endif
+
+#endif /* CONFIG_H */
@@ -0,0 +1,68 @@
+# -------- Generated by configure -----------
+
+CXX := g++
+CXXFLAGS :=   -g -W -Wno-unused-parameter -Wno-empty-body -std=c++11  -I/usr/include/freetype2 -I/usr/include/libpng16 
+LD := g++
+LIBS +=   -lpng16   -lz -lfreetype 
+RANLIB := ranlib
+STRIP := strip
+AR := ar cru
+AS := as
+ASFLAGS := 
+WINDRES := windres
+WINDRESFLAGS := 
+WIN32PATH=
+AMIGAOSPATH=install
+MORPHOSPATH=PROGDIR:
+STATICLIBPATH=
+XCODETOOLSPATH=
+
+EXEEXT := 
+
+PREFIX := /usr/local
+BINDIR := /usr/local/bin
+DATADIR := /usr/local/share
+MANDIR := /usr/local/share/man
+LIBDIR := /usr/local/lib
+
+
+HAVE_GCC = 1
+HAVE_GCC3 = 1
+CXX_UPDATE_DEP_FLAG = -MMD -MF "$(*D)/$(DEPDIR)/$(*F).d" -MQ "$@" -MP
+POSIX = 1
+# VERBOSE_BUILD = 1
+# USE_VORBIS = 1
+# USE_TREMOR = 1
+# USE_FLAC = 1
+# USE_MAD = 1
+USE_PNG = 1
+USE_ZLIB = 1
+USE_FREETYPE2 = 1
+BOOST_SUFFIX = 
+USE_BOOST = 1
+USE_ICONV = 1
+# USE_WXWIDGETS = 1
+
+INCLUDES +=   -I/usr/include/libpng16  
+OBJS += 
+DEFINES +=  -DPOSIX
+LDFLAGS +=  -lm
+
+WXINCLUDES := 
+WXLIBS := 
+WXSTATICLIBS := 
+
+FREETYPE2_CFLAGS := -I/usr/include/freetype2 -I/usr/include/libpng16 
+FREETYPE2_LIBS := -lfreetype 
+
+ICONVLIBS := 
+ICONVCFLAGS := -UICONV_USES_CONST
+
+SAVED_CONFIGFLAGS       := 
+SAVED_LDFLAGS           := 
+SAVED_PKG_CONFIG_LIBDIR := unset
+SAVED_CXX               := 
+SAVED_CXXFLAGS          := 
+SAVED_CPPFLAGS          := 
+SAVED_ASFLAGS           := 
+SAVED_WINDRESFLAGS      := 
@@ -0,0 +1,136 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "arena.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace Arena {
+
+const size_t kChunkSize = 256 * 1024;                ///< Size of each arena chunk.
+const size_t kAlignment = alignof(std::max_align_t); ///< Alignment of each object.
+
+static bool arenaEnabled = false;
+static bool statsEnabled = false;
+
+static std::mutex chunkMutex;
+static std::vector<char *> chunks;        ///< All chunks handed out, protected by chunkMutex.
+static std::atomic<uint32> generation(0); ///< Incremented by release() to invalidate the per-thread cursors.
+
+static std::atomic<uint64> allocations(0);
+static std::atomic<uint64> bytes(0);
+static std::atomic<uint64> liveBytes(0);
+static std::atomic<uint64> peakBytes(0);
+static std::atomic<uint64> reserved(0);
+
+/**
+ * Per-thread position in the current chunk, so threads never contend on allocation.
+ */
+struct Cursor {
+	char *_pos;         ///< Next free byte.
+	size_t _left;       ///< Bytes left in the current chunk.
+	uint32 _generation; ///< Value of generation when the chunk was taken.
+};
+
+static thread_local Cursor cursor = { NULL, 0, 0 };
+
+static char *newChunk(size_t size) {
+	char *chunk = (char *)malloc(size);
+	if (!chunk)
+		throw std::bad_alloc();
+	std::lock_guard<std::mutex> lock(chunkMutex);
+	chunks.push_back(chunk);
+	if (statsEnabled)
+		reserved += size;
+	return chunk;
+}
+
+void enable() {
+	arenaEnabled = true;
+}
+
+bool isEnabled() {
+	return arenaEnabled;
+}
+
+void enableStats() {
+	statsEnabled = true;
+}
+
+void *allocate(size_t size) {
+	if (statsEnabled) {
+		allocations++;
+		bytes += size;
+		uint64 live = (liveBytes += size);
+		uint64 peak = peakBytes;
+		while (live > peak && !peakBytes.compare_exchange_weak(peak, live))
+			;
+	}
+
+	if (!arenaEnabled)
+		return ::operator new(size);
+
+	size = (size + kAlignment - 1) & ~(kAlignment - 1);
+	if (cursor._generation != generation || cursor._left < size) {
+		// Objects larger than a chunk get a chunk of their own
+		if (size > kChunkSize)
+			return newChunk(size);
+		cursor._pos = newChunk(kChunkSize);
+		cursor._left = kChunkSize;
+		cursor._generation = generation;
+	}
+	void *p = cursor._pos;
+	cursor._pos += size;
+	cursor._left -= size;
+	return p;
+}
+
+void deallocate(void *p, size_t size) {
+	if (statsEnabled)
+		liveBytes -= size;
+
+	if (!arenaEnabled)
+		::operator delete(p);
+}
+
+void release() {
+	std::lock_guard<std::mutex> lock(chunkMutex);
+	for (std::vector<char *>::iterator it = chunks.begin(); it != chunks.end(); ++it)
+		free(*it);
+	chunks.clear();
+	generation++;
+}
+
+AllocStats getStats() {
+	AllocStats stats;
+	stats._allocations = allocations;
+	stats._bytes = bytes;
+	stats._peakBytes = peakBytes;
+	stats._reserved = reserved;
+	return stats;
+}
+
+} // End of namespace Arena
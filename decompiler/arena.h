@@ -0,0 +1,97 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef DEC_ARENA_H
+#define DEC_ARENA_H
+
+#include <cstddef>
+
+#include "common/scummsys.h"
+
+/**
+ * Allocation statistics for reference-counted objects.
+ */
+struct AllocStats {
+	uint64 _allocations; ///< Number of objects allocated.
+	uint64 _bytes;       ///< Total number of bytes requested.
+	uint64 _peakBytes;   ///< Highest number of bytes in use by live objects at any time.
+	uint64 _reserved;    ///< Number of bytes reserved for arena chunks.
+};
+
+/**
+ * Allocator used for all RefCounted objects (instructions, values and groups).
+ *
+ * By default, objects are allocated on the heap. In arena mode, objects are
+ * bump-allocated from large chunks instead; destructors still run when the last
+ * reference goes away, but the memory is only returned when release() is called
+ * at the end of the script.
+ */
+namespace Arena {
+
+/**
+ * Switches to arena mode. Must be called before the first RefCounted object is created.
+ */
+void enable();
+
+/**
+ * Returns whether or not arena mode is active.
+ *
+ * @return True if objects are allocated from the arena, false if they are allocated on the heap.
+ */
+bool isEnabled();
+
+/**
+ * Enables collection of allocation statistics.
+ */
+void enableStats();
+
+/**
+ * Allocates memory for an object.
+ *
+ * @param size The size of the object.
+ * @return Pointer to the allocated memory.
+ */
+void *allocate(size_t size);
+
+/**
+ * Deallocates memory for an object. In arena mode, the memory is only
+ * reclaimed by release().
+ *
+ * @param p    Pointer to the object.
+ * @param size The size of the object.
+ */
+void deallocate(void *p, size_t size);
+
+/**
+ * Frees all arena chunks. No objects allocated from the arena may be alive.
+ */
+void release();
+
+/**
+ * Returns the statistics collected since enableStats() was called.
+ *
+ * @return The allocation statistics.
+ */
+AllocStats getStats();
+
+} // End of namespace Arena
+
+#endif
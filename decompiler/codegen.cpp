@@ -21,14 +21,16 @@
 
 #include "codegen.h"
 #include "engine.h"
+#include "common/parallel.h"
 
 #include <algorithm>
 #include <iostream>
 #include <set>
+#include <sstream>
 #include <boost/format.hpp>
 
-#define GET(vertex) (boost::get(boost::vertex_name, _g, vertex))
-#define GET_EDGE(edge) (boost::get(boost::edge_attribute, _g, edge))
+#define GET(vertex) (boost::get(boost::vertex_name, *_g, vertex))
+#define GET_EDGE(edge) (boost::get(boost::edge_attribute, *_g, edge))
 
 std::string CodeGenerator::constructFuncSignature(const Function &func) {
 	return "";
@@ -47,71 +49,113 @@ CodeGenerator::CodeGenerator(Engine *engine, std::ostream &output, ArgOrder binO
 
 typedef std::pair<GraphVertex, ValueStack> DFSEntry;
 
-void CodeGenerator::generate(const Graph &g) {
-	_g = g;
+void CodeGenerator::generate(const Graph &g, unsigned int jobs) {
+	_g = &g;
 
+	if (jobs <= 1 || _engine->_functions.size() < 2) {
+		for (FuncMap::iterator fn = _engine->_functions.begin(); fn != _engine->_functions.end(); ++fn)
+			generateFunction(fn->first, fn->second, fn == _engine->_functions.begin(), NULL);
+		return;
+	}
+
+	std::vector<FuncMap::iterator> funcs;
+	std::vector<const Group *> stopGroups;
+	std::vector<int> dupIndexes;
+	int dupIndex = getDupIndex();
 	for (FuncMap::iterator fn = _engine->_functions.begin(); fn != _engine->_functions.end(); ++fn) {
-		_indentLevel = 0;
-		while (!_stack.empty())
-			_stack.pop();
-		GraphVertex entryPoint = fn->second._v;
-		std::string funcSignature = constructFuncSignature(fn->second);
-		bool printFuncSignature = !funcSignature.empty();
-		if (printFuncSignature) {
-			_curGroup = GET(entryPoint);
-			if (!(fn == _engine->_functions.begin()))
-				addOutputLine("");
-			addOutputLine(funcSignature, false, true);
-		}
+		FuncMap::iterator next = fn;
+		++next;
+		funcs.push_back(fn);
+		stopGroups.push_back(next == _engine->_functions.end() ? NULL : GET(next->second._v).get());
 
-		GroupPtr lastGroup = GET(entryPoint);
-
-		// DFS from entry point to process each vertex
-		Stack<DFSEntry> dfsStack;
-		std::set<GraphVertex> seen;
-		dfsStack.push(DFSEntry(entryPoint, ValueStack()));
-		seen.insert(entryPoint);
-		while (!dfsStack.empty()) {
-			DFSEntry e = dfsStack.pop();
-			GroupPtr tmp = GET(e.first);
-			if ((*tmp->_start)->_address > (*lastGroup->_start)->_address)
-				lastGroup = tmp;
-			_stack = e.second;
-			GraphVertex v = e.first;
-			process(v);
-			OutEdgeRange r = boost::out_edges(v, _g);
-			for (OutEdgeIterator i = r.first; i != r.second; ++i) {
-				GraphVertex target = boost::target(*i, _g);
-				if (seen.find(target) == seen.end()) {
-					dfsStack.push(DFSEntry(target, _stack));
-					seen.insert(target);
-				}
+		// Give each function its own range of temporaries, so the numbering does not depend on scheduling
+		dupIndexes.push_back(dupIndex);
+		if (next != _engine->_functions.end()) {
+			for (ConstInstIterator it = fn->second._startIt; (*it)->_address < next->first; ++it) {
+				if (dynamic_cast<const DupInstruction *>(it->get()))
+					dupIndex++;
 			}
 		}
+	}
 
-		if (printFuncSignature) {
-			_curGroup = lastGroup;
-			addOutputLine("}", true, false);
-		}
+	std::vector<std::string> output(funcs.size());
+	parallelFor(funcs.size(), jobs, [&](size_t i) {
+		std::stringstream stream;
+		CodeGenerator *cg = _engine->getCodeGenerator(stream);
+		cg->_g = _g;
+		setDupIndex(dupIndexes[i]);
+		cg->generateFunction(funcs[i]->first, funcs[i]->second, i == 0, stopGroups[i]);
+		dupIndexes[i] = getDupIndex();
+		delete cg;
+		output[i] = stream.str();
+	});
+	setDupIndex(*std::max_element(dupIndexes.begin(), dupIndexes.end()));
 
-		// Print output
-		GroupPtr p = GET(entryPoint);
-		while (p != NULL) {
-			for (std::vector<CodeLine>::iterator it = p->_code.begin(); it != p->_code.end(); ++it) {
-				if (it->_unindentBefore) {
-					assert(_indentLevel > 0);
-					_indentLevel--;
-				}
-				_output << boost::format("%08X: %s") % (*p->_start)->_address % indentString(it->_line) << std::endl;
-				if (it->_indentAfter)
-					_indentLevel++;
+	for (size_t i = 0; i < output.size(); i++)
+		_output << output[i];
+}
+
+void CodeGenerator::generateFunction(uint32 address, const Function &func, bool first, const Group *stopGroup) {
+	_indentLevel = 0;
+	while (!_stack.empty())
+		_stack.pop();
+	GraphVertex entryPoint = func._v;
+	std::string funcSignature = constructFuncSignature(func);
+	bool printFuncSignature = !funcSignature.empty();
+	if (printFuncSignature) {
+		_curGroup = GET(entryPoint);
+		if (!first)
+			addOutputLine("");
+		addOutputLine(funcSignature, false, true);
+	}
+
+	GroupPtr lastGroup = GET(entryPoint);
+
+	// DFS from entry point to process each vertex
+	Stack<DFSEntry> dfsStack;
+	std::set<GraphVertex> seen;
+	dfsStack.push(DFSEntry(entryPoint, ValueStack()));
+	seen.insert(entryPoint);
+	while (!dfsStack.empty()) {
+		DFSEntry e = dfsStack.pop();
+		GroupPtr tmp = GET(e.first);
+		if ((*tmp->_start)->_address > (*lastGroup->_start)->_address)
+			lastGroup = tmp;
+		_stack = e.second;
+		GraphVertex v = e.first;
+		process(v);
+		OutEdgeRange r = boost::out_edges(v, *_g);
+		for (OutEdgeIterator i = r.first; i != r.second; ++i) {
+			GraphVertex target = boost::target(*i, *_g);
+			if (seen.find(target) == seen.end()) {
+				dfsStack.push(DFSEntry(target, _stack));
+				seen.insert(target);
 			}
-			p = p->_next;
 		}
+	}
 
-		if (_indentLevel != 0)
-			std::cerr << boost::format("WARNING: Indent level for function at %d ended at %d\n") % fn->first % _indentLevel;
+	if (printFuncSignature) {
+		_curGroup = lastGroup;
+		addOutputLine("}", true, false);
 	}
+
+	// Print output
+	const Group *p = GET(entryPoint).get();
+	while (p != NULL && p != stopGroup) {
+		for (std::vector<CodeLine>::const_iterator it = p->_code.begin(); it != p->_code.end(); ++it) {
+			if (it->_unindentBefore) {
+				assert(_indentLevel > 0);
+				_indentLevel--;
+			}
+			_output << boost::format("%08X: %s") % (*p->_start)->_address % indentString(it->_line) << std::endl;
+			if (it->_indentAfter)
+				_indentLevel++;
+		}
+		p = p->_next;
+	}
+
+	if (_indentLevel != 0)
+		std::cerr << boost::format("WARNING: Indent level for function at %d ended at %d\n") % address % _indentLevel;
 }
 
 void CodeGenerator::addOutputLine(std::string s, bool unindentBefore, bool indentAfter) {
@@ -133,12 +177,12 @@ void CodeGenerator::process(GraphVertex v) {
 		addOutputLine("} else {", true, true);
 
 	// Check ingoing edges to see if we want to add any extra output
-	InEdgeRange ier = boost::in_edges(v, _g);
+	InEdgeRange ier = boost::in_edges(v, *_g);
 	for (InEdgeIterator ie = ier.first; ie != ier.second; ++ie) {
-		GraphVertex in = boost::source(*ie, _g);
+		GraphVertex in = boost::source(*ie, *_g);
 		GroupPtr inGroup = GET(in);
 
-		if (!boost::get(boost::edge_attribute, _g, *ie)._isJump || inGroup->_stackLevel == -1)
+		if (!boost::get(boost::edge_attribute, *_g, *ie)._isJump || inGroup->_stackLevel == -1)
 			continue;
 
 		switch (inGroup->_type) {
@@ -176,10 +220,11 @@ void CodeGenerator::processInst(const InstPtr inst) {
 		switch (_curGroup->_type) {
 		case kIfCondGroupType:
 			if (_curGroup->_startElse && _curGroup->_code.size() == 1) {
-				OutEdgeRange oer = boost::out_edges(_curVertex, _g);
+				OutEdgeRange oer = boost::out_edges(_curVertex, *_g);
 				bool coalesceElse = false;
 				for (OutEdgeIterator oe = oer.first; oe != oer.second; ++oe) {
-					GroupPtr oGr = GET(boost::target(*oe, _g))->_prev;
+					// Raw pointer, the previous group may belong to a function generated by another thread
+					const Group *oGr = GET(boost::target(*oe, *_g))->_prev;
 					if (std::find(oGr->_endElse.begin(), oGr->_endElse.end(), _curGroup.get()) != oGr->_endElse.end())
 						coalesceElse = true;
 				}
@@ -214,10 +259,10 @@ void CodeGenerator::processInst(const InstPtr inst) {
 		default:
 			{
 				bool printJump = true;
-				OutEdgeRange r = boost::out_edges(_curVertex, _g);
+				OutEdgeRange r = boost::out_edges(_curVertex, *_g);
 				for (OutEdgeIterator e = r.first; e != r.second && printJump; ++e) {
 					// Don't output jump to next vertex
-					if (boost::target(*e, _g) == _curGroup->_next->_vertex) {
+					if (boost::target(*e, *_g) == _curGroup->_next->_vertex) {
 						printJump = false;
 						break;
 					}
@@ -229,10 +274,10 @@ void CodeGenerator::processInst(const InstPtr inst) {
 					}
 
 
-					OutEdgeRange targetR = boost::out_edges(boost::target(*e, _g), _g);
+					OutEdgeRange targetR = boost::out_edges(boost::target(*e, *_g), *_g);
 					for (OutEdgeIterator targetE = targetR.first; targetE != targetR.second; ++targetE) {
 						// Don't output jump to while loop that has jump to next vertex
-						if (boost::target(*targetE, _g) == _curGroup->_next->_vertex)
+						if (boost::target(*targetE, *_g) == _curGroup->_next->_vertex)
 							printJump = false;
 					}
 				}
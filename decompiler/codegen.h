@@ -49,7 +49,7 @@ enum ArgOrder {
  */
 class CodeGenerator {
 private:
-	Graph _g;                  ///< The annotated graph of the script.
+	const Graph *_g;           ///< The annotated graph of the script.
 
 	/**
 	 * Processes a GraphVertex.
@@ -58,6 +58,16 @@ private:
 	 */
 	void process(GraphVertex v);
 
+	/**
+	 * Generates code for a single function and outputs it.
+	 *
+	 * @param address   The starting address of the function.
+	 * @param func      The function to generate code for.
+	 * @param first     Whether or not this is the first function in the script.
+	 * @param stopGroup The first group not belonging to the function, or NULL to output every group up to the end of the script.
+	 */
+	void generateFunction(uint32 address, const Function &func, bool first, const Group *stopGroup);
+
 protected:
 	Engine *_engine;        ///< Pointer to the Engine used for the script.
 	std::ostream &_output;  ///< The std::ostream to output the code to.
@@ -109,10 +119,14 @@ public:
 
 	/**
 	 * Generates code from the provided graph and outputs it to stdout.
+	 * With more than one job, the functions are generated in parallel by separate
+	 * code generators and output in address order. Only do this if the control flow
+	 * analysis found the functions to be independent (see ControlFlow::isPartitioned).
 	 *
-	 * @param g The annotated graph of the script.
+	 * @param g    The annotated graph of the script.
+	 * @param jobs Maximum number of threads to use.
 	 */
-	void generate(const Graph &g);
+	void generate(const Graph &g, unsigned int jobs = 1);
 
 	/**
 	 * Adds a line of code to the current group.
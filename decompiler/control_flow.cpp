@@ -20,6 +20,7 @@
  */
 
 #include "control_flow.h"
+#include "common/parallel.h"
 #include "stack.h"
 
 #include <algorithm>
@@ -375,19 +376,76 @@ void ControlFlow::detectShortCircuit() {
 	}
 }
 
-const Graph &ControlFlow::analyze() {
-	detectDoWhile();
-	detectWhile();
-	detectBreak();
-	detectContinue();
-	detectIf();
-	detectElse();
-	return _g;
-}
+bool ControlFlow::partitionFunctions() {
+	_partitions.clear();
+	if (_engine->_functions.size() < 2)
+		return false;
+
+	std::vector<uint32> starts;
+	for (FuncMap::iterator fn = _engine->_functions.begin(); fn != _engine->_functions.end(); ++fn)
+		starts.push_back(fn->first);
 
-void ControlFlow::detectWhile() {
+	// Partition 0 holds any code before the first function, partition n holds function n - 1
+	std::vector<size_t> partitionOf(_insts.size());
+	std::vector<VertexList> partitions(starts.size() + 1);
 	VertexRange vr = boost::vertices(_g);
 	for (VertexIterator v = vr.first; v != vr.second; ++v) {
+		uint32 address = (*GET(*v)->_start)->_address;
+		size_t idx = std::upper_bound(starts.begin(), starts.end(), address) - starts.begin();
+		partitionOf[boost::get(boost::vertex_index, _g, *v)] = idx;
+		partitions[idx].push_back(*v);
+	}
+
+	// Functions jumping into each other must be analyzed together
+	boost::graph_traits<Graph>::edge_iterator e, eEnd;
+	for (boost::tie(e, eEnd) = boost::edges(_g); e != eEnd; ++e) {
+		if (partitionOf[boost::get(boost::vertex_index, _g, boost::source(*e, _g))] != partitionOf[boost::get(boost::vertex_index, _g, boost::target(*e, _g))])
+			return false;
+	}
+
+	for (std::vector<VertexList>::iterator it = partitions.begin(); it != partitions.end(); ++it) {
+		if (!it->empty())
+			_partitions.push_back(*it);
+	}
+	return true;
+}
+
+typedef void (ControlFlow::*DetectionStep)(const VertexList &);
+
+const Graph &ControlFlow::analyze(unsigned int jobs) {
+	if (jobs > 1 && partitionFunctions()) {
+		const DetectionStep steps[] = {
+			&ControlFlow::detectDoWhile,
+			&ControlFlow::detectWhile,
+			&ControlFlow::detectBreak,
+			&ControlFlow::detectContinue,
+			&ControlFlow::detectIf,
+			&ControlFlow::detectElse
+		};
+		// Each step must be completed for all functions before the next one starts
+		for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+			DetectionStep step = steps[i];
+			parallelFor(_partitions.size(), jobs, [this, step](size_t idx) {
+				(this->*step)(_partitions[idx]);
+			});
+		}
+		return _g;
+	}
+
+	_partitions.clear();
+	VertexRange vr = boost::vertices(_g);
+	VertexList vertices(vr.first, vr.second);
+	detectDoWhile(vertices);
+	detectWhile(vertices);
+	detectBreak(vertices);
+	detectContinue(vertices);
+	detectIf(vertices);
+	detectElse(vertices);
+	return _g;
+}
+
+void ControlFlow::detectWhile(const VertexList &vertices) {
+	for (VertexList::const_iterator v = vertices.begin(); v != vertices.end(); ++v) {
 		GroupPtr gr = GET(*v);
 		// Undetermined block that ends with conditional jump
 		if (out_degree(*v, _g) == 2 && gr->_type == kNormalGroupType) {
@@ -405,9 +463,8 @@ void ControlFlow::detectWhile() {
 	}
 }
 
-void ControlFlow::detectDoWhile() {
-	VertexRange vr = boost::vertices(_g);
-	for (VertexIterator v = vr.first; v != vr.second; ++v) {
+void ControlFlow::detectDoWhile(const VertexList &vertices) {
+	for (VertexList::const_iterator v = vertices.begin(); v != vertices.end(); ++v) {
 		GroupPtr gr = GET(*v);
 		// Undetermined block that ends with conditional jump...
 		if (out_degree(*v, _g) == 2 && gr->_type == kNormalGroupType) {
@@ -422,9 +479,8 @@ void ControlFlow::detectDoWhile() {
 	}
 }
 
-void ControlFlow::detectBreak() {
-	VertexRange vr = boost::vertices(_g);
-	for (VertexIterator v = vr.first; v != vr.second; ++v) {
+void ControlFlow::detectBreak(const VertexList &vertices) {
+	for (VertexList::const_iterator v = vertices.begin(); v != vertices.end(); ++v) {
 		GroupPtr gr = GET(*v);
 		// Undetermined block with unconditional jump...
 		if (gr->_type == kNormalGroupType && ((*gr->_end)->isUncondJump()) && out_degree(*v, _g) == 1) {
@@ -439,7 +495,7 @@ void ControlFlow::detectBreak() {
 				GroupPtr sourceGr = GET(boost::source(*ie, _g));
 				// ...to block immediately after a do-while condition, or to jump target of a while condition
 				if ((targetGr->_prev == sourceGr && sourceGr->_type == kDoWhileCondGroupType) || sourceGr->_type == kWhileCondGroupType) {
-					if (validateBreakOrContinue(gr, sourceGr))
+					if (validateBreakOrContinue(gr.get(), sourceGr.get()))
 						gr->_type = kBreakGroupType;
 				}
 			}
@@ -447,9 +503,8 @@ void ControlFlow::detectBreak() {
 	}
 }
 
-void ControlFlow::detectContinue() {
-	VertexRange vr = boost::vertices(_g);
-	for (VertexIterator v = vr.first; v != vr.second; ++v) {
+void ControlFlow::detectContinue(const VertexList &vertices) {
+	for (VertexList::const_iterator v = vertices.begin(); v != vertices.end(); ++v) {
 		GroupPtr gr = GET(*v);
 		// Undetermined block with unconditional jump...
 		if (gr->_type == kNormalGroupType && ((*gr->_end)->isUncondJump()) && out_degree(*v, _g) == 1) {
@@ -473,15 +528,16 @@ void ControlFlow::detectContinue() {
 				if (afterJumpTargets)
 					isContinue = false;
 
-				if (isContinue && validateBreakOrContinue(gr, targetGr))
+				if (isContinue && validateBreakOrContinue(gr.get(), targetGr.get()))
 					gr->_type = kContinueGroupType;
 			}
 		}
 	}
 }
 
-bool ControlFlow::validateBreakOrContinue(GroupPtr gr, GroupPtr condGr) {
-	GroupPtr from, to, cursor;
+bool ControlFlow::validateBreakOrContinue(const Group *gr, const Group *condGr) {
+	// Raw pointers, as the walk may reach groups of functions analyzed by other threads
+	const Group *from, *to, *cursor;
 
 	if (condGr->_type == kDoWhileCondGroupType) {
 		to = condGr;
@@ -498,14 +554,14 @@ bool ControlFlow::validateBreakOrContinue(GroupPtr gr, GroupPtr condGr) {
 			OutEdgeRange oerValidate = boost::out_edges(find(cursor->_start), _g);
 			for (OutEdgeIterator oeValidate = oerValidate.first; oeValidate != oerValidate.second; ++oeValidate) {
 				GraphVertex vValidate = boost::target(*oeValidate, _g);
-				GroupPtr gValidate = GET(vValidate);
+				const Group *gValidate = GET(vValidate).get();
 				// For all other loops of same type found in range, all targets must fall within that range
 				if ((*gValidate->_start)->_address < (*from->_start)->_address || (*gValidate->_start)->_address > (*to->_start)->_address )
 					return false;
 
 				InEdgeRange ierValidate = boost::in_edges(vValidate, _g);
 				for (InEdgeIterator ieValidate = ierValidate.first; ieValidate != ierValidate.second; ++ieValidate) {
-					GroupPtr igValidate = GET(boost::source(*ieValidate, _g));
+					const Group *igValidate = GET(boost::source(*ieValidate, _g)).get();
 					// All loops of other type going into range must be placed within range
 					if (igValidate->_type == ogt && ((*igValidate->_start)->_address < (*from->_start)->_address || (*igValidate->_start)->_address > (*to->_start)->_address ))
 					return false;
@@ -516,9 +572,8 @@ bool ControlFlow::validateBreakOrContinue(GroupPtr gr, GroupPtr condGr) {
 	return true;
 }
 
-void ControlFlow::detectIf() {
-	VertexRange vr = boost::vertices(_g);
-	for (VertexIterator v = vr.first; v != vr.second; ++v) {
+void ControlFlow::detectIf(const VertexList &vertices) {
+	for (VertexList::const_iterator v = vertices.begin(); v != vertices.end(); ++v) {
 		GroupPtr gr = GET(*v);
 		// if: Undetermined block with conditional jump
 		if (gr->_type == kNormalGroupType && ((*gr->_end)->isCondJump())) {
@@ -527,9 +582,8 @@ void ControlFlow::detectIf() {
 	}
 }
 
-void ControlFlow::detectElse() {
-	VertexRange vr = boost::vertices(_g);
-	for (VertexIterator v = vr.first; v != vr.second; ++v) {
+void ControlFlow::detectElse(const VertexList &vertices) {
+	for (VertexList::const_iterator v = vertices.begin(); v != vertices.end(); ++v) {
 		GroupPtr gr = GET(*v);
 		if (gr->_type == kIfCondGroupType) {
 			OutEdgeRange oer = boost::out_edges(*v, _g);
@@ -555,7 +609,7 @@ void ControlFlow::detectElse() {
 			OutEdgeIterator toe = boost::out_edges(find((*targetGr->_prev->_start)->_address), _g).first;
 			GroupPtr targetTargetGr = GET(boost::target(*toe, _g));
 			if ((*targetTargetGr->_start)->_address > (*targetGr->_end)->_address) {
-				if (validateElseBlock(gr, targetGr, targetTargetGr)) {
+				if (validateElseBlock(gr.get(), targetGr.get(), targetTargetGr.get())) {
 					targetGr->_startElse = true;
 					targetTargetGr->_prev->_endElse.push_back(targetGr.get());
 				}
@@ -564,14 +618,15 @@ void ControlFlow::detectElse() {
 	}
 }
 
-bool ControlFlow::validateElseBlock(GroupPtr ifGroup, GroupPtr start, GroupPtr end) {
-	for (GroupPtr cursor = start; cursor != end; cursor = cursor->_next) {
+bool ControlFlow::validateElseBlock(const Group *ifGroup, const Group *start, const Group *end) {
+	// Raw pointers, as the walk may reach groups of functions analyzed by other threads
+	for (const Group *cursor = start; cursor != end; cursor = cursor->_next) {
 		if (cursor->_type == kIfCondGroupType || cursor->_type == kWhileCondGroupType || cursor->_type == kDoWhileCondGroupType) {
 			// Validate outgoing edges of conditions
 			OutEdgeRange oer = boost::out_edges(find(cursor->_start), _g);
 			for (OutEdgeIterator oe = oer.first; oe != oer.second; ++oe) {
 				GraphVertex target = boost::target(*oe, _g);
-				GroupPtr targetGr = GET(target);
+				const Group *targetGr = GET(target).get();
 				// Each edge from condition must not leave the range [start, end]
 				if ((*start->_start)->_address > (*targetGr->_start)->_address || (*targetGr->_start)->_address > (*end->_start)->_address)
 					return false;
@@ -593,7 +648,7 @@ bool ControlFlow::validateElseBlock(GroupPtr ifGroup, GroupPtr start, GroupPtr e
 		InEdgeRange ier = boost::in_edges(find(cursor->_start), _g);
 		for (InEdgeIterator ie = ier.first; ie != ier.second; ++ie) {
 			GraphVertex source = boost::source(*ie, _g);
-			GroupPtr sourceGr = GET(source);
+			const Group *sourceGr = GET(source).get();
 
 			// Edges going to conditions...
 			if (sourceGr->_type == kIfCondGroupType || sourceGr->_type == kWhileCondGroupType || sourceGr->_type == kDoWhileCondGroupType) {
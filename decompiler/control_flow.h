@@ -25,6 +25,13 @@
 #include "graph.h"
 #include "engine.h"
 
+#include <vector>
+
+/**
+ * Type representing a list of vertices, e.g. the vertices belonging to a single function.
+ */
+typedef std::vector<GraphVertex> VertexList;
+
 /**
  * Class for doing code flow analysis.
  */
@@ -34,6 +41,7 @@ private:
 	Engine *_engine;                        ///< Pointer to the Engine used for the script.
 	const InstVec &_insts;                  ///< The instructions being analyzed
 	std::map<uint32, GraphVertex> _addrMap; ///< Map between addresses and vertices.
+	std::vector<VertexList> _partitions;    ///< Vertices split by function, ordered by address. Empty if the functions could not be separated.
 
 	/**
 	 * Finds a graph vertex through an instruction.
@@ -77,28 +85,45 @@ private:
 	 */
 	void detectShortCircuit();
 
+	/**
+	 * Splits the vertices into one list per function.
+	 * This only succeeds if no edge connects two different functions, in which
+	 * case each list can be analyzed independently of the others.
+	 *
+	 * @returns True if the graph was partitioned, false if it was not.
+	 */
+	bool partitionFunctions();
+
 	/**
 	 * Detects while blocks.
 	 * Do-while detection must be completed before running this method.
+	 *
+	 * @param vertices The vertices to process.
 	 */
-	void detectWhile();
+	void detectWhile(const VertexList &vertices);
 
 	/**
 	 * Detects do-while blocks.
+	 *
+	 * @param vertices The vertices to process.
 	 */
-	void detectDoWhile();
+	void detectDoWhile(const VertexList &vertices);
 
 	/**
 	 * Detects break statements.
 	 * Do-while and while detection must be completed before running this method.
+	 *
+	 * @param vertices The vertices to process.
 	 */
-	void detectBreak();
+	void detectBreak(const VertexList &vertices);
 
 	/**
 	 * Detects continue statements.
 	 * Do-while and while detection must be completed before running this method.
+	 *
+	 * @param vertices The vertices to process.
 	 */
-	void detectContinue();
+	void detectContinue(const VertexList &vertices);
 
 	/**
 	 * Checks if a candidate break/continue goes to the closest loop.
@@ -107,19 +132,23 @@ private:
 	 * @param condGr The group containing the respective loop condition.
 	 * @returns True if the validation succeeded, false if it did not.
 	 */
-	bool validateBreakOrContinue(GroupPtr gr, GroupPtr condGr);
+	bool validateBreakOrContinue(const Group *gr, const Group *condGr);
 
 	/**
 	 * Detects if blocks.
 	 * Must be performed after break and continue detection.
+	 *
+	 * @param vertices The vertices to process.
 	 */
-	void detectIf();
+	void detectIf(const VertexList &vertices);
 
 	/**
 	 * Detects else blocks.
 	 * Must be performed after if detection.
+	 *
+	 * @param vertices The vertices to process.
 	 */
-	void detectElse();
+	void detectElse(const VertexList &vertices);
 
 	/**
 	 * Checks if a candidate else block will cross block boundaries.
@@ -129,7 +158,7 @@ private:
 	 * @param end     The group immediately after the group ending the else.
 	 * @returns True if the validation succeeded, false if it did not.
 	 */
-	bool validateElseBlock(GroupPtr ifGroup, GroupPtr start, GroupPtr end);
+	bool validateElseBlock(const Group *ifGroup, const Group *start, const Group *end);
 
 public:
 	/**
@@ -162,10 +191,21 @@ public:
 	/**
 	 * Performs control flow analysis.
 	 * The constructs are detected in the following order: do-while, while, break, continue, if/else.
+	 * If jobs is larger than 1 and the functions in the script do not jump into each other,
+	 * each detection step processes the functions in parallel.
 	 *
+	 * @param jobs Maximum number of threads to use.
 	 * @returns The control flow graph after analysis.
 	 */
-	const Graph &analyze();
+	const Graph &analyze(unsigned int jobs = 1);
+
+	/**
+	 * Whether or not the functions could be analyzed independently of each other by the last call to analyze().
+	 * If true, code generation may also process the functions in parallel.
+	 *
+	 * @returns True if the graph was split into independent functions, false if it was not.
+	 */
+	bool isPartitioned() const { return !_partitions.empty(); }
 };
 
 #endif
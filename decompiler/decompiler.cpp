@@ -21,6 +21,7 @@
 
 #include "objectFactory.h"
 
+#include "arena.h"
 #include "disassembler.h"
 #include "reassembler.h"
 #include "engine.h"
@@ -44,7 +45,32 @@ namespace po = boost::program_options;
 
 #define ENGINE(id, description, engineClass) engines[std::string(id)] = description; engineFactory.addEntry<engineClass>(std::string(id));
 
+/**
+ * Frees the arena once all objects of the script have been destroyed, and prints allocation statistics if requested.
+ */
+struct ArenaGuard {
+	bool _printStats; ///< Whether or not to print allocation statistics.
+
+	ArenaGuard() : _printStats(false) { }
+
+	~ArenaGuard() {
+		if (_printStats) {
+			AllocStats stats = Arena::getStats();
+			std::cerr << "Allocation statistics (" << (Arena::isEnabled() ? "arena" : "heap") << "):\n";
+			std::cerr << boost::format("  Objects allocated: %d\n") % stats._allocations;
+			std::cerr << boost::format("  Bytes requested:   %d\n") % stats._bytes;
+			std::cerr << boost::format("  Peak live bytes:   %d\n") % stats._peakBytes;
+			if (Arena::isEnabled())
+				std::cerr << boost::format("  Arena reserved:    %d\n") % stats._reserved;
+		}
+		Arena::release();
+	}
+};
+
 int main(int argc, char** argv) {
+	// Must be destroyed after everything allocated from the arena
+	ArenaGuard arenaGuard;
+
 	try {
 		std::map<std::string, std::string> engines;
 		ObjectFactory<std::string, Engine> engineFactory;
@@ -65,7 +91,10 @@ int main(int argc, char** argv) {
 			("show-unreachable,u", "Show the address and contents of unreachable groups in the script.")
 			("variant,v", po::value<std::string>()->default_value(""), "Tell the engine that the script is from a specific variant. To see a list of variants supported by a specific engine, use the -h option and the -e option together.")
 			("no-stack-effect,s", "Leave out the stack effect when printing raw instructions.")
-			("dump-binary,b", po::value<std::string>(), "Compile the assembly to a binary file.");
+			("dump-binary,b", po::value<std::string>(), "Compile the assembly to a binary file.")
+			("arena,a", "Allocate instructions, values and groups from a per-script arena instead of individually on the heap.")
+			("stats", "Print allocation counts and peak memory use of instructions, values and groups to stderr.")
+			("jobs,j", po::value<unsigned int>()->default_value(1), "Number of threads to use for analyzing and generating code for independent functions.");
 			// TODO: option for only outputting labels for lines that receive jumps
 
 		po::options_description args("");
@@ -128,6 +157,13 @@ int main(int argc, char** argv) {
 			setOutputStackEffect(false);
 		}
 
+		if (vm.count("arena"))
+			Arena::enable();
+		if (vm.count("stats")) {
+			Arena::enableStats();
+			arenaGuard._printStats = true;
+		}
+
 		Engine *engine = engineFactory.create(vm["engine"].as<std::string>());
 		engine->_variant = vm["variant"].as<std::string>();
 		std::string inputFile = vm["input-file"].as<std::string>();
@@ -177,7 +213,8 @@ int main(int argc, char** argv) {
 		// Control flow analysis
 		ControlFlow *cf = new ControlFlow(insts, engine);
 		cf->createGroups();
-		Graph g = cf->analyze();
+		unsigned int jobs = vm["jobs"].as<unsigned int>();
+		Graph g = cf->analyze(jobs);
 
 		if (vm.count("dump-graph")) {
 			std::streambuf *buf;
@@ -207,7 +244,7 @@ int main(int argc, char** argv) {
 
 		// Code generation
 		CodeGenerator *cg = engine->getCodeGenerator(std::cout);
-		cg->generate(g);
+		cg->generate(g, cf->isPartitioned() ? jobs : 1);
 
 		if (vm.count("show-unreachable")) {
 			std::vector<GroupPtr> unreachable;
@@ -22,6 +22,8 @@
 #ifndef REFCOUNTED_H
 #define REFCOUNTED_H
 
+#include "arena.h"
+
 class RefCounted;
 
 inline void intrusive_ptr_add_ref(RefCounted *p);
@@ -39,6 +41,17 @@ private:
 protected:
 	RefCounted() : _refCount(0) { }
 	virtual ~RefCounted() { }
+
+public:
+	/**
+	 * Allocates memory for a reference-counted object through the Arena.
+	 */
+	static void *operator new(size_t size) { return Arena::allocate(size); }
+
+	/**
+	 * Releases memory for a reference-counted object through the Arena.
+	 */
+	static void operator delete(void *p, size_t size) { Arena::deallocate(p, size); }
 };
 
 /**
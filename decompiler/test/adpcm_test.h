@@ -0,0 +1,174 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cxxtest/TestSuite.h>
+
+#include "bench/test_data.h"
+#include "sound/adpcm.h"
+#include "common/util.h"
+
+#include <vector>
+
+class ADPCMTestSuite : public CxxTest::TestSuite {
+	TestRandom _random;
+
+	/**
+	 * The Tinsel 6-bit decoder as it was written in compress_tinsel, in double
+	 * precision, which the decoder of the ADPCM stream must match.
+	 */
+	std::vector<int16> decodeTinselReference(const std::vector<byte> &data) {
+		static const double filterTable[4][2] = {
+			{0, 0 },
+			{0.9375, 0},
+			{1.796875, -0.8125},
+			{1.53125, -0.859375}
+		};
+		const double eVal = 1.032226562;
+		const uint32 blockAlign = 24;
+		std::vector<int16> output;
+		double predictor = 0, k0 = 0, k1 = 0, d0 = 0, d1 = 0;
+		uint32 blockPos = blockAlign;
+		uint16 chunkData = 0;
+		int16 chunkWord = 0;
+		byte chunkPos = 0;
+		size_t pos = 0;
+
+		while (pos < data.size()) {
+			if (blockPos == blockAlign) {
+				byte headerByte = data[pos++];
+				byte filterVal = (headerByte & 0xC0) >> 6;
+				if ((headerByte & 0x20) != 0) {
+					headerByte = ~(headerByte | 0xC0) + 1;
+					predictor = 1 << headerByte;
+				} else {
+					headerByte &= 0x1F;
+					predictor = ((double) 1.0) / (1 << headerByte);
+				}
+				k0 = filterTable[filterVal][0];
+				k1 = filterTable[filterVal][1];
+				blockPos = 0;
+				chunkPos = 0;
+				if (pos == data.size())
+					break;
+			}
+			switch (chunkPos) {
+			case 0:
+				chunkData = data[pos++];
+				chunkWord = (chunkData << 8) & 0xFC00;
+				break;
+			case 1:
+				chunkData = (chunkData << 8) | data[pos++];
+				blockPos++;
+				chunkWord = (chunkData << 6) & 0xFC00;
+				break;
+			case 2:
+				chunkData = (chunkData << 8) | data[pos++];
+				blockPos++;
+				chunkWord = (chunkData << 4) & 0xFC00;
+				break;
+			case 3:
+				chunkData = chunkData << 8;
+				blockPos++;
+				chunkWord = (chunkData << 2) & 0xFC00;
+				break;
+			}
+			double sample = chunkWord;
+			sample *= eVal * predictor;
+			sample += (d0 * k0) + (d1 * k1);
+			d1 = d0;
+			d0 = sample;
+			output.push_back((int16)CLIP<double>(sample, -32768.0, 32767.0));
+			chunkPos = (chunkPos + 1) % 4;
+		}
+		return output;
+	}
+
+	std::vector<int16> decodeTinsel(const std::vector<byte> &data) {
+		std::vector<int16> output;
+		int16 buffer[1000];
+		Audio::AudioStream *stream = Audio::makeADPCMStream(&data[0], data.size(), Audio::kADPCMTinsel6, 22050, 1, 24);
+		while (!stream->endOfData()) {
+			int samples = stream->readBuffer(buffer, ARRAYSIZE(buffer));
+			if (samples <= 0)
+				break;
+			output.insert(output.end(), buffer, buffer + samples);
+		}
+		delete stream;
+		return output;
+	}
+
+	/**
+	 * Generates a sample of the given number of blocks. The headers use the
+	 * scales allowed by scaleMask, and all the filters.
+	 */
+	std::vector<byte> generateTinsel(int blocks, byte scaleMask, bool smooth) {
+		std::vector<byte> data;
+		for (int block = 0; block < blocks; block++) {
+			data.push_back((_random.next() & 0xC0) | (_random.next() & scaleMask));
+			for (int i = 0; i < 24; i++) {
+				// Mostly small codes, as a quiet signal would have, or noise
+				if (smooth)
+					data.push_back(_random.next() & _random.next() & _random.next());
+				else
+					data.push_back(_random.next());
+			}
+		}
+		return data;
+	}
+
+public:
+	void setUp() {
+		_random.setSeed(1);
+	}
+
+	void testTinselMatchesReference() {
+		// Scales of 1 and below, as used by real samples
+		for (int i = 0; i < 200; i++) {
+			std::vector<byte> data = generateTinsel(1 + i % 40, 0x1F, i % 2 == 0);
+			TS_ASSERT(decodeTinsel(data) == decodeTinselReference(data));
+		}
+	}
+
+	void testTinselSmallScales() {
+		// Scales between 1/16 and 1, where the output uses the full 16 bits
+		for (int i = 0; i < 200; i++) {
+			std::vector<byte> data = generateTinsel(64, 0x03, i % 2 == 0);
+			TS_ASSERT(decodeTinsel(data) == decodeTinselReference(data));
+		}
+	}
+
+	void testTinselLargeScales() {
+		// Scales above 1, which make the filter state grow quickly
+		for (int i = 0; i < 100; i++) {
+			std::vector<byte> data = generateTinsel(32, 0x3F, false);
+			TS_ASSERT(decodeTinsel(data) == decodeTinselReference(data));
+		}
+	}
+
+	void testTinselPartialBlock() {
+		// Samples need not end on a block boundary
+		for (int size = 1; size < 60; size++) {
+			std::vector<byte> data = generateTinsel(3, 0x1F, false);
+			data.resize(size);
+			TS_ASSERT(decodeTinsel(data) == decodeTinselReference(data));
+		}
+	}
+};
@@ -0,0 +1,107 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cxxtest/TestSuite.h>
+
+#include "compress.h"
+
+#include <stdio.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#define ENCODER_TEST_OUTPUT "audio_encoder_test.mp3"
+#define ENCODER_TEST_RAW ENCODER_TEST_OUTPUT ".raw"
+
+/** Encodes a buffer to MP3, with the subprocesses spawned by the test. */
+class EncoderTestTool : public CompressionTool {
+public:
+	EncoderTestTool() : CompressionTool("encoder_test", TOOLTYPE_COMPRESSION), rawSize(-1) {
+		ToolInput input;
+		input.format = "*.*";
+		_inputPaths.push_back(input);
+		setPrintFunction(printNothing, NULL);
+		setSubprocessFunction(spawn, this);
+	}
+
+	int encode(const std::vector<byte> &samples) {
+		_samples = samples;
+		std::deque<std::string> args;
+		args.push_back(getName());
+		args.push_back("--mp3");
+		args.push_back("input.raw");
+		return run(args);
+	}
+
+	std::vector<std::string> commands;
+	/** Size of the raw file when the encoder was spawned, -1 if there was none. */
+	long rawSize;
+
+protected:
+	virtual void execute() {
+		RawAudioType type = { true, false, 16 };
+		encodeAudioBuffer(&_samples[0], _samples.size(), type, 22050, ENCODER_TEST_OUTPUT, AUDIO_MP3);
+	}
+
+private:
+	static int spawn(void *udata, const char *cmd) {
+		EncoderTestTool *tool = (EncoderTestTool *)udata;
+		tool->commands.push_back(cmd);
+
+		FILE *raw = fopen(ENCODER_TEST_RAW, "rb");
+		if (raw) {
+			fseek(raw, 0, SEEK_END);
+			tool->rawSize = ftell(raw);
+			fclose(raw);
+		}
+
+		FILE *output = fopen(ENCODER_TEST_OUTPUT, "wb");
+		fputs("mp3", output);
+		fclose(output);
+		return 0;
+	}
+
+	static void printNothing(void *, const char *) {
+	}
+
+	std::vector<byte> _samples;
+};
+
+class AudioEncoderTestSuite : public CxxTest::TestSuite {
+public:
+	// The external encoder runs through the subprocess function of the GUI, not a pipe
+	void testSubprocessFunction() {
+		EncoderTestTool tool;
+		std::vector<byte> samples(10001, 0x40);
+		TS_ASSERT_EQUALS(tool.encode(samples), 0);
+		TS_ASSERT_EQUALS(tool.commands.size(), 1u);
+		TS_ASSERT(tool.commands[0].find("\"" ENCODER_TEST_RAW "\"") != std::string::npos);
+		// The partial frame at the end is not encoded
+		TS_ASSERT_EQUALS(tool.rawSize, 10000);
+
+		FILE *raw = fopen(ENCODER_TEST_RAW, "rb");
+		TS_ASSERT(!raw);
+		if (raw)
+			fclose(raw);
+		remove(ENCODER_TEST_OUTPUT);
+	}
+};
@@ -33,6 +33,7 @@
 
 #include <streambuf>
 #include <ostream>
+#include <sstream>
 
 // Define an ostream which doesn't output anything to avoid clutter
 // Source: http://groups.google.com/group/comp.lang.c++/msg/4a81a74500f9f4d3?hl=en
@@ -330,4 +331,37 @@ public:
 		delete c;
 		delete engine;
 	}
+
+	std::string decompileKyra2(const char *filename, unsigned int jobs, bool &partitioned) {
+		InstVec insts;
+		Kyra::Kyra2Engine *engine = new Kyra::Kyra2Engine();
+		Disassembler *d = engine->getDisassembler(insts);
+		d->open(filename);
+		d->disassemble();
+		delete d;
+		ControlFlow *c = new ControlFlow(insts, engine);
+		c->createGroups();
+		Graph g = c->analyze(jobs);
+		partitioned = c->isPartitioned();
+		engine->postCFG(insts, g);
+		std::stringstream s;
+		CodeGenerator *cg = engine->getCodeGenerator(s);
+		cg->generate(g, partitioned ? jobs : 1);
+		delete cg;
+		delete c;
+		delete engine;
+		return s.str();
+	}
+
+	// functions.emc contains four independent functions, each with a loop
+	// containing an if/else, so they can be decompiled in parallel.
+	void testParallelCodeGen() {
+		bool partitioned;
+		std::string serial = decompileKyra2("decompiler/test/functions.emc", 1, partitioned);
+		TS_ASSERT(!partitioned);
+		std::string parallel = decompileKyra2("decompiler/test/functions.emc", 4, partitioned);
+		TS_ASSERT(partitioned);
+		TS_ASSERT(!serial.empty());
+		TS_ASSERT(serial.compare(parallel) == 0);
+	}
 };
@@ -0,0 +1,89 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cxxtest/TestSuite.h>
+
+#include "bench/test_data.h"
+#include "common/crc32.h"
+#include "common/util.h"
+
+#include <vector>
+
+class CRC32TestSuite : public CxxTest::TestSuite {
+	/** The byte-wise CRC-32, as the ROM and ISO extractors computed it. */
+	uint32 crc32Reference(const byte *data, uint32 length) {
+		uint32 table[256];
+		for (uint32 i = 0; i < 256; i++) {
+			uint32 n = i;
+			for (int j = 0; j < 8; j++)
+				n = (n & 1) ? ((n >> 1) ^ 0xEDB88320) : (n >> 1);
+			table[i] = n;
+		}
+
+		uint32 crc = 0xFFFFFFFF;
+		for (uint32 i = 0; i < length; i++)
+			crc = (crc >> 8) ^ table[(crc ^ data[i]) & 0xFF];
+		return crc ^ 0xFFFFFFFF;
+	}
+
+public:
+	void testCheckValue() {
+		TS_ASSERT_EQUALS(Common::crc32("123456789", 9), 0xCBF43926u);
+		TS_ASSERT_EQUALS(Common::crc32("", 0), 0u);
+	}
+
+	void testLengthsAndAlignments() {
+		std::vector<byte> data(1024);
+		fillRandom(&data[0], data.size());
+
+		// Cover the unaligned heads and tails of every code path
+		for (uint32 offset = 0; offset < 16; offset++) {
+			for (uint32 length = 0; length + offset <= data.size(); length += 1 + length / 16) {
+				uint32 expected = crc32Reference(&data[offset], length);
+				TS_ASSERT_EQUALS(Common::crc32(&data[offset], length), expected);
+				// The fallback of CPUs without carry-less multiplications
+				TS_ASSERT_EQUALS(Common::crc32_update_slice8(0, &data[offset], length), expected);
+			}
+		}
+	}
+
+	void testUpdate() {
+		std::vector<byte> data(100000, 0x5A);
+		for (size_t i = 0; i < data.size(); i += 7)
+			data[i] = (byte)i;
+
+		uint32 crc = 0;
+		for (uint32 pos = 0, step = 1; pos < data.size(); pos += step, step = step * 3 % 1001 + 1)
+			crc = Common::crc32_update(crc, &data[pos], MIN<uint32>(step, data.size() - pos));
+		TS_ASSERT_EQUALS(crc, crc32Reference(&data[0], data.size()));
+
+		// Both code paths continue each other's CRC
+		crc = 0;
+		for (uint32 pos = 0, step = 1; pos < data.size(); pos += step, step = step * 3 % 1001 + 1) {
+			uint32 count = MIN<uint32>(step, data.size() - pos);
+			if (step & 1)
+				crc = Common::crc32_update_slice8(crc, &data[pos], count);
+			else
+				crc = Common::crc32_update(crc, &data[pos], count);
+		}
+		TS_ASSERT_EQUALS(crc, crc32Reference(&data[0], data.size()));
+	}
+};
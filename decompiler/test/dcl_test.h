@@ -0,0 +1,138 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <cxxtest/TestSuite.h>
+
+#include "bench/test_data.h"
+#include "common/dcl.h"
+#include "common/memstream.h"
+
+#include <string.h>
+#include <vector>
+
+class DCLTestSuite : public CxxTest::TestSuite {
+	// Binary mode, 1024 byte dictionary: "AI", then a copy of 11 bytes at
+	// offset 2, which overlaps the bytes it produces
+	static const byte *packed() {
+		static const byte data[] = { 0x00, 0x04, 0x82, 0x24, 0x25, 0x8f, 0x80, 0x7f };
+		return data;
+	}
+
+	/**
+	 * Writes a copy of the longest length code, 264 + extra bytes, from the
+	 * largest distance code, dictionary size - 15 + low bytes back.
+	 */
+	static void putLongCopy(DCLBitWriter &writer, int dictionaryType, uint32 extra, uint32 low) {
+		writer.putBits(1, 1);
+		writer.putCode("0000000");  // length value 15
+		writer.putBits(extra, 8);
+		writer.putCode("00000000"); // distance value 63
+		writer.putBits(low, dictionaryType);
+	}
+
+	/**
+	 * Checks copies whose offset plus length runs past the size of the
+	 * dictionary: the output is longer than the dictionary, and copies start
+	 * as far back as the dictionary allows.
+	 */
+	void checkLongCopies(int dictionaryType) {
+		const uint32 dictionarySize = 64 << dictionaryType;
+		DCLBitWriter writer;
+		std::vector<byte> expected;
+
+		writer.putBits(0, 8); // binary mode
+		writer.putBits(dictionaryType, 8);
+
+		TestRandom randomSource;
+		for (uint32 i = 0; i < dictionarySize + 100; i++) {
+			byte b = (byte)randomSource.next();
+			writer.putBits(0, 1);
+			writer.putBits(b, 8);
+			expected.push_back(b);
+		}
+
+		// Offset: the whole dictionary, then one byte less, then 15 less
+		const uint32 copies[][2] = { { 254, (1u << dictionaryType) - 1 }, { 100, (1u << dictionaryType) - 2 }, { 0, (1u << dictionaryType) - 16 } };
+		for (int c = 0; c < 3; c++) {
+			uint32 length = 264 + copies[c][0];
+			uint32 offset = (63u << dictionaryType) + copies[c][1] + 1;
+			putLongCopy(writer, dictionaryType, copies[c][0], copies[c][1]);
+			for (uint32 i = 0; i < length; i++)
+				expected.push_back(expected[expected.size() - offset]);
+		}
+
+		// End of stream: length value 15 with all extra bits set
+		writer.putBits(1, 1);
+		writer.putCode("0000000");
+		writer.putBits(255, 8);
+
+		std::vector<byte> unpacked(expected.size());
+		Common::MemoryReadStream stream(&writer.data[0], writer.data.size());
+		TS_ASSERT(Common::decompressDCL(&stream, &unpacked[0], writer.data.size(), unpacked.size()));
+		TS_ASSERT(unpacked == expected);
+
+		Common::MemoryReadStream dynamicStream(&writer.data[0], writer.data.size());
+		Common::SeekableReadStream *dynamicUnpacked = Common::decompressDCL(&dynamicStream);
+		TS_ASSERT(dynamicUnpacked);
+		if (!dynamicUnpacked)
+			return;
+		TS_ASSERT_EQUALS((uint32)dynamicUnpacked->size(), (uint32)expected.size());
+		std::vector<byte> dynamicData(dynamicUnpacked->size());
+		dynamicUnpacked->read(&dynamicData[0], dynamicData.size());
+		TS_ASSERT(dynamicData == expected);
+		delete dynamicUnpacked;
+	}
+
+public:
+	void testFixedSize() {
+		byte unpacked[13];
+		Common::MemoryReadStream stream(packed(), 8);
+		TS_ASSERT(Common::decompressDCL(&stream, unpacked, 8, sizeof(unpacked)));
+		TS_ASSERT(memcmp(unpacked, "AIAIAIAIAIAIA", sizeof(unpacked)) == 0);
+	}
+
+	void testDynamicSize() {
+		Common::MemoryReadStream stream(packed(), 8);
+		Common::SeekableReadStream *unpacked = Common::decompressDCL(&stream);
+		TS_ASSERT(unpacked);
+		if (!unpacked)
+			return;
+
+		byte data[13];
+		TS_ASSERT_EQUALS(unpacked->size(), 13);
+		unpacked->read(data, sizeof(data));
+		TS_ASSERT(memcmp(data, "AIAIAIAIAIAIA", sizeof(data)) == 0);
+		delete unpacked;
+	}
+
+	void testWrongSize() {
+		byte unpacked[20];
+		Common::MemoryReadStream stream(packed(), 8);
+		TS_ASSERT(!Common::decompressDCL(&stream, unpacked, 8, sizeof(unpacked)));
+	}
+
+	void testCopyPastDictionarySize() {
+		checkLongCopies(4);
+		checkLongCopies(5);
+		checkLongCopies(6);
+	}
+};
@@ -0,0 +1,137 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cxxtest/TestSuite.h>
+
+#include "bench/test_data.h"
+#include "common/scummsys.h"
+#include "common/memstream.h"
+#include "common/zlib.h"
+
+#include <vector>
+
+class GZipStreamTestSuite : public CxxTest::TestSuite {
+#ifdef USE_ZLIB
+	TestRandom _random;
+	std::vector<byte> _data;
+
+
+	/** Compresses _data, with a gzip header or a zlib one. */
+	std::vector<byte> compress(bool gzip) {
+		z_stream stream = z_stream();
+		deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + (gzip ? 16 : 0), 8, Z_DEFAULT_STRATEGY);
+		std::vector<byte> compressed(deflateBound(&stream, _data.size()));
+		stream.next_in = &_data[0];
+		stream.avail_in = _data.size();
+		stream.next_out = &compressed[0];
+		stream.avail_out = compressed.size();
+		deflate(&stream, Z_FINISH);
+		compressed.resize(stream.total_out);
+		deflateEnd(&stream);
+		return compressed;
+	}
+
+	void checkRandomAccess(Common::GZipSeekableReadStream &stream) {
+		byte buf[300];
+		for (int i = 0; i < 200; i++) {
+			uint32 offset = _random.next() * 97 % _data.size();
+			uint32 size = MIN<uint32>(sizeof(buf), _data.size() - offset);
+			TS_ASSERT(stream.seek(offset));
+			TS_ASSERT_EQUALS(stream.pos(), offset);
+			TS_ASSERT_EQUALS(stream.read(buf, size), size);
+			TS_ASSERT(memcmp(buf, &_data[offset], size) == 0);
+		}
+	}
+
+public:
+	void setUp() {
+		_random.setSeed(1);
+
+		// Text-like data, with matches reaching across the 32 KB window
+		_data.resize(3 * 1024 * 1024 + 123);
+		for (size_t i = 0; i < _data.size(); i++) {
+			if (i > 40000 && _random.next() % 4 != 0)
+				_data[i] = _data[i - 1 - _random.next() % 32000];
+			else
+				_data[i] = 'a' + _random.next() % 26;
+		}
+	}
+
+	void testSequentialRead() {
+		std::vector<byte> compressed = compress(true);
+		Common::GZipSeekableReadStream stream(new Common::MemoryReadStream(&compressed[0], compressed.size()), DisposeAfterUse::YES, 65536);
+		TS_ASSERT_EQUALS(stream.size(), (int64)_data.size());
+
+		std::vector<byte> output(_data.size() + 10);
+		TS_ASSERT_EQUALS(stream.read(&output[0], output.size()), _data.size());
+		TS_ASSERT(stream.eos());
+		TS_ASSERT(!stream.err());
+		output.resize(_data.size());
+		TS_ASSERT(output == _data);
+		TS_ASSERT(stream.getCheckpointCount() > 10);
+	}
+
+	void testRandomAccessGZip() {
+		std::vector<byte> compressed = compress(true);
+		Common::GZipSeekableReadStream stream(new Common::MemoryReadStream(&compressed[0], compressed.size()), DisposeAfterUse::YES, 65536);
+		checkRandomAccess(stream);
+	}
+
+	void testRandomAccessZlib() {
+		std::vector<byte> compressed = compress(false);
+		Common::GZipSeekableReadStream stream(new Common::MemoryReadStream(&compressed[0], compressed.size()), DisposeAfterUse::YES, 100000);
+
+		// The zlib format does not store the size, which takes a pass to find
+		TS_ASSERT_EQUALS(stream.size(), -1);
+		TS_ASSERT(stream.seek(-10, SEEK_END));
+		TS_ASSERT_EQUALS(stream.size(), (int64)_data.size());
+		checkRandomAccess(stream);
+	}
+
+	void testWithoutCheckpoints() {
+		std::vector<byte> compressed = compress(true);
+		Common::GZipSeekableReadStream stream(new Common::MemoryReadStream(&compressed[0], compressed.size()), DisposeAfterUse::YES, 0);
+		checkRandomAccess(stream);
+		TS_ASSERT_EQUALS(stream.getCheckpointCount(), 0u);
+	}
+
+	void testCorruptData() {
+		std::vector<byte> compressed = compress(true);
+		compressed.resize(compressed.size() / 2);
+		Common::GZipSeekableReadStream stream(new Common::MemoryReadStream(&compressed[0], compressed.size()), DisposeAfterUse::YES);
+		std::vector<byte> output(_data.size());
+		TS_ASSERT(stream.read(&output[0], output.size()) < _data.size());
+		TS_ASSERT(stream.err());
+	}
+
+	void testInflateInMemory() {
+		std::vector<byte> compressed = compress(true);
+		std::vector<byte> output;
+		TS_ASSERT(Common::inflateGZip(&compressed[0], compressed.size(), output));
+		TS_ASSERT_EQUALS(output.size(), _data.size());
+		TS_ASSERT_EQUALS(output.capacity(), _data.size());
+		TS_ASSERT(output == _data);
+
+		compressed.resize(compressed.size() - 100);
+		TS_ASSERT(!Common::inflateGZip(&compressed[0], compressed.size(), output));
+	}
+#endif
+};
@@ -8,6 +8,7 @@
 TESTS        := $(srcdir)/decompiler/test/*.h
 TEST_LIBS    := \
 	common/file.o\
+	decompiler/arena.o \
 	decompiler/codegen.o \
 	decompiler/control_flow.o \
 	decompiler/disassembler.o \
@@ -24,6 +25,24 @@ TEST_LIBS    := \
 	decompiler/test/disassembler/pasc.o \
 	decompiler/test/disassembler/subopcode.o	\
 	decompiler/unknown_opcode.o \
+	common/crc32.o \
+	common/dcl.o \
+	common/stream.o \
+	common/util.o \
+	common/str.o \
+	common/memorypool.o \
+	common/hashmap.o \
+	common/zlib.o \
+	sound/adpcm.o \
+	engines/grim/suffix_array.o \
+	compress.o \
+	sample_cache.o \
+	tool.o \
+	tool_trace.o \
+	version.o \
+	common/file_hash.o \
+	common/md5.o \
+	sound/audiostream.o \
 
 #
 TEST_FLAGS   := --runner=StdioPrinter
@@ -45,7 +64,7 @@ endif
 test: decompiler/test/runner
 	./decompiler/test/runner
 decompiler/test/runner: decompiler/test/runner.cpp $(TEST_LIBS)
-	$(QUIET_LINK)$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(TEST_LDFLAGS) $(TEST_CFLAGS) -o $@ $+
+	$(QUIET_LINK)$(CXX) $(CXXFLAGS) $(CPPFLAGS) $(TEST_LDFLAGS) $(TEST_CFLAGS) -o $@ $+ $(LIBS)
 decompiler/test/runner.cpp: $(TESTS)
 	@mkdir -p decompiler
 	@mkdir -p decompiler/test
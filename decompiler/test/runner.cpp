@@ -0,0 +1,418 @@
+/* Generated file, do not edit */
+
+#ifndef CXXTEST_RUNNING
+#define CXXTEST_RUNNING
+#endif
+
+#define _CXXTEST_HAVE_STD
+#define _CXXTEST_HAVE_EH
+#include <cxxtest/TestListener.h>
+#include <cxxtest/TestTracker.h>
+#include <cxxtest/TestRunner.h>
+#include <cxxtest/RealDescriptions.h>
+#include <cxxtest/StdioPrinter.h>
+
+int main() {
+ return CxxTest::StdioPrinter().run();
+}
+#include "decompiler/test/adpcm_test.h"
+
+static ADPCMTestSuite suite_ADPCMTestSuite;
+
+static CxxTest::List Tests_ADPCMTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_ADPCMTestSuite( "decompiler/test/adpcm_test.h", 30, "ADPCMTestSuite", suite_ADPCMTestSuite, Tests_ADPCMTestSuite );
+
+static class TestDescription_ADPCMTestSuite_testTinselMatchesReference : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ADPCMTestSuite_testTinselMatchesReference() : CxxTest::RealTestDescription( Tests_ADPCMTestSuite, suiteDescription_ADPCMTestSuite, 142, "testTinselMatchesReference" ) {}
+ void runTest() { suite_ADPCMTestSuite.testTinselMatchesReference(); }
+} testDescription_ADPCMTestSuite_testTinselMatchesReference;
+
+static class TestDescription_ADPCMTestSuite_testTinselSmallScales : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ADPCMTestSuite_testTinselSmallScales() : CxxTest::RealTestDescription( Tests_ADPCMTestSuite, suiteDescription_ADPCMTestSuite, 150, "testTinselSmallScales" ) {}
+ void runTest() { suite_ADPCMTestSuite.testTinselSmallScales(); }
+} testDescription_ADPCMTestSuite_testTinselSmallScales;
+
+static class TestDescription_ADPCMTestSuite_testTinselLargeScales : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ADPCMTestSuite_testTinselLargeScales() : CxxTest::RealTestDescription( Tests_ADPCMTestSuite, suiteDescription_ADPCMTestSuite, 158, "testTinselLargeScales" ) {}
+ void runTest() { suite_ADPCMTestSuite.testTinselLargeScales(); }
+} testDescription_ADPCMTestSuite_testTinselLargeScales;
+
+static class TestDescription_ADPCMTestSuite_testTinselPartialBlock : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ADPCMTestSuite_testTinselPartialBlock() : CxxTest::RealTestDescription( Tests_ADPCMTestSuite, suiteDescription_ADPCMTestSuite, 166, "testTinselPartialBlock" ) {}
+ void runTest() { suite_ADPCMTestSuite.testTinselPartialBlock(); }
+} testDescription_ADPCMTestSuite_testTinselPartialBlock;
+
+#include "decompiler/test/audio_encoder_test.h"
+
+static AudioEncoderTestSuite suite_AudioEncoderTestSuite;
+
+static CxxTest::List Tests_AudioEncoderTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_AudioEncoderTestSuite( "decompiler/test/audio_encoder_test.h", 89, "AudioEncoderTestSuite", suite_AudioEncoderTestSuite, Tests_AudioEncoderTestSuite );
+
+static class TestDescription_AudioEncoderTestSuite_testSubprocessFunction : public CxxTest::RealTestDescription {
+public:
+ TestDescription_AudioEncoderTestSuite_testSubprocessFunction() : CxxTest::RealTestDescription( Tests_AudioEncoderTestSuite, suiteDescription_AudioEncoderTestSuite, 92, "testSubprocessFunction" ) {}
+ void runTest() { suite_AudioEncoderTestSuite.testSubprocessFunction(); }
+} testDescription_AudioEncoderTestSuite_testSubprocessFunction;
+
+#include "decompiler/test/cfg_test.h"
+
+static CFGTestSuite suite_CFGTestSuite;
+
+static CxxTest::List Tests_CFGTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_CFGTestSuite( "decompiler/test/cfg_test.h", 33, "CFGTestSuite", suite_CFGTestSuite, Tests_CFGTestSuite );
+
+static class TestDescription_CFGTestSuite_testUnreachable : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testUnreachable() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 35, "testUnreachable" ) {}
+ void runTest() { suite_CFGTestSuite.testUnreachable(); }
+} testDescription_CFGTestSuite_testUnreachable;
+
+static class TestDescription_CFGTestSuite_testBranching : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testBranching() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 69, "testBranching" ) {}
+ void runTest() { suite_CFGTestSuite.testBranching(); }
+} testDescription_CFGTestSuite_testBranching;
+
+static class TestDescription_CFGTestSuite_testGrouping : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testGrouping() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 103, "testGrouping" ) {}
+ void runTest() { suite_CFGTestSuite.testGrouping(); }
+} testDescription_CFGTestSuite_testGrouping;
+
+static class TestDescription_CFGTestSuite_testShortCircuitDetection : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testShortCircuitDetection() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 137, "testShortCircuitDetection" ) {}
+ void runTest() { suite_CFGTestSuite.testShortCircuitDetection(); }
+} testDescription_CFGTestSuite_testShortCircuitDetection;
+
+static class TestDescription_CFGTestSuite_testWhileDetection : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testWhileDetection() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 152, "testWhileDetection" ) {}
+ void runTest() { suite_CFGTestSuite.testWhileDetection(); }
+} testDescription_CFGTestSuite_testWhileDetection;
+
+static class TestDescription_CFGTestSuite_testDoWhileDetection : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testDoWhileDetection() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 172, "testDoWhileDetection" ) {}
+ void runTest() { suite_CFGTestSuite.testDoWhileDetection(); }
+} testDescription_CFGTestSuite_testDoWhileDetection;
+
+static class TestDescription_CFGTestSuite_testBreakDetection : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testBreakDetection() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 192, "testBreakDetection" ) {}
+ void runTest() { suite_CFGTestSuite.testBreakDetection(); }
+} testDescription_CFGTestSuite_testBreakDetection;
+
+static class TestDescription_CFGTestSuite_testContinueDetection : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testContinueDetection() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 248, "testContinueDetection" ) {}
+ void runTest() { suite_CFGTestSuite.testContinueDetection(); }
+} testDescription_CFGTestSuite_testContinueDetection;
+
+static class TestDescription_CFGTestSuite_testIfDetection : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testIfDetection() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 306, "testIfDetection" ) {}
+ void runTest() { suite_CFGTestSuite.testIfDetection(); }
+} testDescription_CFGTestSuite_testIfDetection;
+
+static class TestDescription_CFGTestSuite_testElseDetection : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testElseDetection() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 398, "testElseDetection" ) {}
+ void runTest() { suite_CFGTestSuite.testElseDetection(); }
+} testDescription_CFGTestSuite_testElseDetection;
+
+static class TestDescription_CFGTestSuite_testNestedLoops : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testNestedLoops() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 440, "testNestedLoops" ) {}
+ void runTest() { suite_CFGTestSuite.testNestedLoops(); }
+} testDescription_CFGTestSuite_testNestedLoops;
+
+static class TestDescription_CFGTestSuite_testSamAndMaxScript30 : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testSamAndMaxScript30() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 564, "testSamAndMaxScript30" ) {}
+ void runTest() { suite_CFGTestSuite.testSamAndMaxScript30(); }
+} testDescription_CFGTestSuite_testSamAndMaxScript30;
+
+static class TestDescription_CFGTestSuite_testFunctionDetection : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CFGTestSuite_testFunctionDetection() : CxxTest::RealTestDescription( Tests_CFGTestSuite, suiteDescription_CFGTestSuite, 624, "testFunctionDetection" ) {}
+ void runTest() { suite_CFGTestSuite.testFunctionDetection(); }
+} testDescription_CFGTestSuite_testFunctionDetection;
+
+#include "decompiler/test/codegen.h"
+
+static CodeGenTestSuite suite_CodeGenTestSuite;
+
+static CxxTest::List Tests_CodeGenTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_CodeGenTestSuite( "decompiler/test/codegen.h", 73, "CodeGenTestSuite", suite_CodeGenTestSuite, Tests_CodeGenTestSuite );
+
+static class TestDescription_CodeGenTestSuite_testContinue : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CodeGenTestSuite_testContinue() : CxxTest::RealTestDescription( Tests_CodeGenTestSuite, suiteDescription_CodeGenTestSuite, 75, "testContinue" ) {}
+ void runTest() { suite_CodeGenTestSuite.testContinue(); }
+} testDescription_CodeGenTestSuite_testContinue;
+
+static class TestDescription_CodeGenTestSuite_testBreak : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CodeGenTestSuite_testBreak() : CxxTest::RealTestDescription( Tests_CodeGenTestSuite, suiteDescription_CodeGenTestSuite, 119, "testBreak" ) {}
+ void runTest() { suite_CodeGenTestSuite.testBreak(); }
+} testDescription_CodeGenTestSuite_testBreak;
+
+static class TestDescription_CodeGenTestSuite_testElse : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CodeGenTestSuite_testElse() : CxxTest::RealTestDescription( Tests_CodeGenTestSuite, suiteDescription_CodeGenTestSuite, 163, "testElse" ) {}
+ void runTest() { suite_CodeGenTestSuite.testElse(); }
+} testDescription_CodeGenTestSuite_testElse;
+
+static class TestDescription_CodeGenTestSuite_testCoalescing : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CodeGenTestSuite_testCoalescing() : CxxTest::RealTestDescription( Tests_CodeGenTestSuite, suiteDescription_CodeGenTestSuite, 209, "testCoalescing" ) {}
+ void runTest() { suite_CodeGenTestSuite.testCoalescing(); }
+} testDescription_CodeGenTestSuite_testCoalescing;
+
+static class TestDescription_CodeGenTestSuite_testKyra2Start04CodeGen : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CodeGenTestSuite_testKyra2Start04CodeGen() : CxxTest::RealTestDescription( Tests_CodeGenTestSuite, suiteDescription_CodeGenTestSuite, 273, "testKyra2Start04CodeGen" ) {}
+ void runTest() { suite_CodeGenTestSuite.testKyra2Start04CodeGen(); }
+} testDescription_CodeGenTestSuite_testKyra2Start04CodeGen;
+
+static class TestDescription_CodeGenTestSuite_testParallelCodeGen : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CodeGenTestSuite_testParallelCodeGen() : CxxTest::RealTestDescription( Tests_CodeGenTestSuite, suiteDescription_CodeGenTestSuite, 358, "testParallelCodeGen" ) {}
+ void runTest() { suite_CodeGenTestSuite.testParallelCodeGen(); }
+} testDescription_CodeGenTestSuite_testParallelCodeGen;
+
+#include "decompiler/test/crc32_test.h"
+
+static CRC32TestSuite suite_CRC32TestSuite;
+
+static CxxTest::List Tests_CRC32TestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_CRC32TestSuite( "decompiler/test/crc32_test.h", 30, "CRC32TestSuite", suite_CRC32TestSuite, Tests_CRC32TestSuite );
+
+static class TestDescription_CRC32TestSuite_testCheckValue : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CRC32TestSuite_testCheckValue() : CxxTest::RealTestDescription( Tests_CRC32TestSuite, suiteDescription_CRC32TestSuite, 48, "testCheckValue" ) {}
+ void runTest() { suite_CRC32TestSuite.testCheckValue(); }
+} testDescription_CRC32TestSuite_testCheckValue;
+
+static class TestDescription_CRC32TestSuite_testLengthsAndAlignments : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CRC32TestSuite_testLengthsAndAlignments() : CxxTest::RealTestDescription( Tests_CRC32TestSuite, suiteDescription_CRC32TestSuite, 53, "testLengthsAndAlignments" ) {}
+ void runTest() { suite_CRC32TestSuite.testLengthsAndAlignments(); }
+} testDescription_CRC32TestSuite_testLengthsAndAlignments;
+
+static class TestDescription_CRC32TestSuite_testUpdate : public CxxTest::RealTestDescription {
+public:
+ TestDescription_CRC32TestSuite_testUpdate() : CxxTest::RealTestDescription( Tests_CRC32TestSuite, suiteDescription_CRC32TestSuite, 68, "testUpdate" ) {}
+ void runTest() { suite_CRC32TestSuite.testUpdate(); }
+} testDescription_CRC32TestSuite_testUpdate;
+
+#include "decompiler/test/dcl_test.h"
+
+static DCLTestSuite suite_DCLTestSuite;
+
+static CxxTest::List Tests_DCLTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_DCLTestSuite( "decompiler/test/dcl_test.h", 32, "DCLTestSuite", suite_DCLTestSuite, Tests_DCLTestSuite );
+
+static class TestDescription_DCLTestSuite_testFixedSize : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DCLTestSuite_testFixedSize() : CxxTest::RealTestDescription( Tests_DCLTestSuite, suiteDescription_DCLTestSuite, 106, "testFixedSize" ) {}
+ void runTest() { suite_DCLTestSuite.testFixedSize(); }
+} testDescription_DCLTestSuite_testFixedSize;
+
+static class TestDescription_DCLTestSuite_testDynamicSize : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DCLTestSuite_testDynamicSize() : CxxTest::RealTestDescription( Tests_DCLTestSuite, suiteDescription_DCLTestSuite, 113, "testDynamicSize" ) {}
+ void runTest() { suite_DCLTestSuite.testDynamicSize(); }
+} testDescription_DCLTestSuite_testDynamicSize;
+
+static class TestDescription_DCLTestSuite_testWrongSize : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DCLTestSuite_testWrongSize() : CxxTest::RealTestDescription( Tests_DCLTestSuite, suiteDescription_DCLTestSuite, 127, "testWrongSize" ) {}
+ void runTest() { suite_DCLTestSuite.testWrongSize(); }
+} testDescription_DCLTestSuite_testWrongSize;
+
+static class TestDescription_DCLTestSuite_testCopyPastDictionarySize : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DCLTestSuite_testCopyPastDictionarySize() : CxxTest::RealTestDescription( Tests_DCLTestSuite, suiteDescription_DCLTestSuite, 133, "testCopyPastDictionarySize" ) {}
+ void runTest() { suite_DCLTestSuite.testCopyPastDictionarySize(); }
+} testDescription_DCLTestSuite_testCopyPastDictionarySize;
+
+#include "decompiler/test/disassembler_test.h"
+
+static DisassemblerTestSuite suite_DisassemblerTestSuite;
+
+static CxxTest::List Tests_DisassemblerTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_DisassemblerTestSuite( "decompiler/test/disassembler_test.h", 29, "DisassemblerTestSuite", suite_DisassemblerTestSuite, Tests_DisassemblerTestSuite );
+
+static class TestDescription_DisassemblerTestSuite_testDisassembly : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testDisassembly() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 31, "testDisassembly" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testDisassembly(); }
+} testDescription_DisassemblerTestSuite_testDisassembly;
+
+static class TestDescription_DisassemblerTestSuite_testSubOpcodeDisassembly : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testSubOpcodeDisassembly() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 52, "testSubOpcodeDisassembly" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testSubOpcodeDisassembly(); }
+} testDescription_DisassemblerTestSuite_testSubOpcodeDisassembly;
+
+static class TestDescription_DisassemblerTestSuite_testUnknownOpcodeException : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testUnknownOpcodeException() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 61, "testUnknownOpcodeException" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testUnknownOpcodeException(); }
+} testDescription_DisassemblerTestSuite_testUnknownOpcodeException;
+
+static class TestDescription_DisassemblerTestSuite_testScummv6DisassemblerScript15 : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testScummv6DisassemblerScript15() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 75, "testScummv6DisassemblerScript15" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testScummv6DisassemblerScript15(); }
+} testDescription_DisassemblerTestSuite_testScummv6DisassemblerScript15;
+
+static class TestDescription_DisassemblerTestSuite_testScummv6DisassemblerScript31 : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testScummv6DisassemblerScript31() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 126, "testScummv6DisassemblerScript31" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testScummv6DisassemblerScript31(); }
+} testDescription_DisassemblerTestSuite_testScummv6DisassemblerScript31;
+
+static class TestDescription_DisassemblerTestSuite_testScummv6DisassemblerScript33 : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testScummv6DisassemblerScript33() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 155, "testScummv6DisassemblerScript33" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testScummv6DisassemblerScript33(); }
+} testDescription_DisassemblerTestSuite_testScummv6DisassemblerScript33;
+
+static class TestDescription_DisassemblerTestSuite_testScummv6StackChangeFixRoom9202 : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testScummv6StackChangeFixRoom9202() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 203, "testScummv6StackChangeFixRoom9202" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testScummv6StackChangeFixRoom9202(); }
+} testDescription_DisassemblerTestSuite_testScummv6StackChangeFixRoom9202;
+
+static class TestDescription_DisassemblerTestSuite_testScummv6StackChangeFixScript30 : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testScummv6StackChangeFixScript30() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 215, "testScummv6StackChangeFixScript30" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testScummv6StackChangeFixScript30(); }
+} testDescription_DisassemblerTestSuite_testScummv6StackChangeFixScript30;
+
+static class TestDescription_DisassemblerTestSuite_testKyra2Start04 : public CxxTest::RealTestDescription {
+public:
+ TestDescription_DisassemblerTestSuite_testKyra2Start04() : CxxTest::RealTestDescription( Tests_DisassemblerTestSuite, suiteDescription_DisassemblerTestSuite, 229, "testKyra2Start04" ) {}
+ void runTest() { suite_DisassemblerTestSuite.testKyra2Start04(); }
+} testDescription_DisassemblerTestSuite_testKyra2Start04;
+
+#include "decompiler/test/gzip_stream_test.h"
+
+static GZipStreamTestSuite suite_GZipStreamTestSuite;
+
+static CxxTest::List Tests_GZipStreamTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_GZipStreamTestSuite( "decompiler/test/gzip_stream_test.h", 31, "GZipStreamTestSuite", suite_GZipStreamTestSuite, Tests_GZipStreamTestSuite );
+
+static class TestDescription_GZipStreamTestSuite_testSequentialRead : public CxxTest::RealTestDescription {
+public:
+ TestDescription_GZipStreamTestSuite_testSequentialRead() : CxxTest::RealTestDescription( Tests_GZipStreamTestSuite, suiteDescription_GZipStreamTestSuite, 78, "testSequentialRead" ) {}
+ void runTest() { suite_GZipStreamTestSuite.testSequentialRead(); }
+} testDescription_GZipStreamTestSuite_testSequentialRead;
+
+static class TestDescription_GZipStreamTestSuite_testRandomAccessGZip : public CxxTest::RealTestDescription {
+public:
+ TestDescription_GZipStreamTestSuite_testRandomAccessGZip() : CxxTest::RealTestDescription( Tests_GZipStreamTestSuite, suiteDescription_GZipStreamTestSuite, 92, "testRandomAccessGZip" ) {}
+ void runTest() { suite_GZipStreamTestSuite.testRandomAccessGZip(); }
+} testDescription_GZipStreamTestSuite_testRandomAccessGZip;
+
+static class TestDescription_GZipStreamTestSuite_testRandomAccessZlib : public CxxTest::RealTestDescription {
+public:
+ TestDescription_GZipStreamTestSuite_testRandomAccessZlib() : CxxTest::RealTestDescription( Tests_GZipStreamTestSuite, suiteDescription_GZipStreamTestSuite, 98, "testRandomAccessZlib" ) {}
+ void runTest() { suite_GZipStreamTestSuite.testRandomAccessZlib(); }
+} testDescription_GZipStreamTestSuite_testRandomAccessZlib;
+
+static class TestDescription_GZipStreamTestSuite_testWithoutCheckpoints : public CxxTest::RealTestDescription {
+public:
+ TestDescription_GZipStreamTestSuite_testWithoutCheckpoints() : CxxTest::RealTestDescription( Tests_GZipStreamTestSuite, suiteDescription_GZipStreamTestSuite, 109, "testWithoutCheckpoints" ) {}
+ void runTest() { suite_GZipStreamTestSuite.testWithoutCheckpoints(); }
+} testDescription_GZipStreamTestSuite_testWithoutCheckpoints;
+
+static class TestDescription_GZipStreamTestSuite_testCorruptData : public CxxTest::RealTestDescription {
+public:
+ TestDescription_GZipStreamTestSuite_testCorruptData() : CxxTest::RealTestDescription( Tests_GZipStreamTestSuite, suiteDescription_GZipStreamTestSuite, 116, "testCorruptData" ) {}
+ void runTest() { suite_GZipStreamTestSuite.testCorruptData(); }
+} testDescription_GZipStreamTestSuite_testCorruptData;
+
+static class TestDescription_GZipStreamTestSuite_testInflateInMemory : public CxxTest::RealTestDescription {
+public:
+ TestDescription_GZipStreamTestSuite_testInflateInMemory() : CxxTest::RealTestDescription( Tests_GZipStreamTestSuite, suiteDescription_GZipStreamTestSuite, 125, "testInflateInMemory" ) {}
+ void runTest() { suite_GZipStreamTestSuite.testInflateInMemory(); }
+} testDescription_GZipStreamTestSuite_testInflateInMemory;
+
+#include "decompiler/test/suffix_array_test.h"
+
+static SuffixArrayTestSuite suite_SuffixArrayTestSuite;
+
+static CxxTest::List Tests_SuffixArrayTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_SuffixArrayTestSuite( "decompiler/test/suffix_array_test.h", 32, "SuffixArrayTestSuite", suite_SuffixArrayTestSuite, Tests_SuffixArrayTestSuite );
+
+static class TestDescription_SuffixArrayTestSuite_testEmptyAndShort : public CxxTest::RealTestDescription {
+public:
+ TestDescription_SuffixArrayTestSuite_testEmptyAndShort() : CxxTest::RealTestDescription( Tests_SuffixArrayTestSuite, suiteDescription_SuffixArrayTestSuite, 61, "testEmptyAndShort" ) {}
+ void runTest() { suite_SuffixArrayTestSuite.testEmptyAndShort(); }
+} testDescription_SuffixArrayTestSuite_testEmptyAndShort;
+
+static class TestDescription_SuffixArrayTestSuite_testRepeats : public CxxTest::RealTestDescription {
+public:
+ TestDescription_SuffixArrayTestSuite_testRepeats() : CxxTest::RealTestDescription( Tests_SuffixArrayTestSuite, suiteDescription_SuffixArrayTestSuite, 68, "testRepeats" ) {}
+ void runTest() { suite_SuffixArrayTestSuite.testRepeats(); }
+} testDescription_SuffixArrayTestSuite_testRepeats;
+
+static class TestDescription_SuffixArrayTestSuite_testRandom : public CxxTest::RealTestDescription {
+public:
+ TestDescription_SuffixArrayTestSuite_testRandom() : CxxTest::RealTestDescription( Tests_SuffixArrayTestSuite, suiteDescription_SuffixArrayTestSuite, 77, "testRandom" ) {}
+ void runTest() { suite_SuffixArrayTestSuite.testRandom(); }
+} testDescription_SuffixArrayTestSuite_testRandom;
+
+static class TestDescription_SuffixArrayTestSuite_testExtremeBytes : public CxxTest::RealTestDescription {
+public:
+ TestDescription_SuffixArrayTestSuite_testExtremeBytes() : CxxTest::RealTestDescription( Tests_SuffixArrayTestSuite, suiteDescription_SuffixArrayTestSuite, 94, "testExtremeBytes" ) {}
+ void runTest() { suite_SuffixArrayTestSuite.testExtremeBytes(); }
+} testDescription_SuffixArrayTestSuite_testExtremeBytes;
+
+#include "decompiler/test/tool_arguments_test.h"
+
+static ToolArgumentsTestSuite suite_ToolArgumentsTestSuite;
+
+static CxxTest::List Tests_ToolArgumentsTestSuite = { 0, 0 };
+CxxTest::StaticSuiteDescription suiteDescription_ToolArgumentsTestSuite( "decompiler/test/tool_arguments_test.h", 62, "ToolArgumentsTestSuite", suite_ToolArgumentsTestSuite, Tests_ToolArgumentsTestSuite );
+
+static class TestDescription_ToolArgumentsTestSuite_testInsertBeforeInputs : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ToolArgumentsTestSuite_testInsertBeforeInputs() : CxxTest::RealTestDescription( Tests_ToolArgumentsTestSuite, suiteDescription_ToolArgumentsTestSuite, 80, "testInsertBeforeInputs" ) {}
+ void runTest() { suite_ToolArgumentsTestSuite.testInsertBeforeInputs(); }
+} testDescription_ToolArgumentsTestSuite_testInsertBeforeInputs;
+
+static class TestDescription_ToolArgumentsTestSuite_testOutputAfterAudioOptions : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ToolArgumentsTestSuite_testOutputAfterAudioOptions() : CxxTest::RealTestDescription( Tests_ToolArgumentsTestSuite, suiteDescription_ToolArgumentsTestSuite, 96, "testOutputAfterAudioOptions" ) {}
+ void runTest() { suite_ToolArgumentsTestSuite.testOutputAfterAudioOptions(); }
+} testDescription_ToolArgumentsTestSuite_testOutputAfterAudioOptions;
+
+static class TestDescription_ToolArgumentsTestSuite_testOutputBeforeAudioOptions : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ToolArgumentsTestSuite_testOutputBeforeAudioOptions() : CxxTest::RealTestDescription( Tests_ToolArgumentsTestSuite, suiteDescription_ToolArgumentsTestSuite, 107, "testOutputBeforeAudioOptions" ) {}
+ void runTest() { suite_ToolArgumentsTestSuite.testOutputBeforeAudioOptions(); }
+} testDescription_ToolArgumentsTestSuite_testOutputBeforeAudioOptions;
+
+static class TestDescription_ToolArgumentsTestSuite_testTraceAfterOtherOptions : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ToolArgumentsTestSuite_testTraceAfterOtherOptions() : CxxTest::RealTestDescription( Tests_ToolArgumentsTestSuite, suiteDescription_ToolArgumentsTestSuite, 114, "testTraceAfterOtherOptions" ) {}
+ void runTest() { suite_ToolArgumentsTestSuite.testTraceAfterOtherOptions(); }
+} testDescription_ToolArgumentsTestSuite_testTraceAfterOtherOptions;
+
+static class TestDescription_ToolArgumentsTestSuite_testOutputIsNotAnInput : public CxxTest::RealTestDescription {
+public:
+ TestDescription_ToolArgumentsTestSuite_testOutputIsNotAnInput() : CxxTest::RealTestDescription( Tests_ToolArgumentsTestSuite, suiteDescription_ToolArgumentsTestSuite, 123, "testOutputIsNotAnInput" ) {}
+ void runTest() { suite_ToolArgumentsTestSuite.testOutputIsNotAnInput(); }
+} testDescription_ToolArgumentsTestSuite_testOutputIsNotAnInput;
+
+#include <cxxtest/Root.cpp>
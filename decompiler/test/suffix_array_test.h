@@ -0,0 +1,101 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <cxxtest/TestSuite.h>
+
+#include "bench/test_data.h"
+#include "engines/grim/suffix_array.h"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+class SuffixArrayTestSuite : public CxxTest::TestSuite {
+	TestRandom _random;
+
+	/** Sorts the suffixes by comparing them, the empty suffix first. */
+	static std::vector<int32> naiveSuffixArray(const std::vector<byte> &data) {
+		int32 size = data.size();
+		std::vector<int32> suffixes(size + 1);
+		for (int32 i = 0; i <= size; i++)
+			suffixes[i] = i;
+		std::sort(suffixes.begin(), suffixes.end(), [&](int32 a, int32 b) {
+			int32 length = std::min(size - a, size - b);
+			int cmp = length ? memcmp(&data[a], &data[b], length) : 0;
+			return cmp != 0 ? cmp < 0 : a > b;
+		});
+		return suffixes;
+	}
+
+	void check(const std::vector<byte> &data) {
+		std::vector<int32> expected = naiveSuffixArray(data);
+		std::vector<int32> suffixes(data.size() + 1);
+		buildSuffixArray(&suffixes[0], data.empty() ? NULL : &data[0], data.size());
+		TS_ASSERT(suffixes == expected);
+	}
+
+public:
+	void setUp() {
+		_random.setSeed(1);
+	}
+
+	void testEmptyAndShort() {
+		check(std::vector<byte>());
+		const char *strings[] = { "a", "aa", "ab", "ba", "banana", "mississippi", "abracadabra" };
+		for (size_t i = 0; i < ARRAYSIZE(strings); i++)
+			check(std::vector<byte>(strings[i], strings[i] + strlen(strings[i])));
+	}
+
+	void testRepeats() {
+		// Runs and periodic strings give the deepest recursion
+		check(std::vector<byte>(1000, 'x'));
+		std::vector<byte> data;
+		for (int i = 0; i < 1500; i++)
+			data.push_back("abaab"[i % 5]);
+		check(data);
+	}
+
+	void testRandom() {
+		// Small alphabets make many equal LMS substrings, the full one none
+		const uint32 ranges[] = { 2, 3, 4, 16, 256 };
+		for (size_t r = 0; r < ARRAYSIZE(ranges); r++) {
+			for (int size = 1; size < 300; size += 7) {
+				std::vector<byte> data(size);
+				for (int i = 0; i < size; i++)
+					data[i] = _random.next(ranges[r]);
+				check(data);
+			}
+			std::vector<byte> data(5000);
+			for (size_t i = 0; i < data.size(); i++)
+				data[i] = _random.next(ranges[r]);
+			check(data);
+		}
+	}
+
+	void testExtremeBytes() {
+		// Bytes 0 and 255 sit next to the sentinel and the top of the alphabet
+		std::vector<byte> data;
+		for (int i = 0; i < 700; i++)
+			data.push_back(_random.next(2) ? 0 : 255);
+		check(data);
+	}
+};
@@ -0,0 +1,129 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <cxxtest/TestSuite.h>
+
+#include "batch.h"
+#include "compress.h"
+
+#include <stdio.h>
+
+#include <deque>
+#include <string>
+
+/** A compression tool which only records what it was given. */
+class ArgumentsTestTool : public CompressionTool {
+public:
+	ArgumentsTestTool() : CompressionTool("arguments_test", TOOLTYPE_COMPRESSION), executed(false) {
+		ToolInput input;
+		input.format = "*.sou";
+		_inputPaths.push_back(input);
+		setPrintFunction(printNothing, NULL);
+	}
+
+	int runWith(const std::deque<std::string> &arguments) {
+		std::deque<std::string> args = arguments;
+		args.push_front(getName());
+		return run(args);
+	}
+
+	AudioFormat getFormat() const { return _format; }
+	const std::string &getTracePath() const { return _tracePath; }
+
+	bool executed;
+
+protected:
+	virtual void execute() {
+		executed = true;
+	}
+
+	static void printNothing(void *, const char *) {
+	}
+};
+
+class ToolArgumentsTestSuite : public CxxTest::TestSuite {
+	std::deque<std::string> split(const char *line) {
+		std::deque<std::string> args;
+		std::string arg;
+		for (const char *c = line; ; c++) {
+			if (*c == ' ' || *c == '\0') {
+				if (!arg.empty())
+					args.push_back(arg);
+				arg.clear();
+				if (*c == '\0')
+					return args;
+			} else {
+				arg += *c;
+			}
+		}
+	}
+
+public:
+	void testInsertBeforeInputs() {
+		std::deque<std::string> args = split("--vorbis -q 3 a.sou");
+		insertBeforeInputs(args, 1, "-o", "out/");
+		TS_ASSERT(args == split("--vorbis -q 3 -o out/ a.sou"));
+
+		args = split("a.sou b.sou");
+		insertBeforeInputs(args, 2, "-o", "out/");
+		TS_ASSERT(args == split("-o out/ a.sou b.sou"));
+
+		// Fewer arguments than inputs: the tool reports the missing inputs
+		args.clear();
+		insertBeforeInputs(args, 1, "-o", "out/");
+		TS_ASSERT(args == split("-o out/"));
+	}
+
+	// The arguments of a batch job with an audio option, as the batch runs them
+	void testOutputAfterAudioOptions() {
+		ArgumentsTestTool tool;
+		std::deque<std::string> args = split("--vorbis -q 3 a.sou");
+		insertBeforeInputs(args, tool._inputPaths.size(), "-o", "out/");
+		TS_ASSERT_EQUALS(tool.runWith(args), 0);
+		TS_ASSERT(tool.executed);
+		TS_ASSERT_EQUALS(tool.getFormat(), AUDIO_VORBIS);
+		TS_ASSERT_EQUALS(tool._outputPath.getFullPath(), "out/");
+		TS_ASSERT_EQUALS(tool._inputPaths[0].path, "a.sou");
+	}
+
+	void testOutputBeforeAudioOptions() {
+		ArgumentsTestTool tool;
+		TS_ASSERT_EQUALS(tool.runWith(split("-o out/ --flac a.sou")), 0);
+		TS_ASSERT_EQUALS(tool.getFormat(), AUDIO_FLAC);
+		TS_ASSERT_EQUALS(tool._outputPath.getFullPath(), "out/");
+	}
+
+	void testTraceAfterOtherOptions() {
+		ArgumentsTestTool tool;
+		TS_ASSERT_EQUALS(tool.runWith(split("-o out/ --mp3 --trace-format chrome --trace tool_arguments_trace.json a.sou")), 0);
+		TS_ASSERT_EQUALS(tool.getTracePath(), "tool_arguments_trace.json");
+		remove("tool_arguments_trace.json");
+		TS_ASSERT_EQUALS(tool.getFormat(), AUDIO_MP3);
+		TS_ASSERT_EQUALS(tool._inputPaths[0].path, "a.sou");
+	}
+
+	void testOutputIsNotAnInput() {
+		// The last argument is the input, even if it is named like an option
+		ArgumentsTestTool tool;
+		TS_ASSERT_DIFFERS(tool.runWith(split("--mp3 -o")), 0);
+		TS_ASSERT(!tool.executed);
+	}
+};
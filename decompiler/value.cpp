@@ -26,10 +26,18 @@
 #include <sstream>
 #include <string>
 
-static int dupindex = 0;
+static thread_local int dupindex = 0;
 static std::map<std::string, int> binaryOpPrecedence;
 static std::map<std::string, std::string> negateMap;
 
+void setDupIndex(int index) {
+	dupindex = index;
+}
+
+int getDupIndex() {
+	return dupindex;
+}
+
 void initPrecedence() {
 	binaryOpPrecedence["||"] = kLogicalOrPrecedence;
 	binaryOpPrecedence["&&"] = kLogicalAndPrecedence;
@@ -60,6 +68,10 @@ void initNegateMap() {
 	negateMap[">"] = "<=";
 }
 
+// The lookup tables are filled before main() runs, so code generation on
+// several threads only ever reads them.
+static const bool tablesInitialized = (initPrecedence(), initNegateMap(), true);
+
 bool Value::isInteger() {
 	return false;
 }
@@ -199,18 +211,18 @@ std::ostream &BinaryOpValue::print(std::ostream &output) const {
 }
 
 int BinaryOpValue::precedence() const {
-	if (binaryOpPrecedence.empty())
-		initPrecedence();
-	return binaryOpPrecedence[_op];
+	std::map<std::string, int>::const_iterator it = binaryOpPrecedence.find(_op);
+	if (it == binaryOpPrecedence.end())
+		return kNoPrecedence;
+	return it->second;
 }
 
 ValuePtr BinaryOpValue::negate() throw(WrongTypeException) {
-	if (negateMap.empty())
-		initNegateMap();
-	if (negateMap.find(_op) == negateMap.end())
+	std::map<std::string, std::string>::const_iterator it = negateMap.find(_op);
+	if (it == negateMap.end())
 		return Value::negate();
 	else
-		return new BinaryOpValue(_lhs, _rhs, negateMap[_op]);
+		return new BinaryOpValue(_lhs, _rhs, it->second);
 }
 
 std::ostream &UnaryOpValue::print(std::ostream &output) const {
@@ -35,6 +35,21 @@
 
 class Value;
 
+/**
+ * Sets the index of the most recently created duplicate on the calling thread.
+ * The next duplicate created on that thread gets index + 1.
+ *
+ * @param index The new index.
+ */
+void setDupIndex(int index);
+
+/**
+ * Gets the index of the most recently created duplicate on the calling thread.
+ *
+ * @return The current index.
+ */
+int getDupIndex();
+
 const int kNoPrecedence = 0;          ///< Precedence value for individual values with no operations.
 const int kUnaryOpPrecedence = 1;     ///< Precedence value for a unary operation. (!, -, ~, etc.)
 const int kMultOpPrecedence = 2;      ///< Precedence value for multiplication, division, modulus (*, /, %)
@@ -52,8 +52,15 @@ void ExtractAgos::execute() {
 	uint8 *out = (uint8 *)malloc(decrlen);
 
 	if (out) {
-		if (simon_decr(x, out, _filelen)) {
+		beginPhase("decode");
+		int decrunched = simon_decr(x, out, _filelen);
+		addProcessedBytes(_filelen);
+		endPhase();
+		if (decrunched) {
+			ToolPhase phase(*this, "write");
 			savefile(_outputPath.getFullPath(), out, decrlen);
+			addProcessedBytes(decrlen);
+			addProcessedItems();
 			free(x);
 			free(out);
 		} else {
@@ -45,6 +45,10 @@ ExtractAsylum::ExtractAsylum(const std::string &name) : Tool(name, TOOLTYPE_EXTR
 }
 
 InspectionMatch ExtractAsylum::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch ExtractAsylum::inspectFilename(const Common::Filename &filename) {
 	std::string file = filename.getFullName();
 	if (!strncmp(file.c_str(), "RES.", 4) || !strncmp(file.c_str(), "MUS.", 4))
 		return IMATCH_PERFECT;
@@ -63,8 +67,12 @@ void ExtractAsylum::parseExtraArguments() {
 }
 
 void ExtractAsylum::execute() {
-	initPack(_inputPaths[0].path);
+	{
+		ToolPhase phase(*this, "scan");
+		initPack(_inputPaths[0].path);
+	}
 
+	ToolPhase phase(*this, "write");
 	if (_resInd >= 0) {
 		dumpResource(_resInd);
 	} else {
@@ -140,6 +148,8 @@ void ExtractAsylum::dumpResource(int resInd) {
 	fout.close();
 
 	delete[] entry->data;
+	addProcessedBytes(entry->size);
+	addProcessedItems();
 }
 
 #ifdef STANDALONE_MAIN
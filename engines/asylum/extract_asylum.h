@@ -39,6 +39,7 @@ class ExtractAsylum : public Tool {
 public:
 	ExtractAsylum(const std::string &name = "extract_asylum");
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
 	virtual void parseExtraArguments();
 	virtual void execute();
 
@@ -66,10 +66,13 @@ void ExtractCge::execute() {
 		error("Unable to create files.txt");
 	}
 
-	if (!unpack()) {
-		_volCat.seek(0, SEEK_SET);
-		_volDat.seek(0, SEEK_SET);
-		unpack2();
+	{
+		ToolPhase phase(*this, "write");
+		if (!unpack()) {
+			_volCat.seek(0, SEEK_SET);
+			_volDat.seek(0, SEEK_SET);
+			unpack2();
+		}
 	}
 
 	_volCat.close();
@@ -78,6 +81,10 @@ void ExtractCge::execute() {
 }
 
 InspectionMatch ExtractCge::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch ExtractCge::inspectFilename(const Common::Filename &filename) {
 	// Accept either 'vol.cat' or 'vol.dat'
 	std::string file = filename.getFullName();
 	if (
@@ -154,6 +161,8 @@ bool ExtractCge::unpack() {
 
 			fOut.close();
 			free(buffer);
+			addProcessedBytes(btPage._lea[fileNum]._size);
+			addProcessedItems();
 		}
 	}
 
@@ -200,6 +209,8 @@ void ExtractCge::unpack2() {
 
 			fOut.close();
 			free(buffer);
+			addProcessedBytes(btPage2._lea[fileNum]._size);
+			addProcessedItems();
 		}
 	}
 }
@@ -32,6 +32,8 @@ public:
 	
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 	
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+	
 protected:
 	void readData(Common::File &f, byte *buff, int size);
 	bool unpack();
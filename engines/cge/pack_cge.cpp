@@ -111,6 +111,10 @@ void PackCge::execute() {
 }
 
 InspectionMatch PackCge::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch PackCge::inspectFilename(const Common::Filename &filename) {
 	// Check that this is a directory
 	if (!filename.directory())
 		return IMATCH_AWFUL;
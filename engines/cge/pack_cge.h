@@ -35,6 +35,8 @@ public:
 	
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 	
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+	
 protected:
 	void writeData(Common::File &f, byte *buff, int size);
 	void pack();
@@ -206,14 +206,21 @@ void ExtractCine::unpackFile(Common::File &file) {
 		assert(packedData);
 		file.read_throwsOnError(packedData, packedSize);
 		bool status = true;
+		beginPhase("decode");
 		if (packedSize != unpackedSize) {
 			CineUnpacker cineUnpacker;
 			status = cineUnpacker.unpack(packedData, packedSize, data, unpackedSize);
 		} else {
 			memcpy(data, packedData, packedSize);
 		}
+		addProcessedBytes(packedSize);
+		endPhase();
 		free(packedData);
+		beginPhase("write");
 		fpOut.write(data, unpackedSize);
+		addProcessedBytes(unpackedSize);
+		addProcessedItems();
+		endPhase();
 		free(data);
 
 		if (!status) {
@@ -248,9 +248,12 @@ void ExtractCruisePC::execute() {
 	_outputPath.setFullName(hdr.name);
 	Common::File output(_outputPath, "wb");
 
+	ToolPhase phase(*this, "decode");
 	Disk1Decoder d(&stream, &output, hdr.uncompressedSize);
 	print("Decompressing...");
 	if (d.decode()) {
+		addProcessedBytes(hdr.uncompressedSize);
+		addProcessedItems();
 		print("Ok");
 	} else {
 		print("Error");
@@ -39,9 +39,13 @@ ExtractCryo::ExtractCryo(const std::string &name) : Tool(name, TOOLTYPE_EXTRACTI
 void ExtractCryo::execute() {
 	Common::Filename filename = _inputPaths[0].path;
 
-	if (!openDAT(filename))
-		error("Unable to open %s", filename.getFullName().c_str());
+	{
+		ToolPhase phase(*this, "scan");
+		if (!openDAT(filename))
+			error("Unable to open %s", filename.getFullName().c_str());
+	}
 
+	ToolPhase phase(*this, "write");
 	Common::File fOut;
 	for (DATIterator it = _dir.begin(); it != _dir.end(); ++it) {
 		byte *buffer = (byte *)malloc((*it)->size);
@@ -56,12 +60,18 @@ void ExtractCryo::execute() {
 		fOut.close();
 
 		free(buffer);
+		addProcessedBytes((*it)->size);
+		addProcessedItems();
 	}
 
 	_datFile.close();
 }
 
 InspectionMatch ExtractCryo::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch ExtractCryo::inspectFilename(const Common::Filename &filename) {
 	// TODO: DUNE.DAT
 	std::string file = filename.getFullName();
 	if (
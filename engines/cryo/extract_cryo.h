@@ -42,6 +42,8 @@ public:
 
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+
 protected:
 	bool openDAT(Common::Filename &filename);
 
@@ -22,19 +22,82 @@
 /* GobEngine Script disassembler */
 
 #include <string.h>
+#include <stdarg.h>
 #include <stdio.h>
 
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <new>
+#include <thread>
+#include <vector>
+
 #include "degob_script.h"
+#include "extract_gob_stk.h"
 #include "common/file.h"
+#include "common/parallel.h"
 #include "common/util.h"
 
 static void printHelp(const char *bin);
 static int getVersion(const char *verStr);
 static byte *readFile(const char *filename, uint32 &size);
 static Script *initScript(byte *totData, uint32 totSize, ExtTable *extTable, int version);
-static void printInfo(Script &script);
+static void printInfo(Script &script, std::string &output);
+static int deGobArchives(int argc, char **argv, int version);
+
+/** Whether to report the allocations and the time spent on each script. */
+static bool g_stats = false;
+
+/** Number of allocations made by the current thread, for --stats. */
+static thread_local uint32 g_allocations = 0;
+
+void *operator new(size_t size) {
+	g_allocations++;
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+	free(ptr);
+}
+
+/** Measures the allocations and the time spent disassembling a script. */
+class ScriptStats {
+public:
+	ScriptStats() : _allocations(g_allocations), _start(std::chrono::steady_clock::now()) {
+	}
+
+	/** Formats the statistics since construction. */
+	std::string report(const char *name) const {
+		double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+		char buf[1024];
+		snprintf(buf, 1024, "%s: %u allocations, %.3f ms\n", name, g_allocations - _allocations, elapsed);
+		return buf;
+	}
+
+private:
+	uint32 _allocations;
+	std::chrono::steady_clock::time_point _start;
+};
 
 int main(int argc, char **argv) {
+	// --stats may be given anywhere
+	int args = 1;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--stats"))
+			g_stats = true;
+		else
+			argv[args++] = argv[i];
+	}
+	argc = args;
 
 	if ((argc < 3) || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
 		printHelp(argv[0]);
@@ -47,6 +110,9 @@ int main(int argc, char **argv) {
 		return -1;
 	}
 
+	if (!strcmp(argv[2], "--stk"))
+		return deGobArchives(argc, argv, version);
+
 	byte *totData = 0, *extData = 0, *extComData = 0, *ideData = 0;
 	uint32 totSize = 0, extSize = 0, extComSize = 0, ideSize = 0;
 	int32 offset = -1;
@@ -118,11 +184,17 @@ int main(int argc, char **argv) {
 		script->loadIDE(ideData);
 		delete[] ideData;
 	}
-	printInfo(*script);
-	printf("-----\n");
+	ScriptStats stats;
+
+	std::string info;
+	printInfo(*script, info);
+	printf("%s-----\n", info.c_str());
 
 	script->deGob(offset, libMode);
 
+	if (g_stats)
+		fputs(stats.report(argv[2]).c_str(), stderr);
+
 	delete[] totData;
 	delete[] extData;
 	delete[] extComData;
@@ -132,7 +204,9 @@ int main(int argc, char **argv) {
 }
 
 void printHelp(const char *bin) {
-	printf("Usage: %s <version> <file.tot> [-o <offset>] [--lib] [<file.ext>] [<commun.ext>]\n\n", bin);
+	printf("Usage: %s <version> <file.tot> [-o <offset>] [--lib] [<file.ext>] [<commun.ext>]\n", bin);
+	printf("       %s <version> --stk [--lib] <archive.stk>...\n", bin);
+	printf("Adding --stats reports the allocations and the time spent on each script to stderr.\n\n");
 	printf("The disassembled script will be written to stdout.\n\n");
 	printf("Supported versions:\n");
 	printf("	Gob1      - Gobliiins 1\n");
@@ -154,6 +228,8 @@ void printHelp(const char *bin) {
 	printf("--lib\n\tlibrary mode: all offsets from .IDE named functions file are used as entry points\n\n");
 	printf("<file.ext>\n\texternal script resource file (<script name>.EXT)\n\n");
 	printf("<commun.ext>\n\texternal common script resource file (commun.EXn)\n\n");
+	printf("--stk <archive.stk>...\n\tdisassemble all the .tot files of STK/ITK archives, together with their\n");
+	printf("\t.IDE, .EXT and commun.EXn files from any of the archives\n\n");
 
 }
 
@@ -244,29 +320,166 @@ Script *initScript(byte *totData, uint32 totSize, ExtTable *extTable, int versio
 	return 0;
 }
 
-void printInfo(Script &script) {
-	printf("Version (script behaviour): %d\n", script.getVerScript());
-	printf("Version (IM/EX loading): %d\n", script.getVerIMEX());
-	printf("IM file suffix: %d\n", script.getSuffixIM());
-	printf("EX file suffix: %d\n", script.getSuffixEX());
+static void appendf(std::string &output, const char *s, ...) {
+	char buf[1024];
+	va_list va;
+
+	va_start(va, s);
+	vsnprintf(buf, 1024, s, va);
+	va_end(va);
+
+	output += buf;
+}
 
-	printf("Game texts: ");
+void printInfo(Script &script, std::string &output) {
+	appendf(output, "Version (script behaviour): %d\n", script.getVerScript());
+	appendf(output, "Version (IM/EX loading): %d\n", script.getVerIMEX());
+	appendf(output, "IM file suffix: %d\n", script.getSuffixIM());
+	appendf(output, "EX file suffix: %d\n", script.getSuffixEX());
+
+	appendf(output, "Game texts: ");
 	if (script.getTotTextCount() == 0)
-		printf("Read out of language specific files\n");
+		appendf(output, "Read out of language specific files\n");
 	else if (script.getTotTextCount() == 0xFFFFFFFF)
-		printf("None\n");
+		appendf(output, "None\n");
 	else
-		printf("%d, directly embedded in the TOT\n", script.getTotTextCount());
+		appendf(output, "%d, directly embedded in the TOT\n", script.getTotTextCount());
 
-	printf("Resources: ");
+	appendf(output, "Resources: ");
 	if (script.getTotResOffset() != 0xFFFFFFFF)
-		printf("%d, starting at 0x%08X\n", script.getTotResCount(), script.getTotResOffset());
+		appendf(output, "%d, starting at 0x%08X\n", script.getTotResCount(), script.getTotResOffset());
 	else
-		printf("None\n");
+		appendf(output, "None\n");
+
+	appendf(output, "# of variables: %d (%d bytes)\n", script.getVarsCount(), script.getVarsCount() * 4);
+	appendf(output, "# of named functions: %d\n", script.getFuncNamesCount());
+	appendf(output, "AnimDataSize: %d bytes\n", script.getAnimDataSize());
+	appendf(output, "Text center code starts at: 0x%04X\n", script.getTextCenter());
+	appendf(output, "Script code starts at: 0x%04X\n", script.getStart());
+}
 
-	printf("# of variables: %d (%d bytes)\n", script.getVarsCount(), script.getVarsCount() * 4);
-	printf("# of named functions: %d\n", script.getFuncNamesCount());
-	printf("AnimDataSize: %d bytes\n", script.getAnimDataSize());
-	printf("Text center code starts at: 0x%04X\n", script.getTextCenter());
-	printf("Script code starts at: 0x%04X\n", script.getStart());
+static void ignorePrint(void *, const char *) {
+}
+
+static bool isScriptFile(const char *name) {
+	const char *ext = strrchr(name, '.');
+	if (!ext)
+		return false;
+
+	return !scumm_stricmp(ext, ".TOT") || !scumm_stricmp(ext, ".IDE") || !scumm_stricmp(ext, ".EXT") ||
+		!scumm_strnicmp(name, "commun.ex", 9);
+}
+
+static std::string upperCase(std::string name) {
+	for (size_t i = 0; i < name.size(); i++)
+		name[i] = toupper(name[i]);
+	return name;
+}
+
+static const std::vector<byte> *findFile(const std::map<std::string, std::vector<byte> > &files, const std::string &name) {
+	std::map<std::string, std::vector<byte> >::const_iterator file = files.find(upperCase(name));
+	if ((file == files.end()) || file->second.empty())
+		return 0;
+	return &file->second;
+}
+
+/**
+ * Disassembles all the scripts found in STK/ITK archives, without extracting
+ * them. The archives are unpacked in memory, and the scripts are disassembled
+ * concurrently, each one into its own buffer, which are then written to stdout
+ * in order.
+ */
+int deGobArchives(int argc, char **argv, int version) {
+	int n = 3;
+	bool libMode = false;
+
+	if ((argc > n) && !strcmp(argv[n], "--lib")) {
+		libMode = true;
+		n++;
+	}
+
+	if (argc <= n) {
+		printHelp(argv[0]);
+		return -1;
+	}
+
+	// Files of later archives override the files of the same name in earlier ones
+	std::map<std::string, std::vector<byte> > files;
+	for (; n < argc; n++) {
+		std::vector<ExtractGobStk::ArchiveFile> archiveFiles;
+
+		try {
+			ExtractGobStk stk;
+			stk.setPrintFunction(ignorePrint, 0);
+			stk.readArchive(Common::Filename(argv[n]), archiveFiles, isScriptFile);
+		} catch (const std::exception &err) {
+			error("Couldn't read archive \"%s\": %s", argv[n], err.what());
+		}
+
+		for (size_t i = 0; i < archiveFiles.size(); i++)
+			files[upperCase(archiveFiles[i].name)].swap(archiveFiles[i].data);
+	}
+
+	std::vector<std::string> scripts;
+	for (std::map<std::string, std::vector<byte> >::const_iterator file = files.begin(); file != files.end(); ++file) {
+		size_t extPos = file->first.find_last_of('.');
+		if ((extPos != std::string::npos) && (file->first.compare(extPos, std::string::npos, ".TOT") == 0))
+			scripts.push_back(file->first);
+	}
+
+	std::vector<std::string> outputs(scripts.size());
+	std::vector<std::string> statsReports(scripts.size());
+	unsigned int jobs = std::max(std::thread::hardware_concurrency(), 1U);
+
+	parallelFor(scripts.size(), jobs, [&](size_t i) {
+		const std::string &name = scripts[i];
+		std::string &output = outputs[i];
+		const std::vector<byte> &tot = files.find(name)->second;
+		ScriptStats stats;
+
+		if (tot.size() <= 128) {
+			output = "Script too small, skipped\n";
+			return;
+		}
+
+		std::string baseName = name.substr(0, name.find_last_of('.'));
+		const std::vector<byte> *ide = findFile(files, baseName + ".IDE");
+		const std::vector<byte> *ext = findFile(files, baseName + ".EXT");
+
+		// The scripts are not modified, so they can all share the unpacked files
+		ExtTable *extTable = 0;
+		if (ext && (ext->size() >= 3)) {
+			// The common resources are in the commun.EXn named by the script header
+			const std::vector<byte> *extCom = 0;
+			if (tot[0x3C] != 0)
+				extCom = findFile(files, "COMMUN.EX" + std::string(1, '0' + tot[0x3C]));
+
+			extTable = new ExtTable(const_cast<byte *>(&(*ext)[0]), ext->size(),
+				extCom ? const_cast<byte *>(&(*extCom)[0]) : 0, extCom ? extCom->size() : 0);
+		}
+
+		Script *script = initScript(const_cast<byte *>(&tot[0]), tot.size(), extTable, version);
+
+		if (ide)
+			script->loadIDE(&(*ide)[0]);
+
+		printInfo(*script, output);
+		output += "-----\n";
+
+		script->setOutput(&output);
+		script->deGob(-1, libMode);
+
+		delete script;
+		delete extTable;
+
+		if (g_stats)
+			statsReports[i] = stats.report(name.c_str());
+	});
+
+	for (size_t i = 0; i < scripts.size(); i++) {
+		printf("===== %s =====\n%s\n", scripts[i].c_str(), outputs[i].c_str());
+		fputs(statsReports[i].c_str(), stderr);
+	}
+
+	return 0;
 }
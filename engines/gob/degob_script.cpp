@@ -26,6 +26,8 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <algorithm>
+
 #include "degob_script.h"
 #include "common/endian.h"
 #include "common/util.h"
@@ -182,6 +184,7 @@ Script::Script(byte *totData, uint32 totSize, ExtTable *extTable) :
 	assert(totData && (totSize > 128));
 
 	_indent = 0;
+	_output = 0;
 
 	loadProperties(totData);
 }
@@ -200,8 +203,15 @@ uint8 Script::getSuffixIM() const { return _suffixIM; }
 uint8 Script::getSuffixEX() const { return _suffixEX; }
 uint32 Script::getFuncNamesCount() const { return _funcOffsetsNames.size(); }
 
+void Script::setOutput(std::string *output) {
+	_output = output;
+}
+
 void Script::putString(const char *s) const {
-	printf("%s", s);
+	if (_output)
+		_output->append(s);
+	else
+		fputs(s, stdout);
 }
 void Script::print(const char *s, ...) const {
 	char buf[1024];
@@ -232,6 +242,19 @@ std::string Script::printStr(const char *s, ...) const {
 	return buf;
 }
 
+/** Formats into a string in place, without building a temporary string. */
+static void appendStr(std::string &str, const char *s, ...) {
+	char buf[1024];
+	va_list va;
+
+	va_start(va, s);
+	int length = vsnprintf(buf, 1024, s, va);
+	va_end(va);
+
+	if (length > 0)
+		str.append(buf, MIN(length, 1023));
+}
+
 void Script::incIndent() { _indent++; }
 void Script::decIndent() { _indent--; }
 
@@ -360,6 +383,13 @@ void Script::skipExpr(char stopToken) {
 
 std::string Script::readExpr(char stopToken) {
 	std::string expr;
+	appendExpr(expr, stopToken);
+	return expr;
+}
+
+void Script::appendExpr(std::string &expr, char stopToken) {
+	// Where this expression starts, in case it turns out to be invalid
+	size_t start = expr.size();
 	int16 dimCount;
 	byte operation;
 	int16 num;
@@ -374,22 +404,24 @@ std::string Script::readExpr(char stopToken) {
 		while ((operation == 14) || (operation == 15)) {
 			if (operation == 14) {
 				// Add a direct offset
-				expr += printStr("#%d#", readUint16() * 4);
+				appendStr(expr, "#%d#", readUint16() * 4);
 
 				skip(2);
 				if (peekUint8() == 97)
 					skip(1);
 			} else if (operation == 15) {
 				// Add an offset from an array
-				expr += printStr("#%d->", readUint16() * 4);
+				appendStr(expr, "#%d->", readUint16() * 4);
 
 				skip(2);
 				dimCount = readUint8();
 
 				skip(dimCount);
 
-				for (int i = 0; i < dimCount; i++)
-					expr += readExpr(12) + "->";
+				for (int i = 0; i < dimCount; i++) {
+					appendExpr(expr, 12);
+					expr += "->";
+				}
 
 				expr += "#";
 
@@ -405,40 +437,42 @@ std::string Script::readExpr(char stopToken) {
 
 			switch (operation) {
 			case 17: // uint16 variable load
-				expr += printStr("var16_%d", readUint16() * 2);
+				appendStr(expr, "var16_%d", readUint16() * 2);
 				break;
 
 			case 18: // uint8 variable load:
-				expr += printStr("var8_%d", readUint16());
+				appendStr(expr, "var8_%d", readUint16());
 				break;
 
 			case 19: // int32/uint32 immediate
-				expr += printStr("%d", readUint32());
+				appendStr(expr, "%d", readUint32());
 				break;
 
 			case 20: // int16 immediate
-				expr += printStr("%d", (int16) readUint16());
+				appendStr(expr, "%d", (int16) readUint16());
 				break;
 
 			case 21: // int8 immediate
-				expr += printStr("%d", (int8) readUint8());
+				appendStr(expr, "%d", (int8) readUint8());
 				break;
 
 			case 22: // string immediate
-				expr += printStr("\"%s\"", readString());
+				expr += '"';
+				expr += readString();
+				expr += '"';
 				break;
 
 			case 23: // uint32 variable load
 			case 24: // uint32 variable load as uint16
-				expr += printStr("var32_%d", readUint16() * 4);
+				appendStr(expr, "var32_%d", readUint16() * 4);
 				break;
 
 			case 25: // string variable load
-				expr += printStr("(&var8_%d)", readUint16() * 4);
+				appendStr(expr, "(&var8_%d)", readUint16() * 4);
 				if (peekUint8() == 13) {
 					skip(1);
 					expr += "+{*";
-					expr += readExpr(12); // this also prints the closing }
+					appendExpr(expr, 12); // this also prints the closing }
 				}
 				break;
 
@@ -448,22 +482,23 @@ std::string Script::readExpr(char stopToken) {
 			case 28: // string array access
 
 				if (operation == 16)
-					expr += printStr("var8_%d[", readUint16());
+					appendStr(expr, "var8_%d[", readUint16());
 				else if (operation == 26)
-					expr += printStr("var32_%d[", readUint16() * 4);
+					appendStr(expr, "var32_%d[", readUint16() * 4);
 				else if (operation == 27)
-					expr += printStr("var16_%d[", readUint16() * 2);
+					appendStr(expr, "var16_%d[", readUint16() * 2);
 				else if (operation == 28)
-					expr += printStr("(&var8_%d[", readUint16() * 4);
+					appendStr(expr, "(&var8_%d[", readUint16() * 4);
 
 				dimCount = readUint8();
 				arrDesc = _ptr;
 				skip(dimCount);
-        for (dim = 0; dim < dimCount; dim++) {
-          expr += readExpr(12) + printStr(" of %d", (int16) arrDesc[dim]);
+				for (dim = 0; dim < dimCount; dim++) {
+					appendExpr(expr, 12);
+					appendStr(expr, " of %d", (int16) arrDesc[dim]);
 					if (dim != dimCount - 1)
 						expr += "][";
-        }
+				}
 
 				expr += "]";
 				if (operation == 28)
@@ -471,7 +506,8 @@ std::string Script::readExpr(char stopToken) {
 
 				if ((operation == 28) && (peekUint8() == 13)) {
 					skip(1);
-					expr += "+{*" + readExpr(12);
+					expr += "+{*";
+					appendExpr(expr, 12);
 				}
 				break;
 
@@ -487,7 +523,7 @@ std::string Script::readExpr(char stopToken) {
 					expr += "sqrt(";
 				else
 					expr += "id(";
-				expr += readExpr(10);
+				appendExpr(expr, 10);
 				break;
 			}
 			continue;
@@ -585,7 +621,9 @@ std::string Script::readExpr(char stopToken) {
 			// Unknown token -- don't know how to handle this, so just
 			// skip over everything until we reach the stopToken.
 			while (((char) readUint8()) != stopToken) {}
-			return printStr("Invalid operator in expression: <%d>", (int16) operation);
+			expr.resize(start);
+			appendStr(expr, "Invalid operator in expression: <%d>", (int16) operation);
+			return;
 			break;
 		}
 
@@ -605,14 +643,20 @@ std::string Script::readExpr(char stopToken) {
 
 		if (operation == stopToken) {
 			if ((stopToken != 10) || (num < 0)) {
-				return expr;
+				return;
 			}
 		}
 	}
 }
 
 std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
-	std::string expr, pref;
+	std::string expr;
+	appendVarIndex(expr, arg_0, arg_4);
+	return expr;
+}
+
+void Script::appendVarIndex(std::string &expr, uint16 *arg_0, uint16 *arg_4) {
+	std::string pref;
 	byte *arrDesc;
 	int16 dim;
 	int16 dimCount;
@@ -623,7 +667,7 @@ std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
 
 	while ((operation == 14) || (operation == 15)) {
 		if (operation == 14) {
-			pref += printStr("#%d#", readUint16() * 4);
+			appendStr(pref, "#%d#", readUint16() * 4);
 
 			if (arg_0)
 				*arg_0 = peekUint16();
@@ -632,11 +676,11 @@ std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
 
 			skip(2);
 			if (peekUint8() != 97)
-				return expr;
+				return;
 
 			skip(1);
 		} else if (operation == 15) {
-			pref += printStr("#%d->", readUint16() * 4);
+			appendStr(pref, "#%d->", readUint16() * 4);
 
 			if (arg_0)
 				*arg_0 = peekUint16();
@@ -648,13 +692,15 @@ std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
 
 			skip(var_A);
 
-			for (int i = 0; i < var_A; i++)
-				pref += readExpr(12) + "->";
+			for (int i = 0; i < var_A; i++) {
+				appendExpr(pref, 12);
+				pref += "->";
+			}
 
 			pref += "#";
 
 			if (peekUint8() != 97)
-				return expr;
+				return;
 
 			skip(1);
 		}
@@ -668,11 +714,11 @@ std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
 		*arg_4 = operation;
 
 	if ((operation == 16) || (operation == 18) || (operation == 25) || (operation == 28))
-		expr = "var8_";
+		expr += "var8_";
 	else if ((operation == 17) || (operation == 24) || (operation == 27))
-		expr = "var16_";
+		expr += "var16_";
 	else if ((operation == 23) || (operation == 26))
-		expr = "var32_";
+		expr += "var32_";
 
 	expr += pref;
 
@@ -681,20 +727,20 @@ std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
 	case 24:
 	case 25:
 		temp = readUint16() * 4;
-		expr += printStr("%d", temp);
+		appendStr(expr, "%d", temp);
 		if ((operation == 25) && (peekUint8() == 13)) {
 			skip(1);
 			expr += "+{*";
-			expr += readExpr(12);
+			appendExpr(expr, 12);
 		}
 		break;
 
 	case 17:
-		expr += printStr("%d", readUint16() * 2);
+		appendStr(expr, "%d", readUint16() * 2);
 		break;
 
 	case 18:
-		expr += printStr("%d", readUint16());
+		appendStr(expr, "%d", readUint16());
 		break;
 
 	case 16:
@@ -702,20 +748,20 @@ std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
 	case 27:
 	case 28:
 		if (operation == 16)
-			expr += printStr("%d[", readUint16());
+			appendStr(expr, "%d[", readUint16());
 		else if (operation == 26)
-			expr += printStr("%d[", readUint16() * 4);
+			appendStr(expr, "%d[", readUint16() * 4);
 		else if (operation == 27)
-			expr += printStr("%d[", readUint16() * 2);
+			appendStr(expr, "%d[", readUint16() * 2);
 		else if (operation == 28)
-			expr += printStr("%d[", readUint16() * 4);
+			appendStr(expr, "%d[", readUint16() * 4);
 
 		dimCount = readUint8();
 		arrDesc = _ptr;
 		skip(dimCount);
 		for (dim = 0; dim < dimCount; dim++) {
-			expr += readExpr(12);
-			expr += printStr(" of %d", (int16) arrDesc[dim]);
+			appendExpr(expr, 12);
+			appendStr(expr, " of %d", (int16) arrDesc[dim]);
 			if (dim != dimCount - 1)
 				expr += "][";
 		}
@@ -724,7 +770,7 @@ std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
 		if ((operation == 28) && (peekUint8() == 13)) {
 			skip(1);
 			expr += "+{*";
-			expr += readExpr(12);
+			appendExpr(expr, 12);
 		}
 		break;
 
@@ -732,8 +778,6 @@ std::string Script::readVarIndex(uint16 *arg_0, uint16 *arg_4) {
 		expr += "var_0";
 		break;
 	}
-
-	return expr;
 }
 
 uint16 Script::getBlockSize() const {
@@ -779,11 +823,15 @@ void Script::evaluateParams(const Param *params) {
 			break;
 
 		case PARAM_EXPR:
-			print("%s", readExpr().c_str());
+			_exprBuffer.clear();
+			appendExpr(_exprBuffer);
+			putString(_exprBuffer.c_str());
 			break;
 
 		case PARAM_VARINDEX:
-			print("%s", readVarIndex().c_str());
+			_exprBuffer.clear();
+			appendVarIndex(_exprBuffer);
+			putString(_exprBuffer.c_str());
 			break;
 
 		default:
@@ -845,6 +893,10 @@ void Script::loadProperties(byte *data) {
 	_textCenter = READ_LE_UINT16(data + 0x7E);
 }
 
+static bool compareFuncOffsets(const std::pair<uint32, std::string> &a, const std::pair<uint32, std::string> &b) {
+	return a.first < b.first;
+}
+
 void Script::loadIDE(const byte *ideData) {
 	const byte *ptr = ideData;
 	char buffer[17];
@@ -874,8 +926,28 @@ void Script::loadIDE(const byte *ideData) {
 		if ((functionType != 0x47) && (functionType != 0x67))
 			continue;
 
-		_funcOffsetsNames[offset] = buffer;
+		_funcOffsetsNames.push_back(std::make_pair((uint32) offset, std::string(buffer)));
+	}
+
+	// Sort by offset, keeping only the last name given to an offset
+	std::stable_sort(_funcOffsetsNames.begin(), _funcOffsetsNames.end(), compareFuncOffsets);
+	std::vector<std::pair<uint32, std::string> >::iterator last = _funcOffsetsNames.begin();
+	for (std::vector<std::pair<uint32, std::string> >::iterator it = _funcOffsetsNames.begin(); it != _funcOffsetsNames.end(); ++it) {
+		if (it->first == last->first)
+			last->second.swap(it->second);
+		else
+			*++last = *it;
 	}
+	if (!_funcOffsetsNames.empty())
+		_funcOffsetsNames.erase(last + 1, _funcOffsetsNames.end());
+}
+
+const std::string *Script::findFuncName(uint32 offset) const {
+	std::vector<std::pair<uint32, std::string> >::const_iterator it =
+		std::lower_bound(_funcOffsetsNames.begin(), _funcOffsetsNames.end(), std::make_pair(offset, std::string()), compareFuncOffsets);
+	if ((it == _funcOffsetsNames.end()) || (it->first != offset))
+		return 0;
+	return &it->second;
 }
 
 void Script::funcBlock(int16 retFlag) {
@@ -952,12 +1024,9 @@ void Script::deGob(int32 offset, bool isLib) {
 }
 
 void Script::deGobFunction() {
-	if (!_funcOffsetsNames.empty()) {
-		auto it = _funcOffsetsNames.find(getPos());
-		if (it != _funcOffsetsNames.end()) {
-			print("--- %s ---\n", it->second.c_str());
-		}
-	}
+	const std::string *funcName = findFuncName(getPos());
+	if (funcName)
+		print("--- %s ---\n", funcName->c_str());
 	updateOffsetPos(getPos());
 	printIndent();
 	print("sub_%d {\n", getPos());
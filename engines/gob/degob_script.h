@@ -26,7 +26,8 @@
 
 #include <string>
 #include <list>
-#include <map>
+#include <utility>
+#include <vector>
 
 #include "common/scummsys.h"
 
@@ -91,6 +92,12 @@ public:
 
 	void deGob(int32 offset = -1, bool isLib = false);
 
+	/**
+	 * Appends the disassembly to output instead of writing it to stdout,
+	 * unless output is NULL.
+	 */
+	void setOutput(std::string *output);
+
 protected:
 	enum FuncType {
 		TYPE_NONE = 0,   // No description
@@ -121,6 +128,7 @@ protected:
 	};
 
 	uint32 _indent;
+	std::string *_output;
 
 	virtual void setupOpcodes() = 0;
 	virtual void drawOpcode(byte i, FuncParams &params) = 0;
@@ -151,6 +159,11 @@ protected:
 	std::string readExpr(char stopToken = 99);
 	std::string readVarIndex(uint16 *arg_0 = 0, uint16 *arg_4 = 0);
 
+	/** Reads an expression, appending it to expr instead of building a new string. */
+	void appendExpr(std::string &expr, char stopToken = 99);
+	/** Reads a variable index, appending it to expr instead of building a new string. */
+	void appendVarIndex(std::string &expr, uint16 *arg_0 = 0, uint16 *arg_4 = 0);
+
 	uint16 getBlockSize() const;
 
 	void evaluateParams(const Param *params);
@@ -169,6 +182,9 @@ protected:
 	void addFuncOffset(uint32 offset);
 	void deGobFunction();
 
+	/** Returns the name the .IDE file gives to the function at offset, or NULL. */
+	const std::string *findFuncName(uint32 offset) const;
+
 private:
 	byte *_totData, *_ptr, *_lastOffsetPos;
 	uint32 _totSize;
@@ -177,7 +193,10 @@ protected:
 	ExtTable *_extTable;
 
 	std::list<uint32> _funcOffsets;
-	std::map<uint32, std::string> _funcOffsetsNames;
+	/** Names of the functions from the .IDE file, sorted by offset. */
+	std::vector<std::pair<uint32, std::string> > _funcOffsetsNames;
+	/** Reused to build the expressions of the parameters. */
+	std::string _exprBuffer;
 
 	// Script properties
 	uint16 _start, _textCenter;
@@ -1137,43 +1137,43 @@ void Script_v1::o1_loadMultObject(FuncParams &params) {
 		{
 			switch (i) {
 			case 0:
-				printf("animation=");
+				print("animation=");
 				break;
 			case 1:
-				printf("layer=");
+				print("layer=");
 				break;
 			case 2:
-				printf("frame=");
+				print("frame=");
 				break;
 			case 3:
-				printf("animType=");
+				print("animType=");
 				break;
 			case 4:
-				printf("order=");
+				print("order=");
 				break;
 			case 5:
-				printf("isPaused=");
+				print("isPaused=");
 				break;
 			case 6:
-				printf("isStatic=");
+				print("isStatic=");
 				break;
 			case 7:
-				printf("maxTick=");
+				print("maxTick=");
 				break;
 			case 8:
-				printf("maxFrame=");
+				print("maxFrame=");
 				break;
 			case 9:
-				printf("newLayer=");
+				print("newLayer=");
 				break;
 			case 10:
-				printf("newAnimation=");
+				print("newAnimation=");
 				break;
 			default:
-				printf("unknownField=");
+				print("unknownField=");
 			}
 
-			printf("%s%s", readExpr().c_str(), (i < 10)?", ":"");
+			print("%s%s", readExpr().c_str(), (i < 10)?", ":"");
 		}
 		else
 			skip(1);
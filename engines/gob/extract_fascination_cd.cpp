@@ -76,12 +76,16 @@ void ExtractFascinationCD::execute(void) {
 	}
 
 	// Load ISO file to memory. (Should only be ~10MB, and this simplifies the code)
+	beginPhase("scan");
 	byte *data = new byte[fileSize];
 	file.read_noThrow(data, fileSize);
 	file.close();
+	addProcessedBytes(fileSize);
+	endPhase();
 	
 	print("Loaded '%s' (%d bytes)\n", _inputPaths[0].path.c_str(), fileSize);
 	
+	ToolPhase phase(*this, "write");
 	for (uint32 i = 0; i < ARRAYSIZE(stkFile); i++) {
 		// initialize curPos to start of file
 		byte *curPos = data;	
@@ -108,6 +112,8 @@ void ExtractFascinationCD::execute(void) {
 				output.write(stkFileStart, stkEntrySize);
 				output.close();
 				stkFile[i].extracted = true;
+				addProcessedBytes(stkEntrySize);
+				addProcessedItems();
 
 				curPos += stkEntrySize;
 			}
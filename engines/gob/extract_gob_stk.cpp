@@ -58,6 +58,10 @@ ExtractGobStk::~ExtractGobStk() {
 }
 
 InspectionMatch ExtractGobStk::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch ExtractGobStk::inspectFilename(const Common::Filename &filename) {
 	// Accept either any file with stk, itk or ltk extension
 	std::string ext = filename.getExtension();
 	if (
@@ -98,24 +102,26 @@ void ExtractGobStk::execute() {
 	gobConf.open(_outputPath.getFullPath(), "w");
 	gobConf.print("%s\n", inpath.getFullName().c_str());
 
+	beginPhase("scan");
 	stk.read_throwsOnError(signature, 6);
 
 	if (strncmp(signature, "STK2.1", 6) == 0) {
 		print("Signature of new STK format (STK 2.1) detected in file \"%s\"", inpath.getFullPath().c_str());
 		gobConf.print("%s\n", confSTK21);
-		readChunkListV2(stk, gobConf);
+		readChunkListV2(stk, &gobConf);
 	} else {
 		gobConf.print("%s\n", confSTK10);
 		stk.rewind();
-		readChunkList(stk, gobConf);
+		readChunkList(stk, &gobConf);
 	}
+	endPhase();
 
 	print("config file created: %s", _outputPath.getFullPath().c_str());
 
 	extractChunks(_outputPath, stk);
 }
 
-void ExtractGobStk::readChunkList(Common::File &stk, Common::File &gobConf) {
+void ExtractGobStk::readChunkList(Common::File &stk, Common::File *gobConf) {
 	uint16 numDataChunks = stk.readUint16LE();
 
 	// If we are run multiple times, free previous chunk list
@@ -141,7 +147,8 @@ void ExtractGobStk::readChunkList(Common::File &stk, Common::File &gobConf) {
 		}
 
 		// Write the chunk info in the gob Conf file
-		gobConf.print("%s %d\n", curChunk->name, curChunk->packed ? 1 : 0);
+		if (gobConf)
+			gobConf->print("%s %d\n", curChunk->name, curChunk->packed ? 1 : 0);
 
 		if (numDataChunks > 0) {
 			curChunk->next = new Chunk;
@@ -150,8 +157,11 @@ void ExtractGobStk::readChunkList(Common::File &stk, Common::File &gobConf) {
 	}
 }
 
-void ExtractGobStk::readChunkListV2(Common::File &stk, Common::File &gobConf) {
+void ExtractGobStk::readChunkListV2(Common::File &stk, Common::File *gobConf) {
 	uint32 numDataChunks;
+
+	// If we are run multiple times, free previous chunk list
+	delete _chunks;
 	_chunks = new Chunk;
 	Chunk *curChunk = _chunks;
 
@@ -260,7 +270,8 @@ void ExtractGobStk::readChunkListV2(Common::File &stk, Common::File &gobConf) {
 		curChunk->preGob = false;
 
 		// Write the chunk info in the gob Conf file
-		gobConf.print("%s %d\n", curChunk->name, curChunk->packed ? 1 : 0);
+		if (gobConf)
+			gobConf->print("%s %d\n", curChunk->name, curChunk->packed ? 1 : 0);
 
 		if (numDataChunks > 0) {
 			curChunk->next = new Chunk;
@@ -271,8 +282,8 @@ void ExtractGobStk::readChunkListV2(Common::File &stk, Common::File &gobConf) {
 }
 
 void ExtractGobStk::extractChunks(Common::Filename &outpath, Common::File &stk) {
+	ToolPhase phase(*this, "write");
 	Chunk *curChunk = _chunks;
-	byte *unpackedData = NULL;
 
 	while (curChunk != 0) {
 		print("Extracting \"%s\"", curChunk->name);
@@ -281,39 +292,82 @@ void ExtractGobStk::extractChunks(Common::Filename &outpath, Common::File &stk)
 		Common::File chunkFile(outpath, "wb");
 
 		if (curChunk->size > 0) {
-			stk.seek(curChunk->offset, SEEK_SET);
-
-			byte *data = new byte[curChunk->size];
-
-			stk.read_throwsOnError(data, curChunk->size);
-
+			uint32 realSize;
+			byte *data = readChunk(stk, curChunk, realSize);
 			try {
-				if (curChunk->packed) {
-					uint32 realSize;
-
-					if (curChunk->preGob) {
-						unpackedData = unpackPreGobData(data, realSize, curChunk->size);
-					} else {
-						unpackedData = unpackData(data, realSize);
-					}
-
-					chunkFile.write(unpackedData, realSize);
-
-					delete[] unpackedData;
-				} else {
-					chunkFile.write(data, curChunk->size);
-				}
+				chunkFile.write(data, realSize);
 			} catch(...) {
 				delete[] data;
-				delete[] unpackedData;
 				throw;
 			}
 			delete[] data;
+			addProcessedBytes(curChunk->size);
 		}
+		addProcessedItems();
 		curChunk = curChunk->next;
 	}
 }
 
+byte *ExtractGobStk::readChunk(Common::File &stk, const Chunk *chunk, uint32 &size) {
+	stk.seek(chunk->offset, SEEK_SET);
+
+	byte *data = new byte[chunk->size];
+	size = chunk->size;
+
+	try {
+		stk.read_throwsOnError(data, chunk->size);
+
+		if (chunk->packed) {
+			uint32 compSize = chunk->size;
+			byte *unpackedData;
+
+			beginPhase("decode");
+			if (chunk->preGob) {
+				unpackedData = unpackPreGobData(data, size, compSize);
+			} else {
+				unpackedData = unpackData(data, size);
+			}
+			endPhase();
+
+			delete[] data;
+			data = unpackedData;
+		}
+	} catch(...) {
+		delete[] data;
+		throw;
+	}
+	return data;
+}
+
+void ExtractGobStk::readArchive(const Common::Filename &path, std::vector<ArchiveFile> &files, bool (*accept)(const char *name)) {
+	char signature[7];
+	Common::File stk(path, "rb");
+
+	stk.read_throwsOnError(signature, 6);
+	if (strncmp(signature, "STK2.1", 6) == 0) {
+		readChunkListV2(stk, NULL);
+	} else {
+		stk.rewind();
+		readChunkList(stk, NULL);
+	}
+
+	for (Chunk *curChunk = _chunks; curChunk != 0; curChunk = curChunk->next) {
+		if (accept && !accept(curChunk->name))
+			continue;
+
+		files.push_back(ArchiveFile());
+		ArchiveFile &file = files.back();
+		file.name = curChunk->name;
+		if (curChunk->size == 0)
+			continue;
+
+		uint32 size;
+		byte *data = readChunk(stk, curChunk, size);
+		file.data.assign(data, data + size);
+		delete[] data;
+	}
+}
+
 // Some LZ77-variant
 byte *ExtractGobStk::unpackData(byte *src, uint32 &size) {
 	uint32 counter;
@@ -25,6 +25,9 @@
 #define EXTRACT_GOB_STK_H
 
 #include "tool.h"
+
+#include <vector>
+
 class ExtractGobStk : public Tool {
 public:
 	ExtractGobStk(const std::string &name = "extract_gob_stk");
@@ -33,15 +36,31 @@ public:
 	virtual void execute();
 	
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
+	
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+
+	/** A file of an archive, unpacked in memory. */
+	struct ArchiveFile {
+		std::string name;
+		std::vector<byte> data;
+	};
+
+	/**
+	 * Reads and unpacks all the files of an archive into memory, instead of
+	 * extracting them to disk. Files for which accept returns false are
+	 * skipped without being read.
+	 */
+	void readArchive(const Common::Filename &path, std::vector<ArchiveFile> &files, bool (*accept)(const char *name) = 0);
 
 protected:
 	struct Chunk;
 
 	Chunk *_chunks;
 
-	void readChunkList(Common::File &stk, Common::File &gobConf);
-	void readChunkListV2(Common::File &stk, Common::File &gobConf);
+	void readChunkList(Common::File &stk, Common::File *gobConf);
+	void readChunkListV2(Common::File &stk, Common::File *gobConf);
 	void extractChunks(Common::Filename &outpath, Common::File &stk);
+	byte *readChunk(Common::File &stk, const Chunk *chunk, uint32 &size);
 	byte *unpackData(byte *src, uint32 &size);
 	byte *unpackPreGobData(byte *src, uint32 &size, uint32 &compSize);
 };
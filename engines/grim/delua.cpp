@@ -23,6 +23,8 @@
 #include <engines/grim/lua/lundump.h>
 #include <engines/grim/lua/lopcodes.h>
 #include <engines/grim/lua/lzio.h>
+#include <engines/grim/lab.h>
+#include <common/parallel.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,6 +37,7 @@
 #include <stack>
 #include <list>
 #include <set>
+#include <vector>
 
 // Provide debug.cpp functions which don't call SDL_Quit.
 void warning(const char *fmt, ...) {
@@ -58,8 +61,12 @@ void error(const char *fmt, ...) {
 
 class Expression;
 
+// Decompiled bodies of functions, by prototype and by the indentation and
+// upvalues they were decompiled with, which are all the body depends on.
+typedef std::map<std::pair<TProtoFunc *, std::string>, std::string> FuncCache;
+
 void decompile(std::ostream &os, TProtoFunc *tf, std::string indent_str,
-	       Expression **upvals, int num_upvals);
+	       Expression **upvals, int num_upvals, FuncCache *cache);
 
 std::string localname(TProtoFunc *tf, int n) {
 	LocVar *l = tf->locvars;
@@ -154,14 +161,33 @@ public:
   }
 };
 
+FuncCache::key_type func_key(TProtoFunc *tf, const std::string &indent_str,
+			     Expression **upvals, int num_upvals);
+
 class FuncExpr : public Expression {
 public:
-  FuncExpr(Byte *p, TProtoFunc *tf0, std::string is) :
-    Expression(p), indent_str(is), tf(tf0), upvals(NULL), num_upvals(0) { }
+  FuncExpr(Byte *p, TProtoFunc *tf0, std::string is, FuncCache *c) :
+    Expression(p), indent_str(is), tf(tf0), upvals(NULL), num_upvals(0),
+    cache(c) { }
   std::string indent_str;
   TProtoFunc *tf;
   Expression **upvals;
   int num_upvals;
+  FuncCache *cache;
+
+  // The body may have been decompiled already, either ahead of time or
+  // by an earlier pass over the enclosing function.
+  const std::string &body() const {
+    std::string body_indent = indent_str + std::string(4, ' ');
+    FuncCache::key_type key = func_key(tf, body_indent, upvals, num_upvals);
+    FuncCache::iterator i = cache->find(key);
+    if (i == cache->end()) {
+      std::ostringstream body;
+      decompile(body, tf, body_indent, upvals, num_upvals, cache);
+      i = cache->insert(std::make_pair(key, body.str())).first;
+    }
+    return i->second;
+  }
 
   void print(std::ostream &os) const {
     os << "function(";
@@ -171,8 +197,7 @@ public:
 	os << ", ";
     }
     os << ") -- line " << tf->lineDefined << std::endl;
-    decompile(os, tf, indent_str + std::string(4, ' '),
-	      upvals, num_upvals);
+    os << body();
     os << indent_str << "end";
   }
   ~FuncExpr() {
@@ -182,6 +207,15 @@ public:
   }
 };
 
+FuncCache::key_type func_key(TProtoFunc *tf, const std::string &indent_str,
+			     Expression **upvals, int num_upvals) {
+  std::ostringstream key;
+  key << indent_str;
+  for (int i = 0; i < num_upvals; i++)
+    key << '\0' << *upvals[i];
+  return FuncCache::key_type(tf, key.str());
+}
+
 class IndexExpr : public Expression {
 public:
   IndexExpr(Byte *p, Expression *tbl, Expression *i)
@@ -349,6 +383,7 @@ public:
   Byte *break_pos;
   Expression **upvals; int num_upvals;
   std::multiset<Byte *> *local_var_defs;
+  FuncCache *cache;
 
 private:
   void do_multi_assign(Byte *&start);
@@ -734,7 +769,8 @@ void Decompiler::decompileRange(Byte *start, Byte *end) {
 	stk->push(new NumberExpr(start, nvalue(tf->consts + aux)));
 	break;
       case LUA_T_PROTO:
-	stk->push(new FuncExpr(start, tfvalue(tf->consts + aux), indent_str));
+	stk->push(new FuncExpr(start, tfvalue(tf->consts + aux), indent_str,
+			       cache));
 	break;
       default:
 	*os << indent_str << "error: invalid constant type "
@@ -1271,7 +1307,7 @@ void Decompiler::decompileRange(Byte *start, Byte *end) {
   
 // Decompile the body of a function.
 void decompile(std::ostream &os, TProtoFunc *tf, std::string indent_str,
-	       Expression **upvals, int num_upvals) {
+	       Expression **upvals, int num_upvals, FuncCache *cache) {
   Byte *instr = tf->code + 2;
   ExprStack s;
   std::ostringstream first_time;
@@ -1291,6 +1327,7 @@ void decompile(std::ostream &os, TProtoFunc *tf, std::string indent_str,
   dc.upvals = upvals;
   dc.num_upvals = num_upvals;
   dc.local_var_defs = &loc_vars;
+  dc.cache = cache;
   dc.decompileRange(instr, NULL);
 
   if (s.empty() && loc_vars.empty()) {
@@ -1315,32 +1352,141 @@ void decompile(std::ostream &os, TProtoFunc *tf, std::string indent_str,
   }
 }
 
-int main(int argc, char *argv[]) {
-  int filename_pos = 1;
+// Whether a function reads no upvalues, so that its body does not depend
+// on where it is defined
+bool uses_upvalues(TProtoFunc *tf) {
+  for (Byte *instr = tf->code + 2; *instr != ENDCODE;
+       instr += get_instr_len(*instr))
+    if (*instr >= PUSHUPVALUE && *instr <= PUSHUPVALUE1)
+      return true;
+  return false;
+}
 
-  if (argc != filename_pos + 1) {
-    fprintf(stderr, "Usage: delua file.lua\n");
-    exit(1);
-  }
-  char *filename = argv[filename_pos];
+// A compiled script, whose chunks are all loaded before decompiling
+struct Script {
+  std::string name;
+  std::vector<byte> data;
+  std::vector<TProtoFunc *> chunks;
+  FuncCache cache;
+  std::string output;
+};
+
+// A function defined at the top level of a script, decompiled ahead of
+// the script itself
+struct TopLevelFunc {
+  Script *script;
+  TProtoFunc *tf;
+  FuncCache cache;
+};
+
+bool read_file(const char *filename, std::vector<byte> &data) {
   FILE *f = fopen(filename, "rb");
-  if (f == NULL) {
-    perror(filename);
+  if (f == NULL)
+    return false;
+  fseek(f, 0, SEEK_END);
+  data.resize(ftell(f));
+  fseek(f, 0, SEEK_SET);
+  bool ok = data.empty() || fread(&data[0], 1, data.size(), f) == data.size();
+  fclose(f);
+  return ok;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || (strcmp(argv[1], "--all") == 0 && argc != 3)) {
+    fprintf(stderr, "Usage: delua file.lua...\n");
+    fprintf(stderr, "       delua --all file.lab\n");
     exit(1);
   }
 
+  std::vector<Script> scripts;
+  bool from_lab = strcmp(argv[1], "--all") == 0;
+  if (from_lab) {
+    Lab lab(argv[2]);
+    for (int i = 0; i < lab.getNumEntries(); i++) {
+      std::string name = lab.getFileName(i);
+      if (name.size() < 4 ||
+	  scumm_stricmp(name.c_str() + name.size() - 4, ".lua") != 0)
+	continue;
+      scripts.push_back(Script());
+      scripts.back().name = name;
+      if (!lab.readFile(i, scripts.back().data)) {
+	fprintf(stderr, "%s: could not be read\n", name.c_str());
+	exit(1);
+      }
+    }
+  } else {
+    for (int i = 1; i < argc; i++) {
+      scripts.push_back(Script());
+      scripts.back().name = argv[i];
+      if (!read_file(argv[i], scripts.back().data)) {
+	perror(argv[i]);
+	exit(1);
+      }
+    }
+  }
+
+  // Loading goes through the global Lua state, so load everything first.
+  // Decompiling only reads the loaded prototypes.
   lua_open();
-  ZIO z;
-  luaZ_Fopen(&z, f, filename);
-  TProtoFunc *tf = luaU_undump1(&z);
-  fclose(f);
+  for (size_t i = 0; i < scripts.size(); i++) {
+    Script &script = scripts[i];
+    if (!script.data.empty() && script.data[0] == ID_CHUNK) {
+      ZIO z;
+      luaZ_mopen(&z, (const char *)&script.data[0], script.data.size(),
+		 script.name.c_str());
+      TProtoFunc *tf;
+      while ((tf = luaU_undump1(&z)) != NULL)
+	script.chunks.push_back(tf);
+    }
+    if (script.chunks.empty()) {
+      fprintf(stderr, "%s isn't a valid lua script\n", script.name.c_str());
+      if (!from_lab)
+	exit(1);
+    }
+  }
 
-  if (tf == NULL) {
-    fprintf(stderr, "%s isn't a valid lua script\n", filename);
-    exit(1);
+  // The functions defined at the top level of the scripts are independent
+  // of each other, so decompile them all at once, then the scripts, which
+  // find them already decompiled.
+  std::vector<TopLevelFunc> funcs;
+  for (size_t i = 0; i < scripts.size(); i++) {
+    for (size_t j = 0; j < scripts[i].chunks.size(); j++) {
+      TProtoFunc *chunk = scripts[i].chunks[j];
+      for (int k = 0; k < chunk->nconsts; k++) {
+	if (ttype(chunk->consts + k) != LUA_T_PROTO ||
+	    uses_upvalues(tfvalue(chunk->consts + k)))
+	  continue;
+	funcs.push_back(TopLevelFunc());
+	funcs.back().script = &scripts[i];
+	funcs.back().tf = tfvalue(chunk->consts + k);
+      }
+    }
   }
 
-  decompile(std::cout, tf, "", NULL, 0);
+  unsigned int jobs = std::max(std::thread::hardware_concurrency(), 1U);
+  parallelFor(funcs.size(), jobs, [&](size_t i) {
+    std::ostringstream body;
+    decompile(body, funcs[i].tf, std::string(4, ' '), NULL, 0,
+	      &funcs[i].cache);
+    funcs[i].cache[func_key(funcs[i].tf, std::string(4, ' '), NULL, 0)] =
+      body.str();
+  });
+  for (size_t i = 0; i < funcs.size(); i++)
+    funcs[i].script->cache.insert(funcs[i].cache.begin(),
+				  funcs[i].cache.end());
+
+  parallelFor(scripts.size(), jobs, [&](size_t i) {
+    std::ostringstream os;
+    for (size_t j = 0; j < scripts[i].chunks.size(); j++)
+      decompile(os, scripts[i].chunks[j], "", NULL, 0, &scripts[i].cache);
+    scripts[i].output = os.str();
+  });
+
+  for (size_t i = 0; i < scripts.size(); i++) {
+    if (scripts.size() > 1)
+      std::cout << "-- " << scripts[i].name << std::endl;
+    std::cout << scripts[i].output;
+  }
 
   lua_close();
   return 0;
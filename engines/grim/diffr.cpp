@@ -50,159 +50,42 @@
 #include <fstream>
 #include <algorithm>
 #include <deque>
+#include <thread>
+#include <vector>
+#include <stdio.h>
 #include "common/endian.h"
 #include "common/zlib.h"
 #include "common/md5.h"
+#include "common/parallel.h"
+#include "suffix_array.h"
 
 #define MIN(x,y) (((x)<(y)) ? (x) : (y))
 
-static void split(int32 *I, int32 *V, int32 start, int32 len, int32 h) {
-	int32 i, j, k, x, tmp, jj, kk;
-
-	if (len < 16) {
-		for (k = start; k < start + len; k += j) {
-			j = 1;
-			x = V[I[k] + h];
-			for (i = 1; k + i < start + len; i++) {
-				if (V[I[k + i] + h] < x) {
-					x = V[I[k + i] + h];
-					j = 0;
-				};
-				if (V[I[k + i] + h] == x) {
-					tmp = I[k + j];
-					I[k + j] = I[k + i];
-					I[k + i] = tmp;
-					j++;
-				};
-			};
-			for (i = 0; i < j; i++) {
-				V[I[k + i]] = k + j - 1;
-			}
-			if (j == 1) {
-				I[k] = -1;
-			}
-		};
-		return;
-	};
-
-	x = V[I[start + len / 2] + h];
-	jj = 0;
-	kk = 0;
-	for (i = start; i < start + len; i++) {
-		if (V[I[i] + h] < x) {
-			jj++;
-		}
-		if (V[I[i] + h] == x) {
-			kk++;
-		}
-	};
-	jj += start;
-	kk += jj;
-
-	i = start;
-	j = 0;
-	k = 0;
-	while (i < jj) {
-		if (V[I[i] + h] < x) {
-			i++;
-		} else if (V[I[i] + h] == x) {
-			tmp = I[i];
-			I[i] = I[jj + j];
-			I[jj + j] = tmp;
-			j++;
-		} else {
-			tmp = I[i];
-			I[i] = I[kk + k];
-			I[kk + k] = tmp;
-			k++;
-		};
-	};
-
-	while (jj + j < kk) {
-		if (V[I[jj + j] + h] == x) {
-			j++;
-		} else {
-			tmp = I[jj + j];
-			I[jj + j] = I[kk + k];
-			I[kk + k] = tmp;
-			k++;
-		};
-	};
-
-	if (jj > start) {
-		split(I, V, start, jj - start, h);
-	}
-
-	for (i = 0; i < kk - jj; i++) {
-		V[I[jj + i]] = kk - 1;
-	}
-	if (jj == kk - 1) {
-		I[jj] = -1;
-	}
+/**
+ * Size of the pieces of the new file which are compared to the old file
+ * independently, and in parallel. It does not depend on the number of
+ * threads, so that the patch is the same on every machine.
+ */
+static const int32 kSegmentSize = 8 * 1024 * 1024;
 
-	if (start + len > kk) {
-		split(I, V, kk, start + len - kk, h);
-	}
-}
+/**
+ * Most segments compared at once. Each of them holds its part of the new
+ * file and its diff and extra data, up to 3 times kSegmentSize in all.
+ */
+static const unsigned int kMaxJobs = 8;
 
-static void qsufsort(int32 *I, int32 *V, byte *old, int32 oldsize) {
-	int32 buckets[256];
-	int32 i, h, len;
+/** Removes a temporary file when leaving its scope, also on errors. */
+struct TemporaryFile {
+	std::string name;
 
-	for (i = 0; i < 256; i++) {
-		buckets[i] = 0;
-	}
-	for (i = 0; i < oldsize; i++) {
-		buckets[old[i]]++;
-	}
-	for (i = 1; i < 256; i++) {
-		buckets[i] += buckets[i - 1];
+	explicit TemporaryFile(const std::string &fileName) : name(fileName) {}
+	~TemporaryFile() {
+		if (!name.empty())
+			remove(name.c_str());
 	}
-	for (i = 255; i > 0; i--) {
-		buckets[i] = buckets[i - 1];
-	}
-	buckets[0] = 0;
+};
 
-	for (i = 0; i < oldsize; i++) {
-		I[++buckets[old[i]]] = i;
-	}
-	I[0] = oldsize;
-	for (i = 0; i < oldsize; i++) {
-		V[i] = buckets[old[i]];
-	}
-	V[oldsize] = 0;
-	for (i = 1; i < 256; i++) if (buckets[i] == buckets[i - 1] + 1) {
-			I[buckets[i]] = -1;
-		}
-	I[0] = -1;
-
-	for (h = 1; I[0] != -(oldsize + 1); h += h) {
-		len = 0;
-		for (i = 0; i < oldsize + 1;) {
-			if (I[i] < 0) {
-				len -= I[i];
-				i -= I[i];
-			} else {
-				if (len) {
-					I[i - len] = -len;
-				}
-				len = V[I[i]] + 1 - i;
-				split(I, V, i, len, h);
-				i += len;
-				len = 0;
-			};
-		};
-		if (len) {
-			I[i - len] = -len;
-		}
-	};
-
-	for (i = 0; i < oldsize + 1; i++) {
-		I[V[i]] = i;
-	}
-}
-
-static int32 matchlen(byte *old, int32 oldsize, byte *new_block, int32 new_size) {
+static int32 matchlen(const byte *old, int32 oldsize, const byte *new_block, int32 new_size) {
 	int32 i;
 
 	for (i = 0; (i < oldsize) && (i < new_size); i++)
@@ -213,8 +96,8 @@ static int32 matchlen(byte *old, int32 oldsize, byte *new_block, int32 new_size)
 	return i;
 }
 
-static int32 search(int32 *I, byte *old, int32 oldsize,
-					byte *new_block, int32 newsize, int32 st, int32 en, int32 *pos) {
+static int32 search(const int32 *I, const byte *old, int32 oldsize,
+					const byte *new_block, int32 newsize, int32 st, int32 en, int32 *pos) {
 	int32 x, y;
 
 	if (en - st < 2) {
@@ -238,6 +121,156 @@ static int32 search(int32 *I, byte *old, int32 oldsize,
 	};
 }
 
+/** The patch data for a segment of the new file. */
+struct SegmentPatch {
+	int32 start;        ///< Position of the segment in the new file.
+	int32 startPos;     ///< Position in the old file at the start of the segment.
+	int32 endPos;       ///< Position in the old file expected by the next segment.
+	bool last;          ///< Whether this is the last segment.
+	std::vector<byte> data;
+	std::vector<byte> ctrl;
+	std::vector<byte> diff;
+	std::vector<byte> extra;
+};
+
+static void writeCtrl(std::vector<byte> &ctrl, int32 value) {
+	byte buf[4];
+	WRITE_LE_UINT32(buf, value);
+	ctrl.insert(ctrl.end(), buf, buf + 4);
+}
+
+/**
+ * Compares a segment of the new file to the old file, as bsdiff does for
+ * a whole file. The last seek of a segment moves to the position in the old
+ * file at which the next one starts.
+ */
+static void diffSegment(const int32 *I, const byte *old, int32 oldsize, SegmentPatch &segment, bool mix) {
+	const byte *new_block = segment.data.empty() ? NULL : &segment.data[0];
+	int32 newsize = segment.data.size();
+	int32 scan, pos, len;
+	int32 lastscan, lastpos, lastoffset;
+	int32 oldscore, scsc;
+	int32 s, Sf, lenf, Sb, lenb;
+	int32 overlap, Ss, lens;
+	int32 i;
+	std::vector<byte> &db = segment.diff;
+	std::vector<byte> &eb = mix ? segment.diff : segment.extra;
+
+	scan = 0;
+	pos = 0;
+	len = 0;
+	lastscan = 0;
+	lastpos = segment.startPos;
+	lastoffset = segment.startPos;
+	while (scan < newsize) {
+		oldscore = 0;
+
+		for (scsc = scan += len; scan < newsize; scan++) {
+			len = search(I, old, oldsize, new_block + scan, newsize - scan,
+						 0, oldsize, &pos);
+
+			for (; scsc < scan + len; scsc++)
+				if ((scsc + lastoffset < oldsize) &&
+						(old[scsc + lastoffset] == new_block[scsc])) {
+					oldscore++;
+				}
+
+			if (((len == oldscore) && (len != 0)) ||
+					(len > oldscore + 8)) {
+				break;
+			}
+
+			if ((scan + lastoffset < oldsize) &&
+					(old[scan + lastoffset] == new_block[scan])) {
+				oldscore--;
+			}
+		};
+
+		if ((len != oldscore) || (scan == newsize)) {
+			s = 0;
+			Sf = 0;
+			lenf = 0;
+			for (i = 0; (lastscan + i < scan) && (lastpos + i < oldsize);) {
+				if (old[lastpos + i] == new_block[lastscan + i]) {
+					s++;
+				}
+				i++;
+				if (s * 2 - i > Sf * 2 - lenf) {
+					Sf = s;
+					lenf = i;
+				};
+			};
+
+			lenb = 0;
+			if (scan < newsize) {
+				s = 0;
+				Sb = 0;
+				for (i = 1; (scan >= lastscan + i) && (pos >= i); i++) {
+					if (old[pos - i] == new_block[scan - i]) {
+						s++;
+					}
+					if (s * 2 - i > Sb * 2 - lenb) {
+						Sb = s;
+						lenb = i;
+					};
+				};
+			};
+
+			if (lastscan + lenf > scan - lenb) {
+				overlap = (lastscan + lenf) - (scan - lenb);
+				s = 0;
+				Ss = 0;
+				lens = 0;
+				for (i = 0; i < overlap; i++) {
+					if (new_block[lastscan + lenf - overlap + i] ==
+							old[lastpos + lenf - overlap + i]) {
+						s++;
+					}
+					if (new_block[scan - lenb + i] ==
+							old[pos - lenb + i]) {
+						s--;
+					}
+					if (s > Ss) {
+						Ss = s;
+						lens = i + 1;
+					};
+				};
+
+				lenf += lens - overlap;
+				lenb -= lens;
+			};
+
+			for (i = 0; i < lenf; i++) {
+				db.push_back(new_block[lastscan + i] ^ old[lastpos + i]);
+			}
+			eb.insert(eb.end(), new_block + lastscan + lenf, new_block + scan - lenb);
+
+			writeCtrl(segment.ctrl, lenf);
+			writeCtrl(segment.ctrl, (scan - lenb) - (lastscan + lenf));
+			if (scan == newsize && !segment.last)
+				writeCtrl(segment.ctrl, segment.endPos - (lastpos + lenf));
+			else
+				writeCtrl(segment.ctrl, (pos - lenb) - (lastpos + lenf));
+
+			lastscan = scan - lenb;
+			lastpos = pos - lenb;
+			lastoffset = pos - scan;
+		};
+	};
+}
+
+/** Appends a file to the patch, and returns its size. */
+static int32 appendFile(std::ofstream &patch, const std::string &name) {
+	std::ifstream in(name.c_str(), std::ios::in | std::ios::binary);
+	char buf[65536];
+	int32 size = 0;
+	while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+		patch.write(buf, in.gcount());
+		size += in.gcount();
+	}
+	return size;
+}
+
 typedef struct {
 	const char *oldfile;
 	const char *newfile;
@@ -251,19 +284,11 @@ void show_usage(char *name) {
 }
 
 int main(int argc, char *argv[]) {
-	byte *old, *new_block;
-	int32 oldsize, newsize, newsize2;
-	int32 *I, *V;
-	int32 scan, pos, len;
-	int32 lastscan, lastpos, lastoffset;
-	int32 oldscore, scsc;
-	int32 s, Sf, lenf, Sb, lenb;
-	int32 overlap, Ss, lens;
-	int32 i;
-	int32 dblen, eblen;
+	byte *old;
+	int32 oldsize, newsize;
+	int32 *I;
+	int32 len;
 	uint32 flags = 0;
-	byte *db, *eb;
-	byte buf[4];
 	byte header[48];
 	std::ofstream patch;
 	std::ifstream in;
@@ -330,16 +355,13 @@ int main(int argc, char *argv[]) {
 	in.close();
 
 	I = new int32[oldsize + 1];
-	V = new int32[oldsize + 1];
-	if (I == NULL || V == NULL) {
+	if (I == NULL) {
 		std::cerr << "Unable to allocate memory" << std::endl;
 		return 1;
 	}
-	qsufsort(I, V, old, oldsize);
-
-	delete[] V;
+	buildSuffixArray(I, old, oldsize);
 
-	//Read new file
+	//Open new file, which is read one batch of segments at a time
 	in.open(args.newfile, std::ios::in | std::ios::binary);
 	if (in.fail()) {
 		std::cerr << "Unable to open " << args.newfile << std::endl;
@@ -348,32 +370,6 @@ int main(int argc, char *argv[]) {
 	in.seekg(0, std::ios::end);
 	newsize = in.tellg();
 	in.seekg(0);
-	if ((new_block = new byte[newsize + 1]) == NULL) {
-		std::cerr << "Unable to allocate memory" << std::endl;
-		return 1;
-	}
-	in.read((char *)new_block, newsize);
-	if (in.fail()) {
-		std::cerr << "Unable to read from " << args.newfile << std::endl;
-		return 1;
-	}
-	in.close();
-
-
-	db = new byte[newsize + 1];
-	if (db == NULL) {
-		std::cerr << "Unable to allocate memory" << std::endl;
-		return 1;
-	}
-	if (!args.mix) {
-		eb = new byte[newsize + 1];
-		if (eb == NULL) {
-			std::cerr << "Unable to allocate memory" << std::endl;
-			return 1;
-		}
-	}
-	dblen = 0;
-	eblen = 0;
 
 	/* Create the patch file */
 	patch.open(args.patchfile, std::ios::out | std::ios::binary);
@@ -398,197 +394,97 @@ int main(int argc, char *argv[]) {
 		return 1;
 	}
 
-	/* Compute the differences, writing ctrl as we go */
-	GZipWriteStream *ctrlBlock;
+	/* The ctrl data goes straight to the patch, while the diff and extra
+	   data are compressed to temporary files as they are produced, and
+	   appended to the patch at the end */
+	std::string diffName = std::string(args.patchfile) + ".diff.tmp";
+	std::string extraName = std::string(args.patchfile) + ".extra.tmp";
+	// Declared before the streams, so that these are closed first
+	TemporaryFile diffTemp(diffName);
+	TemporaryFile extraTemp(args.mix ? std::string() : extraName);
+	std::ofstream diffFile(diffName.c_str(), std::ios::out | std::ios::binary);
+	std::ofstream extraFile;
+	if (!args.mix)
+		extraFile.open(extraName.c_str(), std::ios::out | std::ios::binary);
+	if (diffFile.fail() || (!args.mix && extraFile.fail())) {
+		std::cerr << "Unable to open " << diffName << std::endl;
+		return 1;
+	}
+
+	GZipWriteStream *ctrlBlock = NULL;
 	if (args.comp_ctrl) {
 		ctrlBlock = new GZipWriteStream(&patch);
 	}
-
-	scan = 0;
-	len = 0;
-	lastscan = 0;
-	lastpos = 0;
-	lastoffset = 0;
-	while (scan < newsize) {
-		oldscore = 0;
-
-		for (scsc = scan += len; scan < newsize; scan++) {
-			len = search(I, old, oldsize, new_block + scan, newsize - scan,
-						 0, oldsize, &pos);
-
-			for (; scsc < scan + len; scsc++)
-				if ((scsc + lastoffset < oldsize) &&
-						(old[scsc + lastoffset] == new_block[scsc])) {
-					oldscore++;
-				}
-
-			if (((len == oldscore) && (len != 0)) ||
-					(len > oldscore + 8)) {
-				break;
-			}
-
-			if ((scan + lastoffset < oldsize) &&
-					(old[scan + lastoffset] == new_block[scan])) {
-				oldscore--;
-			}
-		};
-
-		if ((len != oldscore) || (scan == newsize)) {
-			s = 0;
-			Sf = 0;
-			lenf = 0;
-			for (i = 0; (lastscan + i < scan) && (lastpos + i < oldsize);) {
-				if (old[lastpos + i] == new_block[lastscan + i]) {
-					s++;
-				}
-				i++;
-				if (s * 2 - i > Sf * 2 - lenf) {
-					Sf = s;
-					lenf = i;
-				};
-			};
-
-			lenb = 0;
-			if (scan < newsize) {
-				s = 0;
-				Sb = 0;
-				for (i = 1; (scan >= lastscan + i) && (pos >= i); i++) {
-					if (old[pos - i] == new_block[scan - i]) {
-						s++;
-					}
-					if (s * 2 - i > Sb * 2 - lenb) {
-						Sb = s;
-						lenb = i;
-					};
-				};
-			};
-
-			if (lastscan + lenf > scan - lenb) {
-				overlap = (lastscan + lenf) - (scan - lenb);
-				s = 0;
-				Ss = 0;
-				lens = 0;
-				for (i = 0; i < overlap; i++) {
-					if (new_block[lastscan + lenf - overlap + i] ==
-							old[lastpos + lenf - overlap + i]) {
-						s++;
-					}
-					if (new_block[scan - lenb + i] ==
-							old[pos - lenb + i]) {
-						s--;
-					}
-					if (s > Ss) {
-						Ss = s;
-						lens = i + 1;
-					};
-				};
-
-				lenf += lens - overlap;
-				lenb -= lens;
-			};
-
-			for (i = 0; i < lenf; i++) {
-				db[dblen + i] = new_block[lastscan + i] ^ old[lastpos + i];
-			}
-			dblen += lenf;
-
-			if (!args.mix) {
-				for (i = 0; i < (scan - lenb) - (lastscan + lenf); i++) {
-					eb[eblen + i] = new_block[lastscan + lenf + i];
-				}
-				eblen += (scan - lenb) - (lastscan + lenf);
-			} else {
-				for (i = 0; i < (scan - lenb) - (lastscan + lenf); i++) {
-					db[dblen + i] = new_block[lastscan + lenf + i];
-				}
-				dblen += (scan - lenb) - (lastscan + lenf);
-			}
-
-			WRITE_LE_UINT32(buf, lenf);
-			if (args.comp_ctrl) {
-				ctrlBlock->write(buf, 4);
-				if (ctrlBlock->err()) {
-					std::cerr << "Write error on " << args.patchfile << std::endl;
-					return 1;
-				}
-			} else {
-				patch.write((char *)buf, 4);
+	GZipWriteStream *diffBlock = new GZipWriteStream(&diffFile);
+	GZipWriteStream *extraBlock = args.mix ? NULL : new GZipWriteStream(&extraFile);
+
+	/* Compute the differences, a batch of segments at a time */
+	int32 segmentCount = newsize > 0 ? (newsize - 1) / kSegmentSize + 1 : 1;
+	unsigned int jobs = std::max(std::thread::hardware_concurrency(), 1U);
+	jobs = std::min(jobs, std::min(kMaxJobs, (unsigned int)segmentCount));
+	std::vector<SegmentPatch> batch;
+	for (int32 first = 0; first < segmentCount; first += jobs) {
+		int32 count = MIN((int32)jobs, segmentCount - first);
+		batch.resize(count);
+		for (int32 j = 0; j < count; j++) {
+			SegmentPatch &segment = batch[j];
+			segment.start = (first + j) * kSegmentSize;
+			segment.startPos = MIN(segment.start, oldsize);
+			segment.endPos = MIN(segment.start + kSegmentSize, oldsize);
+			segment.last = (first + j == segmentCount - 1);
+			segment.data.resize(MIN(kSegmentSize, newsize - segment.start));
+			segment.ctrl.clear();
+			segment.diff.clear();
+			segment.extra.clear();
+			if (!segment.data.empty())
+				in.read((char *)&segment.data[0], segment.data.size());
+			if (in.fail()) {
+				std::cerr << "Unable to read from " << args.newfile << std::endl;
+				return 1;
 			}
+		}
 
+		parallelFor(count, jobs, [&](size_t j) {
+			diffSegment(I, old, oldsize, batch[j], args.mix);
+		});
 
-			WRITE_LE_UINT32(buf, (scan - lenb) - (lastscan + lenf));
+		for (int32 j = 0; j < count; j++) {
+			SegmentPatch &segment = batch[j];
 			if (args.comp_ctrl) {
-				ctrlBlock->write(buf, 4);
-				if (ctrlBlock->err()) {
-					std::cerr << "Write error on " << args.patchfile << std::endl;
-					return 1;
-				}
+				ctrlBlock->write(&segment.ctrl[0], segment.ctrl.size());
 			} else {
-				patch.write((char *)buf, 4);
+				patch.write((char *)&segment.ctrl[0], segment.ctrl.size());
 			}
-
-			WRITE_LE_UINT32(buf, int32((pos - lenb) - (lastpos + lenf)));
-			if (args.comp_ctrl) {
-				ctrlBlock->write(buf, 4);
-				if (ctrlBlock->err()) {
-					std::cerr << "Write error on " << args.patchfile << std::endl;
-					return 1;
-				}
-			} else {
-				patch.write((char *)buf, 4);
+			if (!segment.diff.empty())
+				diffBlock->write(&segment.diff[0], segment.diff.size());
+			if (extraBlock && !segment.extra.empty())
+				extraBlock->write(&segment.extra[0], segment.extra.size());
+			if ((ctrlBlock && ctrlBlock->err()) || diffBlock->err() || (extraBlock && extraBlock->err()) || patch.bad()) {
+				std::cerr << "Write error on " << args.patchfile << std::endl;
+				return 1;
 			}
-
-			lastscan = scan - lenb;
-			lastpos = pos - lenb;
-			lastoffset = pos - scan;
-		};
-	};
-	if (args.comp_ctrl) {
-		delete ctrlBlock;
+		}
 	}
+	in.close();
+	batch.clear();
+	delete ctrlBlock;
+	delete diffBlock;
+	delete extraBlock;
+	diffFile.close();
+	if (!args.mix)
+		extraFile.close();
 
 	/* Compute size of ctrl data (compressed or not)*/
 	if ((len = patch.tellp()) == -1) {
 		std::cerr << "Read error on " << args.patchfile << std::endl;
 		return 1;
 	}
-
 	WRITE_LE_UINT32(header + 36, len - 48);
 
-	/* Write compressed diff data */
-	GZipWriteStream *diffBlock = new GZipWriteStream(&patch);
-	diffBlock->write(db, dblen);
-	if (diffBlock->err()) {
-		std::cerr << "Write error on " << args.patchfile << std::endl;
-		return 1;
-	}
-	delete diffBlock;
-
-	/* Compute size of compressed diff data */
-	if ((newsize = patch.tellp()) == -1) {
-		std::cerr << "Read error on " << args.patchfile << std::endl;
-		return 1;
-	}
-	WRITE_LE_UINT32(header + 40, newsize - len);
-
-	/* Write compressed extra data */
+	/* Append compressed diff and extra data */
+	WRITE_LE_UINT32(header + 40, appendFile(patch, diffName));
 	if (!args.mix) {
-		GZipWriteStream *extraBlock = new GZipWriteStream(&patch);
-		extraBlock->write(eb, eblen);
-		if (extraBlock->err()) {
-			std::cerr << "Write error on " << args.patchfile << std::endl;
-			return 1;
-		}
-		delete extraBlock;
-
-		/* Compute size of compressed extra data */
-		if ((newsize2 = patch.tellp()) == -1) {
-			std::cerr << "Read error on " << args.patchfile << std::endl;
-			return 1;
-		}
-		WRITE_LE_UINT32(header + 44, newsize2 - newsize);
-
-		delete[] eb;
+		WRITE_LE_UINT32(header + 44, appendFile(patch, extraName));
 	} else {
 		WRITE_LE_UINT32(header + 44, 0);
 	}
@@ -603,10 +499,8 @@ int main(int argc, char *argv[]) {
 	patch.close();
 
 	/* Free the memory we used */
-	delete[] db;
 	delete[] I;
 	delete[] old;
-	delete[] new_block;
 
 	return 0;
 }
@@ -25,63 +25,41 @@
 #include <string>
 #include <iostream>
 #include "filetools.h"
-#include "engines/grim/lab.h"
+#include "engines/grim/emi/converter.h"
 
 using namespace std;
 
-int main(int argc, char **argv) {
-	if (argc < 2) {
-		std::cout << "Error: filename not specified" << std::endl;
-		return 0;
-	}
-
-	Lab *lab = NULL;
-	std::string filename;
-
-	if (argc > 2) {
-		lab = new Lab(argv[1]);
-		filename = argv[2];
-	} else {
-		filename = argv[1];
-	}
-
-	std::istream *file = getFile(filename, lab);
-
-	if (!file) {
-		std::cout << "Unable to open file " << filename << std::endl;
-		return 0;
-	}
-	std::string animName = readString(*file);
-	float duration = readFloat(*file);
-	int bones = readInt(*file);
-	std::cout << "animName: " << animName << " duration: " << duration << " bones: " << bones << std::endl;
-	float time = 0.0f;
-	Vector3d *vec3d;
-	Vector4d *vec4d;
+void convert(SpanReader &data, std::ostream &out) {
+	StringView animName = data.readString();
+	float duration = data.readFloat();
+	int bones = data.readSint32();
+	out << "animName: " << animName << " duration: " << duration << " bones: " << bones << std::endl;
 	for (int i = 0; i < bones; i++) {
-		std::string boneName = readString(*file);
-		int operation = readInt(*file);
-		int unknown1 = readInt(*file);
-		int unknown2 = readInt(*file);
-		int numKeyframes = readInt(*file);
-		std::cout << "Bone: " << boneName << " Operation: " << operation << " Unknown1: " << unknown1 <<
-				  " Unknown2: " << unknown2 << " numKeyframes: " << numKeyframes << std::endl;
+		StringView boneName = data.readString();
+		int operation = data.readSint32();
+		int unknown1 = data.readSint32();
+		int unknown2 = data.readSint32();
+		int numKeyframes = data.readSint32();
+		out << "Bone: " << boneName << " Operation: " << operation << " Unknown1: " << unknown1 <<
+			" Unknown2: " << unknown2 << " numKeyframes: " << numKeyframes << std::endl;
 
 		if (operation == 3) { // Translation
 			for (int j = 0; j < numKeyframes; j++) {
-				vec3d = readVector3d(*file);
-				time = readFloat(*file);
-				std::cout << "Time : " << time << " Vector: " << vec3d->toString() << std::endl;
-				delete vec3d;
+				Vector3d vec3d = readVector3d(data);
+				float time = data.readFloat();
+				out << "Time : " << time << " Vector: " << vec3d.toString() << std::endl;
 			}
 		} else if (operation == 4) { // Rotation
 			for (int j = 0; j < numKeyframes; j++) {
-				vec4d = readVector4d(*file);
-				time = readFloat(*file);
-				std::cout << "Time : " << time << " Vector: " << vec4d->toString() << std::endl;
-				delete vec4d;
+				Vector4d vec4d = readVector4d(data);
+				float time = data.readFloat();
+				out << "Time : " << time << " Vector: " << vec4d.toString() << std::endl;
 			}
 		}
 
 	}
 }
+
+int main(int argc, char **argv) {
+	return runConverter(argc, argv, ".animb", ".animb.txt", convert);
+}
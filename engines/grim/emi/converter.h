@@ -0,0 +1,146 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CONVERTER_H
+#define CONVERTER_H
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "common/scummsys.h"
+#include "engines/grim/lab.h"
+#include "engines/grim/emi/span_reader.h"
+
+/** Converts the asset read by data, and writes the result to out. */
+typedef void (*ConvertFunc)(SpanReader &data, std::ostream &out);
+
+/** Reads a whole file into memory, from a LAB if lab is not NULL. */
+inline bool readAsset(const std::string &filename, Lab *lab, std::vector<byte> &data) {
+	if (lab)
+		return lab->readFile(lab->getIndex(filename), data);
+
+	std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+	file.seekg(0, std::ios::end);
+	data.resize((size_t)file.tellg());
+	file.seekg(0, std::ios::beg);
+	if (!data.empty())
+		file.read((char *)&data[0], data.size());
+	return file.good();
+}
+
+/** Converts an asset held in memory, reporting a truncated asset. */
+inline bool convertAsset(const std::string &filename, const std::vector<byte> &data, std::ostream &out, ConvertFunc convert) {
+	SpanReader reader(data.empty() ? NULL : &data[0], data.size());
+	try {
+		convert(reader, out);
+	} catch (const std::out_of_range &e) {
+		std::cerr << "ERROR: " << filename << ": " << e.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Converts every file of a LAB with the given extension. Each file is
+ * converted to a file of the current directory, named after it with the
+ * extension replaced by outputExtension.
+ */
+inline int convertLab(const char *labName, const char *extension, const char *outputExtension, ConvertFunc convert) {
+	Lab lab(labName);
+	const size_t extLength = strlen(extension);
+	int converted = 0, failed = 0;
+	std::vector<byte> data;
+
+	for (int i = 0; i < lab.getNumEntries(); i++) {
+		std::string name = lab.getFileName(i);
+		if (name.size() <= extLength || scumm_stricmp(name.c_str() + name.size() - extLength, extension) != 0)
+			continue;
+
+		std::string outName = name.substr(0, name.size() - extLength) + outputExtension;
+		if (!lab.readFile(i, data)) {
+			std::cerr << "ERROR: Could not read " << name << std::endl;
+			failed++;
+			continue;
+		}
+		std::ofstream out(outName.c_str(), std::ios::out | std::ios::binary);
+		if (!out.is_open()) {
+			std::cerr << "ERROR: Could not create " << outName << std::endl;
+			failed++;
+			continue;
+		}
+		bool success = convertAsset(name, data, out, convert);
+		out.close();
+		if (!success || !out) {
+			// Do not leave the output of a truncated file behind
+			remove(outName.c_str());
+			failed++;
+			continue;
+		}
+		converted++;
+	}
+
+	std::cout << "Converted " << converted << " of " << converted + failed << " files" << std::endl;
+	return failed ? 1 : 0;
+}
+
+/**
+ * Runs a converter with the arguments of its command line, which are one of:
+ *   <filename>               converts a file to the standard output
+ *   <labfilename> <filename> converts a file of a LAB to the standard output
+ *   --all <labfilename>      converts every file of a LAB with the extension
+ */
+inline int runConverter(int argc, char **argv, const char *extension, const char *outputExtension, ConvertFunc convert) {
+	if (argc < 2) {
+		std::cout << "Error: filename not specified" << std::endl;
+		std::cout << "Usage: " << argv[0] << " [labfilename] <filename>" << std::endl;
+		std::cout << "       " << argv[0] << " --all <labfilename>" << std::endl;
+		return 0;
+	}
+
+	if (argc > 2 && strcmp(argv[1], "--all") == 0)
+		return convertLab(argv[2], extension, outputExtension, convert);
+
+	Lab *lab = NULL;
+	std::string filename;
+
+	if (argc > 2) {
+		lab = new Lab(argv[1]);
+		filename = argv[2];
+	} else {
+		filename = argv[1];
+	}
+
+	std::vector<byte> data;
+	bool read = readAsset(filename, lab, data);
+	delete lab;
+	if (!read) {
+		std::cout << "Unable to open file " << filename << std::endl;
+		return 0;
+	}
+	return convertAsset(filename, data, std::cout, convert) ? 0 : 1;
+}
+
+#endif
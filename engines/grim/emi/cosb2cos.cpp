@@ -25,22 +25,24 @@
 #include <iomanip>
 #include <vector>
 #include "filetools.h"
+#include "engines/grim/emi/converter.h"
 
 std::vector<std::string> *g_tag = 0;
 
-std::string getTag(std::string str) {
-	if (str.at(0) != '!') {
+StringView getTag(StringView str) {
+	if (str.length < 5)
+		throw std::out_of_range("Track name too short");
+	if (str.data[0] != '!') {
 		std::cout << "Erroneous Tag\n";
 	}
-	std::string tag = str.substr(1, 4);
-	return tag;
+	return StringView(str.data + 1, 4);
 }
 
-std::string getCompName(std::string str) {
-	return str.substr(5);
+StringView getCompName(StringView str) {
+	return StringView(str.data + 5, str.length - 5);
 }
 
-void pushtag(std::string tag) {
+void pushtag(const std::string &tag) {
 	std::vector<std::string>::iterator it;
 	for (it = g_tag->begin(); it != g_tag->end(); it++) {
 		if (*it == tag) {
@@ -54,167 +56,179 @@ struct TrackKey {
 	float _time;
 	float _value;
 
-	void readFromFile(std::istream &file) {
-		_time = readFloat(file);
-		_value = readFloat(file);
+	void readFromFile(SpanReader &file) {
+		_time = file.readFloat();
+		_value = file.readFloat();
 	}
 };
 
 struct ChoreTrack {
-	std::string _tag;
-	std::string _trackName;
+	StringView _tag;
+	StringView _trackName;
 	int _hash;
 	int _parentID;
 	int _numKeys;
-	TrackKey *_keys;
+	std::vector<TrackKey> _keys;
 
-	void readFromFile(std::istream &file) {
+	void readFromFile(SpanReader &file) {
 		// Split this into tag & name later.
-		_trackName = readString(file);
+		_trackName = file.readString();
 		_tag = getTag(_trackName);
 		_trackName = getCompName(_trackName);
-		_hash = readInt(file);
-		_parentID = readInt(file);
-		_numKeys = readInt(file);
+		_hash = file.readSint32();
+		_parentID = file.readSint32();
+		_numKeys = file.readSint32();
 
-		pushtag(_tag);
+		pushtag(_tag.toString());
 
-		_keys = new TrackKey[_numKeys];
 		for (int k = 0; k < _numKeys; k++) {
-			_keys[k].readFromFile(file);
+			_keys.push_back(TrackKey());
+			_keys.back().readFromFile(file);
 		}
 	}
-	void printComponent(int &count) {
-		std::cout << count << "\t" << _tag << "\t" << _hash << "\t" << _parentID << "\t" << _trackName << std::endl;
+	void printComponent(std::ostream &out, int &count) {
+		out << count << "\t" << _tag << "\t" << _hash << "\t" << _parentID << "\t" << _trackName << std::endl;
 	}
 };
 
 struct Chore {
-	std::string _choreName;
+	StringView _choreName;
 	float _length;
 	int _numTracks;
-	ChoreTrack *_tracks;
+	std::vector<ChoreTrack> _tracks;
 
-	void readFromFile(std::istream &file) {
-		_choreName = readString(file);
-		_length = readFloat(file);
-		_numTracks = readInt(file);
-		_tracks = new ChoreTrack[_numTracks];
+	void readFromFile(SpanReader &file) {
+		_choreName = file.readString();
+		_length = file.readFloat();
+		_numTracks = file.readSint32();
 
 		for (int j = 0; j < _numTracks; j++) {
-			_tracks[j].readFromFile(file);
+			_tracks.push_back(ChoreTrack());
+			_tracks.back().readFromFile(file);
 		}
 	}
 
-	void printComponents(int &count) {
+	void printComponents(std::ostream &out, int &count) {
 		for (int i = 0; i < _numTracks; i++) {
-			_tracks[i].printComponent(count);
+			_tracks[i].printComponent(out, count);
 			count++;
 		}
 	}
 
-	void print(int count) {
-		std::cout << count << "\t" << _length << "\t" << _numTracks << "\t" << _choreName << std::endl;
+	void print(std::ostream &out, int count) {
+		out << count << "\t" << _length << "\t" << _numTracks << "\t" << _choreName << std::endl;
 	}
 };
 
 struct Costume {
 	int _numChores;
-	Chore *_chores;
+	std::vector<Chore> _chores;
 
-	void readFromFile(std::istream &file) {
-		_numChores = readInt(file);
-
-		_chores = new Chore[_numChores];
+	void readFromFile(SpanReader &file) {
+		_numChores = file.readSint32();
 
 		for (int i = 0; i < _numChores; i++) {
-			_chores[i].readFromFile(file);
+			_chores.push_back(Chore());
+			_chores.back().readFromFile(file);
 		}
 
 	}
 
-	void print() {
-		std::cout << "section: tags\n";
-		std::cout << "\tnumtags " << g_tag->size() << std::endl;
+	void print(std::ostream &out) {
+		out << "section: tags\n";
+		out << "\tnumtags " << g_tag->size() << std::endl;
 
 		std::vector<std::string>::iterator it = g_tag->begin();
 		for (int i = 0; it != g_tag->end(); it++) {
-			std::cout << i++ << "\t" << *it << std::endl;
+			out << i++ << "\t" << *it << std::endl;
 		}
-		std::cout << std::endl;
-		std::cout << "section: components\n";
-		std::cout << "\tnumcomponents: x\n";
+		out << std::endl;
+		out << "section: components\n";
+		out << "\tnumcomponents: x\n";
 
 		int count = 0;
 		for (int i = 0; i < _numChores; i++) {
-			_chores[i].printComponents(count);
+			_chores[i].printComponents(out, count);
 		}
-		std::cout << std::endl;
-		std::cout << "section: chores\n";
-		std::cout << "\tnumchores: x\n";
+		out << std::endl;
+		out << "section: chores\n";
+		out << "\tnumchores: x\n";
 		count = 0;
 		for (int i = 0; i < _numChores; i++) {
-			_chores[i].print(count);
+			_chores[i].print(out, count);
 			count++;
 		}
-		std::cout << std::endl;
-		std::cout << "section: keys\n";
-		std::cout << "\tnumkeys: x\n";
+		out << std::endl;
+		out << "section: keys\n";
+		out << "\tnumkeys: x\n";
 		// TODO
 	}
 
-	void printChore(const char *choreName) {
+	void printChore(std::ostream &out, const char *choreName) {
 		for (int i = 0; i < _numChores; i++) {
 			if (_chores[i]._choreName == choreName) {
-				std::cout << "Chore " << choreName << " (" << _chores[i]._numTracks << " tracks) ";
+				out << "Chore " << choreName << " (" << _chores[i]._numTracks << " tracks) ";
 				if (_chores[i]._length == 1000) {
-					std::cout << "(instant)";
+					out << "(instant)";
 				} else {
-					std::cout << 1000.0 * _chores[i]._length << " ms";
+					out << 1000.0 * _chores[i]._length << " ms";
 				}
 
-				std::cout << std::endl;
+				out << std::endl;
 				for (int t = 0; t < _chores[i]._numTracks; t++) {
 					ChoreTrack &track = _chores[i]._tracks[t];
-					std::string &tag = track._tag;
-					std::string &data = track._trackName;
-					std::cout << "Track " << t << ": tag " << tag << ", data [" << data << "]" << std::endl;
+					StringView &tag = track._tag;
+					StringView &data = track._trackName;
+					out << "Track " << t << ": tag " << tag << ", data [" << data << "]" << std::endl;
 
 					for (int k = 0; k < track._numKeys; k++) {
 						TrackKey &tk = track._keys[k];
-						std::cout << "\t";
-						std::cout << std::right << std::setw(5);
-						std::cout << (1000.0 * tk._time) << " ms";
-						std::cout << "\t" << tk._value << std::endl;
+						out << "\t";
+						out << std::right << std::setw(5);
+						out << (1000.0 * tk._time) << " ms";
+						out << "\t" << tk._value << std::endl;
 					}
 				}
 				return;
 			}
 		}
-		std::cout << "Error: chore " << choreName << " not found!" << std::endl;
+		out << "Error: chore " << choreName << " not found!" << std::endl;
 	}
 };
 
+// The chore to print, or NULL to print the components of the costume
+static const char *g_choreName = NULL;
+
+void convert(SpanReader &data, std::ostream &out) {
+	std::vector<std::string> tags;
+	g_tag = &tags;
+	Costume c;
+	c.readFromFile(data);
+	if (!g_choreName) {
+		c.print(out);
+	} else {
+		c.printChore(out, g_choreName);
+	}
+	g_tag = 0;
+}
+
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		std::cout << "Error: filename not specified" << std::endl;
+		std::cout << "Usage: cosb2cos <filename> [chorename]" << std::endl;
+		std::cout << "       cosb2cos --all <labfilename>" << std::endl;
 		return 0;
 	}
-	std::string filename = argv[1];
-
-	std::fstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (argc > 2 && strcmp(argv[1], "--all") == 0)
+		return convertLab(argv[2], ".cos", ".cos.txt", convert);
 
-	if (!file.is_open()) {
+	std::string filename = argv[1];
+	std::vector<byte> data;
+	if (!readAsset(filename, NULL, data)) {
 		std::cout << "Unable to open file " << filename << std::endl;
 		return 0;
 	}
-	g_tag = new std::vector<std::string>;
-	Costume c;
-	c.readFromFile(file);
-	if (argc == 2) {
-		c.print();
-	} else {
-		c.printChore(argv[2]);
-	}
-	delete g_tag;
+	if (argc > 2)
+		g_choreName = argv[2];
+	return convertAsset(filename, data, std::cout, convert) ? 0 : 1;
 }
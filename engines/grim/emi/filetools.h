@@ -26,6 +26,7 @@
 #include <string>
 #include <sstream>
 #include "common/endian.h"
+#include "engines/grim/emi/span_reader.h"
 
 #if defined(SCUMM_BIG_ENDIAN)
 
@@ -163,6 +164,30 @@ Vector4d *readVector4d(std::istream &file) {
 	vec4d->w = readFloat(file);
 	return vec4d;
 }
+inline Vector2d readVector2d(SpanReader &data) {
+	Vector2d vec2d;
+	vec2d.x = data.readFloat();
+	vec2d.y = data.readFloat();
+	return vec2d;
+}
+
+inline Vector3d readVector3d(SpanReader &data) {
+	Vector3d vec3d;
+	vec3d.x = data.readFloat();
+	vec3d.y = data.readFloat();
+	vec3d.z = data.readFloat();
+	return vec3d;
+}
+
+inline Vector4d readVector4d(SpanReader &data) {
+	Vector4d vec4d;
+	vec4d.x = data.readFloat();
+	vec4d.y = data.readFloat();
+	vec4d.z = data.readFloat();
+	vec4d.w = data.readFloat();
+	return vec4d;
+}
+
 //TODO: Endianness
 class SeekableReadStream {
 public:
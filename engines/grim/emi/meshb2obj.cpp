@@ -23,154 +23,110 @@
 #include <string>
 #include <iostream>
 #include "filetools.h"
-#include "engines/grim/lab.h"
+#include "engines/grim/emi/converter.h"
 
-int main(int argc, char **argv) {
-	if (argc < 2) {
-		std::cout << "Error: filename not specified" << std::endl;
-		return 0;
-	}
+void convert(SpanReader &data, std::ostream &out) {
+	// The name of the mesh
+	data.readString();
 
-	Lab *lab = NULL;
-	std::string filename;
-
-	if (argc > 2) {
-		lab = new Lab(argv[1]);
-		filename = argv[2];
-	} else {
-		filename = argv[1];
-	}
-
-	std::istream *file = getFile(filename, lab);
-
-	if (!file) {
-		std::cout << "Unable to open file " << filename << std::endl;
-		return 0;
-	}
-	int strLength = 0;
+	out << "# Spheredata: " << readVector4d(data).toString() << std::endl;
+	out << "# Boxdata: " << readVector3d(data).toString();
+	out << readVector3d(data).toString() << std::endl;
 
-	std::string nameString = readString(*file);
+	int numTexSets = data.readSint32();
+	int setType = data.readSint32();
+	out << "# NumTexSets: " << numTexSets << " setType: " << setType << std::endl;
+	int numTextures = data.readSint32();
 
-	Vector4d *vec4d;
-	Vector3d *vec3d;
-
-	vec4d = readVector4d(*file);
-	std::cout << "# Spheredata: " << vec4d->toString() << std::endl;
-	delete vec4d;
-	vec3d = readVector3d(*file);
-	std::cout << "# Boxdata: " << vec3d->toString();
-	delete vec3d;
-	vec3d = readVector3d(*file);
-	std::cout << vec3d->toString() << std::endl;
-	delete vec3d;
-
-	int numTexSets = readInt(*file);
-	int setType = readInt(*file);
-	std::cout << "# NumTexSets: " << numTexSets << " setType: " << setType << std::endl;
-	int numTextures = readInt(*file);
-
-	std::string *texNames = new std::string[numTextures];
+	std::vector<StringView> texNames;
 	for (int i = 0; i < numTextures; i++) {
-		texNames[i] = readString(*file);
+		texNames.push_back(data.readString());
 		// Every texname seems to be followed by 4 0-bytes (Ref mk1.mesh,
 		// this is intentional)
-		readInt(*file);
+		data.readSint32();
 	}
 	for (int i = 0; i < numTextures; i++) {
-		std::cout << "# TexName " << texNames[i] << std::endl;
+		out << "# TexName " << texNames[i] << std::endl;
 	}
 	// 4 unknown bytes - usually with value 19
-	readInt(*file);
+	data.readSint32();
 
 	// Should create an empty mtl
-	std::cout << "mtllib quit.mtl" << std::endl << "o Arrow" << std::endl;
+	out << "mtllib quit.mtl" << std::endl << "o Arrow" << std::endl;
 
-	int numVertices = readInt(*file);
-	std::cout << "#File has " << numVertices << " Vertices" << std::endl;
+	int numVertices = data.readSint32();
+	out << "#File has " << numVertices << " Vertices" << std::endl;
 
-	float x = 0, y = 0;
-	int r = 0, g = 0, b = 0, a = 0;
 	// Vertices
 	for (int i = 0; i < numVertices; ++i) {
-		vec3d = readVector3d(*file);
-		std::cout << "v " << vec3d->x << " " << vec3d->y << " " << vec3d->z << std::endl;
-		delete vec3d;
+		Vector3d vec3d = readVector3d(data);
+		out << "v " << vec3d.x << " " << vec3d.y << " " << vec3d.z << std::endl;
 	}
 	// Vertex-normals
 	for (int i = 0; i < numVertices; ++i) {
-		vec3d = readVector3d(*file);
-		std::cout << "vn " << vec3d->x << " " << vec3d->y << " " << vec3d->z << std::endl;
-		delete vec3d;
+		Vector3d vec3d = readVector3d(data);
+		out << "vn " << vec3d.x << " " << vec3d.y << " " << vec3d.z << std::endl;
 	}
 	// Color map-data, dunno how to interpret them right now.
 	for (int i = 0; i < numVertices; ++i) {
-		r = readByte(*file);
-		g = readByte(*file);
-		b = readByte(*file);
-		a = readByte(*file);
-		std::cout << "# R: " << r << " G: " << g << " B: " << b << " A: " << a << std::endl;
+		int r = data.readSByte();
+		int g = data.readSByte();
+		int b = data.readSByte();
+		int a = data.readSByte();
+		out << "# R: " << r << " G: " << g << " B: " << b << " A: " << a << std::endl;
 	}
 	// Texture-vertices
 	for (int i = 0; i < numVertices; ++i) {
-		x = readFloat(*file);
-		y = readFloat(*file);
-		std::cout << "vt " << x << " " << y << std::endl;
+		Vector2d vec2d = readVector2d(data);
+		out << "vt " << vec2d.x << " " << vec2d.y << std::endl;
 	}
 
-	std::cout << "usemtl (null)" << std::endl;
+	out << "usemtl (null)" << std::endl;
 
 	// Faces
 	// The head of this section needs quite a bit of rechecking
-	int numFaces = 0;
-	int hasTexture = 0;
 	int texID = 0;
-	int flags = 0;
-	numFaces = readInt(*file);
-	int faceLength = 0;
+	int numFaces = data.readSint32();
 	for (int j = 0; j < numFaces; j++) {
-		flags = readInt(*file);
-		hasTexture = readInt(*file);
+		int flags = data.readSint32();
+		int hasTexture = data.readSint32();
 		if (hasTexture) {
-			texID = readInt(*file);
+			texID = data.readSint32();
 		}
-		faceLength = readInt(*file);
-		std::cout << "#Face-header: flags: " << flags << " hasTexture: " << hasTexture
-				  << " texId: " << texID << " faceLength: " << faceLength << std::endl;
-		short xCoord = 0, yCoord = 0, zCoord = 0;
-		std::cout << "g " << j << std::endl;
+		int faceLength = data.readSint32();
+		out << "#Face-header: flags: " << flags << " hasTexture: " << hasTexture
+			<< " texId: " << texID << " faceLength: " << faceLength << std::endl;
+		out << "g " << j << std::endl;
 		for (int i = 0; i < faceLength; i += 3) {
-			xCoord = readShort(*file) + 1;
-			yCoord = readShort(*file) + 1;
-			zCoord = readShort(*file) + 1;
-			std::cout << "f " << xCoord << "//" << xCoord << " " << yCoord << "//" << yCoord << " " << zCoord << "//" << zCoord <<  std::endl;
+			short xCoord = data.readSint16() + 1;
+			short yCoord = data.readSint16() + 1;
+			short zCoord = data.readSint16() + 1;
+			out << "f " << xCoord << "//" << xCoord << " " << yCoord << "//" << yCoord << " " << zCoord << "//" << zCoord <<  std::endl;
 		}
 	}
-	int hasBones = readInt(*file);
+	int hasBones = data.readSint32();
 
 	if (hasBones == 1) {
-		int numBones = readInt(*file);
-		char **boneNames = new char*[numBones];
+		int numBones = data.readSint32();
 		for (int i = 0; i < numBones; i++) {
-			strLength = readInt(*file);
-			boneNames[i] = new char[strLength];
-			file->read(boneNames[i], strLength);
-			std::cout << "# BoneName " << boneNames[i] << std::endl;
+			out << "# BoneName " << data.readString() << std::endl;
 		}
 
-		int numBoneData = readInt(*file);
-		int unknownVal = 0;
-		int boneDatanum;
-		float boneDataWgt;
+		int numBoneData = data.readSint32();
 		int vertex = 0;
 		for (int i = 0; i < numBoneData; i++) {
-			unknownVal = readInt(*file);
-			boneDatanum = readInt(*file);
-			boneDataWgt = readFloat(*file);
+			int unknownVal = data.readSint32();
+			int boneDatanum = data.readSint32();
+			float boneDataWgt = data.readFloat();
 			if (unknownVal) {
 				vertex++;
 			}
-			std::cout << "# BoneData: Vertex: " << vertex << " boneNum: "
-					  << boneDatanum << " weight: " << boneDataWgt << std::endl;
+			out << "# BoneData: Vertex: " << vertex << " boneNum: "
+				<< boneDatanum << " weight: " << boneDataWgt << std::endl;
 		}
 	}
 }
+
+int main(int argc, char **argv) {
+	return runConverter(argc, argv, ".meshb", ".obj", convert);
+}
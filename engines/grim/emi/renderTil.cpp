@@ -22,7 +22,7 @@
 #include <fstream>
 #include <iostream>
 #include <string>
-#include <zlib.h>
+#include <vector>
 #include <cassert>
 #include <sys/types.h>
 #include <sstream>
@@ -30,6 +30,7 @@
 #include <cstdio>
 #include <cstring>
 #include "common/endian.h"
+#include "common/zlib.h"
 #include "engines/grim/lab.h"
 #include "engines/grim/emi/filetools.h"
 #include <GLFW/glfw3.h>
@@ -356,41 +357,6 @@ void keycallback(GLFWwindow *window, int key, int scancode, int action, int mods
 	}
 }
 
-Bytef *decompress(Bytef *in, int size, uint32_t &outsize) {
-	const uint32_t block = 8 * 1024 * 1024;
-	Bytef *dest = new Bytef[block]; // 8 MiB ought to be enough.
-
-	int success = 0;
-	z_stream_s zStream;
-
-	zStream.next_in = Z_NULL;
-	zStream.avail_in = 0;
-	zStream.zalloc = Z_NULL;
-	zStream.zfree = Z_NULL;
-	zStream.opaque = Z_NULL;
-
-	success = inflateInit2(&zStream, 16 + MAX_WBITS);
-	if (success != Z_OK) {
-		std::cout << "ZLIB failed to initialize\n";
-		return 0;
-	}
-	zStream.avail_in = size;
-	zStream.next_in = in;
-	zStream.avail_out = block;
-	zStream.next_out = dest;
-
-	success = inflate(&zStream, Z_NO_FLUSH);
-
-	outsize = zStream.total_out;
-
-	if (success != Z_STREAM_END) {
-		std::cout << "ERROR: decompressed size bigger than 8 MiB\n";
-		return 0;
-	}
-	return dest;
-}
-
-
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		std::cout << "No Argument" << std::endl;
@@ -416,16 +382,21 @@ int main(int argc, char **argv) {
 		return 0;
 	}
 
-	Bytef *compressedData = new Bytef[length];
-	file->read((char *)compressedData, length);
-	uint32_t outsize;
-	Bytef *data = decompress((Bytef *)compressedData, length, outsize);
-	delete[] compressedData;
-	if (!data) {
+	std::vector<byte> compressedData(length);
+	if (length > 0)
+		file->read((char *)&compressedData[0], length);
+	delete file;
+	std::vector<byte> tile;
+	if (!Common::inflateGZip(compressedData.empty() ? NULL : &compressedData[0], compressedData.size(), tile)) {
+		std::cout << "ERROR: Could not decompress " << filename << std::endl;
 		return -1;
 	}
 
-	MemoryReadStream *stream = new MemoryReadStream(data, outsize);
+	// The stream takes ownership of a copy of exactly the size of the tile
+	byte *data = new byte[tile.size()];
+	if (!tile.empty())
+		memcpy(data, &tile[0], tile.size());
+	MemoryReadStream *stream = new MemoryReadStream(data, tile.size());
 
 	// Initialization and render-loop more or less copied directly from
 	// http://www.glfw.org/documentation.html
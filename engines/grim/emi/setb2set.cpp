@@ -27,7 +27,7 @@
 #include <fstream>
 #include <vector>
 #include <sstream>
-#include "engines/grim/lab.h"
+#include "engines/grim/emi/converter.h"
 
 using namespace std;
 
@@ -48,79 +48,24 @@ enum LightType {
 	AmbientType = 4
 };
 
-class Data {
-public:
-	Data(const char *data);
-	float GetFloat();
-	int GetInt();
-	bool GetBool();
-	string GetString(int length);
-	string GetNullTerminatedString();
-	void Skip(int val);
-private:
-	const char *buf;
-};
-
-Data::Data(const char *data) {
-	buf = data;
-}
-
-float Data::GetFloat() {
-	float retVal = *(const float *) buf;
-	buf += 4;
-	return retVal;
-}
-
-int Data::GetInt() {
-	int retVal = *(const int *) buf;
-	buf += 4;
-	return retVal;
-}
-
-bool Data::GetBool() {
-	bool retVal = *(const bool *) buf;
-	buf += 1;
-	return retVal;
-}
-
-string Data::GetString(int length) {
-	//kind of a hack
-	string s = string(buf);
-	buf += length;
-	return s;
-}
-
-string Data::GetNullTerminatedString() {
-	string s = string(buf);
-	buf += s.length() + 1;
-	return s;
-}
-
-void Data::Skip(int val) {
-	buf += val;
-}
-
 struct Section {
 public:
-	Section(Data *data);
 	virtual ~Section() {};
 	//virtual uint32 load() = 0;
 	virtual string ToString() = 0;
-protected:
-	Data *section_data;
 };
 
-Section::Section(Data *data) {
-	this->section_data = data;
-}
-
 class Sector : public Section {
 public:
-	Sector(Data *data);
+	Sector(SpanReader *data);
+	~Sector() {
+		delete[] vertices;
+		delete[] sortPlanes;
+	}
 
 	virtual string ToString();
 private:
-	string name;
+	StringView name;
 	int ID; // byte;
 	SectorType type;
 	float height;
@@ -132,25 +77,29 @@ private:
 	int *sortPlanes;
 };
 
-Sector::Sector(Data *data) : Section(data) {
-	numVertices = data->GetInt();
+Sector::Sector(SpanReader *data) {
+	numVertices = data->readSint32();
+	if (numVertices < 2 || (uint32)numVertices > data->size() / 12)
+		throw std::out_of_range("Invalid number of sector vertices");
 	vertices = new float[3 * numVertices];
 	for (int i = 0; i < numVertices; i++) {
-		vertices[0 + 3 * i] = data->GetFloat();
-		vertices[1 + 3 * i] = data->GetFloat();
-		vertices[2 + 3 * i] = data->GetFloat();
+		vertices[0 + 3 * i] = data->readFloat();
+		vertices[1 + 3 * i] = data->readFloat();
+		vertices[2 + 3 * i] = data->readFloat();
 	}
-	int nameLength = data->GetInt();
-
-	name = data->GetString(nameLength);
-	ID = data->GetInt();
-	visible = data->GetBool();
-	type = (SectorType)data->GetInt();
-	numSortPlanes = data->GetInt();
+	int nameLength = data->readSint32();
+
+	name = data->readFixedString(nameLength);
+	ID = data->readSint32();
+	visible = data->readBool();
+	type = (SectorType)data->readSint32();
+	numSortPlanes = data->readSint32();
+	if (numSortPlanes < 0 || (uint32)numSortPlanes > data->size() / 4)
+		throw std::out_of_range("Invalid number of sort planes");
 	sortPlanes = new int[numSortPlanes];
 	for (int i = 0; i < numSortPlanes; ++i)
-		sortPlanes[i] = data->GetInt();
-	height = data->GetFloat();
+		sortPlanes[i] = data->readSint32();
+	height = data->readFloat();
 
 	float cross1[3], cross2[3];
 	cross1[0] = vertices[3] - vertices[0];
@@ -234,12 +183,16 @@ string Sector::ToString() {
 
 class Setup : public Section {
 public:
-	Setup(Data *data);
+	Setup(SpanReader *data);
+	~Setup() {
+		delete[] position;
+		delete[] rotationQuat;
+	}
 
 	virtual string ToString();
 private:
-	string name;
-	string tile;
+	StringView name;
+	StringView tile;
 	string background;
 	string zbuffer;
 	float *position;
@@ -249,30 +202,30 @@ private:
 	float fclip;
 };
 
-Setup::Setup(Data *data) : Section(data) {
-	name = data->GetString(128); // Parse a string really
+Setup::Setup(SpanReader *data) {
+	name = data->readFixedString(128); // Parse a string really
 
 	// Skip an unknown number
-	data->GetInt();
+	data->readSint32();
 
-	tile = data->GetNullTerminatedString();
+	tile = data->readCString();
 
 	position = new float[3];
 
-	position[0] = data->GetFloat();
-	position[1] = data->GetFloat();
-	position[2] = data->GetFloat();
+	position[0] = data->readFloat();
+	position[1] = data->readFloat();
+	position[2] = data->readFloat();
 
 	rotationQuat = new float[4];
 
-	rotationQuat[0] = data->GetFloat();
-	rotationQuat[1] = data->GetFloat();
-	rotationQuat[2] = data->GetFloat();
-	rotationQuat[3] = data->GetFloat();
+	rotationQuat[0] = data->readFloat();
+	rotationQuat[1] = data->readFloat();
+	rotationQuat[2] = data->readFloat();
+	rotationQuat[3] = data->readFloat();
 
-	fov  = data->GetFloat();
-	nclip = data->GetFloat();
-	fclip = data->GetFloat();
+	fov  = data->readFloat();
+	nclip = data->readFloat();
+	fclip = data->readFloat();
 }
 
 string Setup::ToString() {
@@ -293,11 +246,16 @@ string Setup::ToString() {
 
 class Light : public Section {
 public:
-	Light(Data *data);
+	Light(SpanReader *data);
+	~Light() {
+		delete[] position;
+		delete[] direction;
+		delete[] color;
+	}
 	virtual string ToString();
 
 private:
-	string name;
+	StringView name;
 	LightType type;
 	float *position;
 	float *direction;
@@ -310,41 +268,41 @@ private:
 
 };
 
-Light::Light(Data *data) : Section(data) {
-	name = data->GetString(32);	// 0x00
+Light::Light(SpanReader *data) {
+	name = data->readFixedString(32);	// 0x00
 
 	position = new float[3];	// 0x20
-	position[0] = data->GetFloat(); // X
-	position[1] = data->GetFloat(); // Y
-	position[2] = data->GetFloat(); // Z
+	position[0] = data->readFloat(); // X
+	position[1] = data->readFloat(); // Y
+	position[2] = data->readFloat(); // Z
 
 	direction = new float[3];	// 0x2C
-	direction[0] = data->GetFloat(); // X
-	direction[1] = data->GetFloat(); // Y
-	direction[2] = data->GetFloat(); // Z
+	direction[0] = data->readFloat(); // X
+	direction[1] = data->readFloat(); // Y
+	direction[2] = data->readFloat(); // Z
 
-	intensity = data->GetFloat();	// 0x38
+	intensity = data->readFloat();	// 0x38
 
 	// Need to check the light type
-	type = (LightType)data->GetInt(); // 0x3C
+	type = (LightType)data->readSint32(); // 0x3C
 
-	data->GetFloat();	// 0x40 // Unknown, definitely float
-	int j = data->GetInt(); 	// 0x44
+	data->readFloat();	// 0x40 // Unknown, definitely float
+	int j = data->readSint32(); 	// 0x44
 	if (j != 0) {
 		cout << "Warning j != 0!" << endl;
 	}
 
 	// Light color
 	color = new int[3];
-	color[0] = data->GetInt(); // R // 0x48
-	color[1] = data->GetInt(); // G // 0x4C
-	color[2] = data->GetInt(); // B // 0x50
+	color[0] = data->readSint32(); // R // 0x48
+	color[1] = data->readSint32(); // G // 0x4C
+	color[2] = data->readSint32(); // B // 0x50
 
 	// Not 100% on these names
-	focusdistance = data->GetFloat();	// 0x54
-	spreaddistance = data->GetFloat();	// 0x58
-	umbraangle = data->GetFloat();		// 0x5C // In radians
-	penumbraangle = data->GetFloat();	// 0x60 // In radians
+	focusdistance = data->readFloat();	// 0x54
+	spreaddistance = data->readFloat();	// 0x58
+	umbraangle = data->readFloat();		// 0x5C // In radians
+	penumbraangle = data->readFloat();	// 0x60 // In radians
 }
 
 string Light::ToString() {
@@ -383,8 +341,8 @@ string Light::ToString() {
 class Set {
 public:
 	virtual string ToString();
-	Set(Data *data);
-	virtual ~Set() {}
+	Set(SpanReader *data);
+	virtual ~Set();
 private:
 	string setName;
 	uint32 numSetups;
@@ -396,25 +354,31 @@ private:
 	vector<Section *> sectors;
 };
 
-Set::Set(Data *data) {
-	numSetups = data->GetInt();
-	setups.reserve(numSetups);
+Set::Set(SpanReader *data) {
+	numSetups = data->readSint32();
 	for (uint32 i = 0; i < numSetups; i++) {
 		setups.push_back(new Setup(data));
 	}
 
-	numLights = data->GetInt();
-	lights.reserve(numLights);
+	numLights = data->readSint32();
 	for (uint32 i = 0; i < numLights; i++) {
 		lights.push_back(new Light(data));
 	}
 
-	numSectors = data->GetInt();
-	sectors.reserve(numSectors);
+	numSectors = data->readSint32();
 	for (uint32 i = 0; i < numSectors; i++) {
 		sectors.push_back(new Sector(data));
 	}
 }
+Set::~Set() {
+	for (vector<Section *>::iterator it = setups.begin(); it != setups.end(); ++it)
+		delete *it;
+	for (vector<Section *>::iterator it = lights.begin(); it != lights.end(); ++it)
+		delete *it;
+	for (vector<Section *>::iterator it = sectors.begin(); it != sectors.end(); ++it)
+		delete *it;
+}
+
 string Set::ToString() {
 	stringstream ss;
 	// colormaps
@@ -440,35 +404,11 @@ string Set::ToString() {
 	return ss.str();
 }
 
-int main(int argc, char **argv) {
-	if (argc < 2) {
-		return 0;
-	}
-	Lab *lab = NULL;
-	std::string filename;
-	int length = 0;
-
-	if (argc > 2) {
-		lab = new Lab(argv[1]);
-		filename = argv[2];
-	} else {
-		filename = argv[1];
-	}
-
-	std::istream *file = getFile(filename, lab, length);
-
-	if (!file) {
-		std::cout << "Could not open file" << std::endl;
-		return 0;
-	}
-
-	char *buf = new char[length];
-	file->read(buf, length);
-	delete file;
+void convert(SpanReader &data, std::ostream &out) {
+	Set ourSet(&data);
+	out << ourSet.ToString();
+}
 
-	Data *data = new Data(buf);
-	Set *ourSet = new Set(data);
-	delete data;
-	delete[] buf;
-	cout << ourSet->ToString();
+int main(int argc, char **argv) {
+	return runConverter(argc, argv, ".setb", ".set", convert);
 }
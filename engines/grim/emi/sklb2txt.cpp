@@ -25,55 +25,28 @@
 #include <string>
 #include <iostream>
 #include "filetools.h"
-#include "engines/grim/lab.h"
+#include "engines/grim/emi/converter.h"
 
 using namespace std;
 
-int main(int argc, char **argv) {
-	if (argc < 2) {
-		std::cout << "Error: filename not specified" << std::endl;
-		return 0;
-	}
-
-	Lab *lab = NULL;
-	std::string filename;
-
-	if (argc > 2) {
-		lab = new Lab(argv[1]);
-		filename = argv[2];
-	} else {
-		filename = argv[1];
-	}
-
-	std::istream *file = getFile(filename, lab);
-
-	if (!file) {
-		std::cout << "Unable to open file " << filename << std::endl;
-		return 0;
-	}
-	int numBones = readInt(*file);
-
-	char boneString[32];
-	char parentString[32];
+void convert(SpanReader &data, std::ostream &out) {
+	int numBones = data.readSint32();
 
-	float angle = 0;
 	// Bones are listed in the same order as in the meshb.
-	Vector3d *vec = 0;
 	for (int i = 0; i < numBones; i++) {
-		file->read((char *)&boneString, 32);
-		file->read((char *)&parentString, 32);
-
-		std::cout << "# BoneName " << boneString << "\twith parent: " << parentString << "\t";
-		std::cout << " position: ";
-		vec = readVector3d(*file);
-		std::cout << vec->toString();
-		delete vec;
-		std::cout << " rotation: ";
-		vec = readVector3d(*file);
-		std::cout << vec->toString();
-		delete vec;
-		angle = readFloat(*file);
-		std::cout << angle << std::endl;
-
+		StringView boneString = data.readFixedString(32);
+		StringView parentString = data.readFixedString(32);
+
+		out << "# BoneName " << boneString << "\twith parent: " << parentString << "\t";
+		out << " position: ";
+		out << readVector3d(data).toString();
+		out << " rotation: ";
+		out << readVector3d(data).toString();
+		float angle = data.readFloat();
+		out << angle << std::endl;
 	}
 }
+
+int main(int argc, char **argv) {
+	return runConverter(argc, argv, ".sklb", ".sklb.txt", convert);
+}
@@ -0,0 +1,130 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SPAN_READER_H
+#define SPAN_READER_H
+
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include "common/endian.h"
+
+/**
+ * A string of an asset, which points into the data of the asset rather than
+ * being copied out of it.
+ */
+struct StringView {
+	const char *data;
+	uint32 length;
+
+	StringView() : data(""), length(0) {}
+	StringView(const char *d, uint32 l) : data(d), length(l) {}
+
+	std::string toString() const {
+		return std::string(data, length);
+	}
+	bool operator==(const char *str) const {
+		return strlen(str) == length && memcmp(data, str, length) == 0;
+	}
+};
+
+inline std::ostream &operator<<(std::ostream &out, const StringView &str) {
+	return out.write(str.data, str.length);
+}
+
+/**
+ * Reads the little-endian fields of an asset held in memory.
+ *
+ * Every read is checked against the end of the data, and throws
+ * std::out_of_range if the asset is truncated. Strings are returned as views
+ * into the data, which must outlive them.
+ */
+class SpanReader {
+public:
+	SpanReader(const byte *data, uint32 size) : _data(data), _size(size), _pos(0) {}
+
+	uint32 size() const { return _size; }
+	uint32 pos() const { return _pos; }
+	bool eos() const { return _pos >= _size; }
+
+	void seek(uint32 pos) {
+		if (pos > _size)
+			throw std::out_of_range("Seek past the end of the data");
+		_pos = pos;
+	}
+	void skip(uint32 count) {
+		readBytes(count);
+	}
+
+	/** Returns a pointer to the next count bytes, and skips them. */
+	const byte *readBytes(uint32 count) {
+		if (count > _size - _pos)
+			throw std::out_of_range("Unexpected end of the data");
+		const byte *bytes = _data + _pos;
+		_pos += count;
+		return bytes;
+	}
+
+	byte readByte() { return *readBytes(1); }
+	int8 readSByte() { return (int8)readByte(); }
+	bool readBool() { return readByte() != 0; }
+	uint16 readUint16() { return READ_LE_UINT16(readBytes(2)); }
+	int16 readSint16() { return (int16)readUint16(); }
+	uint32 readUint32() { return READ_LE_UINT32(readBytes(4)); }
+	int32 readSint32() { return (int32)readUint32(); }
+
+	float readFloat() {
+		uint32 bits = readUint32();
+		float value;
+		memcpy(&value, &bits, 4);
+		return value;
+	}
+
+	/** Reads a field of length bytes holding a string, padded with zeros. */
+	StringView readFixedString(uint32 length) {
+		const char *str = (const char *)readBytes(length);
+		const char *end = (const char *)memchr(str, 0, length);
+		return StringView(str, end ? end - str : length);
+	}
+
+	/** Reads a string terminated by a zero. */
+	StringView readCString() {
+		const char *str = (const char *)_data + _pos;
+		const char *end = (const char *)memchr(str, 0, _size - _pos);
+		if (!end)
+			throw std::out_of_range("Unterminated string");
+		_pos += end - str + 1;
+		return StringView(str, end - str);
+	}
+
+	/** Reads a string field preceded by its length. */
+	StringView readString() {
+		return readFixedString(readUint32());
+	}
+
+private:
+	const byte *_data;
+	uint32 _size;
+	uint32 _pos;
+};
+
+#endif
@@ -19,17 +19,19 @@
  *
  */
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <string>
-#include <zlib.h>
+#include <vector>
 #include <cassert>
 #include <sys/types.h>
-#include <sstream>
 #include <stdint.h>
 #include <cstdio>
 #include <cstring>
 #include "common/endian.h"
+#include "common/parallel.h"
+#include "common/zlib.h"
 #include "engines/grim/lab.h"
 
 /*
@@ -45,7 +47,10 @@ The current implementation also has a few limitation w.r.t. if there should be T
 Also, I _THINK_ that it should work on Big-Endian-systems now, but I haven't gotten around to testing that yet.
 
 Usage:
-til2bmp <filename>
+til2bmp [labfilename] <filename>
+til2bmp --all <labfilename>
+
+The second form converts every TILE of the LAB, several at a time.
 
 somaen.
 */
@@ -67,8 +72,6 @@ struct BMPHeader {
 	uint32_t nimpcolors;
 };
 
-Bytef *decompress(Bytef *in, int size, uint32_t &outsize);
-
 class LucasBitMap {
 public:
 	char *_data;
@@ -188,16 +191,72 @@ char *GetLine(int lineNum, LucasBitMap *bit) {
 	return bit->_data + (lineNum * (bit->_width * bpp));
 }
 
-char *GetLine(int lineNum, char *data, unsigned int width, int bpp) {
-	return data + (lineNum * (width * bpp));
+/**
+ * The five sub-images of a TILE, which point into the decompressed TILE
+ * rather than being copied out of it.
+ */
+struct TileImages {
+	uint32_t bpp;
+	uint32_t width[5], height[5];
+	const char *data[5];
+
+	const char *GetLine(int image, int lineNum) const {
+		return data[image] + lineNum * width[image] * bpp;
+	}
+};
+
+/**
+ * Finds the sub-images in a decompressed TILE. Fails if the TILE is too short
+ * for the sizes its header gives.
+ */
+bool ParseTile(const std::vector<byte> &til, TileImages &images) {
+	const uint32_t size = til.size();
+	if (size < 20)
+		return false;
+	uint32_t bmoffset = READ_LE_UINT32(&til[4]);
+	if (bmoffset > size || size - bmoffset < 128)
+		return false;
+
+	// We want to actually read numImages and bpp
+	uint32_t numImages = READ_LE_UINT32(&til[bmoffset + 16]);
+	if (numImages < 5) {
+		printf("This tile has less than 5 tiles, I don't know how to parse it\n");
+		return false;
+	}
+	images.bpp = READ_LE_UINT32(&til[bmoffset + 36]) / 8;
+	if (images.bpp != 2 && images.bpp != 4)
+		return false;
+
+	printf("Detected %d bpp\n", images.bpp * 8);
+
+	uint32_t pos = bmoffset + 128;
+	for (int i = 0; i < 5; ++i) {
+		if (size - pos < 8)
+			return false;
+		images.width[i] = READ_LE_UINT32(&til[pos]);
+		images.height[i] = READ_LE_UINT32(&til[pos + 4]);
+		pos += 8;
+		// MakeFullPicture lays the sub-images side by side on 640 pixel lines,
+		// and takes 256 lines from each of them
+		if (images.width[i] != 256 || images.height[i] < 256 || images.height[i] > 4096) {
+			printf("Sub-image %d is %dx%d, only 256 pixel wide tiles are supported\n", i, images.width[i], images.height[i]);
+			return false;
+		}
+		uint32_t dataSize = images.width[i] * images.height[i] * images.bpp;
+		if (size - pos < dataSize)
+			return false;
+		images.data[i] = (const char *)&til[pos];
+		pos += dataSize;
+	}
+	return true;
 }
 
-// Expects 5 LucasBitmaps, and returns a LucasBitmap untiled.
-LucasBitMap *MakeFullPicture(LucasBitMap **bits) {
-	LucasBitMap *fullImage = new LucasBitMap(0, 640, 480, bits[0]->_bpp);
+// Expects the 5 sub-images of a TILE, and returns a LucasBitmap untiled.
+LucasBitMap *MakeFullPicture(const TileImages &bits) {
+	LucasBitMap *fullImage = new LucasBitMap(0, 640, 480, bits.bpp);
 
-	const int tWidth = 256 * bits[0]->_bpp; // All of them should have the same bpp. (32)
-	int bpp = bits[0]->_bpp;
+	const int tWidth = 256 * bits.bpp; // All of them have the same bpp. (32)
+	int bpp = bits.bpp;
 
 	char *target = fullImage->_data;
 	for (int i = 0; i < 256; i++) {
@@ -209,28 +268,28 @@ LucasBitMap *MakeFullPicture(LucasBitMap **bits) {
 		if (i < 224) { // Skip blank space
 			target = GetLine(223 - i, fullImage);
 
-			memcpy(target, GetLine(i, bits[3]), tWidth);
-			target += bits[3]->_width * bpp;
+			memcpy(target, bits.GetLine(3, i), tWidth);
+			target += bits.width[3] * bpp;
 
-			memcpy(target, GetLine(i, bits[4]), tWidth);
-			target += bits[4]->_width * bpp;
+			memcpy(target, bits.GetLine(4, i), tWidth);
+			target += bits.width[4] * bpp;
 
-			memcpy(target, GetLine(i, bits[2]) + 128 * bpp, 128 * bpp);
-			target += bpp * bits[2]->_width / 2;
+			memcpy(target, bits.GetLine(2, i) + 128 * bpp, 128 * bpp);
+			target += bpp * bits.width[2] / 2;
 		}
 
 		// Top half of course
 
 		target = GetLine(479 - i, fullImage);
 
-		memcpy(target, GetLine(i, bits[0]), tWidth);
-		target += bits[0]->_width * bpp;
+		memcpy(target, bits.GetLine(0, i), tWidth);
+		target += bits.width[0] * bpp;
 
-		memcpy(target, GetLine(i, bits[1]), tWidth);
-		target += bits[1]->_width * bpp;
+		memcpy(target, bits.GetLine(1, i), tWidth);
+		target += bits.width[1] * bpp;
 
-		memcpy(target, GetLine(i, bits[2]), 128 * bpp);
-		target += bpp * bits[2]->_width / 2;
+		memcpy(target, bits.GetLine(2, i), 128 * bpp);
+		target += bpp * bits.width[2] / 2;
 
 	}
 	fullImage->BGR2RGB();
@@ -238,116 +297,65 @@ LucasBitMap *MakeFullPicture(LucasBitMap **bits) {
 	return fullImage;
 }
 
-void ProcessFile(const char *_data, uint32_t size, std::string name) {
-	std::stringstream til;
-	uint32_t outsize = 0, bpp = 4;
-	const char *data = (const char *)decompress((Bytef *)const_cast<char *>(_data), size, outsize);
-	if (!data) {
-		return;
-	}
-	til.write(data, outsize);
-	delete[] data;
-	uint32_t id, bmoffset, rects, b, c, numImages;
-
-	til.read((char *)&id, 4);
-	id = FROM_LE_32(id);
-	til.read((char *)&bmoffset, 4);
-	bmoffset = FROM_LE_32(bmoffset);
-	til.read((char *)&rects, 4);
-	rects = FROM_LE_32(rects);
-	til.read((char *)&b, 4);
-	b = FROM_LE_32(b);
-	til.read((char *)&c, 4);
-	c = FROM_LE_32(c);
-
-	// We want to actually read numImages and bpp
-	til.seekg(bmoffset + 16, std::ios::beg);
-	til.read((char *)&numImages, 4);
-	numImages = FROM_LE_32(numImages);
-
-	if (numImages < 5) {
-		printf("This tile has less than 5 tiles, I don't know how to parse it\n");
-	}
-
-	til.seekg(16, std::ios::cur);
-	til.read((char *)&bpp, 4);
-	bpp = FROM_LE_32(bpp);
-	bpp = bpp / 8;
-
-	printf("Detected %d bpp\n", bpp * 8);
-
-	til.seekg(bmoffset + 128, std::ios::beg);
-
-	uint32_t width = 0, height = 0;
-
-	LucasBitMap **allTheData = new LucasBitMap*[5];
-
-	for (uint32_t i = 0; i < 5; ++i) {
-		til.read((char *)&width, 4);
-		width = FROM_LE_32(width);
-		til.read((char *)&height, 4);
-		height = FROM_LE_32(height);
-		uint32_t dataSize = width * height * bpp;
-		char *imageData = new char[dataSize];
-		char *outnamet = new char[64];
-		sprintf(outnamet, "%d.bmp", i);
-		til.read(imageData, dataSize);
-
-		allTheData[i] = new LucasBitMap(imageData, width, height, bpp, false);
+// Converts a compressed TILE to filename.bmp
+bool ProcessFile(const byte *data, uint32_t size, const std::string &filename) {
+	std::vector<byte> til;
+	if (!Common::inflateGZip(data, size, til)) {
+		std::cout << "ERROR: " << filename << " is not a valid compressed TILE\n";
+		return false;
 	}
-	LucasBitMap *bit = MakeFullPicture(allTheData);
-	bit->WriteBMP(name.c_str());
 
-	for (uint32_t i = 0; i < 5; ++i) {
-		delete allTheData[i];
+	TileImages images;
+	if (!ParseTile(til, images)) {
+		std::cout << "ERROR: " << filename << " is unsupported or truncated\n";
+		return false;
 	}
 
+	std::string outname = filename + ".bmp";
+	LucasBitMap *bit = MakeFullPicture(images);
+	bit->WriteBMP(outname.c_str());
 	delete bit;
-	delete[] allTheData;
+	return true;
 }
 
+/** Converts every TILE of a LAB, on as many threads as there are cores. */
+int ProcessLab(const char *labName) {
+	Lab lab(labName);
 
-Bytef *decompress(Bytef *in, int size, uint32_t &outsize) {
-	const uint32_t block = 8 * 1024 * 1024;
-	Bytef *dest = new Bytef[block]; // 8 MiB ought to be enough.
-
-	int success = 0;
-	z_stream_s zStream;
-
-	zStream.next_in = Z_NULL;
-	zStream.avail_in = 0;
-	zStream.zalloc = Z_NULL;
-	zStream.zfree = Z_NULL;
-	zStream.opaque = Z_NULL;
-
-	success = inflateInit2(&zStream, 16 + MAX_WBITS);
-	if (success != Z_OK) {
-		std::cout << "ZLIB failed to initialize\n";
-		return 0;
+	std::vector<int> tiles;
+	for (int i = 0; i < lab.getNumEntries(); i++) {
+		std::string name = lab.getFileName(i);
+		if (name.size() > 4 && scumm_stricmp(name.c_str() + name.size() - 4, ".til") == 0)
+			tiles.push_back(i);
 	}
-	zStream.avail_in = size;
-	zStream.next_in = in;
-	zStream.avail_out = block;
-	zStream.next_out = dest;
 
-	success = inflate(&zStream, Z_NO_FLUSH);
-
-	outsize = zStream.total_out;
+	std::vector<char> converted(tiles.size(), 0);
+	parallelFor(tiles.size(), std::max(std::thread::hardware_concurrency(), 1U), [&](size_t i) {
+		std::vector<byte> data;
+		std::string name = lab.getFileName(tiles[i]);
+		if (!lab.readFile(tiles[i], data)) {
+			std::cout << "ERROR: Could not read " << name << "\n";
+			return;
+		}
+		converted[i] = ProcessFile(data.empty() ? NULL : &data[0], data.size(), name);
+	});
 
-	if (success != Z_STREAM_END) {
-		std::cout << "ERROR: decompressed size bigger than 8 MiB\n";
-		return 0;
-	}
-	return dest;
+	int failures = std::count(converted.begin(), converted.end(), 0);
+	printf("Converted %d of %d tiles\n", (int)tiles.size() - failures, (int)tiles.size());
+	return failures ? 1 : 0;
 }
 
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		std::cout << "No Argument" << std::endl;
 		std::cout << "Usage: til2bmp [labfilename] <filename>" << std::endl;
+		std::cout << "       til2bmp --all <labfilename>" << std::endl;
 		return 0;
 	}
 
+	if (argc > 2 && strcmp(argv[1], "--all") == 0)
+		return ProcessLab(argv[2]);
+
 	Lab *lab = NULL;
 	std::string filename;
 	int length = 0;
@@ -366,13 +374,10 @@ int main(int argc, char **argv) {
 		return 0;
 	}
 
-	std::string outname = filename;
-	outname += ".bmp";
-
-	char *data = new char[length];
-	file->read(data, length);
+	std::vector<byte> data(length);
+	if (length > 0)
+		file->read((char *)&data[0], length);
 	delete file;
-	ProcessFile(data, length, outname);
-
-	delete[] data;
+	delete lab;
+	return ProcessFile(data.empty() ? NULL : &data[0], data.size(), filename) ? 0 : 1;
 }
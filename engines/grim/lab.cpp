@@ -37,6 +37,7 @@ Lab::Lab(std::string filename) : _filename(filename) {
 	Load(filename);
 }
 Lab::~Lab() {
+	fclose(infile);
 	free(buf);
 	delete[] str_table;
 	delete[] entries;
@@ -151,6 +152,20 @@ std::istream *Lab::getFile(std::string filename) {
 	return NULL;
 }
 
+bool Lab::readFile(int index, std::vector<byte> &data) const {
+	if (index < 0 || (uint32)index >= head.num_entries)
+		return false;
+
+	uint32 start = READ_LE_UINT32(&entries[index].start);
+	uint32 size = READ_LE_UINT32(&entries[index].size);
+	data.resize(size);
+	if (size == 0)
+		return true;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	return fseek(infile, start, SEEK_SET) == 0 && fread(&data[0], 1, size, infile) == size;
+}
+
 int Lab::getLength(std::string filename) {
 	int index = getIndex(filename);
 	if (index == -1) {
@@ -25,6 +25,8 @@
 #include "common/endian.h"
 #include <string>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 #define GT_GRIM 1
 #define GT_EMI 2
@@ -54,6 +56,7 @@ class Lab {
 	char *buf;
 	char *str_table;
 	FILE *infile;
+	mutable std::mutex _mutex;
 	void Load(std::string filename);
 public:
 	Lab(std::string filename);
@@ -65,6 +68,13 @@ public:
 	std::istream *getFile(std::string filename);
 	int getIndex(std::string filename);
 	int getLength(std::string filename);
+
+	/**
+	 * Reads the file with the given index into data, through the handle kept
+	 * open on the LAB. Unlike getFile, this may be called from several
+	 * threads at once.
+	 */
+	bool readFile(int index, std::vector<byte> &data) const;
 };
 
 std::istream *getFile(std::string filename, Lab *lab);
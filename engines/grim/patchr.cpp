@@ -50,10 +50,24 @@
 #include <fstream>
 #include <deque>
 #include <cstdlib>
+#include <stdio.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 #include "common/endian.h"
 #include "common/zlib.h"
 #include "common/md5.h"
 
+#define MIN(x,y) (((x)<(y)) ? (x) : (y))
+
+/**
+ * Size of the blocks in which the new file is produced. The old file is
+ * read, and the new file written, a block at a time, so that patching uses
+ * the same amount of memory whatever the size of the files.
+ */
+static const uint32 kBlockSize = 1024 * 1024;
+
 uint8 *old_block, *new_block;
 GZipReadStream *ctrlDec, *diffDec, *extraDec;
 
@@ -93,6 +107,133 @@ void show_header_info(uint8 *header) {
 	printf("\n");
 }
 
+/** State of the description of a diff string, which may span several blocks. */
+struct DiffInfo {
+	bool inXor;
+	uint32 copyLength;
+};
+
+void show_diff_info(const uint8 *data, uint32 size, DiffInfo &info) {
+	for (uint32 i = 0; i < size; i++) {
+		if (data[i] != 0) {
+			if (!info.inXor) {
+				if (info.copyLength > 0)
+					printf("COPY %d\n", info.copyLength);
+				info.copyLength = 0;
+				printf("XOR");
+				info.inXor = true;
+			}
+			printf(" %02x", data[i]);
+		} else {
+			if (info.inXor)
+				printf("\n");
+			info.inXor = false;
+			info.copyLength++;
+		}
+	}
+}
+
+void end_diff_info(DiffInfo &info) {
+	if (info.inXor)
+		printf("\n");
+	else if (info.copyLength > 0)
+		printf("COPY %d\n", info.copyLength);
+}
+
+/** Adds, with xor, the old data to the diff string, eight bytes at a time. */
+void add_old_data(uint8 *dst, const uint8 *src, uint32 size) {
+	uint32 i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64 a, b;
+		memcpy(&a, dst + i, 8);
+		memcpy(&b, src + i, 8);
+		a ^= b;
+		memcpy(dst + i, &a, 8);
+	}
+	for (; i < size; i++)
+		dst[i] ^= src[i];
+}
+
+/**
+ * Reads size bytes of the old file at pos into old_block. Bytes past the
+ * end of the file read as zeros, which leave the diff string unchanged.
+ */
+bool read_old(std::istream &oldfile, uint32 oldsize, uint32 pos, uint32 size) {
+	uint32 available = 0;
+	if (pos < oldsize)
+		available = MIN(size, oldsize - pos);
+
+	if (available > 0) {
+		oldfile.clear();
+		oldfile.seekg(pos, std::ios::beg);
+		oldfile.read((char *)old_block, available);
+		if (oldfile.fail())
+			return false;
+	}
+	memset(old_block + available, 0, size - available);
+	return true;
+}
+
+/** Reads the next control triple, from the compressed or the raw stream. */
+bool read_ctrl(std::ifstream &ctrlStream, bool comp_ctrl, uint32 ctrl[3]) {
+	uint8 buf[4];
+	for (uint i = 0; i < 3; i++) {
+		uint32 lenread;
+		if (comp_ctrl) {
+			lenread = ctrlDec->read(buf, 4);
+		} else {
+			ctrlStream.read((char *)buf, 4);
+			lenread = ctrlStream.gcount();
+		}
+		if (lenread < 4)
+			return false;
+		ctrl[i] = READ_LE_UINT32(buf);
+	}
+	return true;
+}
+
+/** Moves back to the first control triple. */
+bool rewind_ctrl(std::ifstream &ctrlStream, bool comp_ctrl) {
+	if (comp_ctrl)
+		return ctrlDec->seek(0);
+	ctrlStream.clear();
+	ctrlStream.seekg(48, std::ios::beg);
+	return !ctrlStream.fail();
+}
+
+/**
+ * Checks whether the new file may overwrite the old one as it is produced,
+ * that is whether the old data is never read behind the new data already
+ * written.
+ */
+bool can_patch_in_place(std::ifstream &ctrlStream, bool comp_ctrl, uint32 oldsize, uint32 newsize) {
+	uint32 oldpos = 0, newpos = 0;
+	uint32 ctrl[3];
+	bool result = true;
+
+	while (result && newpos < newsize) {
+		if (!read_ctrl(ctrlStream, comp_ctrl, ctrl))
+			break;
+		if (ctrl[0] > 0 && oldpos < oldsize && oldpos < newpos)
+			result = false;
+		newpos += ctrl[0] + ctrl[1];
+		oldpos += ctrl[0] + int32(ctrl[2]);
+	}
+	return rewind_ctrl(ctrlStream, comp_ctrl) && result;
+}
+
+/** Whether the two paths name the same file. */
+bool same_file(const char *path1, const char *path2) {
+	struct stat st1, st2;
+	if (stat(path1, &st1) != 0 || stat(path2, &st2) != 0)
+		return false;
+#ifdef _WIN32
+	return strcmp(path1, path2) == 0;
+#else
+	return st1.st_dev == st2.st_dev && st1.st_ino == st2.st_ino;
+#endif
+}
+
 typedef struct {
 	const char *oldfile;
 	const char *newfile;
@@ -107,15 +248,17 @@ void show_usage(char *name) {
 int main(int argc, char *argv[]) {
 	uint32 oldsize, newsize;
 	uint32 zctrllen, zdatalen, zextralen;
-	uint8 header[48], buf[4];
+	uint8 header[48];
 	uint32 oldpos, newpos;
 	uint32 ctrl[3];
 	uint32 lenread;
 	uint32 flags;
+	uint32 blockPos;
 	uint8 md5[16];
 	std::ifstream oldfile, patch, ctrlStream, diffStream, extraStream;
-	std::ofstream newfile;
-	bool comp_ctrl, mix;
+	std::fstream newfile;
+	std::string outputName;
+	bool comp_ctrl, mix, inPlace;
 	arguments args;
 	args.show_info = false;
 
@@ -223,83 +366,85 @@ int main(int argc, char *argv[]) {
 		extraDec = new GZipReadStream(&extraStream, 48 + zctrllen + zdatalen, zextralen);
 	}
 
-	old_block = new uint8[oldsize];
-	new_block = new byte[newsize];
+	old_block = new uint8[kBlockSize];
+	new_block = new byte[kBlockSize];
 	if (old_block == NULL || new_block == NULL) {
 		std::cerr << "Not enough memory\n";
 		return 1;
 	}
 
-	//Read the oldfile
-	oldfile.seekg(0, std::ios::beg);
-	oldfile.read((char *)old_block, oldsize);
-	oldfile.close();
-	if (oldfile.bad() || oldfile.fail()) {
-		std::cerr << "Input error\n";
+	/* Open the new file. When it replaces the old file, it is written over
+	   it if the old data is always read before being overwritten, and else
+	   to a temporary file which is renamed at the end */
+	outputName = args.newfile;
+	inPlace = false;
+	if (same_file(args.oldfile, args.newfile)) {
+#ifndef _WIN32
+		inPlace = can_patch_in_place(ctrlStream, comp_ctrl, oldsize, newsize);
+#endif
+		if (!inPlace)
+			outputName += ".tmp";
+	}
+	if (inPlace) {
+		newfile.open(outputName.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	} else {
+		newfile.open(outputName.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+	}
+	if (newfile.fail()) {
+		std::cerr << "Unable to open" << args.newfile << std::endl;
 		return 1;
 	}
 
 	oldpos = 0;
 	newpos = 0;
+	blockPos = 0;
 	while (newpos < newsize) {
 		/* Read control data */
-		for (uint i = 0; i < 3; i++) {
-			if (comp_ctrl) {
-				lenread = ctrlDec->read(buf, 4);
-			} else {
-				ctrlStream.read((char *)buf, 4);
-				lenread = ctrlStream.gcount();
-			}
-			if (lenread < 4) {
-				std::cerr << "Corrupt patch\n";
-				return 1;
-			}
-			ctrl[i] = READ_LE_UINT32(buf);
-		};
-
-		/* Sanity-check */
-		if (newpos + ctrl[0] > newsize) {
+		if (!read_ctrl(ctrlStream, comp_ctrl, ctrl)) {
 			std::cerr << "Corrupt patch\n";
 			return 1;
 		}
 
-		/* Read diff string */
-		lenread = diffDec->read(new_block + newpos, ctrl[0]);
-		if ((lenread < ctrl[0]) || diffDec->err()) {
+		/* Sanity-check */
+		if (newpos + ctrl[0] > newsize) {
 			std::cerr << "Corrupt patch\n";
 			return 1;
 		}
 
-		//Show info
-		if (args.show_info && ctrl[0] > 0) {
-			uint i = 0;
-			while (i < ctrl[0]) {
-				if (*(new_block + newpos + i) != 0) {
-					printf("XOR");
-					do {
-						printf(" %02x", *(new_block + newpos + i));
-						++i;
-					} while (i < ctrl[0] && *(new_block + newpos + i) != 0);
-					printf("\n");
-				} else {
-					uint pos = i;
-					while (i < ctrl[0] && *(new_block + newpos + i) == 0) {
-						++i;
-					}
-					printf("COPY %d\n", i - pos);
-				}
+		/* Read diff string, and add old data to it, a block at a time */
+		DiffInfo info = { false, 0 };
+		while (ctrl[0] > 0) {
+			uint32 size = MIN(ctrl[0], kBlockSize - blockPos);
+			lenread = diffDec->read(new_block + blockPos, size);
+			if ((lenread < size) || diffDec->err()) {
+				std::cerr << "Corrupt patch\n";
+				return 1;
 			}
-		}
 
-		/* Add old data to diff string */
-		for (uint i = 0; i < ctrl[0]; i++)
-			if (oldpos + i < oldsize) {
-				new_block[newpos + i] ^= old_block[oldpos + i];
+			//Show info
+			if (args.show_info) {
+				show_diff_info(new_block + blockPos, size, info);
 			}
 
-		/* Adjust pointers */
-		newpos += ctrl[0];
-		oldpos += ctrl[0];
+			if (!read_old(oldfile, oldsize, oldpos, size)) {
+				std::cerr << "Input error\n";
+				return 1;
+			}
+			add_old_data(new_block + blockPos, old_block, size);
+
+			/* Adjust pointers */
+			newpos += size;
+			oldpos += size;
+			ctrl[0] -= size;
+			blockPos += size;
+			if (blockPos == kBlockSize) {
+				newfile.write((char *)new_block, blockPos);
+				blockPos = 0;
+			}
+		}
+		if (args.show_info) {
+			end_diff_info(info);
+		}
 
 		/* Sanity-check */
 		if (newpos + ctrl[1] > newsize) {
@@ -308,48 +453,79 @@ int main(int argc, char *argv[]) {
 		}
 
 		/* Read extra string */
-		lenread = extraDec->read(new_block + newpos, ctrl[1]);
-		if ((lenread < ctrl[1]) || extraDec->err()) {
-			std::cerr << "Corrupt patch\n";
-			return 1;
+		if (args.show_info && ctrl[1] > 0) {
+			printf("INSERT");
 		}
+		while (ctrl[1] > 0) {
+			uint32 size = MIN(ctrl[1], kBlockSize - blockPos);
+			lenread = extraDec->read(new_block + blockPos, size);
+			if ((lenread < size) || extraDec->err()) {
+				std::cerr << "Corrupt patch\n";
+				return 1;
+			}
 
-		//Show info
-		if (args.show_info) {
-			if (ctrl[1] > 0) {
-				printf("INSERT");
-				for (uint i = 0; i < ctrl[1]; i++) {
-					printf(" %02x", *(new_block + newpos + i));
+			//Show info
+			if (args.show_info) {
+				for (uint i = 0; i < size; i++) {
+					printf(" %02x", *(new_block + blockPos + i));
+				}
+				if (size == ctrl[1]) {
+					printf("\n");
 				}
-				printf("\n");
 			}
 
-			if (ctrl[2] != 0) {
-				printf("JUMP %d\n", ctrl[2]);
+			/* Adjust pointers */
+			newpos += size;
+			ctrl[1] -= size;
+			blockPos += size;
+			if (blockPos == kBlockSize) {
+				newfile.write((char *)new_block, blockPos);
+				blockPos = 0;
 			}
 		}
 
+		//Show info
+		if (args.show_info && ctrl[2] != 0) {
+			printf("JUMP %d\n", ctrl[2]);
+		}
+
 		/* Adjust pointers */
-		newpos += ctrl[1];
 		oldpos += int32(ctrl[2]);
+
+		if (newfile.bad()) {
+			std::cerr << "Output error.\n";
+			return 1;
+		}
 	};
 
+	/* Write the end of the new file */
+	newfile.write((char *)new_block, blockPos);
+	newfile.close();
+	if (newfile.fail()) {
+		std::cerr << "Output error.\n";
+		return 1;
+	}
+
 	/* Clean up the bzip2 reads */
+	oldfile.close();
 	ctrlStream.close();
 	diffStream.close();
 	extraStream.close();
 
-	/* Write the new file */
-	newfile.open(args.newfile, std::ios::out | std::ios::binary);
-	if (newfile.fail()) {
-		std::cerr << "Unable to open" << args.newfile << std::endl;
-		return 1;
-	}
-
-	newfile.write((char *)new_block, newsize);
-	if (patch.bad()) {
-		std::cerr << "Output error.\n";
-		return 1;
+	/* Cut what remains of the old file, or replace it */
+	if (inPlace && newsize < oldsize) {
+		if (truncate(args.newfile, newsize) != 0) {
+			std::cerr << "Output error.\n";
+			return 1;
+		}
+	} else if (outputName != args.newfile) {
+#ifdef _WIN32
+		remove(args.newfile);
+#endif
+		if (rename(outputName.c_str(), args.newfile) != 0) {
+			std::cerr << "Unable to open" << args.newfile << std::endl;
+			return 1;
+		}
 	}
 
 	return 0;
@@ -0,0 +1,159 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include "suffix_array.h"
+
+#include <algorithm>
+#include <vector>
+
+/** The old file, with a sentinel after its last byte. */
+struct ByteString {
+	const byte *s;
+	int32 n;
+	int32 operator[](int32 i) const { return i == n - 1 ? 0 : s[i] + 1; }
+};
+
+/** A reduced string of the recursion of sais. */
+struct IntString {
+	const int32 *s;
+	int32 operator[](int32 i) const { return s[i]; }
+};
+
+template<typename String>
+static void getBuckets(const String &s, int32 n, int32 k, std::vector<int32> &bkt, bool end) {
+	std::fill(bkt.begin(), bkt.end(), 0);
+	for (int32 i = 0; i < n; i++)
+		bkt[s[i]]++;
+	int32 sum = 0;
+	for (int32 i = 0; i < k; i++) {
+		sum += bkt[i];
+		bkt[i] = end ? sum : sum - bkt[i];
+	}
+}
+
+template<typename String>
+static void induceSA(const String &s, int32 *SA, int32 n, int32 k, const std::vector<bool> &t, std::vector<int32> &bkt) {
+	getBuckets(s, n, k, bkt, false);
+	for (int32 i = 0; i < n; i++) {
+		int32 j = SA[i] - 1;
+		if (j >= 0 && !t[j])
+			SA[bkt[s[j]]++] = j;
+	}
+	getBuckets(s, n, k, bkt, true);
+	for (int32 i = n - 1; i >= 0; i--) {
+		int32 j = SA[i] - 1;
+		if (j >= 0 && t[j])
+			SA[--bkt[s[j]]] = j;
+	}
+}
+
+/**
+ * Builds the suffix array of s by induced sorting (SA-IS, Nong, Zhang and
+ * Chan), in linear time. s[n - 1] must be a sentinel, smaller than any other
+ * character, and the characters must be below k.
+ */
+template<typename String>
+static void sais(const String &s, int32 *SA, int32 n, int32 k) {
+	int32 i, j;
+
+	// Type of each suffix: S (true) if smaller than the next one, else L
+	std::vector<bool> t(n);
+	t[n - 1] = true;
+	for (i = n - 2; i >= 0; i--)
+		t[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && t[i + 1]);
+#define isLMS(i) ((i) > 0 && t[(i)] && !t[(i) - 1])
+
+	// Sort the LMS substrings
+	std::vector<int32> bkt(k);
+	getBuckets(s, n, k, bkt, true);
+	for (i = 0; i < n; i++)
+		SA[i] = -1;
+	for (i = 1; i < n; i++)
+		if (isLMS(i))
+			SA[--bkt[s[i]]] = i;
+	induceSA(s, SA, n, k, t, bkt);
+
+	// Name them, in the order of their positions
+	int32 n1 = 0;
+	for (i = 0; i < n; i++)
+		if (isLMS(SA[i]))
+			SA[n1++] = SA[i];
+	for (i = n1; i < n; i++)
+		SA[i] = -1;
+	int32 name = 0, prev = -1;
+	for (i = 0; i < n1; i++) {
+		int32 pos = SA[i];
+		bool diff = false;
+		for (int32 d = 0; d < n; d++) {
+			if (prev == -1 || s[pos + d] != s[prev + d] || t[pos + d] != t[prev + d]) {
+				diff = true;
+				break;
+			} else if (d > 0 && (isLMS(pos + d) || isLMS(prev + d))) {
+				break;
+			}
+		}
+		if (diff) {
+			name++;
+			prev = pos;
+		}
+		SA[n1 + pos / 2] = name - 1;
+	}
+	for (i = n - 1, j = n - 1; i >= n1; i--)
+		if (SA[i] >= 0)
+			SA[j--] = SA[i];
+
+	// Sort the LMS suffixes, recursing if their names are not unique
+	int32 *s1 = SA + n - n1;
+	if (name < n1) {
+		IntString reduced = { s1 };
+		sais(reduced, SA, n1, name);
+	} else {
+		for (i = 0; i < n1; i++)
+			SA[s1[i]] = i;
+	}
+
+	// Induce the order of all the suffixes from the sorted LMS suffixes
+	for (i = 1, j = 0; i < n; i++)
+		if (isLMS(i))
+			s1[j++] = i;
+	for (i = 0; i < n1; i++)
+		SA[i] = s1[SA[i]];
+	for (i = n1; i < n; i++)
+		SA[i] = -1;
+	getBuckets(s, n, k, bkt, true);
+	for (i = n1 - 1; i >= 0; i--) {
+		j = SA[i];
+		SA[i] = -1;
+		SA[--bkt[s[j]]] = j;
+	}
+	induceSA(s, SA, n, k, t, bkt);
+#undef isLMS
+}
+
+void buildSuffixArray(int32 *I, const byte *old, int32 oldsize) {
+	if (oldsize == 0) {
+		I[0] = 0;
+		return;
+	}
+	ByteString s = { old, oldsize + 1 };
+	sais(s, I, oldsize + 1, 257);
+}
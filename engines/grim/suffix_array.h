@@ -0,0 +1,36 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#ifndef GRIM_SUFFIX_ARRAY_H
+#define GRIM_SUFFIX_ARRAY_H
+
+#include "common/scummsys.h"
+
+/**
+ * Fills I with the suffix array of old, including the empty suffix, which
+ * comes first: I[0] = oldsize. I must hold oldsize + 1 entries.
+ *
+ * The array is built by induced sorting (SA-IS), in linear time.
+ */
+void buildSuffixArray(int32 *I, const byte *old, int32 oldsize);
+
+#endif
@@ -42,9 +42,13 @@ ExtractHDB::ExtractHDB(const std::string &name) : Tool(name, TOOLTYPE_EXTRACTION
 void ExtractHDB::execute() {
 	Common::Filename filename = _inputPaths[0].path;
 
-	if (!openMPC(filename))
-		error("Unable to open %s", filename.getFullName().c_str());
+	{
+		ToolPhase phase(*this, "scan");
+		if (!openMPC(filename))
+			error("Unable to open %s", filename.getFullName().c_str());
+	}
 
+	ToolPhase phase(*this, "write");
 	Common::File fOut;
 	for (Common::Array<MPCEntry *>::iterator it = _dir.begin(); it != _dir.end(); ++it) {
 		byte *buffer = (byte *)malloc((*it)->length);
@@ -63,7 +67,12 @@ void ExtractHDB::execute() {
 
 			print("... decompressing %s", (*it)->filename);
 
-			if (uncompress(buffer2, &len, buffer, (*it)->length) != Z_OK) {
+			beginPhase("decode");
+			int status = uncompress(buffer2, &len, buffer, (*it)->length);
+			addProcessedBytes((*it)->length);
+			endPhase();
+
+			if (status != Z_OK) {
 				print("Error uncompressing file %s", (*it)->filename);
 
 				fOut.write(buffer, (*it)->length);
@@ -81,6 +90,8 @@ void ExtractHDB::execute() {
 			fOut.write(buffer, (*it)->length);
 		}
 
+		addProcessedBytes(fOut.pos());
+		addProcessedItems();
 		fOut.close();
 
 		free(buffer);
@@ -90,6 +101,10 @@ void ExtractHDB::execute() {
 }
 
 InspectionMatch ExtractHDB::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch ExtractHDB::inspectFilename(const Common::Filename &filename) {
 	// Accept either 'vol.cat' or 'vol.dat'
 	std::string file = filename.getFullName();
 	if (
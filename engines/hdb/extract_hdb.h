@@ -54,6 +54,8 @@ public:
 
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+
 protected:
 	bool openMPC(Common::Filename &filename);
 
@@ -24,12 +24,17 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
-
+#include <map>
+#include <string>
+#include <vector>
 
 #include "compress_kyra.h"
 
 #include "compress.h"
 #include "kyra_pak.h"
+#include "common/endian.h"
+#include "common/parallel.h"
+#include "common/util.h"
 
 #define TEMPFILE "TEMP.VOC"
 
@@ -41,10 +46,19 @@ CompressKyra::CompressKyra(const std::string &name) : CompressionTool(name, TOOL
 	_supportsMultipleRuns = true;
 
 	_shorthelp = "Used to compress Legend of Kyrandia games.";
-	_helptext = "\nUsage: " + getName() + " [mode params] [-o outfile] <infile>\n";
+	_helptext = "\nUsage: " + getName() + " [mode params] [--jobs <n>] [-o outfile] <infile>\n"
+		" --jobs <n>   encode up to <n> files of a TLK at once (default: one per CPU core)\n";
+}
+
+void CompressKyra::parseExtraArguments() {
+	parseJobsArguments();
 }
 
 InspectionMatch CompressKyra::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch CompressKyra::inspectFilename(const Common::Filename &filename) {
 	if (filename.hasExtension("VRM") ||
 		filename.hasExtension("PAK") ||
 		filename.hasExtension("TLK") ||
@@ -122,7 +136,33 @@ void CompressKyra::process(Common::Filename *infile, Common::Filename *outfile)
 
 // Kyra3 specifc code
 
-uint16 CompressKyra::clip8BitSample(int16 sample) {
+/**
+ * Sample deltas of the Westwood ADPCM codes, for every byte of packed codes:
+ * four 2-bit codes or two 4-bit codes, from the lowest bits up.
+ */
+struct WSADPCMTables {
+	int8 steps2Bit[256][4];
+	int8 steps4Bit[256][2];
+
+	WSADPCMTables() {
+		static const int8 WSTable2Bit[] = { -2, -1, 0, 1 };
+		static const int8 WSTable4Bit[] = {
+			-9, -8, -6, -5, -4, -3, -2, -1,
+			 0,  1,  2,  3,  4,  5,  6,  8
+		};
+
+		for (int code = 0; code < 256; code++) {
+			for (int i = 0; i < 4; i++)
+				steps2Bit[code][i] = WSTable2Bit[(code >> (2 * i)) & 0x03];
+			steps4Bit[code][0] = WSTable4Bit[code & 0x0f];
+			steps4Bit[code][1] = WSTable4Bit[code >> 4];
+		}
+	}
+};
+
+static const WSADPCMTables wsADPCMTables;
+
+static inline int16 clip8BitSample(int16 sample) {
 	if (sample > 255)
 		return 255;
 	if (sample < 0)
@@ -130,238 +170,237 @@ uint16 CompressKyra::clip8BitSample(int16 sample) {
 	return sample;
 }
 
-int CompressKyra::decodeChunk(Common::File &in, Common::File &out) {
-	uint16 size = in.readUint16LE();
-	uint16 outSize = in.readUint16LE();
-	uint32 id = in.readUint32LE();
-	byte *inputBuffer, *outputBuffer;
-	int bytesRead = 0;
-
-	int16 curSample;
-	uint8 code;
-	int8 count;
-	uint16 input;
-	int i, j;
-
-	uint16 remaining;
-
-	const int8 WSTable2Bit[] = { -2, -1, 0, 1 };
-	const int8 WSTable4Bit[] = {
-		-9, -8, -6, -5, -4, -3, -2, -1,
-		 0,  1,  2,  3,  4,  5,  6,  8
-	};
-
-	assert(id == 0x0000DEAF);
-
-	bytesRead += (8 + size);
-
-	outputBuffer = (byte *)malloc(outSize);
-	assert(outputBuffer);
-
-	if (size == outSize) {
-		int readSize = size;
-		while (readSize > 0) {
-			int read = in.read_noThrow(outputBuffer, readSize);
-			if (read <= 0)
-				error("[1] Couldn't read data");
-			readSize -= read;
-		}
-		while (size > 0)  {
-			int written = out.write(outputBuffer, size);
-			size -= written;
-		}
-		free(outputBuffer);
-		return bytesRead;
-	}
-
-	inputBuffer = (byte *)malloc(size);
-	assert(inputBuffer);
-
-	int readSize = size;
-	while (readSize > 0) {
-		int read = in.read_noThrow(inputBuffer, readSize);
-		if (read <= 0)
-			error("[2] Couldn't read data");
-		readSize -= read;
-	}
+/** Writes an unsigned 8-bit sample as a signed 16-bit little endian one. */
+static inline void putSample(byte *&out, byte sample) {
+	out[0] = 0;
+	out[1] = sample ^ 0x80;
+	out += 2;
+}
 
-	curSample = 0x80;
-	i = 0;
-	j = 0;
+/** Decodes a compressed chunk of outSize samples to 16-bit samples. */
+static void decodeAUDChunk(const byte *in, uint16 size, byte *out, uint16 outSize) {
+	const byte *inEnd = in + size;
+	const byte *outEnd = out + 2 * outSize;
+	const WSADPCMTables &tables = wsADPCMTables;
+	int16 curSample = 0x80;
 
-	remaining = outSize;
+	while (out < outEnd) {
+		if (in == inEnd)
+			throw ToolException("Corrupt AUD chunk");
 
-	while (remaining > 0) {
-		input = inputBuffer[i++] << 2;
-		code = (input >> 8) & 0xff;
-		count = (input & 0xff) >> 2;
+		byte command = *in++;
+		int count = (command & 0x3F) + 1;
 
-		switch (code) {
+		switch (command >> 6) {
 		case 2:
-			if (count & 0x20) {
-				/* NOTE: count is signed! */
-				count <<= 3;
-				curSample += (count >> 3);
-				outputBuffer[j++] = (byte)curSample;
-				remaining--;
-			} else {
-				for (; count >= 0; count--) {
-					outputBuffer[j++] = inputBuffer[i++];
-					remaining--;
-				}
-				curSample = inputBuffer[i - 1];
+			if (command & 0x20) {
+				// Sign extend the 5-bit delta
+				curSample += (int8)(command << 3) >> 3;
+				putSample(out, (byte)curSample);
+				break;
 			}
+			if (inEnd - in < count || (outEnd - out) / 2 < count)
+				throw ToolException("Corrupt AUD chunk");
+			for (int i = 0; i < count; i++)
+				putSample(out, in[i]);
+			in += count;
+			curSample = in[-1];
 			break;
 		case 1:
-			for (; count >= 0; count--) {
-				code = inputBuffer[i++];
-
-				curSample += WSTable4Bit[code & 0x0f];
-				curSample = clip8BitSample(curSample);
-				outputBuffer[j++] = (byte)curSample;
-
-				curSample += WSTable4Bit[code >> 4];
-				curSample = clip8BitSample(curSample);
-				outputBuffer[j++] = (byte)curSample;
-
-				remaining -= 2;
+			if (inEnd - in < count || (outEnd - out) / 4 < count)
+				throw ToolException("Corrupt AUD chunk");
+			for (int i = 0; i < count; i++) {
+				const int8 *steps = tables.steps4Bit[*in++];
+				curSample = clip8BitSample(curSample + steps[0]);
+				putSample(out, (byte)curSample);
+				curSample = clip8BitSample(curSample + steps[1]);
+				putSample(out, (byte)curSample);
 			}
 			break;
 		case 0:
-			for (; count >= 0; count--) {
-				code = inputBuffer[i++];
-
-				curSample += WSTable2Bit[code & 0x03];
-				curSample = clip8BitSample(curSample);
-				outputBuffer[j++] = (byte)curSample;
-
-				curSample += WSTable2Bit[(code >> 2) & 0x03];
-				curSample = clip8BitSample(curSample);
-				outputBuffer[j++] = (byte)curSample;
-
-				curSample += WSTable2Bit[(code >> 4) & 0x03];
-				curSample = clip8BitSample(curSample);
-				outputBuffer[j++] = (byte)curSample;
-
-				curSample += WSTable2Bit[(code >> 6) & 0x03];
-				curSample = clip8BitSample(curSample);
-				outputBuffer[j++] = (byte)curSample;
-
-				remaining -= 4;
+			if (inEnd - in < count || (outEnd - out) / 8 < count)
+				throw ToolException("Corrupt AUD chunk");
+			for (int i = 0; i < count; i++) {
+				const int8 *steps = tables.steps2Bit[*in++];
+				for (int j = 0; j < 4; j++) {
+					curSample = clip8BitSample(curSample + steps[j]);
+					putSample(out, (byte)curSample);
+				}
 			}
 			break;
 		default:
-			for (; count >= 0; count--) {
-				outputBuffer[j++] = (byte)curSample;
-				remaining--;
-			}
+			if ((outEnd - out) / 2 < count)
+				throw ToolException("Corrupt AUD chunk");
+			for (int i = 0; i < count; i++)
+				putSample(out, (byte)curSample);
+			break;
 		}
 	}
+}
 
-	while (outSize > 0)  {
-		int written = out.write(outputBuffer, outSize);
-		if (written <= 0)
-			error("[2] Couldn't write data");
-		outSize -= written;
+/**
+ * Decodes a Westwood AUD file held in memory to signed 16-bit little endian
+ * samples, all its chunks at once.
+ *
+ * @param data      Data of the file.
+ * @param available Number of bytes at data, which may be followed by other files.
+ * @param pcm       Receives the samples.
+ * @return The sample rate.
+ */
+static int decodeAUD(const byte *data, uint32 available, std::vector<byte> &pcm) {
+	// Header: rate, compressed size, flags and type
+	if (available < 8)
+		throw ToolException("Truncated AUD file");
+	int rate = READ_LE_UINT16(data);
+	uint32 size = READ_LE_UINT32(data + 2);
+	if (size > available - 8)
+		throw ToolException("Truncated AUD file");
+	const byte *start = data + 8, *end = start + size;
+
+	// Chunk headers: compressed size, decompressed size and id
+	uint32 samples = 0;
+	for (const byte *chunk = start; chunk < end; chunk += 8 + READ_LE_UINT16(chunk)) {
+		if (end - chunk < 8 || READ_LE_UINT32(chunk + 4) != 0x0000DEAF || end - chunk - 8 < READ_LE_UINT16(chunk))
+			throw ToolException("Corrupt AUD file");
+		samples += READ_LE_UINT16(chunk + 2);
 	}
 
-	free(inputBuffer);
-	free(outputBuffer);
+	pcm.resize(2 * samples);
+	byte *out = pcm.data();
+	for (const byte *chunk = start; chunk < end; chunk += 8 + READ_LE_UINT16(chunk)) {
+		uint16 chunkSize = READ_LE_UINT16(chunk);
+		uint16 outSize = READ_LE_UINT16(chunk + 2);
+		if (chunkSize == outSize) {
+			// Stored as unsigned 8-bit samples
+			for (uint16 i = 0; i < outSize; i++)
+				putSample(out, chunk[8 + i]);
+		} else {
+			decodeAUDChunk(chunk + 8, chunkSize, out, outSize);
+			out += 2 * outSize;
+		}
+	}
 
-	return bytesRead;
+	return rate;
 }
 
-typedef struct {
-	uint16 freq;
-	uint32 size;
-	byte flags;
-	byte type;
-} AUDHeader;
-
-void CompressKyra::compressAUDFile(Common::File &input, const char *outfile) {
-	AUDHeader header;
-
-	header.freq = input.readUint16LE();
-	header.size = input.readUint32LE();
-	header.flags = input.readByte();
-	header.type = input.readByte();
-	//print("%d Hz, %d bytes, type %d (%08X)", header.freq, header.size, header.type, header.flags);
-
-	Common::File output(TEMP_RAW, "wb");
-
-	uint32 remaining = header.size;
-	while (remaining > 0)
-		remaining -= decodeChunk(input, output);
-
-	encodeAudio(TEMP_RAW, true, header.freq, outfile, _format);
-
-	Common::removeFile(TEMP_RAW);
+void CompressKyra::encodeAUD(const std::vector<byte> &pcm, int rate, const char *outfile) {
+	RawAudioType type = { true, false, 16 };
+	encodeAudioBuffer(pcm.data(), pcm.size(), type, rate, outfile, _format);
 }
 
-struct CompressKyra::DuplicatedFile {
-	uint32 resFilename;
-	uint32 resOffset;
-};
-
-const CompressKyra::DuplicatedFile *CompressKyra::findDuplicatedFile(uint32 resOffset, const DuplicatedFile *list, const uint32 maxEntries) {
-	for (uint32 i = 0; i < maxEntries; ++i) {
-		if (list[i].resOffset == resOffset && list[i].resOffset != 0)
-			return &list[i];
-	}
-
-	return 0;
-}
+/** Number of files of a TLK encoded before they are added, which bounds the temporary files. */
+static const size_t kTLKBatchSize = 256;
 
 void CompressKyra::processKyra3(Common::Filename *infile, Common::Filename *outfile) {
 	if (infile->hasExtension("AUD")) {
 		outfile->setExtension(audio_extensions(_format));
 
-		Common::File input(*infile, "rb");
+		std::vector<byte> data, pcm;
+		{
+			Common::File input(*infile, "rb");
+			data.resize(input.size());
+			if (!data.empty())
+				input.read_throwsOnError(&data[0], data.size());
+		}
 
-		compressAUDFile(input, outfile->getFullPath().c_str());
+		int rate;
+		{
+			ToolPhase phase(*this, "decode");
+			rate = decodeAUD(data.data(), data.size(), pcm);
+			addProcessedBytes(pcm.size());
+			addProcessedItems();
+		}
+		encodeAUD(pcm, rate, outfile->getFullPath().c_str());
 	} else if (infile->hasExtension("TLK")) {
 		PAKFile output;
 
-		Common::File input(*infile, "rb");
-
 		if (!output.loadFile(NULL, false))
 			return;
 
-		uint16 files = input.readUint16LE();
-		DuplicatedFile *red = new DuplicatedFile[files];
-		memset(red, 0, sizeof(DuplicatedFile)*files);
-
-		for (uint16 i = 0; i < files; ++i) {
-			uint32 resFilename = input.readUint32LE();
-			uint32 resOffset = input.readUint32LE();
-
-			char outname[16];
-			snprintf(outname, 16, "%.08u%s", resFilename, audio_extensions(_format));
+		std::vector<byte> tlk;
+		{
+			Common::File input(*infile, "rb");
+			tlk.resize(input.size());
+			if (!tlk.empty())
+				input.read_throwsOnError(&tlk[0], tlk.size());
+		}
 
-			const DuplicatedFile *file = findDuplicatedFile(resOffset, red, files);
-			if (file) {
-				char linkname[16];
-				snprintf(linkname, 16, "%.08u%s", file->resFilename, audio_extensions(_format));
+		if (tlk.size() < 2)
+			error("Truncated TLK file '%s'", infile->getFullPath().c_str());
+		uint16 files = READ_LE_UINT16(&tlk[0]);
+		if (tlk.size() < 2 + 8 * (size_t)files)
+			error("Truncated TLK file '%s'", infile->getFullPath().c_str());
 
-				output.linkFiles(outname, linkname);
+		// Files at the same offset are only encoded once, and linked to
+		std::vector<uint16> unique;
+		std::vector<int> linkTo(files, -1);
+		std::map<uint32, uint16> firstAtOffset;
+		for (uint16 i = 0; i < files; ++i) {
+			uint32 resOffset = READ_LE_UINT32(&tlk[2 + 8 * i + 4]);
+			std::map<uint32, uint16>::const_iterator first = firstAtOffset.find(resOffset);
+			if (resOffset != 0 && first != firstAtOffset.end()) {
+				linkTo[i] = first->second;
 			} else {
-				red[i].resFilename = resFilename;
-				red[i].resOffset = resOffset;
+				firstAtOffset.insert(std::make_pair(resOffset, i));
+				unique.push_back(i);
+			}
+		}
 
-				uint32 pos = (uint32)input.pos();
-				input.seek(resOffset + 4, SEEK_SET);
+		char outname[16], linkname[16];
+		const char *extension = audio_extensions(_format);
+		uint16 next = 0;
+		auto fileName = [&](char *name, uint16 entry) {
+			snprintf(name, 16, "%.08u%s", READ_LE_UINT32(&tlk[2 + 8 * entry]), extension);
+		};
+		auto linkFile = [&](uint16 entry) {
+			fileName(outname, entry);
+			fileName(linkname, linkTo[entry]);
+			output.linkFiles(outname, linkname);
+		};
+
+		for (size_t first = 0; first < unique.size(); first += kTLKBatchSize) {
+			size_t count = MIN(kTLKBatchSize, unique.size() - first);
+
+			// Each file is encoded under a temporary name of its own, as several are encoded at once
+			std::vector<std::string> encoded(count);
+			for (size_t i = 0; i < count; i++) {
+				char tempName[32];
+				snprintf(tempName, sizeof(tempName), "tempfile%03u%s", (unsigned int)i, extension);
+				encoded[i] = tempName;
+			}
 
-				compressAUDFile(input, outname);
+			parallelFor(count, _jobs, [&](size_t i) {
+				uint32 offset = READ_LE_UINT32(&tlk[2 + 8 * unique[first + i] + 4]) + 4;
+				if (offset > tlk.size())
+					throw ToolException("Truncated TLK file");
+
+				std::vector<byte> pcm;
+				int rate;
+				{
+					ToolPhase phase(*this, "decode");
+					rate = decodeAUD(&tlk[offset], tlk.size() - offset, pcm);
+					addProcessedBytes(pcm.size());
+					addProcessedItems();
+				}
+				encodeAUD(pcm, rate, encoded[i].c_str());
+			});
 
-				output.addFile(outname, outname);
+			// Add the files in the order of the TLK, with the links preceding them
+			for (size_t i = 0; i < count; i++) {
+				uint16 entry = unique[first + i];
+				for (; next < entry; next++)
+					linkFile(next);
+				next = entry + 1;
 
-				Common::removeFile(outname);
+				fileName(outname, entry);
+				output.addFile(outname, encoded[i].c_str());
 
-				input.seek(pos, SEEK_SET);
+				Common::removeFile(encoded[i].c_str());
 			}
 		}
 
-		delete[] red;
+		for (; next < files; next++)
+			linkFile(next);
 
 		if (output.getFileList())
 			output.saveFile(outfile->getFullPath().c_str());
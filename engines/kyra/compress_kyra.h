@@ -26,6 +26,8 @@
 
 #include "compress.h"
 
+#include <vector>
+
 class CompressKyra : public CompressionTool {
 public:
 	CompressKyra(const std::string &name = "compress_kyra");
@@ -34,13 +36,13 @@ public:
 
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+
 protected:
-	struct DuplicatedFile;
+	virtual void parseExtraArguments();
 
-	uint16 clip8BitSample(int16 sample);
-	int decodeChunk(Common::File &in, Common::File &out);
-	void compressAUDFile(Common::File &input, const char *outfile);
-	const DuplicatedFile *findDuplicatedFile(uint32 resOffset, const DuplicatedFile *list, const uint32 maxEntries);
+	/** Encodes signed 16-bit little endian mono samples. May be called from several threads at once. */
+	void encodeAUD(const std::vector<byte> &pcm, int rate, const char *outfile);
 	void process(Common::Filename *infile, Common::Filename *output);
 	void processKyra3(Common::Filename *infile, Common::Filename *output);
 	bool detectKyra3File(Common::Filename *infile);
@@ -80,6 +80,7 @@ void ExtractKyra::execute() {
 	Common::Filename inputpath(_inputPaths[0].path);
 
 	Extractor *extract = 0;
+	beginPhase("scan");
 	if (isHoFInstaller) {
 		extract = new HoFInstaller(inputpath.getFullPath().c_str());
 	} else {
@@ -91,11 +92,18 @@ void ExtractKyra::execute() {
 
 		extract = myfile;
 	}
+	endPhase();
 
 	// Everything has been decided, do the actual extraction
 	if (extractAll) {
+		ToolPhase phase(*this, "write");
 		extract->outputAllFiles(&_outputPath);
+		for (Extractor::cFileList *file = extract->getFileList(); file; file = file->next) {
+			addProcessedBytes(file->size);
+			addProcessedItems();
+		}
 	} else if (extractOne) {
+		ToolPhase phase(*this, "write");
 		inputpath.setFullName(singleFilename);
 		extract->outputFileAs(singleFilename.c_str(), inputpath.getFullPath().c_str());
 	} else {
@@ -27,425 +27,407 @@
 #include "common/endian.h"
 #include "common/util.h"
 
+/**
+ * Reads the bits of a compressed stream, least significant bit first. The bits
+ * are buffered a word at a time, so that a whole literal or match can be
+ * decoded between refills.
+ */
 class FileExpanderSource {
 public:
-	FileExpanderSource(const uint8 *data, int dataSize) : _dataPtr(data), _endofBuffer(data + dataSize), _bitsLeft(8), _key(0), _index(0) {}
-	~FileExpanderSource() {}
+	FileExpanderSource(const uint8 *data, uint32 dataSize) : _dataPtr(data), _endofBuffer(data + dataSize), _bits(0), _bitCount(0), _padding(false) {}
+
+	/** Buffers at least 56 bits. Past the end of the data, zeros are read. */
+	void refill() {
+		if (_endofBuffer - _dataPtr >= 8) {
+			_bits |= ((uint64)READ_LE_UINT32(_dataPtr + 4) << 32 | READ_LE_UINT32(_dataPtr)) << _bitCount;
+			_dataPtr += (63 - _bitCount) >> 3;
+			_bitCount |= 56;
+		} else {
+			while (_bitCount <= 56) {
+				if (_dataPtr < _endofBuffer)
+					_bits |= (uint64)*_dataPtr++ << _bitCount;
+				else
+					_padding = true;
+				_bitCount += 8;
+			}
+		}
+	}
 
-	void advSrcRefresh();
-	void advSrcBitsBy1();
-	void advSrcBitsByIndex(uint8 newIndex);
+	uint32 peekBits(uint8 count) const { return (uint32)_bits & ((1 << count) - 1); }
+	void skipBits(uint8 count) { _bits >>= count; _bitCount -= count; }
 
-	uint8 getKeyLower() { return _key & 0xff; }
-	void setIndex(uint8 index) { _index = index; }
-	uint16 getKeyMasked(uint8 newIndex);
-	uint16 keyMaskedAlign(uint16 val);
+	uint32 getBits(uint8 count) {
+		uint32 res = peekBits(count);
+		skipBits(count);
+		return res;
+	}
 
-	void copyBytes(uint8 *& dst);
+	/** Copies the data of a stored block, which starts on the next byte boundary. */
+	void copyBytes(uint8 *dst, uint32 size);
+	uint32 alignToByte();
 
 private:
 	const uint8 *_dataPtr;
 	const uint8 *_endofBuffer;
-	uint16 _key;
-	int8 _bitsLeft;
-	uint8 _index;
+	uint64 _bits;
+	uint8 _bitCount;
+	bool _padding;
 };
 
-void FileExpanderSource::advSrcBitsBy1() {
-	_key >>= 1;
-	if (!--_bitsLeft) {
-		if (_dataPtr < _endofBuffer)
-			_key = ((*_dataPtr++) << 8 ) | (_key & 0xff);
-		_bitsLeft = 8;
-	}
-}
-
-void FileExpanderSource::advSrcBitsByIndex(uint8 newIndex) {
-	_index = newIndex;
-	_bitsLeft -= _index;
-	if (_bitsLeft <= 0) {
-		_key >>= (_index + _bitsLeft);
-		_index = -_bitsLeft;
-		_bitsLeft = 8 - _index;
-		if (_dataPtr < _endofBuffer)
-			_key = (*_dataPtr++ << 8) | (_key & 0xff);
-	}
-	_key >>= _index;
-}
-
-uint16 FileExpanderSource::getKeyMasked(uint8 newIndex) {
-	static const uint8 mskTable[] = { 0x0F, 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0x7F, 0xFF };
-	_index = newIndex;
-	uint16 res = 0;
-
-	if (_index > 8) {
-		newIndex = _index - 8;
-		res = (_key & 0xff) & mskTable[8];
-		advSrcBitsByIndex(8);
-		_index = newIndex;
-		res |= (((_key & 0xff) & mskTable[_index]) << 8);
-		advSrcBitsByIndex(_index);
-	} else {
-		res = (_key & 0xff) & mskTable[_index];
-		advSrcBitsByIndex(_index);
-	}
-
-	return res;
-}
+uint32 FileExpanderSource::alignToByte() {
+	if (_padding)
+		error("decompression failure");
 
-void FileExpanderSource::copyBytes(uint8 *& dst) {
-	advSrcBitsByIndex(_bitsLeft);
-	uint16 r = (READ_LE_UINT16(_dataPtr) ^ _key) + 1;
-	_dataPtr += 2;
+	// Give the whole bytes left in the bit buffer back to the data
+	_dataPtr -= _bitCount >> 3;
+	_bits = 0;
+	_bitCount = 0;
 
-	if (r)
+	if (_endofBuffer - _dataPtr < 4)
 		error("decompression failure");
+	uint16 size = READ_LE_UINT16(_dataPtr);
+	if ((uint16)(READ_LE_UINT16(_dataPtr + 2) ^ size) != 0xFFFF)
+		error("decompression failure");
+	_dataPtr += 4;
 
-	memcpy(dst, _dataPtr, _key);
-	_dataPtr += _key;
-	dst += _key;
-}
-
-uint16 FileExpanderSource::keyMaskedAlign(uint16 val) {
-	val -= 0x101;
-	_index = (val & 0xff) >> 2;
-	int16 b = ((_bitsLeft << 8) | _index) - 1;
-	_bitsLeft = b >> 8;
-	_index = b & 0xff;
-	uint16 res = (((val & 3) + 4) << _index) + 0x101;
-	return res + getKeyMasked(_index);
+	return size;
 }
 
-void FileExpanderSource::advSrcRefresh() {
-	_key = READ_LE_UINT16(_dataPtr);
-	if (_dataPtr < _endofBuffer - 1)
-		_dataPtr += 2;
-	_bitsLeft = 8;
+void FileExpanderSource::copyBytes(uint8 *dst, uint32 size) {
+	if ((uint32)(_endofBuffer - _dataPtr) < size)
+		error("decompression failure");
+	memcpy(dst, _dataPtr, size);
+	_dataPtr += size;
 }
 
-class FileExpander {
+/**
+ * A Huffman code, decoded through a table indexed by the next kFastBits bits
+ * of the stream. Longer codes are decoded a bit at a time.
+ */
+class FileExpanderCode {
 public:
-	FileExpander();
-	~FileExpander();
+	FileExpanderCode() : _numLengths(0) {}
 
-	bool process(uint8 *dst, const uint8 *src, uint32 outsize, uint32 insize);
+	/** Builds the code, unless it was last built from the same code lengths. */
+	void generate(const uint8 *lengths, int cnt);
+
+	uint16 decode(FileExpanderSource &src) const {
+		uint16 entry = _fast[src.peekBits(kFastBits)];
+		if (entry) {
+			src.skipBits(entry & 0x0F);
+			return entry >> 4;
+		}
+		return decodeSlow(src);
+	}
 
 private:
-	void generateTables(uint8 srcIndex, uint8 dstIndex, uint8 dstIndex2, int cnt);
-	uint8 calcCmdAndIndex(const uint8 *tbl, int16 &para);
+	enum {
+		kFastBits = 10,
+		kMaxBits = 15,
+		kMaxSymbols = 320
+	};
 
-	FileExpanderSource *_src;
-	uint8 *_tables[9];
-	uint16 *_tables16[3];
-};
+	uint16 decodeSlow(FileExpanderSource &src) const;
 
-FileExpander::FileExpander() : _src(0) {
-	_tables[0] = new uint8[3914];
-	assert(_tables[0]);
-
-	_tables[1] = _tables[0] + 320;
-	_tables[2] = _tables[0] + 352;
-	_tables[3] = _tables[0] + 864;
-	_tables[4] = _tables[0] + 2016;
-	_tables[5] = _tables[0] + 2528;
-	_tables[6] = _tables[0] + 2656;
-	_tables[7] = _tables[0] + 2736;
-	_tables[8] = _tables[0] + 2756;
-
-	_tables16[0] = (uint16 *)(_tables[0] + 3268);
-	_tables16[1] = (uint16 *)(_tables[0] + 3302);
-	_tables16[2] = (uint16 *)(_tables[0] + 3338);
-}
+	// Symbol << 4 | code length, or 0 for the codes longer than kFastBits
+	uint16 _fast[1 << kFastBits];
+	uint16 _counts[kMaxBits + 1];
+	uint16 _symbols[kMaxSymbols];
+	uint8 _lengths[kMaxSymbols];
+	int _numLengths;
+};
 
-FileExpander::~FileExpander() {
-	delete _src;
-	delete[] _tables[0];
-}
+void FileExpanderCode::generate(const uint8 *lengths, int cnt) {
+	assert(cnt <= kMaxSymbols);
+	if (cnt == _numLengths && !memcmp(lengths, _lengths, cnt))
+		return;
 
-bool FileExpander::process(uint8 *dst, const uint8 *src, uint32 outsize, uint32 compressedSize) {
-	static const uint8 indexTable[] = {
-		0x10, 0x11, 0x12, 0x00, 0x08, 0x07, 0x09, 0x06, 0x0A,
-		0x05, 0x0B, 0x04, 0x0C, 0x03, 0x0D, 0x02, 0x0E, 0x01, 0x0F
-	};
+	memcpy(_lengths, lengths, cnt);
+	_numLengths = cnt;
 
-	memset(_tables[0], 0, 3914);
+	memset(_counts, 0, sizeof(_counts));
+	for (int i = 0; i < cnt; i++)
+		_counts[lengths[i]]++;
+	_counts[0] = 0;
+
+	uint16 offsets[kMaxBits + 1];
+	uint16 codes[kMaxBits + 1];
+	int left = 1;
+	offsets[1] = 0;
+	codes[1] = 0;
+	for (int i = 1; i <= kMaxBits; i++) {
+		left = (left << 1) - _counts[i];
+		if (left < 0)
+			error("decompression failure");
+		if (i < kMaxBits) {
+			offsets[i + 1] = offsets[i] + _counts[i];
+			codes[i + 1] = (codes[i] + _counts[i]) << 1;
+		}
+	}
 
-	uint8 *d = dst;
-	uint16 tableSize0 = 0;
-	uint16 tableSize1 = 0;
-	bool needrefresh = true;
-	bool postprocess = false;
+	memset(_fast, 0, sizeof(_fast));
+	for (int i = 0; i < cnt; i++) {
+		uint8 len = lengths[i];
+		if (!len)
+			continue;
+		_symbols[offsets[len]++] = i;
 
-	_src = new FileExpanderSource(src, compressedSize);
+		uint16 code = codes[len]++;
+		if (len > kFastBits)
+			continue;
 
-	while (d < dst + outsize) {
+		// The codes are stored starting with their most significant bit
+		uint16 reversed = 0;
+		for (int j = 0; j < len; j++)
+			reversed |= ((code >> j) & 1) << (len - 1 - j);
+		for (uint32 j = reversed; j < (1 << kFastBits); j += 1 << len)
+			_fast[j] = (i << 4) | len;
+	}
+}
 
-		if (needrefresh) {
-			needrefresh = false;
-			_src->advSrcRefresh();
+uint16 FileExpanderCode::decodeSlow(FileExpanderSource &src) const {
+	uint32 bits = src.peekBits(kMaxBits);
+	int code = 0;
+	int first = 0;
+	int index = 0;
+
+	for (int len = 1; len <= kMaxBits; len++) {
+		code |= bits & 1;
+		bits >>= 1;
+		int count = _counts[len];
+		if (code - count < first) {
+			src.skipBits(len);
+			return _symbols[index + (code - first)];
 		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
 
-		_src->advSrcBitsBy1();
+	error("decompression failure");
+	return 0;
+}
 
-		int mode = _src->getKeyMasked(2) - 1;
-		if (mode == 1) {
-			tableSize0 = _src->getKeyMasked(5) + 257;
-			tableSize1 = _src->getKeyMasked(5) + 1;
-			memset(_tables[7], 0, 19);
+/**
+ * Decompresses the files of the HoF installer, which are deflated. The output
+ * is written to a file through a sliding window, so that files of any size
+ * are expanded with a fixed amount of memory.
+ */
+class FileExpander {
+public:
+	FileExpander();
+	~FileExpander();
 
-			const uint8 *itbl = indexTable;
-			int numbytes = _src->getKeyMasked(4) + 4;
+	bool process(FILE *dst, const uint8 *src, uint32 outsize, uint32 insize);
 
-			while (numbytes--)
-				_tables[7][*itbl++] = (uint8)_src->getKeyMasked(3);
+private:
+	enum {
+		kWindowSize = 32768,
+		kMaxMatch = 258,
+		kBufferSize = 2 * kWindowSize + kMaxMatch
+	};
 
-			generateTables(7, 8, 255, 19);
+	void readDynamicTables(FileExpanderSource &src);
+	void expandBlock(FileExpanderSource &src, const FileExpanderCode &lengthCode, const FileExpanderCode &offsetCode, uint32 outsize);
+	void flush(bool slide);
 
-			int cnt = tableSize0 + tableSize1;
-			uint8 *tmp = _tables[0];
+	FileExpanderCode _fixedLengthCode, _fixedOffsetCode;
+	FileExpanderCode _dynLengthCode, _dynOffsetCode;
+	FileExpanderCode _tableCode;
 
-			while (cnt) {
-				uint16 cmd = _src->getKeyLower();
-				cmd = READ_LE_UINT16(&_tables[8][cmd << 1]);
-				_src->advSrcBitsByIndex(_tables[7][cmd]);
+	FILE *_dst;
+	uint8 *_buffer;
+	uint32 _pos;
+	uint32 _flushed;
+	uint32 _total;
+};
 
-				if (cmd < 16) {
-					*tmp++ = (uint8)cmd;
-					cnt--;
-				} else {
-					uint8 tmpI = 0;
-					if (cmd == 16) {
-						cmd = _src->getKeyMasked(2) + 3;
-						tmpI = *(tmp - 1);
-					} else if (cmd == 17) {
-						cmd = _src->getKeyMasked(3) + 3;
-					} else {
-						cmd = _src->getKeyMasked(7) + 11;
-					}
-					_src->setIndex(tmpI);
-					memset(tmp, tmpI, cmd);
-					tmp += cmd;
+FileExpander::FileExpander() : _dst(0), _pos(0), _flushed(0), _total(0) {
+	_buffer = new uint8[kBufferSize];
 
-					cnt -= cmd;
-					if (cnt < 0)
-						error("decompression failure");
-				}
-			}
+	uint8 lengths[288];
+	memset(lengths, 8, 144);
+	memset(lengths + 144, 9, 112);
+	memset(lengths + 256, 7, 24);
+	memset(lengths + 280, 8, 8);
+	_fixedLengthCode.generate(lengths, 288);
 
-			memcpy(_tables[1], _tables[0] + tableSize0, tableSize1);
-			generateTables(0, 2, 3, tableSize0);
-			generateTables(1, 4, 5, tableSize1);
-			postprocess = true;
-		} else if (mode < 0) {
-			_src->copyBytes(d);
-			postprocess = false;
-			needrefresh = true;
-		} else if (mode == 0){
-			uint8 *d2 = _tables[0];
-			memset(d2, 8, 144);
-			memset(d2 + 144, 9, 112);
-			memset(d2 + 256, 7, 24);
-			memset(d2 + 280, 8, 8);
-			d2 = _tables[1];
-			memset(d2, 5, 32);
-			tableSize0 = 288;
-			tableSize1 = 32;
-
-			generateTables(0, 2, 3, tableSize0);
-			generateTables(1, 4, 5, tableSize1);
-			postprocess = true;
-		} else {
-			error("decompression failure");
-		}
+	memset(lengths, 5, 32);
+	_fixedOffsetCode.generate(lengths, 32);
+}
 
-		if (!postprocess)
-			continue;
+FileExpander::~FileExpander() {
+	delete[] _buffer;
+}
 
-		int16 cmd = 0;
+bool FileExpander::process(FILE *dst, const uint8 *src, uint32 outsize, uint32 compressedSize) {
+	FileExpanderSource source(src, compressedSize);
+	bool lastBlock = false;
 
-		do  {
-			cmd = ((int16*) _tables[2])[_src->getKeyLower()];
-			_src->advSrcBitsByIndex(cmd < 0 ? calcCmdAndIndex(_tables[3], cmd) : _tables[0][cmd]);
+	_dst = dst;
+	_pos = _flushed = _total = 0;
 
-			if (cmd == 0x11d) {
-				cmd = 0x200;
-			} else if (cmd > 0x108) {
-				cmd = _src->keyMaskedAlign(cmd);
-			}
+	while (_total < outsize && !lastBlock) {
+		source.refill();
+		lastBlock = source.getBits(1) != 0;
 
-			if (!(cmd >> 8)) {
-				*d++ = cmd & 0xff;
-			} else if (cmd != 0x100) {
-				cmd -= 0xfe;
-				int16 offset = ((int16*) _tables[4])[_src->getKeyLower()];
-				_src->advSrcBitsByIndex(offset < 0 ? calcCmdAndIndex(_tables[5], offset) : _tables[1][offset]);
-
-				if ((offset & 0xff) >= 4) {
-					uint8 newIndex = ((offset & 0xff) >> 1) - 1;
-					offset = (((offset & 1) + 2) << newIndex);
-					offset += _src->getKeyMasked(newIndex);
-				}
+		int mode = source.getBits(2) - 1;
+		if (mode < 0) {
+			uint32 size = source.alignToByte();
+			if (size > outsize - _total)
+				error("decompression failure");
 
-				uint8 *s2 = d - 1 - offset;
-				if (s2 >= dst) {
-					while (cmd--)
-						*d++ = *s2++;
-				} else {
-					uint32 pos = dst - s2;
-					s2 += (d - dst);
-
-					if (pos < (uint32) cmd) {
-						cmd -= pos;
-						while (pos--)
-							*d++ = *s2++;
-						s2 = dst;
-					}
-					while (cmd--)
-						*d++ = *s2++;
-				}
+			while (size) {
+				uint32 n = MIN<uint32>(size, 2 * kWindowSize - _pos);
+				source.copyBytes(_buffer + _pos, n);
+				_pos += n;
+				_total += n;
+				size -= n;
+				if (_pos >= 2 * kWindowSize)
+					flush(true);
 			}
-		} while (cmd != 0x100);
+		} else if (mode == 0) {
+			expandBlock(source, _fixedLengthCode, _fixedOffsetCode, outsize);
+		} else if (mode == 1) {
+			readDynamicTables(source);
+			expandBlock(source, _dynLengthCode, _dynOffsetCode, outsize);
+		} else {
+			error("decompression failure");
+		}
 	}
 
-	delete _src;
-	_src = 0;
-
-	return true;
+	flush(false);
+	return _total == outsize;
 }
 
-void FileExpander::generateTables(uint8 srcIndex, uint8 dstIndex, uint8 dstIndex2, int cnt) {
-	const uint8 *tbl1 = _tables[srcIndex];
-	uint8 *tbl2 = _tables[dstIndex];
-	uint8 *tbl3 = dstIndex2 == 0xff ? 0 : _tables[dstIndex2];
-
-	if (!cnt)
-		return;
-
-	const uint8 *s = tbl1;
-	memset(_tables16[0], 0, 32);
-
-	for (int i = 0; i < cnt; i++)
-		_tables16[0][(*s++)]++;
+void FileExpander::readDynamicTables(FileExpanderSource &src) {
+	static const uint8 indexTable[] = {
+		0x10, 0x11, 0x12, 0x00, 0x08, 0x07, 0x09, 0x06, 0x0A,
+		0x05, 0x0B, 0x04, 0x0C, 0x03, 0x0D, 0x02, 0x0E, 0x01, 0x0F
+	};
 
-	_tables16[1][1] = 0;
+	src.refill();
+	int tableSize0 = src.getBits(5) + 257;
+	int tableSize1 = src.getBits(5) + 1;
+	int numbytes = src.getBits(4) + 4;
 
-	for (uint16 i = 1, r = 0; i < 16; i++) {
-		r = (r + _tables16[0][i]) << 1;
-		_tables16[1][i + 1] = r;
+	uint8 lengths[320];
+	memset(lengths, 0, 19);
+	for (int i = 0; i < numbytes; i++) {
+		src.refill();
+		lengths[indexTable[i]] = (uint8)src.getBits(3);
 	}
+	_tableCode.generate(lengths, 19);
 
-	if (_tables16[1][16]) {
-		uint16 r = 0;
-		for (uint16 i = 1; i < 16; i++)
-			r += _tables16[0][i];
-		if (r > 1)
-			error("decompression failure");
-	}
+	int cnt = tableSize0 + tableSize1;
+	for (int i = 0; i < cnt;) {
+		src.refill();
+		uint16 cmd = _tableCode.decode(src);
 
-	s = tbl1;
-	uint16 *d = _tables16[2];
-	for (int i = 0; i < cnt; i++) {
-		uint16 t = *s++;
-		if (t) {
-			_tables16[1][t]++;
-			t = _tables16[1][t] - 1;
+		if (cmd < 16) {
+			lengths[i++] = (uint8)cmd;
+			continue;
 		}
-		*d++ = t;
-	}
 
-	s = tbl1;
-	d = _tables16[2];
-	for (int i = 0; i < cnt; i++) {
-		int8 t = ((int8)(*s++)) - 1;
-		if (t > 0) {
-			uint16 v1 = *d;
-			uint16 v2 = 0;
-
-			do {
-				v2 = (v2 << 1) | (v1 & 1);
-				v1 >>= 1;
-			} while (--t && v1);
-
-			t++;
-			uint8 c1 = (v1 & 1);
-			while (t--) {
-				uint8 c2 = v2 >> 15;
-				v2 = (v2 << 1) | c1;
-				c1 = c2;
-			};
-
-			*d++ = v2;
+		uint8 value = 0;
+		int repeat;
+		if (cmd == 16) {
+			if (!i)
+				error("decompression failure");
+			value = lengths[i - 1];
+			repeat = src.getBits(2) + 3;
+		} else if (cmd == 17) {
+			repeat = src.getBits(3) + 3;
 		} else {
-			d++;
+			repeat = src.getBits(7) + 11;
 		}
-	}
 
-	memset((void*) tbl2, 0, 512);
+		if (i + repeat > cnt)
+			error("decompression failure");
+		memset(lengths + i, value, repeat);
+		i += repeat;
+	}
 
-	cnt--;
-	s = tbl1 + cnt;
-	d = &_tables16[2][cnt];
-	uint16 * bt = (uint16*) tbl3;
-	uint16 inc = 0;
-	uint16 cnt2 = 0;
+	_dynLengthCode.generate(lengths, tableSize0);
+	_dynOffsetCode.generate(lengths + tableSize0, tableSize1);
+}
 
-	do {
-		uint8 t = *s--;
-		uint16 *s2 = (uint16*) tbl2;
+void FileExpander::expandBlock(FileExpanderSource &src, const FileExpanderCode &lengthCode, const FileExpanderCode &offsetCode, uint32 outsize) {
+	static const uint16 lengthBase[] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	static const uint8 lengthBits[] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	static const uint16 offsetBase[] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	static const uint8 offsetBits[] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
 
-		if (t && t < 9) {
-			inc = 1 << t;
-			uint16 o = *d;
+	for (;;) {
+		if (_pos >= 2 * kWindowSize)
+			flush(true);
 
-			do {
-				s2[o] = cnt;
-				o += inc;
-			} while (!(o & 0xf00));
+		// A length and an offset with their extra bits take at most 48 bits
+		src.refill();
+		uint16 cmd = lengthCode.decode(src);
 
-		} else if (t > 8) {
-			if (!bt)
+		if (cmd < 0x100) {
+			if (_total == outsize)
 				error("decompression failure");
+			_buffer[_pos++] = (uint8)cmd;
+			_total++;
+			continue;
+		}
 
-			t -= 8;
-			uint8 shiftCnt = 1;
-			uint8 v = (*d) >> 8;
-			s2 = &((uint16*) tbl2)[*d & 0xff];
+		if (cmd == 0x100)
+			return;
 
-			do {
-				if (!*s2) {
-					*s2 = (uint16)(~cnt2);
-					*(uint32*)&bt[cnt2] = 0;
-					cnt2 += 2;
-				}
+		cmd -= 0x101;
+		if (cmd >= ARRAYSIZE(lengthBase))
+			error("decompression failure");
+		uint32 length = lengthBase[cmd] + src.getBits(lengthBits[cmd]);
 
-				s2 = &bt[(uint16)(~*s2)];
-				if (v & shiftCnt)
-					s2++;
+		uint16 offsetCmd = offsetCode.decode(src);
+		if (offsetCmd >= ARRAYSIZE(offsetBase))
+			error("decompression failure");
+		uint32 offset = offsetBase[offsetCmd] + src.getBits(offsetBits[offsetCmd]);
+
+		if (offset > _pos || length > outsize - _total)
+			error("decompression failure");
 
-				shiftCnt <<= 1;
-			} while (--t);
-			*s2 = cnt;
+		uint8 *d = _buffer + _pos;
+		const uint8 *s = d - offset;
+		if (offset >= length) {
+			memcpy(d, s, length);
+		} else {
+			for (uint32 i = 0; i < length; i++)
+				d[i] = s[i];
 		}
-		d--;
-	} while (--cnt >= 0);
+		_pos += length;
+		_total += length;
+	}
 }
 
-uint8 FileExpander::calcCmdAndIndex(const uint8 *tbl, int16 &para) {
-	const uint16 *t = (const uint16*)tbl;
-	_src->advSrcBitsByIndex(8);
-	uint8 newIndex = 0;
-	uint16 v = _src->getKeyLower();
+void FileExpander::flush(bool slide) {
+	if (_pos > _flushed && fwrite(_buffer + _flushed, 1, _pos - _flushed, _dst) != _pos - _flushed)
+		error("couldn't write the expanded file");
+	_flushed = _pos;
 
-	do {
-		newIndex++;
-		para = t[((~para) & 0xfffe) | (v & 1)];
-		v >>= 1;
-	} while (para < 0);
-
-	return newIndex;
+	if (slide && _pos > kWindowSize) {
+		// Keep the last window, which later matches may refer to
+		memmove(_buffer, _buffer + _pos - kWindowSize, kWindowSize);
+		_pos = _flushed = kWindowSize;
+	}
 }
 
-HoFInstaller::HoFInstaller(const char *baseFilename) : _list(0), _files(0) {
+HoFInstaller::HoFInstaller(const char *baseFilename) : _list(0), _files(0), _expander(new FileExpander) {
 	strncpy(_baseFilename, baseFilename, sizeof(_baseFilename));
 	char *str = strstr(_baseFilename, ".");
 	if (str) {
@@ -519,11 +501,8 @@ HoFInstaller::HoFInstaller(const char *baseFilename) : _list(0), _files(0) {
 		}
 	}
 
-	FileExpander exp;
 	uint32 insize = 0;
 	uint32 outsize = 0;
-	uint8 *inbuffer = 0;
-	uint8 *outbuffer = 0;
 	uint32 inPart1 = 0;
 	uint32 inPart2 = 0;
 	char entryStr[64];
@@ -541,6 +520,7 @@ HoFInstaller::HoFInstaller(const char *baseFilename) : _list(0), _files(0) {
 			snprintf(filename, 64, "%s%03d", _baseFilename, i);
 
 			Common::File file(filename, "rb");
+			const std::string volumeName = filename;
 
 			uint32 size = (i == a->lastFile) ? a->endOffset : file.size();
 
@@ -553,25 +533,9 @@ HoFInstaller::HoFInstaller(const char *baseFilename) : _list(0), _files(0) {
 				}
 			} else {
 				if (inPart2) {
-					file.seek(1, SEEK_SET);
-					file.read_throwsOnError(inbuffer + inPart1, inPart2);
+					Entry::Part part = { volumeName, 1, inPart2 };
+					_entries.back().parts.push_back(part);
 					inPart2 = 0;
-					exp.process(outbuffer, inbuffer, outsize, insize);
-					delete[] inbuffer;
-					inbuffer = 0;
-
-					FileList *newEntry = new FileList;
-					assert(newEntry);
-					newEntry->filename = new char[strlen(entryStr)+1];
-					assert(newEntry->filename);
-					strncpy(newEntry->filename, entryStr, strlen(entryStr)+1);
-					newEntry->size = outsize;
-					newEntry->data = outbuffer;
-
-					if (_files)
-						_files->addEntry(newEntry);
-					else
-						_files = newEntry;
 				}
 				pos++;
 			}
@@ -618,39 +582,34 @@ HoFInstaller::HoFInstaller(const char *baseFilename) : _list(0), _files(0) {
 					pos += (kHeaderSize + filestrlen - m);
 					file.seek(pos, SEEK_SET);
 
-					outbuffer = new uint8[outsize];
-					assert(outbuffer);
+					// The files are only listed here, and expanded when they are output
+					FileList *newEntry = new FileList;
+					assert(newEntry);
+					newEntry->filename = new char[strlen(entryStr)+1];
+					assert(newEntry->filename);
+					strncpy(newEntry->filename, entryStr, strlen(entryStr)+1);
+					newEntry->size = outsize;
 
-					if (!inbuffer) {
-						inbuffer = new uint8[insize];
-						assert(inbuffer);
-					}
+					if (_files)
+						_files->addEntry(newEntry);
+					else
+						_files = newEntry;
+
+					_entries.push_back(Entry());
+					Entry &entry = _entries.back();
+					entry.file = newEntry;
+					entry.compressedSize = insize;
 
 					if ((pos + insize) > size) {
 						// this is for files that are split between two archive files
 						inPart1 = size - pos;
 						inPart2 = insize - inPart1;
-						file.read_throwsOnError(inbuffer, inPart1);
 					} else {
-						file.read_throwsOnError(inbuffer, insize);
+						inPart1 = insize;
 						inPart2 = 0;
-						exp.process(outbuffer, inbuffer, outsize, insize);
-						delete[] inbuffer;
-						inbuffer = 0;
-
-						FileList *newEntry = new FileList;
-						assert(newEntry);
-						newEntry->filename = new char[strlen(entryStr)+1];
-						assert(newEntry->filename);
-						strncpy(newEntry->filename, entryStr, strlen(entryStr)+1);
-						newEntry->size = outsize;
-						newEntry->data = outbuffer;
-
-						if (_files)
-							_files->addEntry(newEntry);
-						else
-							_files = newEntry;
 					}
+					Entry::Part part = { volumeName, pos, inPart1 };
+					entry.parts.push_back(part);
 
 					pos += insize;
 					if (pos > size) {
@@ -666,3 +625,54 @@ HoFInstaller::HoFInstaller(const char *baseFilename) : _list(0), _files(0) {
 	}
 }
 
+HoFInstaller::~HoFInstaller() {
+	delete _list;
+	delete _files;
+	delete _expander;
+}
+
+bool HoFInstaller::outputAllFiles(Common::Filename *outputPath) {
+	for (size_t i = 0; i < _entries.size(); i++) {
+		outputPath->setFullName(_entries[i].file->filename);
+		printf("Extracting file '%s'...", _entries[i].file->filename);
+		if (expandEntry(_entries[i], outputPath->getFullPath().c_str())) {
+			printf("OK\n");
+		} else {
+			printf("FAILED\n");
+			return false;
+		}
+	}
+	return true;
+}
+
+bool HoFInstaller::outputFileAs(const char *file, const char *outputName) {
+	for (size_t i = 0; i < _entries.size(); i++) {
+		if (scumm_stricmp(_entries[i].file->filename, file) == 0)
+			return expandEntry(_entries[i], outputName);
+	}
+
+	error("file '%s' not found", file);
+	return false;
+}
+
+bool HoFInstaller::expandEntry(const Entry &entry, const char *outputName) {
+	std::vector<uint8> inbuffer(entry.compressedSize + 1);
+	uint32 size = 0;
+	for (size_t i = 0; i < entry.parts.size(); i++) {
+		Common::File file(entry.parts[i].filename, "rb");
+		file.seek(entry.parts[i].offset, SEEK_SET);
+		file.read_throwsOnError(&inbuffer[size], entry.parts[i].size);
+		size += entry.parts[i].size;
+	}
+
+	FILE *out = fopen(outputName, "wb");
+	if (!out) {
+		error("couldn't open file '%s' for writing", outputName);
+		return false;
+	}
+
+	bool success = _expander->process(out, &inbuffer[0], entry.file->size, size);
+	if (fclose(out) != 0)
+		success = false;
+	return success;
+}
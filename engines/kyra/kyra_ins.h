@@ -24,15 +24,42 @@
 
 #include "extract_kyra.h"
 
+#include <string>
+#include <vector>
+
+class FileExpander;
+
 class HoFInstaller : public Extractor {
 public:
 	HoFInstaller(const char *baseFilename);
-	~HoFInstaller() { delete _list; delete _files; }
+	~HoFInstaller();
 
 	cFileList *getFileList() const { return _files; }
+
+	/** Expands the files straight to disk, as the file list holds no data. */
+	bool outputAllFiles(Common::Filename *outputPath);
+	bool outputFileAs(const char *file, const char *outputName);
 private:
 	char _baseFilename[1024];
 
+	/** Where the compressed data of a file is, in one or two archive files. */
+	struct Entry {
+		struct Part {
+			std::string filename;
+			uint32 offset;
+			uint32 size;
+		};
+
+		const FileList *file;
+		uint32 compressedSize;
+		std::vector<Part> parts;
+	};
+
+	bool expandEntry(const Entry &entry, const char *outputName);
+
+	std::vector<Entry> _entries;
+	FileExpander *_expander;
+
 	struct Archive {
 		Archive() : next(0), firstFile(0), startOffset(0), lastFile(0), endOffset(0), totalSize(0) { memset(filename, 0, sizeof(filename)); }
 		~Archive() { delete next; next = 0; }
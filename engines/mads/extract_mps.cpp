@@ -24,10 +24,16 @@
 #include "common/str.h"
 #include "common/util.h"
 #include "common/dcl.h"
+#include "common/parallel.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <thread>
+#include <vector>
 
 struct FileDescriptorBin {
 	char name[0x52]; // zero-terminated, rest is filled with what looks like garbage
@@ -38,21 +44,110 @@ struct FileDescriptorBin {
 	uint32 uncompressedSize;
 } __attribute__ ((packed));
 
+/** An entry of the index, and where its data starts. */
+struct Entry {
+	Common::String name;
+	uint16 compression;
+	int volume;
+	uint32 offset;
+	uint32 compressedSize;
+	uint32 uncompressedSize;
+};
+
+/** The entries whose data starts in one volume, in the order of the data. */
+struct VolumeGroup {
+	int volume;
+	std::vector<Entry> entries;
+};
+
+static bool compareOffsets(const Entry &a, const Entry &b) {
+	return a.offset < b.offset;
+}
+
+/**
+ * Extracts the entries of one volume. The volumes are kept open while the
+ * group is processed, as the data of an entry may continue in the next
+ * volume, and the buffers are reused for all the entries.
+ */
+static void extractGroup(const Common::String &base, const Common::String &outDir, const VolumeGroup &group,
+                         byte *compressedBuf, byte *uncompressedBuf) {
+	std::map<int, FILE *> volumes;
+
+	for (size_t i = 0; i < group.entries.size(); i++) {
+		const Entry &entry = group.entries[i];
+		int vol = entry.volume;
+		uint32 off = entry.offset;
+		byte *outptr = compressedBuf;
+		uint32 rem = entry.compressedSize;
+		while (rem > 0) {
+			FILE *&fvol = volumes[vol];
+			if (!fvol)
+				fvol = fopen((base + Common::String::format(".%03d", vol)).c_str(), "rb");
+			if (!fvol)
+				break;
+			fseek(fvol, off, SEEK_SET);
+			int actual = fread(outptr, 1, rem, fvol);
+			rem -= actual;
+			outptr += actual;
+			if (actual == 0)
+				break;
+			vol++;
+			off = 0;
+		}
+
+		const byte *data = compressedBuf;
+		uint32 size = entry.compressedSize;
+		if (entry.compression == 1) {
+			Common::MemoryReadStream compressedReadStream(compressedBuf, entry.compressedSize - rem);
+			if (!Common::decompressDCL(&compressedReadStream, uncompressedBuf, entry.compressedSize - rem, entry.uncompressedSize)) {
+				fprintf (stderr, "Unable to decompress %s\n", entry.name.c_str());
+				continue;
+			}
+			data = uncompressedBuf;
+			size = entry.uncompressedSize;
+		}
+
+		Common::String fn = Common::String::format("%s/%s", outDir.c_str(), entry.name.c_str());
+		FILE *fout = fopen(fn.c_str(), "wb");
+		if (fout == NULL)
+			throw std::runtime_error(Common::String::format("Unable to open %s: %s", fn.c_str(), strerror(errno)).c_str());
+		fwrite(data, 1, size, fout);
+		fclose(fout);
+	}
+
+	for (std::map<int, FILE *>::iterator it = volumes.begin(); it != volumes.end(); ++it)
+		if (it->second)
+			fclose(it->second);
+}
+
 int main (int argc, char **argv) {
 	unsigned char * buf;
 	size_t indexSize;
 	FILE *fin;
+	unsigned int jobs = MAX(std::thread::hardware_concurrency(), 1U);
+	int arg = 1;
 
-	if (argc < 3) {
-		fprintf (stderr, "USAGE: %s BASENAME OUTDIR\n", argv[0]);
+	if (arg + 1 < argc && strcmp(argv[arg], "--jobs") == 0) {
+		char *end;
+		long value = strtol(argv[arg + 1], &end, 10);
+		if (*argv[arg + 1] == '\0' || *end != '\0' || value < 1) {
+			fprintf (stderr, "The number of jobs must be a positive integer, not '%s'\n", argv[arg + 1]);
+			return -1;
+		}
+		jobs = (unsigned int)value;
+		arg += 2;
+	}
+
+	if (argc - arg < 2) {
+		fprintf (stderr, "USAGE: %s [--jobs N] BASENAME OUTDIR\n", argv[0]);
 		return -1;
 	}
 
-	Common::String base = argv[1];
+	Common::String base = argv[arg];
 
 	fin = fopen ((base + ".IDX").c_str(), "rb");
 	if (fin == NULL) {
-		fprintf (stderr, "Unable to open %s: %s\n", argv[1], strerror(errno));
+		fprintf (stderr, "Unable to open %s: %s\n", argv[arg], strerror(errno));
 		return -2;
 	}
 	fseek (fin, 0, SEEK_END);
@@ -74,63 +169,56 @@ int main (int argc, char **argv) {
 	if (filecnt > (indexSize - 12) / sizeof(FileDescriptorBin))
 		filecnt = (indexSize - 12) / sizeof(FileDescriptorBin);
 
+	// Group the entries by the volume holding the start of their data, so
+	// that every volume is read sequentially by a single worker
+	std::map<int, size_t> groupIndex;
+	std::vector<VolumeGroup> groups;
+	uint32 maxCompressedSize = 0, maxUncompressedSize = 0;
+
 	for (ptr = buf + 12, i = 0; i < filecnt; ptr += sizeof(FileDescriptorBin), i++) {
 		FileDescriptorBin *descBin = (FileDescriptorBin *) ptr;
-		uint32 compressedSize = FROM_LE_32(descBin->compressedSize);
-		uint32 uncompressedSize = FROM_LE_32(descBin->uncompressedSize);
-		uint16 compressionAlgo = FROM_LE_16(descBin->compression);
+		Entry entry;
+		entry.compressedSize = FROM_LE_32(descBin->compressedSize);
+		entry.uncompressedSize = FROM_LE_32(descBin->uncompressedSize);
+		entry.compression = FROM_LE_16(descBin->compression);
+		entry.offset = FROM_LE_32(descBin->offset_in_volume);
+		entry.volume = FROM_LE_16(descBin->volume);
 		printf("name: %s, compressed=%d, uncompressed=%d, compression=%d, offset=%x, volume = %03d\n",
-		       descBin->name, compressedSize,
-		       uncompressedSize, compressionAlgo, FROM_LE_32(descBin->offset_in_volume), FROM_LE_16(descBin->volume));
-		if (compressionAlgo != 0 && compressionAlgo != 1) {
+		       descBin->name, entry.compressedSize,
+		       entry.uncompressedSize, entry.compression, entry.offset, entry.volume);
+		if (entry.compression != 0 && entry.compression != 1) {
 			fprintf (stderr, "Unsupported compression alorithm for %s, skipping\n", descBin->name);
 			continue;
 		}
-		Common::String fn = Common::String::format("%s/%s", argv[2], descBin->name);
-		uint32 off = FROM_LE_32(descBin->offset_in_volume);
-		int vol = FROM_LE_16(descBin->volume);
-		byte *compressedBuf = new byte[compressedSize];
-		byte *outptr = compressedBuf;
-		uint32 rem = compressedSize;
-		while (rem > 0) {
-			FILE *fvol = fopen((base + Common::String::format(".%03d", vol)).c_str(), "rb");
-			fseek(fvol, off, SEEK_SET);
-			int actual = fread(outptr, 1, rem, fvol);
-			fclose(fvol);
-			rem -= actual;
-			outptr += actual;
-			if (actual == 0)
-				break;
-			vol++;
-			off = 0;
-		}
-		byte *uncompressedBuf;
-		switch (compressionAlgo) {
-		case 0:
-			uncompressedBuf = compressedBuf;
-			uncompressedSize = compressedSize;
-			break;
-		case 1:
-			Common::MemoryReadStream compressedReadStream(compressedBuf, compressedSize);
-			uncompressedBuf = new byte[uncompressedSize];
-			if (!Common::decompressDCL(&compressedReadStream, uncompressedBuf, compressedSize, uncompressedSize)) {
-				fprintf (stderr, "Unable to decompress %s\n", descBin->name);
-				continue;
-			}
-				
-			break;
-		}
-		FILE *fout;
-		fout = fopen(fn.c_str(), "wb");
-		if (fout == NULL) {
-			fprintf (stderr, "Unable to open %s: %s\n", fn.c_str(), strerror(errno));
-			return -3;
+		entry.name = Common::String(descBin->name, strnlen(descBin->name, sizeof(descBin->name)));
+
+		maxCompressedSize = MAX(maxCompressedSize, entry.compressedSize);
+		if (entry.compression == 1)
+			maxUncompressedSize = MAX(maxUncompressedSize, entry.uncompressedSize);
+
+		std::map<int, size_t>::iterator group = groupIndex.find(entry.volume);
+		if (group == groupIndex.end()) {
+			group = groupIndex.insert(std::make_pair(entry.volume, groups.size())).first;
+			groups.push_back(VolumeGroup());
+			groups.back().volume = entry.volume;
 		}
-		fwrite(uncompressedBuf, 1, uncompressedSize, fout);
-		fclose(fout);
-		if (uncompressedBuf != compressedBuf)
-			delete[] uncompressedBuf;
-		delete[]compressedBuf;
+		groups[group->second].entries.push_back(entry);
+	}
+	free(buf);
+
+	for (size_t g = 0; g < groups.size(); g++)
+		std::stable_sort(groups[g].entries.begin(), groups[g].entries.end(), compareOffsets);
+
+	try {
+		parallelFor(groups.size(), jobs, [&](size_t g) {
+			// Buffers large enough for any entry, reused for the whole volume
+			std::vector<byte> compressed(MAX<uint32>(maxCompressedSize, 1));
+			std::vector<byte> uncompressed(MAX<uint32>(maxUncompressedSize, 1));
+			extractGroup(base, argv[arg + 1], groups[g], &compressed[0], &uncompressed[0]);
+		});
+	} catch (const std::exception &e) {
+		fprintf (stderr, "%s\n", e.what());
+		return -3;
 	}
 
 	return 0;
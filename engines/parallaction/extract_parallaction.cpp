@@ -325,11 +325,16 @@ void ExtractParallaction::execute() {
 		outpath.setFullPath("out/");
 
 	Archive arc(*this);
-	arc.open(inpath.getFullPath().c_str(), _small);
+	{
+		ToolPhase phase(*this, "scan");
+		arc.open(inpath.getFullPath().c_str(), _small);
+	}
 
 	for (uint32 i = 0; i < arc._numFiles; i++) {
 
+		beginPhase("decode");
 		arc.openSubfile(i);
+		endPhase();
 
 		char filename[260], * d = filename;
 
@@ -339,8 +344,11 @@ void ExtractParallaction::execute() {
 
 		outpath.setFullName(filename);
 
+		ToolPhase phase(*this, "write");
 		Common::File ofile(outpath, "wb");
 		ofile.write(arc._fileData, arc._fileSize);
+		addProcessedBytes(arc._fileSize);
+		addProcessedItems();
 	}
 }
 
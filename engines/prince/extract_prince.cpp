@@ -163,6 +163,10 @@ void ExtractPrince::execute() {
 }
 
 InspectionMatch ExtractPrince::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch ExtractPrince::inspectFilename(const Common::Filename &filename) {
 	if (!filename.directory())
 		return IMATCH_AWFUL;
 
@@ -196,7 +200,10 @@ FileData ExtractPrince::loadFile(const std::string &fileName) {
 }
 
 void ExtractPrince::exportMobs(FileData fileData) {
+	ToolPhase phase(*this, "write");
 	if (fileData._fileTable != 0) {
+		addProcessedBytes(fileData._size);
+		addProcessedItems();
 		const int kMobsStructSize = 32;
 		const int kMobsTextOffsetsPos = 24;
 		int streamPos = 0;
@@ -257,7 +264,10 @@ void ExtractPrince::exportMobs(FileData fileData) {
 }
 
 void ExtractPrince::exportVariaTxt(FileData fileData) {
+	ToolPhase phase(*this, "write");
 	if (fileData._fileTable != 0) {
+		addProcessedBytes(fileData._size);
+		addProcessedItems();
 		_outputPath.setFullName("variatxt.txt");
 		_fFiles.open(_outputPath, "w");
 		if (!_fFiles.isOpen()) {
@@ -294,7 +304,10 @@ void ExtractPrince::exportVariaTxt(FileData fileData) {
 }
 
 void ExtractPrince::exportInvTxt(FileData fileData) {
+	ToolPhase phase(*this, "write");
 	if (fileData._fileTable != 0) {
+		addProcessedBytes(fileData._size);
+		addProcessedItems();
 		std::string itemName, itemExamText;
 		const int kItems = 100;
 		_outputPath.setFullName("invtxt.txt");
@@ -338,7 +351,10 @@ void ExtractPrince::exportInvTxt(FileData fileData) {
 }
 
 void ExtractPrince::exportCredits(FileData fileData) {
+	ToolPhase phase(*this, "write");
 	if (fileData._fileTable != 0) {
+		addProcessedBytes(fileData._size);
+		addProcessedItems();
 		_outputPath.setFullName("credits.txt");
 		_fFiles.open(_outputPath, "w");
 		if (!_fFiles.isOpen()) {
@@ -371,7 +387,10 @@ void ExtractPrince::exportCredits(FileData fileData) {
 }
 
 void ExtractPrince::exportTalkTxt(FileData fileData) {
+	ToolPhase phase(*this, "write");
 	if (fileData._fileTable != 0) {
+		addProcessedBytes(fileData._size);
+		addProcessedItems();
 		_outputPath.setFullName("talktxt.txt");
 		_fFiles.open(_outputPath, "w");
 		if (!_fFiles.isOpen()) {
@@ -36,6 +36,8 @@ public:
 
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+
 protected:
 	FileData loadFile(const std::string &fileName);
 	char correctPolishLetter(char c);
@@ -147,6 +147,10 @@ void PackPrince::execute() {
 }
 
 InspectionMatch PackPrince::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch PackPrince::inspectFilename(const Common::Filename &filename) {
 	if (!filename.directory())
 		return IMATCH_AWFUL;
 
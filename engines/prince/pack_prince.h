@@ -33,6 +33,8 @@ public:
 
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+
 protected:
 	struct FileEntry {
 		uint32 _offset;
@@ -24,18 +24,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <map>
 
 #include "compress.h"
 #include "compress_saga.h"
-#include "common/md5.h"
+#include "common/file_hash.h"
 #include "common/file.h"
+#include "common/str.h"
 #include "common/util.h"
 #include "sound/audiostream.h"
 #include "sound/voc.h"
 #include "sound/wave.h"
 #include "sound/adpcm.h"
 
-#define FILE_MD5_BYTES 5000
 #define RSC_TABLEINFO_SIZE 8
 #define RSC_TABLEENTRY_SIZE 8
 #define HEADER_SIZE 9
@@ -141,7 +142,8 @@ bool CompressSaga::detectFile(const Common::Filename *infile) {
 	uint8 md5sum[16];
 	char md5str[32+1];
 
-	Common::md5_file(infile->getFullPath().c_str(), md5sum, FILE_MD5_BYTES);
+	if (!Common::FileHashCache::instance().md5(infile->getFullPath(), Common::kDetectionHashSize, md5sum))
+		return false;
 	print("Input file name: %s", infile->getFullPath().c_str());
 	for (j = 0; j < 16; j++) {
 		sprintf(md5str + j*2, "%02x", (int)md5sum[j]);
@@ -241,7 +243,6 @@ void CompressSaga::writeHeader(Common::File &outputFile) {
 
 uint32 CompressSaga::encodeEntry(Common::File &inputFile, uint32 inputSize, Common::File &outputFile) {
 	uint8 *inputData = 0;
-	byte *buffer = 0;
 	int rate, size;
 	byte flags;
 
@@ -297,16 +298,10 @@ uint32 CompressSaga::encodeEntry(Common::File &inputFile, uint32 inputSize, Comm
 		_sampleStereo = _currentFileDescription->stereo;
 		writeHeader(outputFile);
 
-		Audio::AudioStream *voxStream = Audio::makeADPCMStream(&inputFile, inputSize, Audio::kADPCMOki);
-		buffer = (byte *)malloc(_sampleSize);
-		uint32 voxSize = voxStream->readBuffer((int16*)buffer, inputSize * 2);
-		if (voxSize != inputSize * 2)
-			error("Wrong VOX output size");
-		writeBufferToFile((uint8 *)buffer, _sampleSize, TEMP_RAW);
-		free(buffer);
-
-		setRawAudioType( !_currentFileDescription->swapEndian, _sampleStereo != 0, _sampleBits);
-		encodeAudio(TEMP_RAW, true, _sampleRate, tempEncoded, _format);
+		Audio::AudioStream *voxStream = Audio::makeADPCMStream(&inputFile, inputSize, Audio::kADPCMOki, _sampleRate, 1);
+		std::string sourceKey = Common::String::format("oki:%d:", _sampleRate).c_str() + hashFileRegion(inputFile, inputSize);
+		encodeAudioStream(*voxStream, sourceKey, tempEncoded, _format);
+		delete voxStream;
 		return copyFile(tempEncoded, outputFile) + HEADER_SIZE;
 	}
 	if (_currentFileDescription->resourceType == kSoundMacPCM) {
@@ -329,7 +324,7 @@ uint32 CompressSaga::encodeEntry(Common::File &inputFile, uint32 inputSize, Comm
 		*/
 	}
 
-	error("Unsupported resourceType %ul\n", _currentFileDescription->resourceType);
+	error("Unsupported resourceType %u\n", _currentFileDescription->resourceType);
 	// Never reached
 	return 0;
 }
@@ -344,10 +339,11 @@ void CompressSaga::sagaEncode(Common::Filename *inpath, Common::Filename *outpat
 
 	Record *inputTable;
 	Record *outputTable;
+	std::map<std::string, uint32> encodedRecords;
 
 	inputFile.open(*inpath, "rb");
 	inputFileSize = inputFile.size();
-	print("Filesize: %ul", inputFileSize);
+	print("Filesize: %u", inputFileSize);
 	/*
 	 * At the end of the resource file there are 2 values: one points to the
 	 * beginning of the resource table the other gives the number of
@@ -363,7 +359,7 @@ void CompressSaga::sagaEncode(Common::Filename *inpath, Common::Filename *outpat
 		resTableCount = inputFile.readUint32BE();
 	}
 
-	print("Table offset: %ul\nnumber of records: %ul", resTableOffset, resTableCount);
+	print("Table offset: %u\nnumber of records: %u", resTableOffset, resTableCount);
 	if (resTableOffset != inputFileSize - RSC_TABLEINFO_SIZE - RSC_TABLEENTRY_SIZE * resTableCount) {
 		error("Something's wrong with your resource file");
 	}
@@ -384,7 +380,7 @@ void CompressSaga::sagaEncode(Common::Filename *inpath, Common::Filename *outpat
 			inputTable[i].size = inputFile.readUint32BE();
 		}
 
-		print("Record: %ul, offset: %ul, size: %ul", i, inputTable[i].offset, inputTable[i].size);
+		print("Record: %u, offset: %u, size: %u", i, inputTable[i].offset, inputTable[i].size);
 
 		if ((inputTable[i].offset > inputFileSize) ||
 			(inputTable[i].offset + inputTable[i].size > inputFileSize)) {
@@ -408,7 +404,16 @@ void CompressSaga::sagaEncode(Common::Filename *inpath, Common::Filename *outpat
 		outputTable[i].offset = outputFile.pos();
 
 		if (inputTable[i].size >= 8) {
-			outputTable[i].size = encodeEntry(inputFile, inputTable[i].size, outputFile);
+			// Records holding the same sound share their encoded data
+			std::string recordHash = hashFileRegion(inputFile, inputTable[i].size);
+			std::map<std::string, uint32>::const_iterator encoded = encodedRecords.find(recordHash);
+			if (encoded != encodedRecords.end()) {
+				print("Record %u is the same as record %u", i, encoded->second);
+				outputTable[i] = outputTable[encoded->second];
+			} else {
+				encodedRecords[recordHash] = i;
+				outputTable[i].size = encodeEntry(inputFile, inputTable[i].size, outputFile);
+			}
 		} else {
 			outputTable[i].size = inputTable[i].size;	// Empty sound resource
 		}
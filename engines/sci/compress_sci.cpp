@@ -21,10 +21,13 @@
 
 /* resource.aud/resource.sfx compressor */
 
+#include <assert.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #include "compress.h"
 #include "common/endian.h"
+#include "common/parallel.h"
 
 #include "sound/audiostream.h"
 #include "sound/wave.h"
@@ -45,9 +48,6 @@
 //  the samples, because SCI32 used a different scheme for decoding. I don't know yet how to detect SCI32 games easily
 //  without having resourcemanager.
 
-#define TEMP_RAW "tempfile.raw"
-#define TEMP_ENC "tempfile.enc"
-
 CompressSci::CompressSci(const std::string &name) : CompressionTool(name, TOOLTYPE_COMPRESSION) {
 	_supportsProgressBar = true;
 
@@ -58,11 +58,16 @@ CompressSci::CompressSci(const std::string &name) : CompressionTool(name, TOOLTY
 	_outputToDirectory = false;
 
 	_shorthelp = "Used to compress Sierra resource.aud/.sfx and AUDIO001.002 files. (NOT SCI32 compatible!)";
-	_helptext = "\nUsage: " + getName() + " [mode-params] [-o outputname] <inputname>\n";
+	_helptext = "\nUsage: " + getName() + " [mode-params] [--jobs <n>] [-o outputname] <inputname>\n"
+		" --jobs <n>   encode up to <n> samples at once (default: one per CPU core)\n";
+}
+
+void CompressSci::parseExtraArguments() {
+	parseJobsArguments();
 }
 
 // header is first 6 bytes read from file
-SciResourceDataType CompressSci::detectData(byte *header, bool compressMode) {
+SciResourceDataType CompressSci::detectData(byte *header) {
 	uint32 dataSize;
 	if (_rawAudio) {
 		// File is a raw audio file
@@ -130,8 +135,7 @@ SciResourceDataType CompressSci::detectData(byte *header, bool compressMode) {
 	//  lip-sync data w/o the actual sync data
 	if (!searchForward) {
 		searchForward = 2048;
-		if (!compressMode)
-			warning("possibly raw lipsync data found at offset %lx", _input.pos());
+		warning("possibly raw lipsync data found at offset %lx", _input.pos());
 		noSignature = true;
 	}
 
@@ -185,143 +189,226 @@ template<typename T> inline T CLIP (T v, T amin, T amax) {
 		return v;
 }
 
-static void deDPCM16(byte *soundBuf, byte *inputBuf, uint32 n) {
-	int16 *out = (int16 *) soundBuf;
-
-	int32 s = 0;
-	for (uint32 i = 0; i < n; i++) {
-		byte b = *inputBuf++;
-		if (b & 0x80)
-			s -= tableDPCM16[b & 0x7f];
-		else
-			s += tableDPCM16[b];
+/**
+ * Decodes SOL DPCM data. The 8-bit variant packs two 4-bit deltas per byte,
+ * the 16-bit variant has one 8-bit delta per byte.
+ */
+class SolDPCMStream : public Audio::AudioStream {
+public:
+	SolDPCMStream(const byte *data, uint32 size, bool is16Bit, int rate)
+		: _pos(data), _end(data + size), _is16Bit(is16Bit), _rate(rate), _sample(is16Bit ? 0 : 0x80) {
+	}
 
-		s = CLIP<int32>(s, -32768, 32767);
-		*out++ = (uint16)s;
+	int readBuffer(int16 *buffer, const int numSamples) {
+		int samples = 0;
+		if (_is16Bit) {
+			for (; samples < numSamples && _pos < _end; samples++) {
+				byte b = *_pos++;
+				if (b & 0x80)
+					_sample -= tableDPCM16[b & 0x7f];
+				else
+					_sample += tableDPCM16[b];
+				_sample = CLIP<int32>(_sample, -32768, 32767);
+				buffer[samples] = (int16)_sample;
+			}
+		} else {
+			assert(numSamples % 2 == 0);
+			for (; samples < numSamples && _pos < _end; samples += 2) {
+				byte b = *_pos++;
+				buffer[samples] = decodeNibble(b >> 4);
+				buffer[samples + 1] = decodeNibble(b & 0xf);
+			}
+		}
+		return samples;
 	}
-}
 
-static void deDPCM8Nibble(byte *soundBuf, int32 &s, byte b) {
-	if (b & 8) {
+	bool isStereo() const { return false; }
+	bool endOfData() const { return _pos == _end; }
+	int getRate() const { return _rate; }
+
+private:
+	/** Decodes an 8-bit sample, and converts it to 16 bits. */
+	int16 decodeNibble(byte b) {
+		if (b & 8) {
 // TODO: Can't include it currently because i have yet no idea how to identifiy sci2.1+ easily
 // #ifdef ENABLE_SCI32
-// 		// SCI2.1 reverses the order of the table values here
-// 		if (getSciVersion() >= SCI_VERSION_2_1)
-// 			s -= tableDPCM8[b & 7];
-// 		else
+// 			// SCI2.1 reverses the order of the table values here
+// 			if (getSciVersion() >= SCI_VERSION_2_1)
+// 				_sample -= tableDPCM8[b & 7];
+// 			else
 // #endif
-			s -= tableDPCM8[7 - (b & 7)];
-	} else
-		s += tableDPCM8[b & 7];
-	s = CLIP<int32>(s, 0, 255);
-	*soundBuf = s;
-}
+				_sample -= tableDPCM8[7 - (b & 7)];
+		} else
+			_sample += tableDPCM8[b & 7];
+		_sample = CLIP<int32>(_sample, 0, 255);
+		return (int16)((_sample - 0x80) << 8);
+	}
 
-static void deDPCM8(byte *soundBuf, byte *inputBuf, uint32 n) {
-	int32 s = 0x80;
+	const byte *_pos;
+	const byte *_end;
+	bool _is16Bit;
+	int _rate;
+	int32 _sample;
+};
 
-	for (uint i = 0; i < n; i++) {
-		byte b = *inputBuf++;
+/**
+ * A resource read from the input file: the samples to encode, or the data to
+ * copy as it is.
+ */
+struct CompressSci::Sample {
+	Sample() : rate(0), isStereo(false), bits(8), isDPCM(false), copy(false) {}
+
+	std::vector<byte> data;
+	/** The encoded samples, empty for a sample which is copied. */
+	std::string encoded;
+	int rate;
+	bool isStereo;
+	uint8 bits;
+	bool isDPCM;
+	bool copy;
+};
 
-		deDPCM8Nibble(soundBuf++, s, b >> 4);
-		deDPCM8Nibble(soundBuf++, s, b & 0xf);
+/**
+ * Decodes SOL DPCM data to signed 16-bit little endian samples, or to unsigned
+ * 8-bit samples for the 8-bit variant, so that they keep their bit depth.
+ */
+static void decodeSolDPCM(const std::vector<byte> &data, bool is16Bit, std::vector<byte> &pcm) {
+	const uint32 count = is16Bit ? data.size() : 2 * data.size();
+	std::vector<int16> samples(count);
+	pcm.resize(is16Bit ? 2 * count : count);
+	if (!count)
+		return;
+
+	SolDPCMStream stream(&data[0], data.size(), is16Bit, 0);
+	stream.readBuffer(&samples[0], count);
+	if (is16Bit) {
+		for (uint32 i = 0; i < count; i++)
+			WRITE_LE_UINT16(&pcm[2 * i], samples[i]);
+	} else {
+		for (uint32 i = 0; i < count; i++)
+			pcm[i] = (byte)((samples[i] >> 8) + 0x80);
 	}
 }
 
-// Will compress dataType at current offset in inputfile to outputfile using requested codec
-void CompressSci::compressData(SciResourceDataType dataType) {
-	int orgDataSize = _inputEndOffset - _inputOffset;
-	int newDataSize = 0;
-	byte *newData = 0;
+void CompressSci::scanResources() {
+	SciResource resource;
+	byte header[6];
+
+	_resources.clear();
+	_inputOffset = 0;
+	_input.seek(0, SEEK_SET);
+
+	if (_rawAudio) {
+		uint resourceCount = parseRawAudioMap();
+		for (uint resourceNo = 0; resourceNo < resourceCount; resourceNo++) {
+			resource.dataType = detectData(header);
+			resource.offset = _inputOffset;
+			resource.size = _inputEndOffset - _inputOffset;
+			_resources.push_back(resource);
+			// raw files are 0-padded to 2048 bytes
+			_inputOffset = (((_inputEndOffset - 1) >> 11) + 1) << 11;
+		}
+		return;
+	}
+
+	_input.read_throwsOnError(&header, 6);
+	do {
+		resource.dataType = detectData(header);
+		if (!resource.dataType)
+			error("Unsupported data at offset %lx", _inputOffset);
+		resource.offset = _inputOffset;
+		resource.size = _inputEndOffset - _inputOffset;
+		_resources.push_back(resource);
+
+		_input.seek(_inputEndOffset, SEEK_SET);
+		_inputOffset = _inputEndOffset;
+		// We abort even, if file position is one below size because of pharkas resource.sfx
+		if (_inputOffset >= _inputSize - 1)
+			break;
+
+		_input.read_throwsOnError(&header, 6);
+	} while (true);
+
+	// This case happens on pharkas resource.sfx
+	if (_inputOffset != _inputSize)
+		warning("resource file has additional byte before end-of-file");
+}
 
-	int sampleRate = 0;
-	byte *sampleData = 0;
+void CompressSci::readSample(const SciResource &resource, Sample &sample) {
 	int sampleDataSize = 0;
-	bool sampleIsStereo = false;
-	uint8 sampleBits = 8;
 	byte sampleFlags = 0;
 
-	switch (dataType) {
+	_inputOffset = resource.offset;
+	_input.seek(resource.offset, SEEK_SET);
+
+	switch (resource.dataType) {
 	case kSciResourceDataTypeWAVE:
 		print("WAVE found");
-		if (!Audio::loadWAVFromStream(_input, sampleDataSize, sampleRate, sampleFlags))
+		if (!Audio::loadWAVFromStream(_input, sampleDataSize, sample.rate, sampleFlags))
 			error("Unable to read WAV at offset %lx", _inputOffset);
 
-		sampleData = new byte[sampleDataSize];
-		_input.read_throwsOnError(sampleData, sampleDataSize);
 		if (sampleFlags & Audio::Mixer::FLAG_16BITS)
-			sampleBits = 16;
+			sample.bits = 16;
 		if (sampleFlags & Audio::Mixer::FLAG_STEREO)
-			sampleIsStereo = true;
+			sample.isStereo = true;
 		break;
 	case kSciResourceDataTypeSOL: {
 		_input.readByte();
 		byte headerSize = _input.readByte();
 		_input.readUint32LE(); // Skip over "SOL" 0x00
-		sampleRate = _input.readUint16LE();
+		sample.rate = _input.readUint16LE();
 		sampleFlags = _input.readByte();
 		sampleDataSize = _input.readUint32LE();
 		if (headerSize == 0x0C)
 			_input.readByte();
-		// Now we read SOL datastream
-		sampleData = new byte[sampleDataSize];
-		_input.read_throwsOnError(sampleData, sampleDataSize);
 
 		//bool dataUnsigned = false;
 		if (sampleFlags & 0x04)
-			sampleBits = 16;
+			sample.bits = 16;
 		//if (sampleFlags & 0x08)
 		//	dataUnsigned = true;
-		if (sampleFlags & 0x01) {
-			// SOL datastream is compressed, we need to uncompress it
-			byte *uncompressedData = new byte[sampleDataSize * 2];
-			if (sampleBits == 16)
-				deDPCM16(uncompressedData, sampleData, sampleDataSize);
-			else
-				deDPCM8(uncompressedData, sampleData, sampleDataSize);
-			delete[] sampleData;
-			sampleData = uncompressedData;
-			sampleDataSize *= 2;
-		}
+		// SOL datastream may be compressed, it is decoded before being encoded
+		sample.isDPCM = (sampleFlags & 0x01) != 0;
 		break;
 	}
 	case kSciResourceDataTypeRaw:
-		sampleRate = 11025;
+		sample.rate = 11025;
 		// No headers so just use the original data as sample data
-		sampleDataSize = orgDataSize;
-		sampleData = new byte[sampleDataSize];
-		_input.read_throwsOnError(sampleData, sampleDataSize);
+		sampleDataSize = resource.size;
 		break;
 	case kSciResourceTypeTypeSync:
 		print("SYNC found at %lx", _inputOffset);
 		// Simply copy original data over
-		newDataSize = orgDataSize;
-		newData = new byte[newDataSize];
-		_input.read_throwsOnError(newData, newDataSize);
+		sampleDataSize = resource.size;
+		sample.copy = true;
 		break;
 	default:
 		error("Unsupported datatype");
 	}
 
-	if (sampleData) {
-		// Write sample data to temporary raw file
-		Common::File tempfileRaw(TEMP_RAW, "wb");
-		tempfileRaw.write(sampleData, sampleDataSize);
-		tempfileRaw.close();
-		delete[] sampleData;
-		// Now compress temporary raw file
-		setRawAudioType(true, sampleIsStereo, sampleBits);
-		encodeAudio(TEMP_RAW, true, sampleRate, TEMP_ENC, _format);
-		// And copy encoded file into output-file
-		Common::File tempfileEnc(TEMP_ENC, "rb");
-		newDataSize = tempfileEnc.size();
-		newData = new byte[newDataSize];
-		tempfileEnc.read_throwsOnError(newData, newDataSize);
-		tempfileEnc.close();
+	sample.data.resize(sampleDataSize);
+	if (sampleDataSize)
+		_input.read_throwsOnError(&sample.data[0], sampleDataSize);
+}
+
+void CompressSci::encodeSample(Sample &sample) {
+	if (sample.copy)
+		return;
+
+	if (sample.isDPCM) {
+		// SOL datastream is compressed, we need to uncompress it
+		ToolPhase phase(*this, "decode");
+		std::vector<byte> pcm;
+		decodeSolDPCM(sample.data, sample.bits == 16, pcm);
+		sample.data.swap(pcm);
+		addProcessedBytes(sample.data.size());
+		addProcessedItems();
 	}
 
-	_output.write(newData, newDataSize);
-	delete[] newData;
+	// And keep the encoded data, to be written in order
+	RawAudioType type = { true, sample.isStereo, sample.bits };
+	encodeAudioBuffer(sample.data.data(), sample.data.size(), type, sample.rate, sample.encoded, _format);
+	std::vector<byte>().swap(sample.data);
 }
 
 uint CompressSci::parseRawAudioMap() {
@@ -343,21 +430,18 @@ uint CompressSci::parseRawAudioMap() {
 	return _rawAudioMap.size();
 }
 
+/** Number of resources read and encoded at once, which bounds the memory used. */
+static const size_t kSampleBatchSize = 256;
+
 void CompressSci::execute() {
 	Common::Filename infile = _inputPaths[0].path;
 	Common::Filename outfile = _outputPath;
-	SciResourceDataType recognizedDataType;
 
 	_input.open(infile, "rb");
 	_inputSize = _input.size();
 	_rawAudio = false;
 
-	// First find out how many samples are in this file
-
-	_input.seek(0, SEEK_SET);
 	byte header[6];
-
-	_inputOffset = 0;
 	_input.read_throwsOnError(&header, 6);
 	if (memcmp(header, "MP3 ", 4) == 0)
 		error("This resource file is already MP3-compressed, aborting...");
@@ -366,30 +450,14 @@ void CompressSci::execute() {
 	if (memcmp(header, "FLAC", 4) == 0)
 		error("This resource file is already FLAC-compressed, aborting...");
 
-	int resourceCount = 0;
 	if (_input.size() == 97103872 || _input.size() == 23126016) {
 		print("Size matches KQ5 or Jones in the Fast Lane audio file, assuming raw audio");
 		_rawAudio = true;
-		resourceCount = parseRawAudioMap();
-	} else {
-		do {
-			recognizedDataType = detectData(header, false);
-			if (!recognizedDataType)
-				error("Unsupported data at offset %lx", _inputOffset);
-			_input.seek(_inputEndOffset, SEEK_SET);
-			_inputOffset = _inputEndOffset;
-			resourceCount++;
-			// We abort even, if file position is one below size because of pharkas resource.sfx
-			if (_inputOffset >= _inputSize - 1)
-				break;
-
-			_input.read_throwsOnError(&header, 6);
-		} while (true);
 	}
 
-	// This case happens on pharkas resource.sfx
-	if (_inputOffset != _inputSize)
-		warning("resource file has additional byte before end-of-file");
+	// Find all the samples of this file in a single pass
+	scanResources();
+	const int resourceCount = _resources.size();
 
 	print("Valid sci audio resource file. Found %d resources", resourceCount);
 
@@ -407,43 +475,46 @@ void CompressSci::execute() {
 	}
 	// Resource count
 	_output.writeUint32LE(resourceCount);
-	// Offset mapping table
+	// Offset mapping table, filled in once all the samples are written
 	for (int resourceNo = 0; resourceNo < resourceCount; resourceNo++) {
 		_output.writeUint32LE(0); // Original offset
 		_output.writeUint32LE(0); // New offset
 	}
-	// Now actually compress the file
-	_input.seek(0, SEEK_SET);
-	for (int resourceNo = 0; resourceNo < resourceCount; resourceNo++) {
-		_inputOffset = _input.pos();
-		_outputOffset = _output.pos();
-		_input.read_throwsOnError(&header, 6);
-		recognizedDataType = detectData(header, true);
-
-		assert(recognizedDataType);
-		_input.seek(_inputOffset, SEEK_SET);
-		compressData(recognizedDataType);
 
-		// raw files are 0-padded to 2048 bytes
-		if (_rawAudio)
-			_inputEndOffset = (((_inputEndOffset - 1) >> 11) + 1) << 11;
-
-		// Seek inputfile to the end of the data
-		_input.seek(_inputEndOffset, SEEK_SET);
-		// Seek outputfile to mapping table
-		_output.seek(8 + resourceNo * 8, SEEK_SET);
-		// And write offset translations
-		_output.writeUint32LE(_inputOffset);
-		_output.writeUint32LE(_outputOffset);
-		// Seek to end of file
-		_output.seek(0, SEEK_END);
-
-		updateProgress(resourceNo, resourceCount);
+	// Now actually compress the file: samples are read in order, decoded and
+	// encoded in parallel, and written in order
+	std::vector<uint32> outputOffsets(resourceCount);
+	for (int first = 0; first < resourceCount; first += kSampleBatchSize) {
+		const int count = std::min<int>(kSampleBatchSize, resourceCount - first);
+		std::vector<Sample> samples(count);
+
+		for (int i = 0; i < count; i++)
+			readSample(_resources[first + i], samples[i]);
+
+		parallelFor(count, _jobs, [&](size_t i) {
+			encodeSample(samples[i]);
+		});
+
+		for (int i = 0; i < count; i++) {
+			outputOffsets[first + i] = _output.pos();
+			if (samples[i].copy) {
+				if (!samples[i].data.empty())
+					_output.write(&samples[i].data[0], samples[i].data.size());
+			} else {
+				_output.write(samples[i].encoded.data(), samples[i].encoded.size());
+			}
+			samples[i] = Sample();
+
+			updateProgress(first + i, resourceCount);
+		}
 	}
 
-	// And some clean-up :-)
-	Common::removeFile(TEMP_RAW);
-	Common::removeFile(TEMP_ENC);
+	// And write offset translations
+	_output.seek(8, SEEK_SET);
+	for (int resourceNo = 0; resourceNo < resourceCount; resourceNo++) {
+		_output.writeUint32LE(_resources[resourceNo].offset);
+		_output.writeUint32LE(outputOffsets[resourceNo]);
+	}
 }
 
 
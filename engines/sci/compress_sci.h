@@ -26,6 +26,7 @@
 
 #include "compress.h"
 #include <map>
+#include <vector>
 
 enum SciResourceDataType {
 	kSciResourceDataTypeUnknown	= 0,
@@ -35,6 +36,13 @@ enum SciResourceDataType {
 	kSciResourceDataTypeRaw		= 4
 };
 
+/** A resource of a resource.aud/resource.sfx file, as found by scanning it. */
+struct SciResource {
+	uint32 offset;
+	uint32 size;
+	SciResourceDataType dataType;
+};
+
 class CompressSci : public CompressionTool {
 public:
 	CompressSci(const std::string &name = "compress_sci");
@@ -42,17 +50,24 @@ public:
 	virtual void execute();
 
 protected:
-	SciResourceDataType detectData(byte *header, bool compressMode);
-	void compressData(SciResourceDataType dataType);
+	struct Sample;
+
+	virtual void parseExtraArguments();
+
+	SciResourceDataType detectData(byte *header);
+	void scanResources();
+	void readSample(const SciResource &resource, Sample &sample);
+	/** Decodes and encodes a sample in place. May be called from several threads at once. */
+	void encodeSample(Sample &sample);
 	uint parseRawAudioMap();
 
 	Common::File _input, _output;
 	int _inputOffset;
 	int _inputEndOffset;
 	int _inputSize;
-	int _outputOffset;
 	bool _rawAudio;
 	std::map<uint32,uint32> _rawAudioMap;
+	std::vector<SciResource> _resources;
 };
 
 #endif
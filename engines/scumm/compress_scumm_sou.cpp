@@ -125,16 +125,9 @@ bool CompressScummSou::get_part() {
 	assert(tags >= 8);
 	tags -= 8;
 
-	_output_idx.writeUint32BE((uint32)pos);
-	_output_idx.writeUint32BE((uint32)_output_snd.pos());
-	_output_idx.writeUint32BE(tags);
-	// FIXME/TODO: Copying "tags" bytes one by one is
-	// inefficient; should use a buffer (say, "buf") to copy
-	// larger amounts at a time.
-	while (tags > 0) {
-		_output_snd.writeChar(_input.readChar());
-		tags--;
-	}
+	std::string part(tags, '\0');
+	if (tags > 0)
+		_input.read_throwsOnError(&part[0], tags);
 
 	/* The German Sam & Max MONSTER.SOU seems to have a VCTL without an
 	 * associated SOU entry at the end (Bug ID 3280674). 
@@ -167,14 +160,30 @@ bool CompressScummSou::get_part() {
 		extractAndEncodeVOC(TEMP_RAW, _input, _format);
 	}
 
-	/* Append the converted data to the master output file */
+	/* Append the converted data to the master output file, unless the same
+	 * tags and audio are already there */
 	Common::File f(tempEncoded, "rb");
-	tot_size = 0;
-	while ((size = f.read_noThrow(buf, 2048)) > 0) {
-		tot_size += size;
-		_output_snd.write(buf, size);
+	tot_size = f.size();
+	part.resize(tags + tot_size);
+	if (tot_size > 0)
+		f.read_throwsOnError(&part[tags], tot_size);
+	f.close();
+
+	std::string partHash = EncodedSampleCache::hash(part.data(), part.size());
+	std::map<std::string, uint32>::const_iterator written = _writtenParts.find(partHash);
+	uint32 offset;
+	if (written != _writtenParts.end()) {
+		print("Same as a previous voice, sharing its data");
+		offset = written->second;
+	} else {
+		offset = _output_snd.pos();
+		_writtenParts[partHash] = offset;
+		_output_snd.write(part.data(), part.size());
 	}
 
+	_output_idx.writeUint32BE((uint32)pos);
+	_output_idx.writeUint32BE(offset);
+	_output_idx.writeUint32BE(tags);
 	_output_idx.writeUint32BE(tot_size);
 
 	updateProgress(_input.pos(), _file_size);
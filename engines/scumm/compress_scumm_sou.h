@@ -26,6 +26,8 @@
 
 #include "compress.h"
 
+#include <map>
+
 class CompressScummSou : public CompressionTool {
 public:
 	CompressScummSou(const std::string &name = "compress_scumm_sou");
@@ -35,6 +37,8 @@ public:
 protected:
 	Common::File _input, _output_idx, _output_snd;
 	int _file_size;
+	/** Offsets in the sound data of the parts already written, by hash of their tags and audio. */
+	std::map<std::string, uint32> _writtenParts;
 
 	std::string getOutputName() const;
 	void end_of_file();
@@ -0,0 +1,53 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "console_image.h"
+#include "common/util.h"
+
+void readImage(Common::File &file, std::vector<byte> &image) {
+	image.resize(file.size() - file.pos());
+	if (!image.empty())
+		file.read_throwsOnError(&image[0], image.size());
+}
+
+void copyImageBytes(Common::SeekableReadStream &input, Common::WriteStream &output, uint32 count) {
+	byte buf[4096];
+	while (count > 0) {
+		uint32 size = MIN<uint32>(count, sizeof(buf));
+		if (input.read(buf, size) != size)
+			throw Common::FileException("Unexpected end of image");
+		output.write(buf, size);
+		count -= size;
+	}
+}
+
+void writeDecodedFile(const Common::Filename &path, Common::MemoryWriteStreamDynamic &data, uint8 xorMode) {
+	byte *bytes = data.getData();
+	uint32 size = data.size();
+	if (xorMode != 0) {
+		for (uint32 i = 0; i < size; i++)
+			bytes[i] ^= xorMode;
+	}
+
+	Common::File output(path, "wb");
+	if (size > 0)
+		output.write(bytes, size);
+}
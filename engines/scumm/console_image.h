@@ -0,0 +1,47 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Helpers to decode the resources of console and home computer images in memory */
+
+#ifndef SCUMM_CONSOLE_IMAGE_H
+#define SCUMM_CONSOLE_IMAGE_H
+
+#include "common/file.h"
+#include "common/memstream.h"
+
+#include <vector>
+
+/**
+ * Reads the rest of a ROM, disc or disk image into memory, from which its
+ * resources are then decoded through a Common::MemoryReadStream.
+ */
+void readImage(Common::File &file, std::vector<byte> &image);
+
+/** Copies bytes of the image to a decoded file as they are. */
+void copyImageBytes(Common::SeekableReadStream &input, Common::WriteStream &output, uint32 count);
+
+/**
+ * Writes a file decoded in memory with a single write, xored with xorMode
+ * as Common::File::setXorMode would do. The data is xored in place.
+ */
+void writeDecodedFile(const Common::Filename &path, Common::MemoryWriteStreamDynamic &data, uint8 xorMode = 0);
+
+#endif
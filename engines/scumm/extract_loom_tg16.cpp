@@ -26,32 +26,38 @@
 #include <stdio.h>
 
 #include "extract_loom_tg16.h"
+#include "console_image.h"
+#include "common/crc32.h"
 
 // if defined, generates a set of .LFL files
 // if not defined, dumps all resources to separate files
 #define MAKE_LFLS
 
-uint8 read_cbyte(Common::File &input, uint32 *ctr) {
+uint8 read_cbyte(Common::SeekableReadStream &input, uint32 *ctr) {
 	(*ctr) += 1;
 	return input.readByte();
 }
-uint16 read_cword(Common::File &input, uint32 *ctr) {
+uint16 read_cword(Common::SeekableReadStream &input, uint32 *ctr) {
 	(*ctr) += 2;
 	return input.readUint16LE();
 }
 
-void write_cbyte(Common::File &output, uint8 val, uint32 *ctr) {
+void write_cbyte(Common::WriteStream &output, uint8 val, uint32 *ctr) {
 	output.writeByte(val);
 	(*ctr) += 1;
 }
-void write_cword(Common::File &output, uint16 val, uint32 *ctr) {
+void write_cword(Common::WriteStream &output, uint16 val, uint32 *ctr) {
 	output.writeUint16LE(val);
 	(*ctr) += 2;
 }
-void write_clong(Common::File &output, uint32 val, uint32 *ctr) {
+void write_clong(Common::WriteStream &output, uint32 val, uint32 *ctr) {
 	output.writeUint32LE(val);
 	(*ctr) += 4;
 }
+void copy_cbytes(Common::SeekableReadStream &input, Common::WriteStream &output, uint32 count, uint32 *ctr) {
+	copyImageBytes(input, output, count);
+	(*ctr) += count;
+}
 
 typedef enum _res_type {
 	RES_GLOBDATA = 0,
@@ -694,10 +700,9 @@ uint16 r_length(p_resource res) {
 	return res->length[ISO];
 }
 
-void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output, p_resource res) {
+void ExtractLoomTG16::extract_resource(Common::SeekableReadStream &input, Common::SeekableWriteStream &output, p_resource res) {
 #ifdef MAKE_LFLS
 	uint32 off;
-	uint16 j;
 #endif
 	uint32 i, rlen;
 	uint8 junk = 0, rtype = 0, rid = 0;
@@ -725,8 +730,7 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 		output.writeByte(0x80);
 		output.writeByte(0x08);
 
-		for (i = 0; i < rlen - 4; i++)
-			output.writeByte(input.readByte());
+		copyImageBytes(input, output, rlen - 4);
 		break;
 	case RES_GLOBDATA:
 		rlen = read_cword(input,&i);
@@ -739,8 +743,7 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 			error("extract_resource(globdata) - resource tag is incorrect");
 		output.writeUint32LE(rlen + 1);
 		output.writeUint16LE('O0');	// 0O - Object Index
-		for (i = 5; i < rlen; i++)
-			output.writeByte(input.readByte());
+		copyImageBytes(input, output, rlen - 5);
 		break;
 #ifdef MAKE_LFLS
 	case RES_CUSTOM_ROOM:
@@ -772,16 +775,14 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 			read_cbyte(input, &i);
 			write_cbyte(output, 15, &rlen);
 
-			for (j = 0; j < slen - 1; j++)
-				write_cbyte(output, read_cbyte(input, &i), &rlen);
+			copy_cbytes(input, output, slen - 1, &rlen);
 
 			slen = read_cword(input, &i) - 3;
 			/*stype =*/ read_cbyte(input, &i);
 
 			write_clong(output, slen + 6, &rlen);
 			write_cword(output, 'LT', &rlen); // TL - tiles
-			for (j = 0; j < slen; j++)
-				write_cbyte(output, read_cbyte(input, &i), &rlen);
+			copy_cbytes(input, output, slen, &rlen);
 
 			output.seek(off, SEEK_SET);
 			output.writeUint32LE(rlen);
@@ -813,6 +814,8 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 				uint8 stype;
 
 				slen = read_cword(input, &i);
+				if (input.eos())
+					error("extract_resource(room) - unexpected end of ISO");
 				if (slen == 0xFFFF) {
 					break;
 				}
@@ -846,6 +849,8 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 				uint8 stype;
 
 				slen = read_cword(input, &i);
+				if (input.eos())
+					error("extract_resource(room) - unexpected end of ISO");
 				if (slen == 0xFFFF)
 					break;
 				stype = read_cbyte(input, &i);
@@ -854,33 +859,28 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 				case 0x06:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'AP', &rlen); // PA - palettes
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x07:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'MB', &rlen); // BM - bitmap
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x0A:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'PZ', &rlen); // ZP - Mask data
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x05:
 					// Verb images for the diststaff
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'IO', &rlen); // OI - object image
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x08:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'LT', &rlen); // TL - tiles
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x09:
 					read_cword(input, &i);
@@ -888,44 +888,37 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 					slen -= 2;
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'XB', &rlen); // BX - boxes
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x0B:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'NE', &rlen); // EN - entrance script
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x0C:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'XE', &rlen); // EX - exit script
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x0D:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'IO', &rlen); // OI - object image
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x0E:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'CO', &rlen); // OC - object code
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x0F:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'CL', &rlen); // LC - local script count
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				case 0x10:
 					write_clong(output, slen + 6, &rlen);
 					write_cword(output, 'SL', &rlen); // LS - local script
-					for (j = 0; j < slen; j++)
-						write_cbyte(output, read_cbyte(input, &i), &rlen);
+					copy_cbytes(input, output, slen, &rlen);
 					break;
 				default:
 					input.seek(slen, SEEK_CUR);
@@ -952,8 +945,7 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 			error("extract_resource(costume) - resource tag is incorrect");
 		output.writeUint32LE(rlen + 1);
 		output.writeUint16LE('OC');	// CO - Costume
-		for (i = 5; i < rlen; i++)
-			output.writeByte(input.readByte());
+		copyImageBytes(input, output, rlen - 5);
 		break;
 	case RES_SCRIPT:
 		rlen = read_cword(input,&i);
@@ -966,8 +958,7 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 			error("extract_resource(script) - resource tag is incorrect");
 		output.writeUint32LE(rlen + 1);
 		output.writeUint16LE('CS');	// SC - Script
-		for (i = 5; i < rlen; i++)
-			output.writeByte(input.readByte());
+		copyImageBytes(input, output, rlen - 5);
 		break;
 	case RES_UNKNOWN:
 #else
@@ -980,8 +971,7 @@ void ExtractLoomTG16::extract_resource(Common::File &input, Common::File &output
 		if (rlen != r_length(res))
 			error("extract_resource - length mismatch while extracting resource (was %04X, expected %04X)", rlen, r_length(res));
 		output.writeUint16LE(rlen);
-		for (i = 2; i < rlen; i++)
-			output.writeByte(input.readByte());
+		copyImageBytes(input, output, rlen - 2);
 		break;
 #endif
 	default:
@@ -1177,35 +1167,15 @@ struct _index {
 	uint32 sound_addr[NUM_SOUNDS];
 }	lfl_index;
 #else // !MAKE_LFLS
-void dump_resource (Common::File &input, const char *fn_template, int num, p_resource res) {
+void dump_resource (Common::SeekableReadStream &input, const char *fn_template, int num, p_resource res) {
 	char fname[256];
 	sprintf(fname, fn_template, num);
-	Common::File output(fname, "wb");
+	Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
 	extract_resource(input, output, res);
+	writeDecodedFile(fname, output);
 }
 #endif // MAKE_LFLS
 
-uint32 CRCtable[256];
-void InitCRC() {
-	const uint32 poly = 0xEDB88320;
-	int i, j;
-	uint32 n;
-	for (i = 0; i < 256; i++) {
-		n = i;
-		for (j = 0; j < 8; j++)
-			n = (n & 1) ? ((n >> 1) ^ poly) : (n >> 1);
-		CRCtable[i] = n;
-	}
-}
-
-uint32 ISO_CRC(Common::File &file) {
-	uint32 CRC = 0xFFFFFFFF;
-	uint32 len = file.size();
-	for (uint32 i = 0; i < len; i++)
-		CRC = (CRC >> 8) ^ CRCtable[(CRC ^ file.readByte()) & 0xFF];
-	return CRC ^ 0xFFFFFFFF;
-}
-
 ExtractLoomTG16::ExtractLoomTG16(const std::string &name) : Tool(name, TOOLTYPE_EXTRACTION) {
 	ToolInput input;
 	input.format = "*.iso";
@@ -1219,10 +1189,17 @@ void ExtractLoomTG16::execute() {
 	if (_outputPath.empty())
 		_outputPath.setFullPath("./");
 
-	Common::File input(_inputPaths[0].path, "rb");
-
-	InitCRC();
-	uint32 CRC = ISO_CRC(input);
+	// The whole ISO is decoded from memory
+	std::vector<byte> image;
+	uint32 CRC;
+	{
+		ToolPhase phase(*this, "scan");
+		Common::File file(_inputPaths[0].path, "rb");
+		readImage(file, image);
+		CRC = Common::crc32(image.data(), image.size());
+		addProcessedBytes(image.size());
+	}
+	Common::MemoryReadStream input(image.data(), image.size());
 
 	switch (CRC) {
 	case 0x29EED3C5: // dumpcd
@@ -1239,6 +1216,8 @@ void ExtractLoomTG16::execute() {
 		error("ISO contents not recognized");
 		break;
 	}
+
+	ToolPhase phase(*this, "write");
 #ifdef	MAKE_LFLS
 	memset(&lfl_index, 0xFF, sizeof(lfl_index));
 
@@ -1248,7 +1227,7 @@ void ExtractLoomTG16::execute() {
 		sprintf(fname, "%02i.LFL", lfl->num);
 		_outputPath.setFullName(fname);
 
-		Common::File output(_outputPath, "wb");
+		Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
 
 		print("Creating %s...", fname);
 		for (int j = 0; lfl->entries[j] != NULL; j++) {
@@ -1278,71 +1257,76 @@ void ExtractLoomTG16::execute() {
 
 			extract_resource(input, output, entry);
 		}
+		writeDecodedFile(_outputPath, output);
+		addProcessedBytes(output.size());
+		addProcessedItems();
 	}
 
 	_outputPath.setFullName("00.LFL");
-	Common::File output(_outputPath, "wb");
 	print("Creating 00.LFL...");
 
+	Common::MemoryWriteStreamDynamic index(DisposeAfterUse::YES);
+
 	lfl_index.num_rooms = NUM_ROOMS;
 	lfl_index.num_costumes = NUM_COSTUMES;
 	lfl_index.num_scripts = NUM_SCRIPTS;
 	lfl_index.num_sounds = NUM_SOUNDS;
 
-	output.writeUint32LE(8 + 5 * lfl_index.num_rooms);
-	output.writeUint16LE('R0'); // 0R - room index
-	output.writeUint16LE(lfl_index.num_rooms);
+	index.writeUint32LE(8 + 5 * lfl_index.num_rooms);
+	index.writeUint16LE('R0'); // 0R - room index
+	index.writeUint16LE(lfl_index.num_rooms);
 
 	for (int i = 0; i < lfl_index.num_rooms; i++) {
-		output.writeByte(lfl_index.room_lfl[i]);
-		output.writeUint32LE(lfl_index.room_addr[i]);
+		index.writeByte(lfl_index.room_lfl[i]);
+		index.writeUint32LE(lfl_index.room_addr[i]);
 	}
 
-	output.writeUint32LE(8 + 5 * lfl_index.num_scripts);
-	output.writeUint16LE('S0'); // 0S - script index
-	output.writeUint16LE(lfl_index.num_scripts);
+	index.writeUint32LE(8 + 5 * lfl_index.num_scripts);
+	index.writeUint16LE('S0'); // 0S - script index
+	index.writeUint16LE(lfl_index.num_scripts);
 
 	for (int i = 0; i < lfl_index.num_scripts; i++) {
-		output.writeByte(lfl_index.script_lfl[i]);
-		output.writeUint32LE(lfl_index.script_addr[i]);
+		index.writeByte(lfl_index.script_lfl[i]);
+		index.writeUint32LE(lfl_index.script_addr[i]);
 	}
 
-	output.writeUint32LE(8 + 5 * lfl_index.num_costumes);
-	output.writeUint16LE('C0'); // 0C - costume index
-	output.writeUint16LE(lfl_index.num_costumes);
+	index.writeUint32LE(8 + 5 * lfl_index.num_costumes);
+	index.writeUint16LE('C0'); // 0C - costume index
+	index.writeUint16LE(lfl_index.num_costumes);
 
 	for (int i = 0; i < lfl_index.num_costumes; i++) {
-		output.writeByte(lfl_index.costume_lfl[i]);
-		output.writeUint32LE(lfl_index.costume_addr[i]);
+		index.writeByte(lfl_index.costume_lfl[i]);
+		index.writeUint32LE(lfl_index.costume_addr[i]);
 	}
 
 /*
-	output.writeUint32LE(8 + 5 * lfl_index.num_sounds);
-	output.writeUint16LE('N0'); 0N - sounds index
-	output.writeUint16LE(lfl_index.num_sounds);
+	index.writeUint32LE(8 + 5 * lfl_index.num_sounds);
+	index.writeUint16LE('N0'); 0N - sounds index
+	index.writeUint16LE(lfl_index.num_sounds);
 
 	for (i = 0; i < lfl_index.num_sounds; i++) {
-		output.writeByte(lfl_index.sound_lfl[i]);
-		output.writeUint32LE(lfl_index.sound_addr[i]);
+		index.writeByte(lfl_index.sound_lfl[i]);
+		index.writeUint32LE(lfl_index.sound_addr[i]);
 	}
 */
 
-	extract_resource(input, output, &res_globdata);
-
-	_outputPath.setFullName("97.LFL");
-	output.open(_outputPath, "wb");
-	print("Creating 97.LFL...");
-	extract_resource(input, output, &res_charset);
-
-	_outputPath.setFullName("98.LFL");
-	output.open(_outputPath, "wb");
-	print("Creating 98.LFL...");
-	extract_resource(input, output, &res_charset);
+	extract_resource(input, index, &res_globdata);
+	writeDecodedFile(_outputPath, index);
+	addProcessedBytes(index.size());
+	addProcessedItems();
 
-	_outputPath.setFullName("99.LFL");
-	output.open(_outputPath, "wb");
-	print("Creating 99.LFL...");
-	extract_resource(input, output, &res_charset);
+	// The three charset files are the same
+	Common::MemoryWriteStreamDynamic charset(DisposeAfterUse::YES);
+	extract_resource(input, charset, &res_charset);
+	for (int i = 97; i <= 99; i++) {
+		char fname[256];
+		sprintf(fname, "%02i.LFL", i);
+		_outputPath.setFullName(fname);
+		print("Creating %s...", fname);
+		writeDecodedFile(_outputPath, charset);
+		addProcessedBytes(charset.size());
+		addProcessedItems();
+	}
 
 #else // !MAKE_LFLS
 	dump_resource(input, "globdata.dmp", 0, &res_globdata);
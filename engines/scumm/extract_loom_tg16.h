@@ -25,6 +25,7 @@
 #define EXTRACT_LOOM_TG16_H
 
 #include "compress.h"
+#include "common/stream.h"
 
 struct t_resource;
 typedef t_resource * p_resource;
@@ -37,7 +38,7 @@ public:
 
 protected:
 
-	void extract_resource(Common::File &input, Common::File &output, p_resource res);
+	void extract_resource(Common::SeekableReadStream &input, Common::SeekableWriteStream &output, p_resource res);
 };
 
 #endif
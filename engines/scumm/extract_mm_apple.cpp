@@ -87,6 +87,7 @@ void ExtractMMApple::execute() {
 	if (signature != 0x0032)
 		error("Signature not found in disk 2!");
 
+	ToolPhase phase(*this, "write");
 	outpath.setFullName("00.LFL");
 	Common::File output(outpath, "wb");
 	// All output should be xored
@@ -131,6 +132,8 @@ void ExtractMMApple::execute() {
 		output.writeUint16LE(input1.readUint16LE());
 
 	/* NOTE: Extra 92 bytes of unknown data */
+	addProcessedBytes(output.pos());
+	addProcessedItems();
 
 	for (i = 0; i < NUM_ROOMS; i++) {
 		Common::File *input;
@@ -158,6 +161,8 @@ void ExtractMMApple::execute() {
 				output.writeByte(input->readByte());
 		}
 		input->rewind();
+		addProcessedBytes(output.pos());
+		addProcessedItems();
 	}
 	print("All done!");
 }
@@ -24,6 +24,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include "extract_mm_c64.h"
+#include "console_image.h"
 
 #define NUM_ROOMS	55
 
@@ -71,8 +72,18 @@ void ExtractMMC64::execute() {
 		// Standard output path
 		outpath.setFullPath("out/");
 
-	Common::File input1(inpath1, "rb");
-	Common::File input2(inpath2, "rb");
+	// Both disk images are decoded from memory
+	std::vector<byte> image1, image2;
+	{
+		ToolPhase phase(*this, "scan");
+		Common::File file1(inpath1, "rb");
+		Common::File file2(inpath2, "rb");
+		readImage(file1, image1);
+		readImage(file2, image2);
+		addProcessedBytes(image1.size() + image2.size());
+	}
+	Common::MemoryReadStream input1(image1.data(), image1.size());
+	Common::MemoryReadStream input2(image2.data(), image2.size());
 
 	/* check signature */
 	signature = input1.readUint16LE();
@@ -82,50 +93,44 @@ void ExtractMMC64::execute() {
 	if (signature != 0x0132)
 		error("Signature not found in disk 2!");
 
+	ToolPhase phase(*this, "write");
 	outpath.setFullName("00.LFL");
-	Common::File output(outpath, "wb");
-	output.setXorMode(0xFF);
 	print("Creating 00.LFL...");
+	{
+		Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
+
+		/* write signature */
+		output.writeUint16LE(signature);
+
+		/* copy object flags */
+		copyImageBytes(input1, output, 256);
+		/* copy room offsets */
+		for (i = 0; i < NUM_ROOMS; i++) {
+			room_disks[i] = input1.readByte();
+			output.writeByte(room_disks[i]);
+		}
+		for (i = 0; i < NUM_ROOMS; i++) {
+			room_sectors[i] = input1.readByte();
+			output.writeByte(room_sectors[i]);
+			room_tracks[i] = input1.readByte();
+			output.writeByte(room_tracks[i]);
+		}
 
-	/* write signature */
-	output.writeUint16LE(signature);
+		/* copy costume offsets */
+		copyImageBytes(input1, output, 25 * 3);
 
-	/* copy object flags */
-	for (i = 0; i < 256; i++)
-		output.writeByte(input1.readByte());
-	/* copy room offsets */
-	for (i = 0; i < NUM_ROOMS; i++) {
-		room_disks[i] = input1.readByte();
-		output.writeByte(room_disks[i]);
-	}
-	for (i = 0; i < NUM_ROOMS; i++) {
-		room_sectors[i] = input1.readByte();
-		output.writeByte(room_sectors[i]);
-		room_tracks[i] = input1.readByte();
-		output.writeByte(room_tracks[i]);
-	}
+		/* copy script offsets */
+		copyImageBytes(input1, output, 160 * 3);
 
-	/* copy costume offsets */
-	for (i = 0; i < 25; i++)
-		output.writeByte(input1.readByte());
-	for (i = 0; i < 25; i++)
-		output.writeUint16LE(input1.readUint16LE());
-
-	/* copy script offsets */
-	for (i = 0; i < 160; i++)
-		output.writeByte(input1.readByte());
-	for (i = 0; i < 160; i++)
-		output.writeUint16LE(input1.readUint16LE());
-
-	/* copy sound offsets */
-	for (i = 0; i < 70; i++)
-		output.writeByte(input1.readByte());
-	for (i = 0; i < 70; i++)
-		output.writeUint16LE(input1.readUint16LE());
-	output.close();
+		/* copy sound offsets */
+		copyImageBytes(input1, output, 70 * 3);
+		writeDecodedFile(outpath, output, 0xFF);
+		addProcessedBytes(output.size());
+		addProcessedItems();
+	}
 
 	for (i = 0; i < NUM_ROOMS; i++) {
-		Common::File *input;
+		Common::MemoryReadStream *input;
 
 		if (room_disks[i] == '1')
 			input = &input1;
@@ -136,22 +141,21 @@ void ExtractMMC64::execute() {
 
 		sprintf(fname, "%02i.LFL", i);
 		outpath.setFullName(fname);
-		output.open(outpath, "wb");
-		output.setXorMode(0xFF);
 
 		print("Creating %s...", fname);
 		input->seek((SectorOffset[room_tracks[i]] + room_sectors[i]) * 256, SEEK_SET);
 
+		Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
 		for (j = 0; j < ResourcesPerFile[i]; j++) {
 			unsigned short len = input->readUint16LE();
 			output.writeUint16LE(len);
-
-			for (len -= 2; len > 0; len--) {
-				output.writeByte(input->readByte());
-			}
+			copyImageBytes(*input, output, (unsigned short)(len - 2));
 		}
-
-		input->rewind();
+		if (input->eos())
+			error("Unexpected end of disk image while reading %s", fname);
+		writeDecodedFile(outpath, output, 0xFF);
+		addProcessedBytes(output.size());
+		addProcessedItems();
 	}
 
 	print("All done!");
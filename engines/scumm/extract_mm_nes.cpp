@@ -25,6 +25,9 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include "extract_mm_nes.h"
+#include "console_image.h"
+#include "common/parallel.h"
+#include "common/crc32.h"
 
 /* if defined, generates a set of .LFL files */
 /* if not defined, dumps all resources to separate files */
@@ -935,7 +938,7 @@ const struct t_resgroup res_preplist = {
 	}
 };
 
-void ExtractMMNes::extract_resource(Common::File &input, Common::File &output, const struct t_resource *res, res_type type) {
+void ExtractMMNes::extract_resource(Common::SeekableReadStream &input, Common::SeekableWriteStream &output, const struct t_resource *res, res_type type) {
 	uint16 len, i, j;
 	uint8 val;
 	uint8 cnt;
@@ -949,8 +952,7 @@ void ExtractMMNes::extract_resource(Common::File &input, Common::File &output, c
 	switch (type) {
 	case NES_GLOBDATA:
 		len = res->length;
-		for (i = 0; i < len; i++)
-			output.writeByte(input.readByte());
+		copyImageBytes(input, output, len);
 		break;
 	case NES_ROOMGFX:
 	case NES_COSTUMEGFX:
@@ -968,7 +970,7 @@ void ExtractMMNes::extract_resource(Common::File &input, Common::File &output, c
 					output.writeByte(input.readByte());
 		}
 		if (input.pos() - res->offset != res->length)
-			error("extract_resource - length mismatch while extracting graphics resource (was %04X, should be %04X)", input.pos() - res->offset, res->length);
+			error("extract_resource - length mismatch while extracting graphics resource (was %04X, should be %04X)", (uint32)input.pos() - res->offset, res->length);
 		break;
 	case NES_ROOM:
 	case NES_SCRIPT:
@@ -976,8 +978,7 @@ void ExtractMMNes::extract_resource(Common::File &input, Common::File &output, c
 		if (len != res->length)
 			error("extract_resource - length mismatch while extracting room/script resource (was %04X, should be %04X)", len, res->length);
 		input.seek(-2, SEEK_CUR);
-		for (i = 0; i < len; i++)
-			output.writeByte(input.readByte());
+		copyImageBytes(input, output, len);
 		break;
 	case NES_SOUND:
 		len = res->length + 2;
@@ -989,10 +990,7 @@ void ExtractMMNes::extract_resource(Common::File &input, Common::File &output, c
 			output.writeByte(cnt);
 			cnt = input.readByte();
 			output.writeByte(cnt);
-			for (i = 0; i < cnt; i++)
-				output.writeByte(input.readByte());
-			for (i = 0; i < cnt; i++)
-				output.writeByte(input.readByte());
+			copyImageBytes(input, output, cnt * 2);
 			while (1) {
 				val = input.readByte();
 				output.writeByte(val);
@@ -1021,7 +1019,7 @@ void ExtractMMNes::extract_resource(Common::File &input, Common::File &output, c
 			error("extract_resource - unknown sound type %d/%d detected", val, cnt);
 		}
 		if (input.pos() - res->offset != res->length)
-			error("extract_resource - length mismatch while extracting sound resource (was %04X, should be %04X)", input.pos() - res->offset, res->length);
+			error("extract_resource - length mismatch while extracting sound resource (was %04X, should be %04X)", (uint32)input.pos() - res->offset, res->length);
 		break;
 	case NES_COSTUME:
 	case NES_SPRPALS:
@@ -1032,8 +1030,7 @@ void ExtractMMNes::extract_resource(Common::File &input, Common::File &output, c
 	case NES_CHARSET:
 		len = res->length;
 		output.writeUint16LE((uint16)(len + 2));
-		for (i = 0; i < len; i++)
-			output.writeByte(input.readByte());
+		copyImageBytes(input, output, len);
 		break;
 	case NES_PREPLIST:
 		len = res->length;
@@ -1052,6 +1049,8 @@ void ExtractMMNes::extract_resource(Common::File &input, Common::File &output, c
 	default:
 		error("extract_resource - unknown resource type %d specified", type);
 	}
+	if (input.eos())
+		error("extract_resource - unexpected end of ROM");
 }
 
 #ifdef MAKE_LFLS
@@ -1197,39 +1196,18 @@ struct	t_lflindex {
 #include "common/pack-end.h"	/* END STRUCT PACKING */
 
 #else	/* !MAKE_LFLS */
-void ExtractMMNes::dump_resource (Common::File &input, const char *fn_template, int num, const struct t_resource *res, res_type type) {
+void ExtractMMNes::dump_resource (Common::SeekableReadStream &input, const char *fn_template, int num, const struct t_resource *res, res_type type) {
 	char fname[256];
 	sprintf(fname, fn_template, num);
 	Common::Filename &outpath = _outputPath;
 	outpath.setFullName(fname);
-	Common::File output(outpath, "wb");
 	print("Extracting resource to %s", fname);
+	Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
 	extract_resource(input, output, res, type);
+	writeDecodedFile(outpath, output);
 }
 #endif /* MAKE_LFLS */
 
-static uint32	CRCtable[256];
-static void InitCRC(void) {
-	const uint32 poly = 0xEDB88320;
-	int i, j;
-	uint32 n;
-	for (i = 0; i < 256; i++) {
-		n = i;
-		for (j = 0; j < 8; j++)
-			n = (n & 1) ? ((n >> 1) ^ poly) : (n >> 1);
-		CRCtable[i] = n;
-	}
-}
-static uint32 CheckROM(Common::File &file) {
-	uint32 CRC = 0xFFFFFFFF;
-	uint32 i;
-
-	for (i = 0; i < 262144; i++)
-		CRC = (CRC >> 8) ^ CRCtable[(CRC ^ file.readByte()) & 0xFF];
-
-	return CRC ^ 0xFFFFFFFF;
-}
-
 ExtractMMNes::ExtractMMNes(const std::string &name) : Tool(name, TOOLTYPE_EXTRACTION) {
 
 	ToolInput input;
@@ -1251,18 +1229,25 @@ void ExtractMMNes::execute() {
 	Common::Filename inpath(_inputPaths[0].path);
 	Common::Filename &outpath = _outputPath;
 
-	Common::File input(inpath, "rb");
+	// The whole ROM is decoded from memory
+	std::vector<byte> image;
+	{
+		ToolPhase phase(*this, "scan");
+		Common::File file(inpath, "rb");
+		readImage(file, image);
+		addProcessedBytes(image.size());
+	}
+	if (image.size() < 262144)
+		error("ROM contents not recognized (the PRG section is too short)");
+	Common::MemoryReadStream input(image.data(), image.size());
 
-	if ((input.readByte() == 'N') && (input.readByte() == 'E') && (input.readByte() == 'S') && (input.readByte() == 0x1A)) {
+	if ((image[0] == 'N') && (image[1] == 'E') && (image[2] == 'S') && (image[3] == 0x1A)) {
 		error(
 			"You have specified an iNES formatted ROM image, which is not supported.\n"
 			"You must input the PRG section only - see Maniac Mansion NES notes section of README.");
 	}
 
-	input.rewind();
-
-	InitCRC();
-	CRC = CheckROM(input);
+	CRC = Common::crc32(image.data(), 262144);
 	switch (CRC) {
 	case 0x0D9F5BD1:
 		ROMset = ROMSET_USA;
@@ -1303,20 +1288,20 @@ void ExtractMMNes::execute() {
 #ifdef MAKE_LFLS
 	memset(&mm_lfl_index, 0, sizeof(struct t_lflindex));
 
-	for (i = 0; lfls[i].num != -1; i++) {
-		char fname[256];
-		const struct t_lfl *lfl = &lfls[i];
+	// The LFL files are independent, and are decoded in parallel
+	int numLfls;
+	for (numLfls = 0; lfls[numLfls].num != -1; numLfls++)
+		;
+	std::vector<std::vector<byte> > decoded(numLfls);
 
-		sprintf(fname, "%02i.LFL", lfl->num);
-		outpath.setFullName(fname);
-		Common::File output(outpath, "wb");
-#ifdef MAKE_LFLS
-		output.setXorMode(0xFF);
-#endif
-		print("Creating %s...", fname);
+	beginPhase("decode");
+	parallelFor(numLfls, MAX(std::thread::hardware_concurrency(), 1U), [&](size_t lflIndex) {
+		const struct t_lfl *lfl = &lfls[lflIndex];
+		Common::MemoryReadStream lflInput(image.data(), image.size());
+		Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
 
-		for (j = 0; lfl->entries[j].type != NULL; j++) {
-			const struct t_lflentry *entry = &lfl->entries[j];
+		for (int k = 0; lfl->entries[k].type != NULL; k++) {
+			const struct t_lflentry *entry = &lfl->entries[k];
 			switch (entry->type->type) {
 			case NES_ROOM:
 				mm_lfl_index.room_lfl[entry->index] = lfl->num;
@@ -1374,22 +1359,41 @@ void ExtractMMNes::execute() {
 				error("Unindexed entry found");
 				break;
 			}
-			extract_resource(input, output, &entry->type->langs[ROMset][entry->index], entry->type->type);
+			extract_resource(lflInput, output, &entry->type->langs[ROMset][entry->index], entry->type->type);
 		}
 		output.writeUint16LE(0xF5D1);
+		decoded[lflIndex].assign(output.getData(), output.getData() + output.size());
+		addProcessedBytes(output.size());
+		addProcessedItems();
+	});
+	endPhase();
+
+	ToolPhase phase(*this, "write");
+
+	for (i = 0; i < numLfls; i++) {
+		char fname[256];
+		sprintf(fname, "%02i.LFL", lfls[i].num);
+		outpath.setFullName(fname);
+		print("Creating %s...", fname);
+
+		for (j = 0; j < (int)decoded[i].size(); j++)
+			decoded[i][j] ^= 0xFF;
+		Common::File output(outpath, "wb");
+		output.write(decoded[i].data(), decoded[i].size());
+		addProcessedBytes(decoded[i].size());
+		addProcessedItems();
 	}
 
 	outpath.setFullName("00.LFL");
-	Common::File output(outpath, "wb");
-#ifdef MAKE_LFLS
-	output.setXorMode(0xFF);
-#endif
 	print("Creating 00.LFL...");
 
+	Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
 	output.writeUint16LE(0x4643);
 	extract_resource(input, output, &res_globdata.langs[ROMset][0], res_globdata.type);
-	for (i = 0; i < (int)sizeof(struct t_lflindex); i++)
-		output.writeByte(((uint8 *)&mm_lfl_index)[i]);
+	output.write(&mm_lfl_index, sizeof(struct t_lflindex));
+	writeDecodedFile(outpath, output, 0xFF);
+	addProcessedBytes(output.size());
+	addProcessedItems();
 #else	/* !MAKE_LFLS */
 	dump_resource(input, "globdata.dmp", 0, &res_globdata.langs[ROMset][0], res_globdata.type);
 	for (i = 0; i < 40; i++)
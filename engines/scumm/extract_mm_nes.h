@@ -25,6 +25,7 @@
 #define EXTRACT_MM_NES_H
 
 #include "compress.h"
+#include "common/stream.h"
 
 typedef enum _res_type {
 	NES_UNKNOWN,
@@ -73,8 +74,8 @@ public:
 
 protected:
 
-	void extract_resource(Common::File &input, Common::File &output, const t_resource *res, res_type type);
-	void dump_resource(Common::File &input, const char *fn_template, int num, const t_resource *res, res_type type);
+	void extract_resource(Common::SeekableReadStream &input, Common::SeekableWriteStream &output, const t_resource *res, res_type type);
+	void dump_resource(Common::SeekableReadStream &input, const char *fn_template, int num, const t_resource *res, res_type type);
 };
 
 #endif
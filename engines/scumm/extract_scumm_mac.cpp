@@ -37,6 +37,10 @@ ExtractScummMac::ExtractScummMac(const std::string &name) : Tool(name, TOOLTYPE_
 }
 
 InspectionMatch ExtractScummMac::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch ExtractScummMac::inspectFilename(const Common::Filename &filename) {
 	std::string name = filename.getFullName();
 	std::transform(name.begin(), name.end(), name.begin(), tolower);
 	std::string::size_type pos = name.find(" data");
@@ -70,6 +74,7 @@ void ExtractScummMac::execute() {
 		error("File record length not multiple of 40");
 
 	// Extract the files
+	ToolPhase phase(*this, "write");
 	for (uint32 i = 0; i < fileRecordLength; i += 0x28) {
 		// read a file record
 		ifp.seek(fileRecordOffset + i, SEEK_SET);
@@ -100,6 +105,8 @@ void ExtractScummMac::execute() {
 		ifp.read_throwsOnError(buf, fileLength);
 		ofp.write(buf, fileLength);
 		delete[] buf;
+		addProcessedBytes(fileLength);
+		addProcessedItems();
 	}
 }
 
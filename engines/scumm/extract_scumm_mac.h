@@ -33,6 +33,8 @@ public:
 	virtual void execute();
 
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
+
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
 };
 
 #endif
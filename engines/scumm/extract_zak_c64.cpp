@@ -24,6 +24,7 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include "extract_zak_c64.h"
+#include "console_image.h"
 
 #define NUM_ROOMS 59
 unsigned char room_disks_c64[NUM_ROOMS], room_tracks_c64[NUM_ROOMS], room_sectors_c64[NUM_ROOMS];
@@ -71,8 +72,18 @@ void ExtractZakC64::execute() {
 		// Standard output path
 		outpath.setFullPath("out/");
 
-	Common::File input1(inpath1, "rb");
-	Common::File input2(inpath2, "rb");
+	// Both disk images are decoded from memory
+	std::vector<byte> image1, image2;
+	{
+		ToolPhase phase(*this, "scan");
+		Common::File file1(inpath1, "rb");
+		Common::File file2(inpath2, "rb");
+		readImage(file1, image1);
+		readImage(file2, image2);
+		addProcessedBytes(image1.size() + image2.size());
+	}
+	Common::MemoryReadStream input1(image1.data(), image1.size());
+	Common::MemoryReadStream input2(image2.data(), image2.size());
 
 	/* check signature */
 	signature = input1.readUint16LE();
@@ -82,52 +93,47 @@ void ExtractZakC64::execute() {
 	if (signature != 0x0132)
 		error("Signature not found in disk 2!");
 
+	ToolPhase phase(*this, "write");
 	outpath.setFullName("00.LFL");
-	Common::File output(outpath, "wb");
-	output.setXorMode(0xFF);
 	print("Creating 00.LFL...");
+	{
+		Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
 
-	/* write signature */
-	output.writeUint16LE(signature);
+		/* write signature */
+		output.writeUint16LE(signature);
 
-	/* copy object flags */
-	for (i = 0; i < 775; i++)
-		output.writeByte(input1.readByte());
+		/* copy object flags */
+		copyImageBytes(input1, output, 775);
 
-	/* copy room offsets */
-	for (i = 0; i < NUM_ROOMS; i++) {
-		room_disks_c64[i] = input1.readByte();
-		output.writeByte(room_disks_c64[i]);
-	}
-	for (i = 0; i < NUM_ROOMS; i++) {
-		room_sectors_c64[i] = input1.readByte();
-		output.writeByte(room_sectors_c64[i]);
-		room_tracks_c64[i] = input1.readByte();
-		output.writeByte(room_tracks_c64[i]);
-	}
+		/* copy room offsets */
+		for (i = 0; i < NUM_ROOMS; i++) {
+			room_disks_c64[i] = input1.readByte();
+			output.writeByte(room_disks_c64[i]);
+			output.writeByte(room_disks_c64[i]);
+		}
+		for (i = 0; i < NUM_ROOMS; i++) {
+			room_sectors_c64[i] = input1.readByte();
+			output.writeByte(room_sectors_c64[i]);
+			room_tracks_c64[i] = input1.readByte();
+			output.writeByte(room_tracks_c64[i]);
+		}
 
-	/* copy costume offsets */
-	for (i = 0; i < 38; i++)
-		output.writeByte(input1.readByte());
-	for (i = 0; i < 38; i++)
-		output.writeUint16LE(input1.readUint16LE());
+		/* copy costume offsets */
+		copyImageBytes(input1, output, 38 * 3);
 
-	/* copy script offsets */
-	for (i = 0; i < 155; i++)
-		output.writeByte(input1.readByte());
-	for (i = 0; i < 155; i++)
-		output.writeUint16LE(input1.readUint16LE());
+		/* copy script offsets */
+		copyImageBytes(input1, output, 155 * 3);
 
-	/* copy sound offsets */
-	for (i = 0; i < 127; i++)
-		output.writeByte(input1.readByte());
-	for (i = 0; i < 127; i++)
-		output.writeUint16LE(input1.readUint16LE());
+		/* copy sound offsets */
+		copyImageBytes(input1, output, 127 * 3);
 
-	output.close();
+		writeDecodedFile(outpath, output, 0xFF);
+		addProcessedBytes(output.size());
+		addProcessedItems();
+	}
 
 	for (i = 0; i < NUM_ROOMS; i++) {
-		Common::File *input;
+		Common::MemoryReadStream *input;
 
 		if (room_disks_c64[i] == '1')
 			input = &input1;
@@ -138,26 +144,26 @@ void ExtractZakC64::execute() {
 
 		sprintf(fname, "%02i.LFL", i);
 		outpath.setFullName(fname);
-		output.open(outpath, "wb");
-		output.setXorMode(0xFF);
 
 		print("Creating %s...", fname);
 		input->seek((SectorOffset[room_tracks_c64[i]] + room_sectors_c64[i]) * 256, SEEK_SET);
 
+		Common::MemoryWriteStreamDynamic output(DisposeAfterUse::YES);
 		for (j = 0; j < ResourcesPerFile[i]; j++) {
 			unsigned short len;
 
 			do {
 				len = input->readUint16LE();
 				output.writeUint16LE(len);
-			} while (len == 0xffff);
+			} while (len == 0xffff && !input->eos());
 
-			for (len -= 2; len > 0; len--) {
-				output.writeByte(input->readByte());
-			}
+			copyImageBytes(*input, output, (unsigned short)(len - 2));
 		}
-
-		input->rewind();
+		if (input->eos())
+			error("Unexpected end of disk image while reading %s", fname);
+		writeDecodedFile(outpath, output, 0xFF);
+		addProcessedBytes(output.size());
+		addProcessedItems();
 	}
 
 	print("All done!");
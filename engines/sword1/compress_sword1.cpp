@@ -769,6 +769,10 @@ void CompressSword1::checkFilesExist(bool checkSpeech, bool checkMusic, const Co
 }
 
 InspectionMatch CompressSword1::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch CompressSword1::inspectFilename(const Common::Filename &filename) {
 	// Wildcard matching as implemented in Tools is too restrictive (e.g. it doesn't
 	// work with *.cl? or even *.cl*).
 	// This is the reason why this function is reimplemented there.
@@ -34,6 +34,8 @@ public:
 
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 
+	static InspectionMatch inspectFilename(const Common::Filename &filename);
+
 	bool _compSpeech;
 	bool _compMusic;
 
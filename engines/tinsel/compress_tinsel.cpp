@@ -22,9 +22,11 @@
 /* .smp compressor */
 
 #include <stdlib.h>
+#include <map>
 
 #include "compress.h"
 #include "common/endian.h"
+#include "sound/adpcm.h"
 
 #include "compress_tinsel.h"
 
@@ -103,39 +105,8 @@ void CompressTinsel::convertTinselRawSample (uint32 sampleSize) {
 	}
 }
 
-static const double TinselFilterTable[4][2] = {
-	{0, 0 },
-	{0.9375, 0},
-	{1.796875, -0.8125},
-	{1.53125, -0.859375}
-};
-
-template<typename T> inline T CLIP (T v, T amin, T amax) {
-	if (v < amin)
-		return amin;
-	else if (v > amax)
-		return amax;
-	else
-		return v;
-}
-
 /* Converts ADPCM-data sample in input_smp of size SampleSize to requested dataformat and writes to output_smp */
-/* Quick hack together from adpcm.cpp */
 void CompressTinsel::convertTinselADPCMSample (uint32 sampleSize) {
-	byte *inBuffer, *inPos;
-	int16 *outBuffer, *outPos;
-	double predictor = 0;
-	double k0 = 0, k1 = 0;
-	double d0 = 0, d1 = 0;
-	uint32 blockAlign, blockPos;
-	uint16 chunkData = 0;
-	int16 chunkWord = 0;
-	uint8 headerByte, filterVal, chunkPos = 0;
-	const double eVal = 1.032226562;
-	uint32 decodeLeft = 0, decodedCount = 0;
-	uint32 uncompressedSize;
-	double sample;
-
 	uint32 copyLeft = 0;
 	uint32 doneRead = 0;
 	char buffer[2048];
@@ -143,96 +114,12 @@ void CompressTinsel::convertTinselADPCMSample (uint32 sampleSize) {
 
 	print("Assuming DW2 sample using ADPCM 6-bit, decoding to 16-bit raw...");
 
-	// Allocate buffer for the ADPCM-compressed sample
-	inBuffer = (byte *)malloc(sampleSize);
-	if (!inBuffer) {
-		print("malloc failed!");
-		return;
-	}
-
-	// Allocate buffer for uncompressed sample data (3 bytes will be uncompressed to 8 bytes)
-	uncompressedSize = (sampleSize/3)*4*2+16;
-	outBuffer = (int16 *)malloc(uncompressedSize);
-	if (!outBuffer) {
-		print("malloc failed!");
-		free(inBuffer);
-		return;
-	}
-
-	_input_smp.read_throwsOnError(inBuffer, sampleSize);
-
-	// 1 channel, 22050 rate, block align 24,
-	blockAlign = 24; // Fixed for Tinsel 6-bit
-	blockPos = blockAlign; // To make sure first header is read
-
-	inPos = inBuffer; outPos = outBuffer;
-	decodeLeft = sampleSize;
-	while (decodeLeft > 0) {
-		if (blockPos == blockAlign) {
-			// read Tinsel header
-			headerByte = *inPos; inPos++; decodeLeft--;
-			filterVal = (headerByte & 0xC0) >> 6;
-
-			if ((headerByte & 0x20) != 0) {
-				//Lower 6 bit are negative
-				// Negate
-				headerByte = ~(headerByte | 0xC0) + 1;
-				predictor = 1 << headerByte;
-			} else {
-				// Lower 6 bit are positive
-				// Truncate
-				headerByte &= 0x1F;
-				predictor = ((double) 1.0) / (1 << headerByte);
-			}
-			k0 = TinselFilterTable[filterVal][0];
-			k1 = TinselFilterTable[filterVal][1];
-			blockPos = 0;
-			chunkPos = 0;
-		}
-
-		switch (chunkPos) {
-		case 0:
-			chunkData = *inPos; inPos++; decodeLeft--;
-			chunkWord = (chunkData << 8) & 0xFC00;
-			break;
-		case 1:
-			chunkData = (chunkData << 8) | *inPos; inPos++; decodeLeft--;
-			blockPos++;
-			chunkWord = (chunkData << 6) & 0xFC00;
-			break;
-		case 2:
-			chunkData = (chunkData << 8) | *inPos; inPos++; decodeLeft--;
-			blockPos++;
-			chunkWord = (chunkData << 4) & 0xFC00;
-			break;
-		case 3:
-			chunkData = chunkData << 8;
-			blockPos++;
-			chunkWord = (chunkData << 2) & 0xFC00;
-			break;
-		}
-		sample = chunkWord;
-		sample *= eVal * predictor;
-		sample += (d0 * k0) + (d1 * k1);
-		d1 = d0;
-		d0 = sample;
-		*outPos = (int16) CLIP<double>(sample, -32768.0, 32767.0); outPos++;
-		decodedCount++;
-		chunkPos = (chunkPos + 1) % 4;
-	}
-
-	Common::removeFile(TEMP_RAW);
-	Common::removeFile(TEMP_ENC);
-
-	curFileHandle.open(TEMP_RAW, "wb");
-	curFileHandle.write(outBuffer, decodedCount*2);
-
-	free(inBuffer);
-	free(outBuffer);
-
-	// Encode this raw data...
-	setRawAudioType(true, false, 16); // LE, mono, 16-bit
-	encodeAudio(TEMP_RAW, true, 22050, TEMP_ENC, _format);
+	// Decode and encode this sample, in chunks
+	int samplePos = _input_smp.pos();
+	Audio::AudioStream *stream = Audio::makeADPCMStream(&_input_smp, sampleSize, Audio::kADPCMTinsel6, 22050, 1, 24);
+	encodeAudioStream(*stream, "tinsel6:" + hashFileRegion(_input_smp, sampleSize), TEMP_ENC, _format);
+	delete stream;
+	_input_smp.seek(samplePos + sampleSize, SEEK_SET);
 
 	// Append compressed data to output_smp
 	curFileHandle.open(TEMP_ENC, "rb");
@@ -258,6 +145,7 @@ void CompressTinsel::execute() {
 	uint32 loopCount = 0;
 	uint32 sampleSize = 0;
 	uint32 sampleCount = 0;
+	std::map<std::string, uint32> convertedEntries;
 
 	Common::Filename inpath_smp = _inputPaths[0].path;
 	Common::Filename inpath_idx = _inputPaths[1].path;
@@ -314,10 +202,30 @@ void CompressTinsel::execute() {
 			_input_smp.seek(indexOffset, SEEK_SET);
 			sampleSize = _input_smp.readUint32LE();
 
-			// Write offset of new data to new index file
-			_output_idx.writeUint32LE(_output_smp.pos());
-
+			// Entries holding the same samples share their converted data
+			uint32 entrySize = 4;
 			if (sampleSize & 0x80000000) {
+				for (sampleCount = sampleSize & ~0x80000000; sampleCount > 0; sampleCount--) {
+					_input_smp.seek(indexOffset + entrySize, SEEK_SET);
+					entrySize += 4 + _input_smp.readUint32LE();
+				}
+			} else {
+				entrySize += sampleSize;
+			}
+			_input_smp.seek(indexOffset, SEEK_SET);
+			std::string entryHash = hashFileRegion(_input_smp, entrySize);
+			_input_smp.seek(indexOffset + 4, SEEK_SET);
+
+			std::map<std::string, uint32>::const_iterator converted = convertedEntries.find(entryHash);
+			if (converted != convertedEntries.end()) {
+				print("Sample %d is the same as a previous one", indexNo);
+				_output_idx.writeUint32LE(converted->second);
+			} else if (sampleSize & 0x80000000) {
+				convertedEntries[entryHash] = _output_smp.pos();
+
+				// Write offset of new data to new index file
+				_output_idx.writeUint32LE(_output_smp.pos());
+
 				// multiple samples in ADPCM format
 				sampleCount = sampleSize & ~0x80000000;
 				// Write sample count to new sample file
@@ -328,6 +236,9 @@ void CompressTinsel::execute() {
 					sampleCount--;
 				}
 			} else {
+				convertedEntries[entryHash] = _output_smp.pos();
+				_output_idx.writeUint32LE(_output_smp.pos());
+
 				// just one sample in raw format
 				convertTinselRawSample(sampleSize);
 			}
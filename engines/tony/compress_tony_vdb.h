@@ -39,14 +39,9 @@ public:
 
 protected:
 	Common::File _input_vdb, _output_enc;
-	ADPCMStatus _status;
 	uint32 _sampleSize;
 	uint32 _rate;
-	byte *_inBuffer;
-	int16 *_outBuffer;
-	uint32 _uncompressedSize;
 
-	int16 decodeIMA(byte code, int channel);
 	bool convertTonyADPCMSample();
 };
 
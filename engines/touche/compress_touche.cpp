@@ -56,6 +56,10 @@ CompressTouche::CompressTouche(const std::string &name) : CompressionTool(name,
 }
 
 InspectionMatch CompressTouche::inspectInput(const Common::Filename &filename) {
+	return inspectFilename(filename);
+}
+
+InspectionMatch CompressTouche::inspectFilename(const Common::Filename &filename) {
 	if (!filename.directory())
 		return IMATCH_AWFUL;
 
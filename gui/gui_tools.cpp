@@ -46,8 +46,8 @@ ToolsGUI::ToolsGUI() {
 }
 
 void ToolsGUI::init() {
-	for (ToolList::iterator tool = _tools.begin(); tool != _tools.end(); ++tool)
-		_toolmap[wxString((*tool)->getName().c_str(), wxConvUTF8)] = new ToolGUI(*tool);
+	for (size_t i = 0; i < getToolCount(); i++)
+		_toolmap[wxString(getTool(i)->getName().c_str(), wxConvUTF8)] = new ToolGUI(getTool(i));
 }
 
 ToolsGUI::~ToolsGUI() {
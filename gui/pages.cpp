@@ -1518,7 +1518,9 @@ ProcessToolThread::ProcessToolThread(const ToolGUI *tool, Configuration &configu
 wxThread::ExitCode ProcessToolThread::Entry() {
 	try {
 		_tool->run(_configuration);
-		_output.buffer += "\nTool finished without errors!\n";
+		wxMutexLocker lock(_output.mutex);
+		_output.buffer += "\nTool finished without errors!\n\n";
+		_output.buffer += _tool->_backend->getTrace().getSummary();
 		_success = true;
 	} catch (ToolException &err) {
 		wxMutexLocker lock(_output.mutex);
@@ -0,0 +1,185 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "sample_cache.h"
+#include "tool_exception.h"
+#include "common/md5.h"
+
+/** Clips are no longer kept in memory once they use this many bytes. */
+static const size_t kMemoryBudget = 256 * 1024 * 1024;
+
+static std::string hexDigest(const uint8 digest[16]) {
+	static const char hexDigits[] = "0123456789abcdef";
+	std::string hex;
+	for (int i = 0; i < 16; i++) {
+		hex += hexDigits[digest[i] >> 4];
+		hex += hexDigits[digest[i] & 0xf];
+	}
+	return hex;
+}
+
+EncodedSampleCache::EncodedSampleCache() : _memorySize(0), _hits(0), _misses(0), _tempFiles(0) {
+}
+
+void EncodedSampleCache::setDirectory(const std::string &directory) {
+	_directory = directory;
+	if (_directory.empty())
+		return;
+
+	char last = _directory[_directory.size() - 1];
+	if (last != '/' && last != '\\')
+		_directory += '/';
+
+	struct stat st;
+	if (stat(directory.c_str(), &st) == 0 && (st.st_mode & S_IFDIR))
+		return;
+#ifdef _WIN32
+	if (_mkdir(directory.c_str()) != 0)
+#else
+	if (mkdir(directory.c_str(), 0755) != 0)
+#endif
+		throw ToolException("Could not create sample cache directory " + directory);
+}
+
+const std::string &EncodedSampleCache::getDirectory() const {
+	return _directory;
+}
+
+std::string EncodedSampleCache::makeKey(const void *data, uint32 size, const std::string &settings) {
+	Common::md5_context ctx;
+	uint8 digest[16];
+
+	Common::md5_starts(&ctx);
+	Common::md5_update(&ctx, (const uint8 *)settings.c_str(), settings.size() + 1);
+	Common::md5_update(&ctx, (const uint8 *)data, size);
+	Common::md5_finish(&ctx, digest);
+	return hexDigest(digest);
+}
+
+std::string EncodedSampleCache::hash(const void *data, uint32 size) {
+	Common::md5_context ctx;
+	uint8 digest[16];
+
+	Common::md5_starts(&ctx);
+	Common::md5_update(&ctx, (const uint8 *)data, size);
+	Common::md5_finish(&ctx, digest);
+	return hexDigest(digest);
+}
+
+std::string EncodedSampleCache::getPath(const std::string &key) const {
+	return _directory + key + ".enc";
+}
+
+uint32 EncodedSampleCache::getHits() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _hits;
+}
+
+uint32 EncodedSampleCache::getMisses() const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _misses;
+}
+
+bool EncodedSampleCache::lookup(const std::string &key, std::string &encoded) {
+	std::unique_lock<std::mutex> lock(_mutex);
+	std::map<std::string, std::string>::const_iterator it = _memory.find(key);
+	if (it != _memory.end()) {
+		encoded = it->second;
+		_hits++;
+		return true;
+	}
+
+	if (!_directory.empty()) {
+		// Other threads may use the memory cache while this one reads the file
+		lock.unlock();
+		bool found = false;
+		FILE *f = fopen(getPath(key).c_str(), "rb");
+		if (f) {
+			fseek(f, 0, SEEK_END);
+			long size = ftell(f);
+			fseek(f, 0, SEEK_SET);
+			encoded.resize(size);
+			found = size > 0 && fread(&encoded[0], 1, size, f) == (size_t)size;
+			fclose(f);
+		}
+		lock.lock();
+
+		if (found) {
+			if (_memorySize + encoded.size() <= kMemoryBudget && _memory.find(key) == _memory.end()) {
+				_memory[key] = encoded;
+				_memorySize += encoded.size();
+			}
+			_hits++;
+			return true;
+		}
+	}
+
+	_misses++;
+	return false;
+}
+
+void EncodedSampleCache::store(const std::string &key, const std::string &encoded) {
+	if (encoded.empty())
+		return;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	if (_memorySize + encoded.size() <= kMemoryBudget && _memory.find(key) == _memory.end()) {
+		_memory[key] = encoded;
+		_memorySize += encoded.size();
+	}
+	uint32 tempFile = _tempFiles++;
+	lock.unlock();
+
+	if (!_directory.empty()) {
+		// Write under a temporary name first, so that several tools can share the
+		// directory without ever reading a partially written clip
+		char suffix[48];
+		snprintf(suffix, sizeof(suffix), ".%d.%u.tmp", (int)getpid(), tempFile);
+		std::string path = getPath(key);
+		std::string tempPath = path + suffix;
+
+		FILE *f = fopen(tempPath.c_str(), "wb");
+		if (!f)
+			return;
+		bool ok = fwrite(encoded.data(), 1, encoded.size(), f) == encoded.size();
+		ok = (fclose(f) == 0) && ok;
+		if (!ok || rename(tempPath.c_str(), path.c_str()) != 0)
+			remove(tempPath.c_str());
+	}
+}
+
+void EncodedSampleCache::clear() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_memory.clear();
+	_memorySize = 0;
+}
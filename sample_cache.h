@@ -0,0 +1,107 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "common/scummsys.h"
+
+/**
+ * Cache of encoded audio, keyed by the audio data and the encoder settings.
+ *
+ * Games often store the same clip several times, and compressing a game again
+ * after a small patch encodes mostly the same clips as before. The cache is
+ * kept in memory for the duration of a run and, if a directory is given, on
+ * disk across runs, one file per encoded clip.
+ *
+ * Lookups and stores may be made from several threads at once.
+ */
+class EncodedSampleCache {
+public:
+	EncodedSampleCache();
+
+	/**
+	 * Sets the directory in which encoded clips are kept across runs.
+	 * The directory is created if needed. An empty path disables the disk cache.
+	 *
+	 * @throws ToolException if the directory can not be created.
+	 */
+	void setDirectory(const std::string &directory);
+
+	/** Returns the directory of the disk cache, or an empty string. */
+	const std::string &getDirectory() const;
+
+	/**
+	 * Computes the key of a clip.
+	 *
+	 * @param data     The audio data, as passed to the encoder.
+	 * @param size     Size of the data.
+	 * @param settings Everything else that affects the output of the encoder.
+	 */
+	static std::string makeKey(const void *data, uint32 size, const std::string &settings);
+
+	/** Returns the MD5 of a buffer, as a hexadecimal string. */
+	static std::string hash(const void *data, uint32 size);
+
+	/**
+	 * Looks up an encoded clip, first in memory, then on disk.
+	 *
+	 * @param key     The key of the clip.
+	 * @param encoded Receives the encoded clip if found.
+	 * @return true if the clip was found.
+	 */
+	bool lookup(const std::string &key, std::string &encoded);
+
+	/**
+	 * Adds an encoded clip to the cache.
+	 *
+	 * @param key     The key of the clip.
+	 * @param encoded The encoded clip.
+	 */
+	void store(const std::string &key, const std::string &encoded);
+
+	/** Forgets the clips kept in memory. */
+	void clear();
+
+	/** Number of lookups which found a clip. */
+	uint32 getHits() const;
+	/** Number of lookups which did not find a clip. */
+	uint32 getMisses() const;
+
+private:
+	std::string getPath(const std::string &key) const;
+
+	std::string _directory;
+	std::map<std::string, std::string> _memory;
+	/** Total size of the clips in _memory. */
+	size_t _memorySize;
+	uint32 _hits;
+	uint32 _misses;
+	/** Numbers the temporary files of the disk cache, which all threads share. */
+	uint32 _tempFiles;
+	mutable std::mutex _mutex;
+};
+
+#endif
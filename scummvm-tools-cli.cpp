@@ -22,11 +22,18 @@
 /* CLI interface for the tools */
 
 #include <iostream>
+#include <fstream>
 #include <algorithm>
+#include <thread>
 #include <assert.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 
 #include "scummvm-tools-cli.h"
+#include "batch.h"
+#include "tool_exception.h"
 #include "version.h"
+#include "common/file_hash.h"
 
 ToolsCLI::ToolsCLI() {
 }
@@ -59,12 +66,10 @@ int ToolsCLI::run(int argc, char *argv[]) {
 	if (option == "--tool" || option == "-t") {
 		arguments.pop_front();
 		if (arguments.size()) {
-			for (ToolList::iterator iter = _tools.begin(); iter != _tools.end(); ++iter) {
-				Tool *tool = *iter;
-				if (arguments.front() == tool->getName()) {
-					// Run the tool, first argument will be name, very nice!
-					return tool->run(arguments);
-				}
+			Tool *tool = getTool(arguments.front());
+			if (tool) {
+				// Run the tool, first argument will be name, very nice!
+				return tool->run(arguments);
 			}
 			std::cout << "\tUnknown tool, make sure you input one of the following:" << std::endl;
 		} else {
@@ -75,18 +80,19 @@ int ToolsCLI::run(int argc, char *argv[]) {
 		arguments.pop_front();
 
 		if (arguments.size()) {
-			for (ToolList::iterator iter = _tools.begin(); iter != _tools.end(); ++iter) {
-				Tool *tool = *iter;
-				if (arguments.front() == tool->getName()) {
-					// Obtain the help text for this tool and print it
-					std::cout << tool->getHelp() << std::endl;
-					return 2;
-				}
+			Tool *tool = getTool(arguments.front());
+			if (tool) {
+				// Obtain the help text for this tool and print it
+				std::cout << tool->getHelp() << std::endl;
+				return 2;
 			}
 			std::cout << std::endl << "Unknown help topic '" << arguments[0] << "'" << std::endl;
 		}
 		printHelp(argv[0]);
 		return 2;
+	} else if (option == "--batch" || option == "-b") {
+		arguments.pop_front();
+		return runBatch(argv[0], arguments);
 	} else if (option == "--list" || option == "-l") {
 		printTools();
 	} else if (option == "--version") {
@@ -199,6 +205,76 @@ int ToolsCLI::run(int argc, char *argv[]) {
 	return 0;
 }
 
+static void printNothing(void *, const char *) {
+}
+
+int ToolsCLI::runBatch(const char *exeName, std::deque<std::string> &arguments) {
+	if (arguments.empty()) {
+		std::cout << "\tMissing manifest or directory after '--batch'" << std::endl;
+		return 2;
+	}
+	std::string source = arguments.front();
+	arguments.pop_front();
+
+	unsigned int jobs = std::thread::hardware_concurrency();
+	std::string outputPath;
+	std::string summaryPath;
+	std::deque<std::string> options;
+	while (!arguments.empty()) {
+		std::string arg = arguments.front();
+		arguments.pop_front();
+		if ((arg == "-j" || arg == "--jobs" || arg == "-o" || arg == "--output" || arg == "--summary") && arguments.empty()) {
+			std::cout << "\tExpected a value after '" << arg << "'" << std::endl;
+			return 2;
+		}
+		if (arg == "-j" || arg == "--jobs") {
+			char *end;
+			long value = strtol(arguments.front().c_str(), &end, 10);
+			if (*end != '\0' || value < 1) {
+				std::cout << "\tThe number of jobs must be a positive integer, not '" << arguments.front() << "'" << std::endl;
+				return 2;
+			}
+			jobs = (unsigned int)value;
+			arguments.pop_front();
+		} else if (arg == "-o" || arg == "--output") {
+			outputPath = arguments.front();
+			arguments.pop_front();
+		} else if (arg == "--summary") {
+			summaryPath = arguments.front();
+			arguments.pop_front();
+		} else if (arg == "--hash-cache") {
+			Common::FileHashCache::instance().setSidecarEnabled(true);
+		} else {
+			options.push_back(arg);
+		}
+	}
+
+	// Some tools print while inspecting their input, keep that out of the summary
+	setPrintFunction(printNothing, NULL);
+
+	BatchRunner batch(*this, exeName);
+	int failed;
+	try {
+		struct stat st;
+		if (stat(source.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+			batch.addDirectory(source, options);
+		else
+			batch.addManifest(source);
+		failed = batch.run(outputPath, jobs ? jobs : 1);
+	} catch (ToolException &err) {
+		std::cout << "\tFatal Error : " << err.what() << std::endl;
+		return err._retcode;
+	}
+
+	if (summaryPath.empty()) {
+		batch.writeSummary(std::cout);
+	} else {
+		std::ofstream summary(summaryPath.c_str());
+		batch.writeSummary(summary);
+	}
+	return failed ? 1 : 0;
+}
+
 void ToolsCLI::printHelp(const char *exeName) {
 	std::cout <<
 		gScummVMToolsFullVersion << std::endl <<
@@ -211,6 +287,18 @@ void ToolsCLI::printHelp(const char *exeName) {
 		"  --help\tDisplay this text" << std::endl <<
 		"  --version\tDisplay version information" << std::endl <<
 		"  --list\tList all tools that are available" << std::endl <<
+		std::endl <<
+		"Tool options, given anywhere before the input files:" << std::endl <<
+		"  --trace <file>\tWrite the time spent and the data processed in each phase of the tool to a file" << std::endl <<
+		"  --trace-format <json|chrome>\tFormat of the trace, the default is json. Chrome traces can be loaded in chrome://tracing" << std::endl <<
+		std::endl <<
+		"Batch mode:" << std::endl <<
+		"  " << exeName << " --batch <manifest|directory> [-j <jobs>] [-o <output directory>] [--summary <file>] [--hash-cache] [tool options]" << std::endl <<
+		"    Runs all the jobs listed in a manifest, one per line as '<tool name|auto> [options] <input files>'," << std::endl <<
+		"    or every input found in a directory of game installs, several at a time. A JSON summary of the" << std::endl <<
+		"    jobs is written to the given file, or to the standard output. With --hash-cache, the digests" << std::endl <<
+		"    used to recognize game files are kept in a .scummvm-tools-md5 file in each directory, which" << std::endl <<
+		"    makes later runs over the same directories faster." << std::endl <<
 		"";
 }
 
@@ -221,7 +309,7 @@ void ToolsCLI::printVersion() {
 
 void ToolsCLI::printTools() {
 	std::cout << std::endl << "All available tools:" << std::endl;
-	for (ToolList::iterator tool = _tools.begin(); tool != _tools.end(); ++tool)
+	for (size_t i = 0; i < getToolCount(); i++)
 		// There *really* should be a short version of the help text available
-		std::cout << "\t" << (*tool)->getName() << ":\t" << (*tool)->getShortHelp() << std::endl;
+		std::cout << "\t" << getTool(i)->getName() << ":\t" << getTool(i)->getShortHelp() << std::endl;
 }
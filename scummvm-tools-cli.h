@@ -33,6 +33,15 @@ public:
 
 	int run(int argc, char *argv[]);
 
+	/**
+	 * Runs the jobs of a manifest, or of a directory of game installs.
+	 *
+	 * @param exeName   Path to this executable, used to start the jobs.
+	 * @param arguments The arguments following '--batch'.
+	 * @return 0 if all the jobs succeeded.
+	 */
+	int runBatch(const char *exeName, std::deque<std::string> &arguments);
+
 	void printHelp(const char *exeName);
 	void printVersion();
 	void printTools();
@@ -28,13 +28,69 @@
 
 namespace Audio {
 
-// TODO: Switch from a SeekableReadStream to a plain ReadStream. This requires
-// some internal refactoring but is definitely possible and will increase the
-// flexibility of this code.
+static const int16 stepAdjustTable[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+static const int16 okiStepSize[49] = {
+	  16,   17,   19,   21,   23,   25,   28,   31,
+	  34,   37,   41,   45,   50,   55,   60,   66,
+	  73,   80,   88,   97,  107,  118,  130,  143,
+	 157,  173,  190,  209,  230,  253,  279,  307,
+	 337,  371,  408,  449,  494,  544,  598,  658,
+	 724,  796,  876,  963, 1060, 1166, 1282, 1411,
+	1552
+};
+
+static const uint16 imaStepTable[89] = {
+		7,	  8,	9,	 10,   11,	 12,   13,	 14,
+	   16,	 17,   19,	 21,   23,	 25,   28,	 31,
+	   34,	 37,   41,	 45,   50,	 55,   60,	 66,
+	   73,	 80,   88,	 97,  107,	118,  130,	143,
+	  157,	173,  190,	209,  230,	253,  279,	307,
+	  337,	371,  408,	449,  494,	544,  598,	658,
+	  724,	796,  876,	963, 1060, 1166, 1282, 1411,
+	 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+	 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
+	 7132, 7845, 8630, 9493,10442,11487,12635,13899,
+	15289,16818,18500,20350,22385,24623,27086,29794,
+	32767
+};
+
+/**
+ * Difference and next step index for every pair of step index and code, so
+ * that decoding a nibble is two table lookups and a clip.
+ */
+template<int kSteps>
+struct ADPCMStepTables {
+	int32 diff[kSteps * 16];
+	byte nextIndex[kSteps * 16];
+
+	template<typename T>
+	explicit ADPCMStepTables(const T *stepSizes) {
+		for (int index = 0; index < kSteps; index++) {
+			for (int code = 0; code < 16; code++) {
+				int32 E = (2 * (code & 0x7) + 1) * stepSizes[index] / 8;
+				diff[index * 16 + code] = (code & 0x08) ? -E : E;
+				nextIndex[index * 16 + code] = (byte)CLIP<int>(index + stepAdjustTable[code & 0x07], 0, kSteps - 1);
+			}
+		}
+	}
+};
+
+static const ADPCMStepTables<ARRAYSIZE(okiStepSize)> okiTables(okiStepSize);
+static const ADPCMStepTables<ARRAYSIZE(imaStepTable)> imaTables(imaStepTable);
+
 class ADPCMInputStream : public AudioStream {
 private:
+	enum {
+		kBufferSize = 4096 ///< Size of the blocks read from the file.
+	};
+
 	Common::File *_stream;
-	uint32 _endpos;
+	uint32 _fileLeft;    ///< Bytes of the data not yet read from the file.
+	const byte *_pos;    ///< Next byte of the data.
+	const byte *_end;    ///< End of the data available in memory.
+	byte _buffer[kBufferSize];
+
 	int _channels;
 	typesADPCM _type;
 	uint32 _blockAlign;
@@ -58,15 +114,55 @@ private:
 
 		// MS ADPCM
 		ADPCMChannelStatus ch[2];
+
+		// IMA, per channel
+		int32 imaLast[2];
+		int32 imaStepIndex[2];
+
+		// Tinsel
+		double predictor;
+		double scale;       ///< TinselScale * predictor.
+		double k0, k1;
+		double d0, d1;
+		uint16 chunkData;
+		byte chunkPos;
 	} _status;
 
-	int16 stepAdjust(byte);
+	void refill();
+
+	bool hasData() const { return _pos < _end || _fileLeft > 0; }
+
+	byte getByte() {
+		if (_pos == _end) {
+			refill();
+			if (_pos == _end)
+				return 0;
+		}
+		return *_pos++;
+	}
+
+	int16 getSint16LE() {
+		byte b0 = getByte();
+		return (int16)(b0 | (getByte() << 8));
+	}
+
+	uint32 getUint32LE() {
+		uint32 b0 = getByte();
+		uint32 b1 = getByte();
+		uint32 b2 = getByte();
+		return b0 | (b1 << 8) | (b2 << 16) | ((uint32)getByte() << 24);
+	}
+
 	int16 decodeOKI(byte);
 	int16 decodeMSIMA(byte);
+	int16 decodeIMA(byte, int channel);
 	int16 decodeMS(ADPCMChannelStatus *c, byte);
 
+	void init(uint32 size);
+
 public:
 	ADPCMInputStream(Common::File *stream, uint32 size, typesADPCM type, int rate, int channels = 2, uint32 blockAlign = 0);
+	ADPCMInputStream(const byte *data, uint32 size, typesADPCM type, int rate, int channels = 2, uint32 blockAlign = 0);
 	~ADPCMInputStream() {}
 
 	int readBuffer(int16 *buffer, const int numSamples);
@@ -74,9 +170,11 @@ public:
 	int readBufferMSIMA1(int16 *buffer, const int numSamples);
 	int readBufferMSIMA2(int16 *buffer, const int numSamples);
 	int readBufferMS(int channels, int16 *buffer, const int numSamples);
+	int readBufferIMA(int16 *buffer, const int numSamples);
+	int readBufferTinsel6(int16 *buffer, const int numSamples);
 
-	bool endOfData() const { return (_stream->eos() || _stream->pos() >= (int)_endpos); }
-	bool isStereo() const	{ return false; }
+	bool endOfData() const { return !hasData(); }
+	bool isStereo() const	{ return _type != kADPCMOki && _channels == 2; }
 	int getRate() const	{ return _rate; }
 };
 
@@ -88,18 +186,39 @@ public:
 //   <http://wiki.multimedia.cx/index.php?title=Microsoft_IMA_ADPCM>.
 
 ADPCMInputStream::ADPCMInputStream(Common::File *stream, uint32 size, typesADPCM type, int rate, int channels, uint32 blockAlign)
-	: _stream(stream), _channels(channels), _type(type), _blockAlign(blockAlign), _rate(rate) {
+	: _stream(stream), _fileLeft(size), _pos(_buffer), _end(_buffer), _channels(channels), _type(type), _blockAlign(blockAlign), _rate(rate) {
+	init(size);
+}
+
+ADPCMInputStream::ADPCMInputStream(const byte *data, uint32 size, typesADPCM type, int rate, int channels, uint32 blockAlign)
+	: _stream(0), _fileLeft(0), _pos(data), _end(data + size), _channels(channels), _type(type), _blockAlign(blockAlign), _rate(rate) {
+	init(size);
+}
 
-	_status.last = 0;
-	_status.stepIndex = 0;
-	memset(_status.ch, 0, sizeof(_status.ch));
-	_endpos = stream->pos() + size;
+void ADPCMInputStream::init(uint32 size) {
+	memset(&_status, 0, sizeof(_status));
 	_blockPos = _blockLen = 0;
 
-	if (type == kADPCMMSIma && blockAlign == 0)
+	if (_type == kADPCMMSIma && _blockAlign == 0)
 		error("ADPCMInputStream(): blockAlign isn't specifiled for MS IMA ADPCM");
-	if (type == kADPCMMS && blockAlign == 0)
+	if (_type == kADPCMMS && _blockAlign == 0)
 		error("ADPCMInputStream(): blockAlign isn't specifiled for MS ADPCM");
+	if (_type == kADPCMTinsel6 && _blockAlign == 0)
+		error("ADPCMInputStream(): blockAlign isn't specifiled for Tinsel ADPCM");
+
+	// Start with a block header
+	if (_type == kADPCMTinsel6)
+		_blockPos = _blockAlign;
+}
+
+void ADPCMInputStream::refill() {
+	if (!_fileLeft)
+		return;
+	uint32 size = MIN<uint32>(_fileLeft, kBufferSize);
+	_stream->read_throwsOnError(_buffer, size);
+	_fileLeft -= size;
+	_pos = _buffer;
+	_end = _buffer + size;
 }
 
 int ADPCMInputStream::readBuffer(int16 *buffer, const int numSamples) {
@@ -116,6 +235,12 @@ int ADPCMInputStream::readBuffer(int16 *buffer, const int numSamples) {
 	case kADPCMMS:
 		return readBufferMS(_channels, buffer, numSamples);
 		break;
+	case kADPCMIma:
+		return readBufferIMA(buffer, numSamples);
+		break;
+	case kADPCMTinsel6:
+		return readBufferTinsel6(buffer, numSamples);
+		break;
 	default:
 		error("Unsupported ADPCM encoding");
 		break;
@@ -129,10 +254,10 @@ int ADPCMInputStream::readBufferOKI(int16 *buffer, const int numSamples) {
 
 	assert(numSamples % 2 == 0);
 
-	for (samples = 0; samples < numSamples && !_stream->eos() && _stream->pos() < (int)_endpos; samples += 2) {
-		data = _stream->readByte();
-		WRITE_LE_UINT16(buffer + samples,     decodeOKI((data >> 4) & 0x0f));
-		WRITE_LE_UINT16(buffer + samples + 1, decodeOKI(data & 0x0f));
+	for (samples = 0; samples < numSamples && hasData(); samples += 2) {
+		data = getByte();
+		buffer[samples]     = decodeOKI((data >> 4) & 0x0f);
+		buffer[samples + 1] = decodeOKI(data & 0x0f);
 	}
 	return samples;
 }
@@ -146,19 +271,19 @@ int ADPCMInputStream::readBufferMSIMA1(int16 *buffer, const int numSamples) {
 
 	samples = 0;
 
-	while (samples < numSamples && !_stream->eos() && _stream->pos() < (int)_endpos) {
+	while (samples < numSamples && hasData()) {
 		if (_blockPos == _blockAlign) {
 			// read block header
-			_status.last = _stream->readSint16LE();
-			_status.stepIndex = _stream->readSint16LE();
+			_status.last = getSint16LE();
+			_status.stepIndex = CLIP<int32>(getSint16LE(), 0, ARRAYSIZE(imaStepTable) - 1);
 			_blockPos = 4;
 		}
 
-		for (; samples < numSamples && _blockPos < _blockAlign && !_stream->eos() && _stream->pos() < (int)_endpos; samples += 2) {
-			data = _stream->readByte();
+		for (; samples < numSamples && _blockPos < _blockAlign && hasData(); samples += 2) {
+			data = getByte();
 			_blockPos++;
-			WRITE_LE_UINT16(buffer + samples,     decodeMSIMA(data & 0x0f));
-			WRITE_LE_UINT16(buffer + samples + 1, decodeMSIMA((data >> 4) & 0x0f));
+			buffer[samples]     = decodeMSIMA(data & 0x0f);
+			buffer[samples + 1] = decodeMSIMA((data >> 4) & 0x0f);
 		}
 	}
 	return samples;
@@ -172,13 +297,13 @@ int ADPCMInputStream::readBufferMSIMA2(int16 *buffer, const int numSamples) {
 	uint32 data;
 	int nibble;
 
-	for (samples = 0; samples < numSamples && !_stream->eos() && _stream->pos() < (int)_endpos;) {
+	for (samples = 0; samples < numSamples && hasData();) {
 		for (int channel = 0; channel < 2; channel++) {
-			data = _stream->readUint32LE();
+			data = getUint32LE();
 
 			for (nibble = 0; nibble < 8; nibble++) {
 				byte k = ((data & 0xf0000000) >> 28);
-				WRITE_LE_UINT16(buffer + samples + channel + nibble * 2, decodeMSIMA(k));
+				buffer[samples + channel + nibble * 2] = decodeMSIMA(k);
 				data <<= 4;
 			}
 		}
@@ -187,6 +312,138 @@ int ADPCMInputStream::readBufferMSIMA2(int16 *buffer, const int numSamples) {
 	return samples;
 }
 
+int ADPCMInputStream::readBufferIMA(int16 *buffer, const int numSamples) {
+	int samples;
+	byte data;
+
+	assert(numSamples % 2 == 0);
+
+	for (samples = 0; samples < numSamples && hasData(); samples += 2) {
+		data = getByte();
+		buffer[samples]     = decodeIMA((data >> 4) & 0x0f, 0);
+		buffer[samples + 1] = decodeIMA(data & 0x0f, _channels == 2 ? 1 : 0);
+	}
+	return samples;
+}
+
+static const double TinselFilterTable[4][2] = {
+	{0, 0 },
+	{0.9375, 0},
+	{1.796875, -0.8125},
+	{1.53125, -0.859375}
+};
+
+static const double TinselScale = 1.032226562;
+
+// Every block starts with a header byte giving the filter and the scale of
+// the block, followed by groups of 3 bytes holding four 6-bit samples.
+//
+// The filter is computed in double precision, exactly as the original decoder
+// did: the output is truncated, so any other arithmetic would change samples
+// whose filtered value lies close to an integer. Whole groups of 3 bytes are
+// decoded at once, with the filter state kept in local variables.
+int ADPCMInputStream::readBufferTinsel6(int16 *buffer, const int numSamples) {
+	int samples = 0;
+	int16 chunkWord = 0;
+	double sample;
+
+	while (samples < numSamples && hasData()) {
+		if (_blockPos == _blockAlign) {
+			// read Tinsel header
+			byte headerByte = getByte();
+			byte filterVal = (headerByte & 0xC0) >> 6;
+
+			if ((headerByte & 0x20) != 0) {
+				//Lower 6 bit are negative
+				// Negate
+				headerByte = ~(headerByte | 0xC0) + 1;
+				_status.predictor = 1 << headerByte;
+			} else {
+				// Lower 6 bit are positive
+				// Truncate
+				headerByte &= 0x1F;
+				_status.predictor = ((double) 1.0) / (1 << headerByte);
+			}
+			_status.scale = TinselScale * _status.predictor;
+			_status.k0 = TinselFilterTable[filterVal][0];
+			_status.k1 = TinselFilterTable[filterVal][1];
+			_blockPos = 0;
+			_status.chunkPos = 0;
+
+			if (!hasData())
+				break;
+		}
+
+		if (_status.chunkPos == 0) {
+			const double scale = _status.scale;
+			const double k0 = _status.k0;
+			const double k1 = _status.k1;
+			double d0 = _status.d0;
+			double d1 = _status.d1;
+
+			// The last sample of a group is only decoded if more data follows,
+			// hence the fourth byte
+			while (numSamples - samples >= 4 && _blockAlign - _blockPos >= 3 && _end - _pos >= 4) {
+				const byte b0 = _pos[0];
+				const byte b1 = _pos[1];
+				const byte b2 = _pos[2];
+				const int16 words[4] = {
+					(int16)((b0 << 8) & 0xFC00),
+					(int16)((((b0 << 8) | b1) << 6) & 0xFC00),
+					(int16)((((b1 << 8) | b2) << 4) & 0xFC00),
+					(int16)((b2 << 10) & 0xFC00)
+				};
+				_pos += 3;
+				_blockPos += 3;
+
+				for (int i = 0; i < 4; i++) {
+					sample = words[i];
+					sample *= scale;
+					sample += (d0 * k0) + (d1 * k1);
+					d1 = d0;
+					d0 = sample;
+					buffer[samples++] = (int16)CLIP<double>(sample, -32768.0, 32767.0);
+				}
+			}
+
+			_status.d0 = d0;
+			_status.d1 = d1;
+			if (samples == numSamples || _blockPos == _blockAlign)
+				continue;
+		}
+
+		switch (_status.chunkPos) {
+		case 0:
+			_status.chunkData = getByte();
+			chunkWord = (_status.chunkData << 8) & 0xFC00;
+			break;
+		case 1:
+			_status.chunkData = (_status.chunkData << 8) | getByte();
+			_blockPos++;
+			chunkWord = (_status.chunkData << 6) & 0xFC00;
+			break;
+		case 2:
+			_status.chunkData = (_status.chunkData << 8) | getByte();
+			_blockPos++;
+			chunkWord = (_status.chunkData << 4) & 0xFC00;
+			break;
+		case 3:
+			_status.chunkData = _status.chunkData << 8;
+			_blockPos++;
+			chunkWord = (_status.chunkData << 2) & 0xFC00;
+			break;
+		}
+		sample = chunkWord;
+		sample *= _status.scale;
+		sample += (_status.d0 * _status.k0) + (_status.d1 * _status.k1);
+		_status.d1 = _status.d0;
+		_status.d0 = sample;
+		buffer[samples++] = (int16)CLIP<double>(sample, -32768.0, 32767.0);
+		_status.chunkPos = (_status.chunkPos + 1) % 4;
+	}
+	return samples;
+}
+
 static const int MSADPCMAdaptCoeff1[] = {
 	256, 512, 0, 192, 240, 460, 392
 };
@@ -202,39 +459,39 @@ int ADPCMInputStream::readBufferMS(int channels, int16 *buffer, const int numSam
 
 	samples = 0;
 
-	while (samples < numSamples && !_stream->eos() && _stream->pos() < (int)_endpos) {
+	while (samples < numSamples && hasData()) {
 		if (_blockPos == _blockAlign) {
 			// read block header
-			_status.ch[0].predictor = CLIP(_stream->readByte(), (byte)0, (byte)6);
+			_status.ch[0].predictor = CLIP(getByte(), (byte)0, (byte)6);
 			_status.ch[0].coeff1 = MSADPCMAdaptCoeff1[_status.ch[0].predictor];
 			_status.ch[0].coeff2 = MSADPCMAdaptCoeff2[_status.ch[0].predictor];
 			if (stereo) {
-				_status.ch[1].predictor = CLIP(_stream->readByte(), (byte)0, (byte)6);
+				_status.ch[1].predictor = CLIP(getByte(), (byte)0, (byte)6);
 				_status.ch[1].coeff1 = MSADPCMAdaptCoeff1[_status.ch[1].predictor];
 				_status.ch[1].coeff2 = MSADPCMAdaptCoeff2[_status.ch[1].predictor];
 			}
 
-			_status.ch[0].delta = _stream->readSint16LE();
+			_status.ch[0].delta = getSint16LE();
 			if (stereo)
-				_status.ch[1].delta = _stream->readSint16LE();
+				_status.ch[1].delta = getSint16LE();
 
-			buffer[samples++] = _status.ch[0].sample1 = _stream->readSint16LE();
+			buffer[samples++] = _status.ch[0].sample1 = getSint16LE();
 			if (stereo)
-				buffer[samples++] = _status.ch[1].sample1 = _stream->readSint16LE();
+				buffer[samples++] = _status.ch[1].sample1 = getSint16LE();
 
-			buffer[samples++] = _status.ch[0].sample2 = _stream->readSint16LE();
+			buffer[samples++] = _status.ch[0].sample2 = getSint16LE();
 			if (stereo)
-				buffer[samples++] = _status.ch[1].sample2 = _stream->readSint16LE();
+				buffer[samples++] = _status.ch[1].sample2 = getSint16LE();
 
 			_blockPos = channels * 7;
 		}
 
 
-		for (; samples < numSamples && _blockPos < _blockAlign && !_stream->eos() && _stream->pos() < (int)_endpos; samples += 2) {
-			data = _stream->readByte();
+		for (; samples < numSamples && _blockPos < _blockAlign && hasData(); samples += 2) {
+			data = getByte();
 			_blockPos++;
-			WRITE_LE_UINT16(buffer + samples,     decodeMS(&_status.ch[0], (data >> 4) & 0x0f));
-			WRITE_LE_UINT16(buffer + samples + 1, decodeMS(&_status.ch[stereo], data & 0x0f));
+			buffer[samples]     = decodeMS(&_status.ch[0], (data >> 4) & 0x0f);
+			buffer[samples + 1] = decodeMS(&_status.ch[stereo], data & 0x0f);
 		}
 	}
 
@@ -242,83 +499,37 @@ int ADPCMInputStream::readBufferMS(int channels, int16 *buffer, const int numSam
 }
 
 
-// adjust the step for use on the next sample.
-int16 ADPCMInputStream::stepAdjust(byte code) {
-	static const int16 adjusts[] = {-1, -1, -1, -1, 2, 4, 6, 8};
-
-	return adjusts[code & 0x07];
-}
-
-static const int16 okiStepSize[49] = {
-	  16,   17,   19,   21,   23,   25,   28,   31,
-	  34,   37,   41,   45,   50,   55,   60,   66,
-	  73,   80,   88,   97,  107,  118,  130,  143,
-	 157,  173,  190,  209,  230,  253,  279,  307,
-	 337,  371,  408,  449,  494,  544,  598,  658,
-	 724,  796,  876,  963, 1060, 1166, 1282, 1411,
-	1552
-};
-
 // Decode Linear to ADPCM
 int16 ADPCMInputStream::decodeOKI(byte code) {
-	int16 diff, E, samp;
-
-	E = (2 * (code & 0x7) + 1) * okiStepSize[_status.stepIndex] / 8;
-	diff = (code & 0x08) ? -E : E;
-	samp = _status.last + diff;
+	int entry = _status.stepIndex * 16 + code;
+	int32 samp = _status.last + okiTables.diff[entry];
 
-    // Clip the values to +/- 2^11 (supposed to be 12 bits)
-	if (samp > 2048)
-		samp = 2048;
-	if (samp < -2048)
-		samp = -2048;
+	// Clip the values to +/- 2^11 (supposed to be 12 bits)
+	samp = CLIP<int32>(samp, -2048, 2048);
 
 	_status.last = samp;
-	_status.stepIndex += stepAdjust(code);
-	if (_status.stepIndex < 0)
-		_status.stepIndex = 0;
-	if (_status.stepIndex > ARRAYSIZE(okiStepSize) - 1)
-		_status.stepIndex = ARRAYSIZE(okiStepSize) - 1;
+	_status.stepIndex = okiTables.nextIndex[entry];
 
 	// * 16 effectively converts 12-bit input to 16-bit output
 	return samp * 16;
 }
 
-
-static const uint16 imaStepTable[89] = {
-		7,	  8,	9,	 10,   11,	 12,   13,	 14,
-	   16,	 17,   19,	 21,   23,	 25,   28,	 31,
-	   34,	 37,   41,	 45,   50,	 55,   60,	 66,
-	   73,	 80,   88,	 97,  107,	118,  130,	143,
-	  157,	173,  190,	209,  230,	253,  279,	307,
-	  337,	371,  408,	449,  494,	544,  598,	658,
-	  724,	796,  876,	963, 1060, 1166, 1282, 1411,
-	 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
-	 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484,
-	 7132, 7845, 8630, 9493,10442,11487,12635,13899,
-	15289,16818,18500,20350,22385,24623,27086,29794,
-	32767
-};
-
 int16 ADPCMInputStream::decodeMSIMA(byte code) {
-	int32 diff, E, samp;
+	int entry = _status.stepIndex * 16 + code;
+	int32 samp = CLIP<int32>(_status.last + imaTables.diff[entry], -0x8000, 0x7fff);
 
-	E = (2 * (code & 0x7) + 1) * imaStepTable[_status.stepIndex] / 8;
-	diff = (code & 0x08) ? -E : E;
-	samp = _status.last + diff;
+	_status.last = samp;
+	_status.stepIndex = imaTables.nextIndex[entry];
 
-	if (samp < -0x8000)
-		samp = -0x8000;
-	else if (samp > 0x7fff)
-		samp = 0x7fff;
+	return samp;
+}
 
-	_status.last = samp;
+int16 ADPCMInputStream::decodeIMA(byte code, int channel) {
+	int entry = _status.imaStepIndex[channel] * 16 + code;
+	int32 samp = CLIP<int32>(_status.imaLast[channel] + imaTables.diff[entry], -0x8000, 0x7fff);
 
-	_status.stepIndex += stepAdjust(code);
-	if (_status.stepIndex < 0)
-		_status.stepIndex = 0;
-	if (_status.stepIndex > ARRAYSIZE(imaStepTable) - 1)
-		_status.stepIndex = ARRAYSIZE(imaStepTable) - 1;
+	_status.imaLast[channel] = samp;
+	_status.imaStepIndex[channel] = imaTables.nextIndex[entry];
 
 	return samp;
 }
@@ -354,4 +565,8 @@ AudioStream *makeADPCMStream(Common::File *stream, uint32 size, typesADPCM type,
 	return new ADPCMInputStream(stream, size, type, rate, channels, blockAlign);
 }
 
+AudioStream *makeADPCMStream(const byte *data, uint32 size, typesADPCM type, int rate, int channels, uint32 blockAlign) {
+	return new ADPCMInputStream(data, size, type, rate, channels, blockAlign);
+}
+
 } // End of namespace Audio
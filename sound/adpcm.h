@@ -32,11 +32,34 @@ class AudioStream;
 enum typesADPCM {
 	kADPCMOki,
 	kADPCMMSIma,
-	kADPCMMS
+	kADPCMMS,
+	kADPCMIma,     ///< Plain IMA nibbles, high nibble first (Tony Tough)
+	kADPCMTinsel6  ///< Tinsel 6-bit ADPCM, in blocks of blockAlign bytes after a header byte (Discworld 2)
 };
 
+/**
+ * Creates a stream decoding ADPCM data read from a file.
+ *
+ * The data is read from the current position of the file, in blocks, and the
+ * file is left after the last byte read. The samples are produced on demand
+ * by readBuffer(), so a caller pulling them in chunks never holds the whole
+ * decoded sample in memory.
+ *
+ * @param stream     The file to read from.
+ * @param size       Size of the ADPCM data.
+ * @param type       Type of ADPCM encoding.
+ * @param rate       Sample rate of the decoded data.
+ * @param channels   Number of channels.
+ * @param blockAlign Size of a block, for the block based encodings.
+ */
 AudioStream *makeADPCMStream(Common::File *stream, uint32 size, typesADPCM type, int rate = 22050, int channels = 2, uint32 blockAlign = 0);
 
+/**
+ * Creates a stream decoding ADPCM data from memory. The data is not copied and
+ * must stay valid until the stream is deleted.
+ */
+AudioStream *makeADPCMStream(const byte *data, uint32 size, typesADPCM type, int rate = 22050, int channels = 2, uint32 blockAlign = 0);
+
 } // End of namespace Audio
 
 #endif
@@ -24,10 +24,12 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 
 #include "common/file.h"
+#include "common/util.h"
 #include "tool.h"
 #include "version.h"
 
@@ -50,6 +52,8 @@ Tool::Tool(const std::string &name, ToolType type) {
 
 	_abort = false;
 
+	_traceFormat = "json";
+
 	_helptext = "\nUsage: tool [-o outputname] <infile>";
 }
 
@@ -63,6 +67,9 @@ int Tool::run(const std::deque<std::string> &args) {
 	// Pop the first argument (name of ourselves)
 	_arguments.pop_front();
 
+	_tracePath.clear();
+	_traceFormat = "json";
+
 	// Check for help
 	if (_arguments.empty() || _arguments.front() == "-h" || _arguments.front() == "--help") {
 		print(getHelp());
@@ -76,8 +83,9 @@ int Tool::run(const std::deque<std::string> &args) {
 	}
 
 	// Read standard arguments
-	parseAudioArguments();
+	parseTraceArguments();
 	parseOutputArguments();
+	parseAudioArguments();
 	// Read tool specific arguments
 	parseExtraArguments();
 
@@ -202,7 +210,17 @@ void Tool::run() {
 		}
 	}
 
-	execute();
+	_trace.reset();
+	_trace.beginPhase(_name);
+	try {
+		execute();
+	} catch (...) {
+		_trace.endAllPhases();
+		writeTrace();
+		throw;
+	}
+	_trace.endAllPhases();
+	writeTrace();
 }
 
 InspectionMatch Tool::inspectInput(const Common::Filename &filename) {
@@ -272,6 +290,10 @@ int Tool::spawnSubprocess(const char *cmd) {
 	return _internalSubprocess(_subprocess_udata, cmd);
 }
 
+bool Tool::hasSubprocessFunction() const {
+	return _internalSubprocess != standardSpawnSubprocess;
+}
+
 void Tool::abort() {
 	// Set abort safe
 	// (Non-concurrent) writes are atomic on x86
@@ -342,19 +364,74 @@ void Tool::parseAudioArguments() {
 void Tool::setTempFileName() {
 }
 
+bool Tool::takeOption(const std::string &name, const std::string &alias, std::string &value) {
+	// The arguments which are not options are the input paths, at the end
+	size_t options = _arguments.size() - MIN(_arguments.size(), _inputPaths.size());
+	for (size_t i = 0; i < options; i++) {
+		if (_arguments[i] != name && _arguments[i] != alias)
+			continue;
+		if (i + 1 == _arguments.size())
+			throw ToolException("Could not parse arguments: Expected value after '" + _arguments[i] + "'.");
+
+		value = _arguments[i + 1];
+		_arguments.erase(_arguments.begin() + i, _arguments.begin() + i + 2);
+		return true;
+	}
+	return false;
+}
+
 void Tool::parseOutputArguments() {
-	if (_arguments.empty())
-		return;
-	if (_arguments.front() == "-o" || _arguments.front() == "--output") {
-		// It's an -o argument
+	// The output may be given anywhere before the input paths
+	std::string path;
+	if (takeOption("-o", "--output", path))
+		_outputPath = path;
+}
 
-		_arguments.pop_front();
-		if (_arguments.empty())
-			throw ToolException("Could not parse arguments: Expected path after '-o' or '--output'.");
+void Tool::parseTraceArguments() {
+	// The trace options may be given anywhere before the input paths
+	std::string value;
+	while (takeOption("--trace", "--trace", value))
+		_tracePath = value;
+	while (takeOption("--trace-format", "--trace-format", value)) {
+		_traceFormat = value;
+		if (_traceFormat != "json" && _traceFormat != "chrome")
+			throw ToolException("Could not parse arguments: Trace format must be 'json' or 'chrome'.");
+	}
+}
 
-		_outputPath = _arguments.front();
-		_arguments.pop_front();
+void Tool::writeTrace() {
+	if (_tracePath.empty())
+		return;
+
+	std::ofstream file(_tracePath.c_str());
+	if (!file) {
+		warning("Could not write trace to '%s'", _tracePath.c_str());
+		return;
 	}
+	if (_traceFormat == "chrome")
+		_trace.writeChromeTrace(file, _name);
+	else
+		_trace.writeJSON(file, _name);
+}
+
+void Tool::beginPhase(const char *name) {
+	_trace.beginPhase(name);
+}
+
+void Tool::endPhase() {
+	_trace.endPhase();
+}
+
+void Tool::addProcessedBytes(uint64 bytes) {
+	_trace.addBytes(bytes);
+}
+
+void Tool::addProcessedItems(uint64 items) {
+	_trace.addItems(items);
+}
+
+const ToolTrace &Tool::getTrace() const {
+	return _trace;
 }
 
 void Tool::parseExtraArguments() {
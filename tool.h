@@ -27,6 +27,7 @@
 #include <string>
 
 #include "common/file.h"
+#include "tool_trace.h"
 
 /**
  * Different types of tools, used to differentiate them when
@@ -96,6 +97,15 @@ public:
 	 */
 	virtual InspectionMatch inspectInput(const Common::Filename &filename);
 
+	/**
+	 * Checks a file name against a single input format, as used in the
+	 * expected inputs ("/" for a directory, "*.ext", "name.*" or "name.ext").
+	 *
+	 * @param filename The file to inspect
+	 * @param format The expected input format
+	 */
+	static InspectionMatch inspectInput(const Common::Filename &filename, const std::string& format);
+
 	/**
 	 * Check the given input path against the expected inputs that have not
 	 * yet been provided. If it finds a match the input is stored and the
@@ -176,6 +186,36 @@ public:
 	 */
 	void updateProgress(int done, int total = 100);
 
+	/**
+	 * Begins a named phase of the tool (e.g. "scan", "decode", "encode", "write"),
+	 * for the trace written with --trace. Phases can be nested.
+	 *
+	 * @param name Name of the phase
+	 */
+	void beginPhase(const char *name);
+
+	/**
+	 * Ends the phase started by the last call to beginPhase.
+	 */
+	void endPhase();
+
+	/**
+	 * Counts bytes processed in the current phases.
+	 *
+	 * @param bytes Number of bytes read or written
+	 */
+	void addProcessedBytes(uint64 bytes);
+
+	/**
+	 * Counts items (files, chunks, sounds...) completed in the current phases.
+	 *
+	 * @param items Number of items completed
+	 */
+	void addProcessedItems(uint64 items = 1);
+
+	/** Returns the trace of the last run of the tool. */
+	const ToolTrace &getTrace() const;
+
 	/**
 	 * Spawns a subprocess with the given commandline.
 	 * This acts exactly the same as 'system()', but hides the process window.
@@ -184,6 +224,12 @@ public:
 	 */
 	int spawnSubprocess(const char *cmd);
 
+	/**
+	 * Returns true if subprocesses are spawned by a function given to
+	 * setSubprocessFunction(), such as the one of the GUI.
+	 */
+	bool hasSubprocessFunction() const;
+
 	/**
 	 * This function sets the function which will be called needs to
 	 * output something.
@@ -217,8 +263,17 @@ protected:
 	virtual void parseAudioArguments();
 	virtual void setTempFileName();
 	void parseOutputArguments();
-	
-	InspectionMatch inspectInput(const Common::Filename &filename, const std::string& format);
+	/**
+	 * Removes an option and its value from the arguments preceding the input paths.
+	 *
+	 * @param name  Name of the option.
+	 * @param alias Other name of the option.
+	 * @param value Receives the value of the option.
+	 * @return True if the option was found.
+	 */
+	bool takeOption(const std::string &name, const std::string &alias, std::string &value);
+	void parseTraceArguments();
+	void writeTrace();
 
 	/** Parses the arguments only this tool takes. */
 	virtual void parseExtraArguments();
@@ -257,6 +312,13 @@ protected:
 	/** Status of internal abort flag, if set, next call to *Progress will throw. */
 	bool _abort;
 
+	/** Phases of the current run. */
+	ToolTrace _trace;
+	/** File to write the trace to when the run ends, if any. */
+	std::string _tracePath;
+	/** Format of the trace file, "json" or "chrome". */
+	std::string _traceFormat;
+
 private:
 	typedef void (*PrintFunction)(void *, const char *);
 	PrintFunction _internalPrint;
@@ -282,5 +344,17 @@ private:
 	friend class ToolGUI;
 };
 
+/**
+ * Begins a phase of a tool, and ends it when going out of scope.
+ */
+class ToolPhase {
+public:
+	ToolPhase(Tool &tool, const char *name) : _tool(tool) { _tool.beginPhase(name); }
+	~ToolPhase() { _tool.endPhase(); }
+
+private:
+	Tool &_tool;
+};
+
 #endif
 
@@ -0,0 +1,241 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <sstream>
+
+#include "tool_trace.h"
+
+ToolTrace::ToolTrace() {
+	reset();
+}
+
+void ToolTrace::reset() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_phases.clear();
+	_threads.clear();
+	_workerThreads = 0;
+	_mainThread = std::this_thread::get_id();
+	_origin = std::chrono::steady_clock::now();
+}
+
+double ToolTrace::now() const {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - _origin).count();
+}
+
+ToolTrace::Thread &ToolTrace::currentThread() {
+	std::thread::id id = std::this_thread::get_id();
+	std::map<std::thread::id, Thread>::iterator it = _threads.find(id);
+	if (it == _threads.end()) {
+		Thread thread;
+		thread.index = (id == _mainThread) ? 0 : ++_workerThreads;
+		it = _threads.insert(std::make_pair(id, thread)).first;
+	}
+	return it->second;
+}
+
+void ToolTrace::beginPhase(const std::string &name) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	Thread &thread = currentThread();
+	if (!thread.open.empty() && _phases[thread.open.back()].name == name) {
+		// Re-entering the current phase
+		thread.open.push_back(thread.open.back());
+		thread.cpuStart.push_back(thread.cpuStart.back());
+		return;
+	}
+
+	int depth = thread.open.size();
+	if (thread.index != 0 && _threads.count(_mainThread))
+		depth += _threads[_mainThread].open.size();
+
+	TracePhase phase;
+	phase.name = name;
+	phase.depth = depth;
+	phase.thread = thread.index;
+	phase.start = now();
+	phase.wallTime = 0;
+	phase.cpuTime = 0;
+	phase.bytes = 0;
+	phase.items = 0;
+	thread.open.push_back(_phases.size());
+	thread.cpuStart.push_back(std::clock());
+	_phases.push_back(phase);
+}
+
+void ToolTrace::endPhase() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	endPhase(currentThread());
+}
+
+void ToolTrace::endPhase(Thread &thread) {
+	if (thread.open.empty())
+		return;
+
+	size_t index = thread.open.back();
+	std::clock_t cpuStart = thread.cpuStart.back();
+	thread.open.pop_back();
+	thread.cpuStart.pop_back();
+	if (!thread.open.empty() && thread.open.back() == index)
+		return;
+
+	TracePhase &phase = _phases[index];
+	phase.wallTime = now() - phase.start;
+	phase.cpuTime = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+}
+
+void ToolTrace::endAllPhases() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (std::map<std::thread::id, Thread>::iterator it = _threads.begin(); it != _threads.end(); ++it)
+		while (!it->second.open.empty())
+			endPhase(it->second);
+}
+
+void ToolTrace::countIn(const Thread &thread, std::vector<TracePhase> &phases, uint64 bytes, uint64 items) {
+	for (size_t i = 0; i < thread.open.size(); i++) {
+		if (i == 0 || thread.open[i] != thread.open[i - 1]) {
+			phases[thread.open[i]].bytes += bytes;
+			phases[thread.open[i]].items += items;
+		}
+	}
+}
+
+void ToolTrace::addBytes(uint64 bytes) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	Thread &thread = currentThread();
+	countIn(thread, _phases, bytes, 0);
+	// The open phases of the main thread enclose those of the other threads
+	if (thread.index != 0 && _threads.count(_mainThread))
+		countIn(_threads[_mainThread], _phases, bytes, 0);
+}
+
+void ToolTrace::addItems(uint64 items) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	Thread &thread = currentThread();
+	countIn(thread, _phases, 0, items);
+	if (thread.index != 0 && _threads.count(_mainThread))
+		countIn(_threads[_mainThread], _phases, 0, items);
+}
+
+const std::vector<TracePhase> &ToolTrace::getPhases() const {
+	return _phases;
+}
+
+std::vector<ToolTrace::Totals> ToolTrace::getTotals() const {
+	std::vector<Totals> totals;
+	for (std::vector<TracePhase>::const_iterator phase = _phases.begin(); phase != _phases.end(); ++phase) {
+		std::vector<Totals>::iterator total = totals.begin();
+		while (total != totals.end() && total->name != phase->name)
+			++total;
+		if (total == totals.end()) {
+			Totals t = { phase->name, 0, 0, 0, 0, 0 };
+			totals.push_back(t);
+			total = totals.end() - 1;
+		}
+		total->count++;
+		total->wallTime += phase->wallTime;
+		total->cpuTime += phase->cpuTime;
+		total->bytes += phase->bytes;
+		total->items += phase->items;
+	}
+	return totals;
+}
+
+void ToolTrace::writeJSON(std::ostream &output, const std::string &tool) const {
+	std::vector<Totals> totals = getTotals();
+
+	output << "{\n\t\"tool\": " << jsonString(tool) << ",\n\t\"totals\": [";
+	for (std::vector<Totals>::const_iterator total = totals.begin(); total != totals.end(); ++total) {
+		output << (total == totals.begin() ? "\n" : ",\n");
+		output << "\t\t{\"name\": " << jsonString(total->name) << ", \"count\": " << total->count
+		       << ", \"wall_seconds\": " << total->wallTime << ", \"cpu_seconds\": " << total->cpuTime
+		       << ", \"bytes\": " << total->bytes << ", \"items\": " << total->items << "}";
+	}
+	output << "\n\t],\n\t\"phases\": [";
+	for (std::vector<TracePhase>::const_iterator phase = _phases.begin(); phase != _phases.end(); ++phase) {
+		output << (phase == _phases.begin() ? "\n" : ",\n");
+		output << "\t\t{\"name\": " << jsonString(phase->name) << ", \"depth\": " << phase->depth
+		       << ", \"thread\": " << phase->thread << ", \"start\": " << phase->start << ", \"wall_seconds\": " << phase->wallTime
+		       << ", \"cpu_seconds\": " << phase->cpuTime << ", \"bytes\": " << phase->bytes
+		       << ", \"items\": " << phase->items << "}";
+	}
+	output << "\n\t]\n}" << std::endl;
+}
+
+void ToolTrace::writeChromeTrace(std::ostream &output, const std::string &tool) const {
+	// Complete ("X") events, with timestamps and durations in microseconds
+	output << "{\"traceEvents\": [\n";
+	output << "\t{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": " << jsonString(tool) << "}}";
+	for (std::vector<TracePhase>::const_iterator phase = _phases.begin(); phase != _phases.end(); ++phase) {
+		output << ",\n\t{\"name\": " << jsonString(phase->name) << ", \"cat\": " << jsonString(tool)
+		       << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << phase->thread + 1 << ", \"ts\": " << (uint64)(phase->start * 1000000)
+		       << ", \"dur\": " << (uint64)(phase->wallTime * 1000000)
+		       << ", \"args\": {\"cpu_ms\": " << phase->cpuTime * 1000 << ", \"bytes\": " << phase->bytes
+		       << ", \"items\": " << phase->items << "}}";
+	}
+	output << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+}
+
+std::string ToolTrace::getSummary() const {
+	std::vector<Totals> totals = getTotals();
+	std::ostringstream os;
+	char line[256];
+
+	snprintf(line, sizeof(line), "%-16s %8s %10s %10s %14s %10s\n", "Phase", "Count", "Wall (s)", "CPU (s)", "Bytes", "Items");
+	os << line;
+	for (std::vector<Totals>::const_iterator total = totals.begin(); total != totals.end(); ++total) {
+		snprintf(line, sizeof(line), "%-16s %8llu %10.3f %10.3f %14llu %10llu\n", total->name.c_str(),
+		         (unsigned long long)total->count, total->wallTime, total->cpuTime,
+		         (unsigned long long)total->bytes, (unsigned long long)total->items);
+		os << line;
+	}
+	return os.str();
+}
+
+std::string jsonString(const std::string &str) {
+	std::ostringstream os;
+	os << '"';
+	for (std::string::const_iterator c = str.begin(); c != str.end(); ++c) {
+		switch (*c) {
+		case '"':
+			os << "\\\"";
+			break;
+		case '\\':
+			os << "\\\\";
+			break;
+		case '\n':
+			os << "\\n";
+			break;
+		case '\t':
+			os << "\\t";
+			break;
+		default:
+			if ((unsigned char)*c < 0x20) {
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", *c);
+				os << buf;
+			} else {
+				os << *c;
+			}
+		}
+	}
+	os << '"';
+	return os.str();
+}
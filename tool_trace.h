@@ -0,0 +1,160 @@
+/* ScummVM Tools
+ *
+ * ScummVM Tools is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TOOL_TRACE_H
+#define TOOL_TRACE_H
+
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/scummsys.h"
+
+/**
+ * A phase of a tool run, such as "scan", "decode", "encode" or "write".
+ */
+struct TracePhase {
+	/** Name of the phase. */
+	std::string name;
+	/** Number of enclosing phases. */
+	int depth;
+	/** Index of the thread which ran the phase, 0 for the thread which started the trace. */
+	int thread;
+	/** Wall clock time at which the phase started, in seconds since the start of the trace. */
+	double start;
+	/** Wall clock time spent in the phase, in seconds. */
+	double wallTime;
+	/** CPU time used by the process during the phase, in seconds. */
+	double cpuTime;
+	/** Number of bytes processed during the phase. */
+	uint64 bytes;
+	/** Number of items (files, samples, chunks...) completed during the phase. */
+	uint64 items;
+};
+
+/**
+ * Records the phases of a tool run, so that one can see where the time is spent.
+ *
+ * Phases can be nested; the bytes and items processed are counted in all the
+ * open phases. Beginning a phase with the same name as the innermost open one
+ * does not create a new phase, so that helpers opening a phase can call each other.
+ *
+ * Phases may be recorded from several threads at once. Each thread has its own
+ * open phases, nested in those of the thread which started the trace.
+ */
+class ToolTrace {
+public:
+	ToolTrace();
+
+	/** Forgets all the recorded phases and restarts the clock. */
+	void reset();
+
+	/**
+	 * Begins a new phase, nested in the current one.
+	 *
+	 * @param name Name of the phase.
+	 */
+	void beginPhase(const std::string &name);
+
+	/** Ends the innermost open phase. */
+	void endPhase();
+
+	/** Ends all the open phases, e.g. after an error. */
+	void endAllPhases();
+
+	/** Counts processed bytes in the open phases. */
+	void addBytes(uint64 bytes);
+
+	/** Counts completed items in the open phases. */
+	void addItems(uint64 items);
+
+	/**
+	 * Returns the recorded phases, in the order in which they started.
+	 * Must not be called while other threads record phases.
+	 */
+	const std::vector<TracePhase> &getPhases() const;
+
+	/**
+	 * Writes the phases as JSON, with totals per phase name.
+	 *
+	 * @param output The stream to write to.
+	 * @param tool   Name of the traced tool.
+	 */
+	void writeJSON(std::ostream &output, const std::string &tool) const;
+
+	/**
+	 * Writes the phases in the Chrome trace event format, which can be loaded
+	 * in chrome://tracing or Perfetto.
+	 *
+	 * @param output The stream to write to.
+	 * @param tool   Name of the traced tool.
+	 */
+	void writeChromeTrace(std::ostream &output, const std::string &tool) const;
+
+	/** Returns a human readable table of the totals per phase name. */
+	std::string getSummary() const;
+
+private:
+	struct Totals {
+		std::string name;
+		uint64 count;
+		double wallTime;
+		double cpuTime;
+		uint64 bytes;
+		uint64 items;
+	};
+	std::vector<Totals> getTotals() const;
+
+	/** The open phases of a thread. */
+	struct Thread {
+		/** Index of the thread, in the order in which threads began their first phase. */
+		int index;
+		/** Indices of the open phases, innermost last. */
+		std::vector<size_t> open;
+		/** CPU clock at the start of each entry of open. */
+		std::vector<std::clock_t> cpuStart;
+	};
+
+	double now() const;
+	Thread &currentThread();
+	void endPhase(Thread &thread);
+	static void countIn(const Thread &thread, std::vector<TracePhase> &phases, uint64 bytes, uint64 items);
+
+	std::vector<TracePhase> _phases;
+	std::map<std::thread::id, Thread> _threads;
+	/** The thread which started the trace, whose open phases enclose those of the others. */
+	std::thread::id _mainThread;
+	int _workerThreads;
+	std::chrono::steady_clock::time_point _origin;
+	std::mutex _mutex;
+};
+
+/**
+ * Escapes a string and encloses it in double quotes, for use in JSON output.
+ */
+std::string jsonString(const std::string &str);
+
+#endif
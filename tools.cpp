@@ -23,6 +23,7 @@
 
 #include "tools.h"
 #include "tool.h"
+#include "common/util.h"
 
 #include "engines/agos/compress_agos.h"
 #include "engines/asylum/extract_asylum.h"
@@ -67,49 +68,137 @@
 #include "engines/scumm/extract_scumm_mac.h"
 #include "engines/scumm/extract_zak_c64.h"
 
-Tools::Tools() {
-
-	_tools.push_back(new CompressAgos());
-	_tools.push_back(new CompressGob());
-	_tools.push_back(new CompressKyra());
-	_tools.push_back(new CompressQueen());
-	_tools.push_back(new CompressSaga());
-	_tools.push_back(new CompressSci());
-	_tools.push_back(new CompressScummSan());
-	_tools.push_back(new CompressScummSou());
-	_tools.push_back(new CompressSword1());
-	_tools.push_back(new CompressSword2());
-	_tools.push_back(new CompressTinsel());
-	_tools.push_back(new CompressTony());
-	_tools.push_back(new CompressTonyVDB());
-	_tools.push_back(new CompressTouche());
-	_tools.push_back(new CompressTucker());
+#include <algorithm>
+#include <assert.h>
+#include <map>
+
+namespace {
+
+template<class T>
+Tool *createTool() {
+	return new T();
+}
+
+/** All available tools, in the order in which they are listed and inspected. */
+const ToolDescriptor toolRegistry[] = {
+	{ "compress_agos",          TOOLTYPE_COMPRESSION, "*.*",       NULL,                              false, &createTool<CompressAgos> },
+	{ "compress_gob",           TOOLTYPE_COMPRESSION, "*.gob",     NULL,                              false, &createTool<CompressGob> },
+	{ "compress_kyra",          TOOLTYPE_COMPRESSION, "*.*",       &CompressKyra::inspectFilename,    false, &createTool<CompressKyra> },
+	{ "compress_queen",         TOOLTYPE_COMPRESSION, "queen.1",   NULL,                              false, &createTool<CompressQueen> },
+	// Saga detects its input from the MD5 sum of the file
+	{ "compress_saga",          TOOLTYPE_COMPRESSION, "*.*",       NULL,                              true,  &createTool<CompressSaga> },
+	{ "compress_sci",           TOOLTYPE_COMPRESSION, "resource.*", NULL,                             false, &createTool<CompressSci> },
+	{ "compress_scumm_san",     TOOLTYPE_COMPRESSION, "*.san",     NULL,                              false, &createTool<CompressScummSan> },
+	{ "compress_scumm_sou",     TOOLTYPE_COMPRESSION, "*.sou",     NULL,                              false, &createTool<CompressScummSou> },
+	{ "compress_sword1",        TOOLTYPE_COMPRESSION, "*.*",       &CompressSword1::inspectFilename,  false, &createTool<CompressSword1> },
+	{ "compress_sword2",        TOOLTYPE_COMPRESSION, "*.clu",     NULL,                              false, &createTool<CompressSword2> },
+	{ "compress_tinsel",        TOOLTYPE_COMPRESSION, "*.smp;*.idx", NULL,                            false, &createTool<CompressTinsel> },
+	{ "compress_tony",          TOOLTYPE_COMPRESSION, "*.adp",     NULL,                              false, &createTool<CompressTony> },
+	{ "compress_tony_vdb",      TOOLTYPE_COMPRESSION, "*.vdb",     NULL,                              false, &createTool<CompressTonyVDB> },
+	{ "compress_touche",        TOOLTYPE_COMPRESSION, "/",         &CompressTouche::inspectFilename,  false, &createTool<CompressTouche> },
+	{ "compress_tucker",        TOOLTYPE_COMPRESSION, "/",         NULL,                              false, &createTool<CompressTucker> },
 
 #ifdef USE_PNG
-	_tools.push_back(new EncodeDXA());
+	{ "encode_dxa",             TOOLTYPE_COMPRESSION, "*.*",       NULL,                              false, &createTool<EncodeDXA> },
 #endif
 
-	_tools.push_back(new ExtractAgos());
-	_tools.push_back(new ExtractAsylum());
-	_tools.push_back(new PackBladeRunner());
-	_tools.push_back(new ExtractCge());
-	_tools.push_back(new PackCge());
-	_tools.push_back(new ExtractCine());
-	_tools.push_back(new ExtractCruisePC());
-	_tools.push_back(new ExtractCryo());
-	_tools.push_back(new ExtractGobStk());
-	_tools.push_back(new ExtractFascinationCD());
-	_tools.push_back(new ExtractHDB());
-	_tools.push_back(new ExtractKyra());
-	_tools.push_back(new ExtractPrince());
-	_tools.push_back(new PackPrince());
-	_tools.push_back(new ExtractLoomTG16());
-	_tools.push_back(new ExtractMMApple());
-	_tools.push_back(new ExtractMMC64());
-	_tools.push_back(new ExtractMMNes());
-	_tools.push_back(new ExtractParallaction());
-	_tools.push_back(new ExtractScummMac());
-	_tools.push_back(new ExtractZakC64());
+	{ "extract_agos",           TOOLTYPE_EXTRACTION,  "*.*",       NULL,                              false, &createTool<ExtractAgos> },
+	{ "extract_asylum",         TOOLTYPE_EXTRACTION,  "*.*",       &ExtractAsylum::inspectFilename,   false, &createTool<ExtractAsylum> },
+	{ "pack_bladerunner",       TOOLTYPE_EXTRACTION,  "*.DAT",     NULL,                              false, &createTool<PackBladeRunner> },
+	{ "extract_cge",            TOOLTYPE_EXTRACTION,  "vol.*",     &ExtractCge::inspectFilename,      false, &createTool<ExtractCge> },
+	{ "pack_cge",               TOOLTYPE_EXTRACTION,  "/",         &PackCge::inspectFilename,         false, &createTool<PackCge> },
+	{ "extract_cine",           TOOLTYPE_EXTRACTION,  "*.*",       NULL,                              false, &createTool<ExtractCine> },
+	{ "extract_cruise_pc",      TOOLTYPE_EXTRACTION,  "*.*",       NULL,                              false, &createTool<ExtractCruisePC> },
+	{ "extract_cryo",           TOOLTYPE_EXTRACTION,  "*.*",       &ExtractCryo::inspectFilename,     false, &createTool<ExtractCryo> },
+	{ "extract_gob_stk",        TOOLTYPE_EXTRACTION,  "*.*",       &ExtractGobStk::inspectFilename,   false, &createTool<ExtractGobStk> },
+	{ "extract_fascination_cd", TOOLTYPE_EXTRACTION,  "*.iso",     NULL,                              false, &createTool<ExtractFascinationCD> },
+	{ "extract_hdb",            TOOLTYPE_EXTRACTION,  "*.*",       &ExtractHDB::inspectFilename,      false, &createTool<ExtractHDB> },
+	{ "extract_kyra",           TOOLTYPE_EXTRACTION,  "*.*",       NULL,                              false, &createTool<ExtractKyra> },
+	{ "extract_prince",         TOOLTYPE_EXTRACTION,  "/",         &ExtractPrince::inspectFilename,   false, &createTool<ExtractPrince> },
+	{ "pack_prince",            TOOLTYPE_EXTRACTION,  "/",         &PackPrince::inspectFilename,      false, &createTool<PackPrince> },
+	{ "extract_loom_tg16",      TOOLTYPE_EXTRACTION,  "*.iso",     NULL,                              false, &createTool<ExtractLoomTG16> },
+	{ "extract_mm_apple",       TOOLTYPE_EXTRACTION,  "*.dsk",     NULL,                              false, &createTool<ExtractMMApple> },
+	{ "extract_mm_c64",         TOOLTYPE_EXTRACTION,  "*.d64",     NULL,                              false, &createTool<ExtractMMC64> },
+	{ "extract_mm_nes",         TOOLTYPE_EXTRACTION,  "*.prg",     NULL,                              false, &createTool<ExtractMMNes> },
+	{ "extract_parallaction",   TOOLTYPE_EXTRACTION,  "*.*",       NULL,                              false, &createTool<ExtractParallaction> },
+	{ "extract_scumm_mac",      TOOLTYPE_EXTRACTION,  "*.*",       &ExtractScummMac::inspectFilename, false, &createTool<ExtractScummMac> },
+	{ "extract_zak_c64",        TOOLTYPE_EXTRACTION,  "*.d64",     NULL,                              false, &createTool<ExtractZakC64> }
+};
+
+const size_t kToolCount = ARRAYSIZE(toolRegistry);
+
+typedef std::vector<size_t> IndexList;
+
+/**
+ * Precomputed dispatch table, so that inspecting an input only looks at
+ * the tools that may accept it.
+ */
+struct DetectionTable {
+	std::map<std::string, IndexList> extensions; ///< Tools expecting "*.ext", indexed by lower case extension.
+	IndexList anyFile;   ///< Tools accepting any file ("*.*").
+	IndexList directory; ///< Tools accepting any directory ("/").
+	IndexList named;     ///< Tools expecting a file name ("name.*" or "name.ext").
+	IndexList custom;    ///< Tools with their own inspection function, or that must be probed.
+
+	DetectionTable() {
+		for (size_t i = 0; i < kToolCount; i++) {
+			const ToolDescriptor &desc = toolRegistry[i];
+			if (desc.inspect || desc.probe) {
+				custom.push_back(i);
+				continue;
+			}
+			std::string inputs = desc.inputs;
+			for (size_t pos = 0; pos != std::string::npos; ) {
+				size_t end = inputs.find(';', pos);
+				std::string format = inputs.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+				pos = (end == std::string::npos) ? end : end + 1;
+
+				Common::Filename cmp(format);
+				if (format == "/") {
+					directory.push_back(i);
+				} else if (cmp.getName() != "*") {
+					named.push_back(i);
+				} else if (cmp.getExtension() == "*") {
+					anyFile.push_back(i);
+				} else {
+					std::string ext = cmp.getExtension();
+					std::transform(ext.begin(), ext.end(), ext.begin(), tolower);
+					extensions[ext].push_back(i);
+				}
+			}
+		}
+	}
+};
+
+const DetectionTable &getDetectionTable() {
+	static const DetectionTable table;
+	return table;
+}
+
+/** Checks the given file name against all the formats in a ';' separated list. */
+InspectionMatch inspectFormats(const Common::Filename &filename, const std::string &inputs) {
+	InspectionMatch bestMatch = IMATCH_AWFUL;
+	for (size_t pos = 0; pos != std::string::npos; ) {
+		size_t end = inputs.find(';', pos);
+		InspectionMatch match = Tool::inspectInput(filename, inputs.substr(pos, end == std::string::npos ? std::string::npos : end - pos));
+		if (match == IMATCH_PERFECT)
+			return IMATCH_PERFECT;
+		else if (match == IMATCH_POSSIBLE)
+			bestMatch = match;
+		pos = (end == std::string::npos) ? end : end + 1;
+	}
+	return bestMatch;
+}
+
+/** Replaces the current match with the given one, if it is a better one. */
+void improveMatch(InspectionMatch *current, InspectionMatch match) {
+	if (match == IMATCH_PERFECT || (match == IMATCH_POSSIBLE && *current == IMATCH_AWFUL))
+		*current = match;
+}
+
+} // End of anonymous namespace
+
+Tools::Tools() : _tools(kToolCount, (Tool *)NULL), _printFunction(NULL), _printUdata(NULL) {
 }
 
 Tools::~Tools() {
@@ -117,33 +206,85 @@ Tools::~Tools() {
 		delete *iter;
 }
 
+size_t Tools::getToolCount() const {
+	return kToolCount;
+}
+
+Tool *Tools::getTool(size_t index) const {
+	assert(index < kToolCount);
+	if (!_tools[index]) {
+		_tools[index] = toolRegistry[index].create();
+		assert(_tools[index]->getName() == toolRegistry[index].name);
+		if (_printFunction)
+			_tools[index]->setPrintFunction(_printFunction, _printUdata);
+	}
+	return _tools[index];
+}
+
+Tool *Tools::getTool(const std::string &name) const {
+	for (size_t i = 0; i < kToolCount; i++)
+		if (name == toolRegistry[i].name)
+			return getTool(i);
+	return NULL;
+}
+
+void Tools::setPrintFunction(void f(void *, const char *), void *udata) {
+	_printFunction = f;
+	_printUdata = udata;
+	for (ToolList::iterator iter = _tools.begin(); iter != _tools.end(); ++iter)
+		if (*iter)
+			(*iter)->setPrintFunction(f, udata);
+}
+
 Tools::ToolList Tools::inspectInput(const Common::Filename &filename, ToolType type, bool check_directory) const {
-	ToolList perfect_choices;
-	ToolList good_choices;
-	ToolList awful_choices;
+	const DetectionTable &table = getDetectionTable();
+	std::vector<InspectionMatch> matches(kToolCount, IMATCH_AWFUL);
 
 	Common::Filename dirname;
 	if (check_directory && !filename.directory())
 		dirname = filename.getPath();
 
-	for (ToolList::const_iterator tool = _tools.begin(); tool != _tools.end(); ++tool) {
-		if (type == TOOLTYPE_ALL || (*tool)->getType() == type) {
-			InspectionMatch fm = (*tool)->inspectInput(filename);
-			InspectionMatch dm = dirname.empty() ? IMATCH_AWFUL : (*tool)->inspectInput(dirname);
-
-			if (fm == IMATCH_PERFECT || dm == IMATCH_PERFECT)
-				perfect_choices.push_back(*tool);
-			else if (fm == IMATCH_POSSIBLE || dm == IMATCH_POSSIBLE)
-				good_choices.push_back(*tool);
-			else
-				awful_choices.push_back(*tool);
+	for (int pass = 0; pass < 2; pass++) {
+		const Common::Filename &input = (pass == 0) ? filename : dirname;
+		if (pass == 1 && dirname.empty())
+			break;
+
+		if (input.directory()) {
+			for (IndexList::const_iterator i = table.directory.begin(); i != table.directory.end(); ++i)
+				improveMatch(&matches[*i], IMATCH_POSSIBLE);
+		} else {
+			std::string ext = input.getExtension();
+			std::transform(ext.begin(), ext.end(), ext.begin(), tolower);
+			std::map<std::string, IndexList>::const_iterator byExt = table.extensions.find(ext);
+			if (byExt != table.extensions.end())
+				for (IndexList::const_iterator i = byExt->second.begin(); i != byExt->second.end(); ++i)
+					improveMatch(&matches[*i], IMATCH_PERFECT);
+			for (IndexList::const_iterator i = table.anyFile.begin(); i != table.anyFile.end(); ++i)
+				improveMatch(&matches[*i], IMATCH_POSSIBLE);
+			for (IndexList::const_iterator i = table.named.begin(); i != table.named.end(); ++i)
+				improveMatch(&matches[*i], inspectFormats(input, toolRegistry[*i].inputs));
+		}
+
+		for (IndexList::const_iterator i = table.custom.begin(); i != table.custom.end(); ++i) {
+			const ToolDescriptor &desc = toolRegistry[*i];
+			if (type != TOOLTYPE_ALL && desc.type != type)
+				continue;
+			if (desc.inspect)
+				improveMatch(&matches[*i], desc.inspect(input));
+			else if (inspectFormats(input, desc.inputs) != IMATCH_AWFUL)
+				improveMatch(&matches[*i], getTool(*i)->inspectInput(input));
 		}
 	}
 
-	if (perfect_choices.size() > 0)
-		return perfect_choices;
-	if (good_choices.size() > 0)
-		return good_choices;
+	// Return the best matching tools. If none matched, this returns all the tools of the given type.
+	InspectionMatch bestMatch = IMATCH_AWFUL;
+	for (size_t i = 0; i < kToolCount && bestMatch != IMATCH_PERFECT; i++)
+		if (type == TOOLTYPE_ALL || toolRegistry[i].type == type)
+			improveMatch(&bestMatch, matches[i]);
 
-	return awful_choices;
+	ToolList choices;
+	for (size_t i = 0; i < kToolCount; i++)
+		if ((type == TOOLTYPE_ALL || toolRegistry[i].type == type) && matches[i] == bestMatch)
+			choices.push_back(getTool(i));
+	return choices;
 }
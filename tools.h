@@ -24,10 +24,37 @@
 
 #include "tool.h"
 
+/**
+ * Lightweight description of a tool, so that tools can be listed and matched
+ * against an input without being instantiated.
+ */
+struct ToolDescriptor {
+	/** Name of the tool, as returned by Tool::getName(). */
+	const char *name;
+	/** Type of the tool. */
+	ToolType type;
+	/** Input formats expected by the tool, separated by ';' ("/" for a directory). */
+	const char *inputs;
+	/**
+	 * Replacement for Tool::inspectInput that does not need an instance of the tool,
+	 * or NULL if the tool only checks the input against its formats.
+	 */
+	InspectionMatch (*inspect)(const Common::Filename &filename);
+	/**
+	 * If true, the tool has to be instantiated to inspect an input. This is only done
+	 * for inputs matching one of the formats.
+	 */
+	bool probe;
+	/** Creates a new instance of the tool. */
+	Tool *(*create)();
+};
+
 /**
  * This class holds a list of all the tools available
  * Used by both the GUI and CLI as a base class to get ahold
  * of all the tools.
+ *
+ * Tools are only instantiated when they are first needed.
  */
 class Tools {
 public:
@@ -39,12 +66,32 @@ public:
 	/**
 	 * Returns a list of the tools that supports opening the input file
 	 * specified in the input list.
+	 * Only the tools that may accept the input are instantiated, unless none
+	 * of them does, in which case all the tools of the given type are returned.
 	 */
 	ToolList inspectInput(const Common::Filename &filename, ToolType type = TOOLTYPE_ALL, bool check_directory = false) const;
 
-protected:
-	/** List of all tools */
-	ToolList _tools;
+	/** Returns the number of available tools. */
+	size_t getToolCount() const;
+
+	/** Returns the tool at the given index, instantiating it if needed. */
+	Tool *getTool(size_t index) const;
+
+	/** Returns the tool with the given name, or NULL if there is no such tool. */
+	Tool *getTool(const std::string &name) const;
+
+	/**
+	 * Sets the print function of the tools created so far, and of the tools
+	 * created from now on.
+	 */
+	void setPrintFunction(void f(void *, const char *), void *udata);
+
+private:
+	/** Instantiated tools, indexed like the tool registry (NULL if not created yet). */
+	mutable ToolList _tools;
+
+	void (*_printFunction)(void *, const char *);
+	void *_printUdata;
 };
 
 #endif